@@ -0,0 +1,340 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "coze.h"
+
+// Allocation budget check: serves canned responses through a fake transport, drives every endpoint and stream
+// type with allocation counting enabled (SDK and cJSON), and fails when a call leaks after its coze_free_*
+// or exceeds its allocation budget. Streams are additionally bounded per delta by running N and 2N deltas.
+//
+// Budgets are upper bounds on allocations per call (including cJSON); tighten them as hot paths get cheaper.
+// 预算为单次调用的分配次数上限 (含 cJSON), 热路径优化后应同步收紧。
+
+#define STREAM_DELTAS 16
+#define CHAT_STREAM_PER_DELTA_BUDGET 10
+#define WORKFLOW_STREAM_PER_DELTA_BUDGET 20
+
+static const char *MESSAGE_JSON =
+        "{\"id\":\"7400000000000000001\",\"conversation_id\":\"7400000000000000002\","
+        "\"bot_id\":\"7400000000000000003\",\"chat_id\":\"7400000000000000004\",\"role\":\"assistant\","
+        "\"type\":\"answer\",\"content\":\"hello \\\"world\\\"\",\"content_type\":\"text\","
+        "\"created_at\":1700000000,\"updated_at\":1700000001}";
+
+static const char *CHAT_JSON =
+        "{\"id\":\"7400000000000000004\",\"conversation_id\":\"7400000000000000002\","
+        "\"bot_id\":\"7400000000000000003\",\"status\":\"in_progress\",\"created_at\":1700000000}";
+
+static struct {
+    int stream_deltas; // 流式响应中 delta 事件的数量
+    int failures;
+} g_check = {.stream_deltas = STREAM_DELTAS};
+
+static void sink_string(coze_transport_sink_t *sink, const char *data) {
+    coze_transport_sink_body(sink, data, strlen(data));
+}
+
+static void sink_header(coze_transport_sink_t *sink, const char *line) {
+    coze_transport_sink_header(sink, line, strlen(line));
+}
+
+static void sink_json(coze_transport_sink_t *sink, const char *data_json) {
+    sink_string(sink, "{\"code\":0,\"msg\":\"\",\"data\":");
+    sink_string(sink, data_json);
+    sink_string(sink, "}");
+}
+
+static void sink_list(coze_transport_sink_t *sink, const char *prefix, const char *item, int count,
+                      const char *suffix) {
+    sink_string(sink, prefix);
+    for (int i = 0; i < count; i++) {
+        if (i > 0) {
+            sink_string(sink, ",");
+        }
+        sink_string(sink, item);
+    }
+    sink_string(sink, suffix);
+}
+
+static void sink_event(coze_transport_sink_t *sink, const char *event, const char *data) {
+    sink_string(sink, "event:");
+    sink_string(sink, event);
+    sink_string(sink, "\ndata:");
+    sink_string(sink, data);
+    sink_string(sink, "\n\n");
+}
+
+static void serve_chat_stream(coze_transport_sink_t *sink) {
+    sink_event(sink, COZE_EVENT_TYPE_CONVERSATION_CHAT_CREATED, CHAT_JSON);
+    sink_event(sink, COZE_EVENT_TYPE_CONVERSATION_CHAT_IN_PROGRESS, CHAT_JSON);
+    for (int i = 0; i < g_check.stream_deltas; i++) {
+        sink_event(sink, COZE_EVENT_TYPE_CONVERSATION_MESSAGE_DELTA, MESSAGE_JSON);
+    }
+    sink_event(sink, COZE_EVENT_TYPE_CONVERSATION_MESSAGE_COMPLETED, MESSAGE_JSON);
+    sink_event(sink, COZE_EVENT_TYPE_CONVERSATION_CHAT_COMPLETED, CHAT_JSON);
+    sink_event(sink, COZE_EVENT_TYPE_DONE, "\"[DONE]\"");
+}
+
+static void serve_workflow_stream(coze_transport_sink_t *sink) {
+    for (int i = 0; i < g_check.stream_deltas; i++) {
+        sink_event(sink, COZE_WORKFLOW_EVENT_TYPE_MESSAGE,
+                   "{\"content\":\"token\",\"node_title\":\"End\",\"node_seq_id\":\"0\",\"node_is_finish\":false}");
+    }
+    sink_event(sink, COZE_WORKFLOW_EVENT_TYPE_DONE, "{}");
+}
+
+static bool has_prefix(const char *str, const char *prefix) {
+    return strncmp(str, prefix, strlen(prefix)) == 0;
+}
+
+static coze_error_t fake_transport(const coze_transport_request_t *req, coze_transport_sink_t *sink, void *ctx) {
+    (void) ctx;
+    const char *path = req->path;
+
+    sink_header(sink, "HTTP/1.1 200 OK");
+    sink_header(sink, "x-tt-logid: 20241210000000000000000000000000");
+
+    if (req->stream && has_prefix(path, "/v3/chat")) {
+        serve_chat_stream(sink);
+    } else if (req->stream) {
+        serve_workflow_stream(sink);
+    } else if (has_prefix(path, "/api/permission/oauth2/token")) {
+        sink_string(sink, "{\"access_token\":\"czs_access\",\"refresh_token\":\"czs_refresh\","
+                    "\"expires_in\":1700000000,\"token_type\":\"Bearer\"}");
+    } else if (has_prefix(path, "/v1/workspaces")) {
+        sink_list(sink, "{\"code\":0,\"msg\":\"\",\"data\":{\"total_count\":20,\"workspaces\":[",
+                  "{\"id\":\"7400000000000000005\",\"name\":\"Personal\",\"icon_url\":\"https://example.com/icon.png\","
+                  "\"role_type\":\"owner\",\"workspace_type\":\"personal\"}", 20, "]}}");
+    } else if (has_prefix(path, "/v1/space/published_bots_list")) {
+        sink_list(sink, "{\"code\":0,\"msg\":\"\",\"data\":{\"total\":20,\"space_bots\":[",
+                  "{\"bot_id\":\"7400000000000000003\",\"bot_name\":\"bot\",\"description\":\"description\","
+                  "\"icon_url\":\"https://example.com/icon.png\",\"publish_time\":\"1700000000\"}", 20, "]}}");
+    } else if (has_prefix(path, "/v1/bot/get_online_info")) {
+        sink_json(sink, "{\"bot_id\":\"7400000000000000003\",\"name\":\"bot\",\"description\":\"description\","
+                  "\"icon_url\":\"https://example.com/icon.png\",\"create_time\":1700000000,"
+                  "\"update_time\":1700000001,\"version\":\"1\"}");
+    } else if (has_prefix(path, "/v1/bot/")) {
+        sink_json(sink, "{\"bot_id\":\"7400000000000000003\",\"version\":\"1\"}");
+    } else if (has_prefix(path, "/v1/conversation/message/list")) {
+        sink_list(sink, "{\"code\":0,\"msg\":\"\",\"data\":[", MESSAGE_JSON, 50,
+                  "],\"first_id\":\"7400000000000000001\",\"last_id\":\"7400000000000000050\",\"has_more\":true}");
+    } else if (has_prefix(path, "/v1/conversation/message/")) {
+        sink_json(sink, MESSAGE_JSON);
+    } else if (has_prefix(path, "/v1/conversation/")) {
+        sink_json(sink, "{\"id\":\"7400000000000000002\",\"created_at\":1700000000,"
+                  "\"last_section_id\":\"7400000000000000006\"}");
+    } else if (has_prefix(path, "/v3/chat/message/list")) {
+        sink_list(sink, "{\"code\":0,\"msg\":\"\",\"data\":[", MESSAGE_JSON, 50, "]}");
+    } else if (has_prefix(path, "/v3/chat")) {
+        sink_json(sink, CHAT_JSON);
+    } else if (has_prefix(path, "/v1/files/retrieve")) {
+        sink_json(sink, "{\"id\":\"7400000000000000007\",\"file_name\":\"file.txt\",\"bytes\":10,"
+                  "\"created_at\":1700000000}");
+    } else if (has_prefix(path, "/v1/workflow/run")) {
+        sink_string(sink, "{\"code\":0,\"msg\":\"\",\"data\":\"{\\\"output\\\":\\\"ok\\\"}\","
+                    "\"debug_url\":\"https://example.com/debug\",\"execute_id\":\"7400000000000000008\"}");
+    } else if (has_prefix(path, "/v1/audio/voices")) {
+        sink_list(sink, "{\"code\":0,\"msg\":\"\",\"data\":{\"has_more\":false,\"voice_list\":[",
+                  "{\"voice_id\":\"7400000000000000009\",\"name\":\"voice\",\"language_code\":\"zh\","
+                  "\"language_name\":\"Chinese\",\"preview_text\":\"text\",\"preview_audio\":\"https://example.com/a\","
+                  "\"is_system_voice\":true,\"create_time\":1700000000,\"update_time\":1700000001,"
+                  "\"available_training_times\":3}", 20, "]}}");
+    } else if (has_prefix(path, "/v1/audio/rooms")) {
+        sink_json(sink, "{\"room_id\":\"7400000000000000010\",\"app_id\":\"app\",\"token\":\"token\","
+                  "\"uid\":\"7400000000000000011\"}");
+    } else {
+        fprintf(stderr, "unexpected request: %s %s\n", req->method, path);
+        return COZE_ERROR_NETWORK;
+    }
+    return COZE_OK;
+}
+
+// Runs one endpoint with its request initializer and frees the response; a non-OK result is a failure too.
+#define ENDPOINT_VARIANT(run_name, name, ...) \
+    static bool run_##run_name(void) { \
+        const coze_##name##_request_t req = {.api_base = "http://coze.fake", __VA_ARGS__}; \
+        coze_##name##_response_t resp = {0}; \
+        const coze_error_t err = coze_##name(&req, &resp); \
+        coze_free_##name##_response(&resp); \
+        return err == COZE_OK; \
+    }
+
+#define ENDPOINT(name, ...) ENDPOINT_VARIANT(name, name, __VA_ARGS__)
+
+#define TOKEN .api_token = "pat_fake"
+
+static coze_message_t g_message = {
+    .role = COZE_MESSAGE_ROLE_USER,
+    .type = COZE_MESSAGE_TYPE_QUESTION,
+    .content = "Hello!",
+    .content_type = COZE_MESSAGE_CONTENT_TYPE_TEXT,
+};
+
+static coze_tool_output_t g_tool_output = {.tool_call_id = "call_1", .output = "ok"};
+
+static const char *g_connector_ids[] = {"1024"};
+
+static void on_chat_event(const coze_chat_event_t *event) {
+    (void) event;
+}
+
+static void on_workflow_event(const coze_workflow_event_t *event) {
+    (void) event;
+}
+
+ENDPOINT(web_oauth_get_access_token, .client_id = "client", .client_secret = "secret", .code = "code",
+         .redirect_uri = "https://example.com/callback")
+ENDPOINT(web_oauth_refresh_access_token, .client_id = "client", .client_secret = "secret",
+         .refresh_token = "refresh")
+ENDPOINT(workspaces_list, TOKEN, .page_num = 1, .page_size = 20)
+ENDPOINT_VARIANT(workspaces_list_zero_copy, workspaces_list, TOKEN, .page_num = 1, .page_size = 20, .zero_copy = true)
+ENDPOINT(bots_create, TOKEN, .space_id = "7400000000000000005", .name = "bot",
+         .prompt_info = &(coze_bots_prompt_info_t){.prompt = "prompt"})
+ENDPOINT(bots_update, TOKEN, .bot_id = "7400000000000000003", .name = "bot")
+ENDPOINT(bots_publish, TOKEN, .bot_id = "7400000000000000003", .connector_ids = g_connector_ids,
+         .connector_ids_count = 1)
+ENDPOINT(bots_list, TOKEN, .space_id = "7400000000000000005", .page_num = 1, .page_size = 20)
+ENDPOINT_VARIANT(bots_list_zero_copy, bots_list, TOKEN, .space_id = "7400000000000000005", .page_num = 1,
+                 .page_size = 20, .zero_copy = true)
+ENDPOINT(bots_retrieve, TOKEN, .bot_id = "7400000000000000003")
+ENDPOINT(conversations_create, TOKEN, .bot_id = "7400000000000000003", .messages = &g_message, .message_count = 1)
+ENDPOINT(conversations_retrieve, TOKEN, .conversation_id = "7400000000000000002")
+ENDPOINT(conversations_messages_create, TOKEN, .conversation_id = "7400000000000000002",
+         .role = COZE_MESSAGE_ROLE_USER, .content = "Hello!", .content_type = COZE_MESSAGE_CONTENT_TYPE_TEXT)
+ENDPOINT(conversations_messages_list, TOKEN, .conversation_id = "7400000000000000002", .limit = 50)
+ENDPOINT_VARIANT(conversations_messages_list_zero_copy, conversations_messages_list, TOKEN,
+                 .conversation_id = "7400000000000000002", .limit = 50, .zero_copy = true)
+ENDPOINT(conversations_messages_retrieve, TOKEN, .conversation_id = "7400000000000000002",
+         .message_id = "7400000000000000001")
+ENDPOINT(conversations_messages_update, TOKEN, .conversation_id = "7400000000000000002",
+         .message_id = "7400000000000000001", .content = "Hello!", .content_type = COZE_MESSAGE_CONTENT_TYPE_TEXT)
+ENDPOINT(conversations_messages_delete, TOKEN, .conversation_id = "7400000000000000002",
+         .message_id = "7400000000000000001")
+ENDPOINT(chat_create, TOKEN, .bot_id = "7400000000000000003", .user_id = "user", .additional_messages = &g_message,
+         .additional_messages_count = 1)
+ENDPOINT(chat_stream, TOKEN, .bot_id = "7400000000000000003", .user_id = "user", .additional_messages = &g_message,
+         .additional_messages_count = 1, .on_event = on_chat_event)
+ENDPOINT(chat_retrieve, TOKEN, .conversation_id = "7400000000000000002", .chat_id = "7400000000000000004")
+ENDPOINT(chat_messages_list, TOKEN, .conversation_id = "7400000000000000002", .chat_id = "7400000000000000004")
+ENDPOINT_VARIANT(chat_messages_list_zero_copy, chat_messages_list, TOKEN, .conversation_id = "7400000000000000002",
+                 .chat_id = "7400000000000000004", .zero_copy = true)
+ENDPOINT(chat_submit_tool_outputs_create, TOKEN, .conversation_id = "7400000000000000002",
+         .chat_id = "7400000000000000004", .tool_outputs = &g_tool_output, .tool_outputs_count = 1)
+ENDPOINT(chat_cancel, TOKEN, .conversation_id = "7400000000000000002", .chat_id = "7400000000000000004")
+ENDPOINT(files_retrieve, TOKEN, .file_id = "7400000000000000007")
+ENDPOINT(workflows_runs_create, TOKEN, .workflow_id = "7400000000000000012")
+ENDPOINT(workflows_runs_stream, TOKEN, .workflow_id = "7400000000000000012", .on_event = on_workflow_event)
+ENDPOINT(workflows_runs_resume, TOKEN, .workflow_id = "7400000000000000012", .on_event = on_workflow_event)
+ENDPOINT(audio_voices_list, TOKEN, .page_num = 1, .page_size = 20)
+ENDPOINT_VARIANT(audio_voices_list_zero_copy, audio_voices_list, TOKEN, .page_num = 1, .page_size = 20,
+                 .zero_copy = true)
+ENDPOINT(audio_rooms_create, TOKEN, .bot_id = "7400000000000000003", .voice_id = "7400000000000000009")
+
+typedef struct {
+    const char *name;
+    bool (*run)(void);
+    size_t budget; // 单次调用允许的分配次数
+} endpoint_check_t;
+
+#define CHECK(name, budget) {#name, run_##name, budget}
+
+// 列表接口: workspaces/bots/voices 各 20 条, messages 50 条; 流式接口: STREAM_DELTAS 个 delta
+static const endpoint_check_t CHECKS[] = {
+    CHECK(web_oauth_get_access_token, 12),
+    CHECK(web_oauth_refresh_access_token, 12),
+    CHECK(workspaces_list, 12),
+    CHECK(workspaces_list_zero_copy, 12),
+    CHECK(bots_create, 12),
+    CHECK(bots_update, 12),
+    CHECK(bots_publish, 12),
+    CHECK(bots_list, 12),
+    CHECK(bots_list_zero_copy, 12),
+    CHECK(bots_retrieve, 12),
+    CHECK(conversations_create, 12),
+    CHECK(conversations_retrieve, 12),
+    CHECK(conversations_messages_create, 12),
+    CHECK(conversations_messages_list, 20),
+    CHECK(conversations_messages_list_zero_copy, 20),
+    CHECK(conversations_messages_retrieve, 12),
+    CHECK(conversations_messages_update, 12),
+    CHECK(conversations_messages_delete, 12),
+    CHECK(chat_create, 12),
+    CHECK(chat_stream, 192),
+    CHECK(chat_retrieve, 12),
+    CHECK(chat_messages_list, 20),
+    CHECK(chat_messages_list_zero_copy, 20),
+    CHECK(chat_submit_tool_outputs_create, 12),
+    CHECK(chat_cancel, 12),
+    CHECK(files_retrieve, 12),
+    CHECK(workflows_runs_create, 12),
+    CHECK(workflows_runs_stream, 320),
+    CHECK(workflows_runs_resume, 320),
+    CHECK(audio_voices_list, 12),
+    CHECK(audio_voices_list_zero_copy, 12),
+    CHECK(audio_rooms_create, 12),
+};
+
+// 执行一次调用, 返回分配次数; 泄漏或失败计入 g_check.failures
+static size_t measure(const char *name, bool (*run)(void), bool quiet) {
+    coze_alloc_stats_t stats = {0};
+    coze_alloc_stats_reset();
+    const bool ok = run();
+    coze_alloc_stats_get(&stats);
+
+    if (!ok) {
+        fprintf(stderr, "FAIL %s: request failed\n", name);
+        g_check.failures++;
+    }
+    if (stats.live != 0) {
+        fprintf(stderr, "FAIL %s: %zu allocations still live after free\n", name, stats.live);
+        g_check.failures++;
+    }
+    if (!quiet) {
+        printf("%-40s %6zu allocs %6zu reallocs %8zu bytes\n", name, stats.allocations, stats.reallocs, stats.bytes);
+    }
+    return stats.allocations + stats.reallocs;
+}
+
+// 用 N 和 2N 个 delta 各跑一次, 差值即每个 delta 的分配次数
+static void check_per_delta(const char *name, bool (*run)(void), size_t budget) {
+    g_check.stream_deltas = STREAM_DELTAS;
+    const size_t base = measure(name, run, true);
+    g_check.stream_deltas = STREAM_DELTAS * 2;
+    const size_t doubled = measure(name, run, true);
+    g_check.stream_deltas = STREAM_DELTAS;
+
+    const size_t per_delta = doubled > base ? (doubled - base) / STREAM_DELTAS : 0;
+    printf("%-40s %6zu allocs per delta (budget %zu)\n", name, per_delta, budget);
+    if (per_delta > budget) {
+        fprintf(stderr, "FAIL %s: %zu allocations per delta exceeds budget %zu\n", name, per_delta, budget);
+        g_check.failures++;
+    }
+}
+
+int main() {
+    coze_log_enable(false); // 报告写 stdout, 不和 SDK 的请求日志混在一起
+
+    coze_set_transport(fake_transport, NULL);
+    coze_alloc_stats_enable(true);
+
+    for (size_t i = 0; i < sizeof(CHECKS) / sizeof(CHECKS[0]); i++) {
+        const endpoint_check_t *check = &CHECKS[i];
+        const size_t allocations = measure(check->name, check->run, false);
+        if (allocations > check->budget) {
+            fprintf(stderr, "FAIL %s: %zu allocations exceeds budget %zu\n", check->name, allocations,
+                    check->budget);
+            g_check.failures++;
+        }
+    }
+    check_per_delta("chat_stream", run_chat_stream, CHAT_STREAM_PER_DELTA_BUDGET);
+    check_per_delta("workflows_runs_stream", run_workflows_runs_stream, WORKFLOW_STREAM_PER_DELTA_BUDGET);
+
+    coze_alloc_stats_enable(false);
+    coze_set_transport(NULL, NULL);
+
+    if (g_check.failures > 0) {
+        fprintf(stderr, "%d allocation budget violations\n", g_check.failures);
+        return 1;
+    }
+    printf("all allocation budgets met\n");
+    return 0;
+}
@@ -42,14 +42,15 @@ int main() {
     printf("[chat.create] status: %s\n", resp.data.status);
     printf("\n");
 
-    const char *conversation_id = strdup(resp.data.conversation_id);
-    const char *chat_id = strdup(resp.data.id);
+    // 数值形式的 ID 在释放响应后仍可直接使用
+    const uint64_t conversation_id = resp.data.conversation_id_u64;
+    const uint64_t chat_id = resp.data.id_u64;
     coze_free_chat_create_response(&resp);
 
     const coze_chat_retrieve_request_t retrieve_req = {
         .api_token = api_token,
-        .conversation_id = conversation_id,
-        .chat_id = chat_id
+        .conversation_id_u64 = conversation_id,
+        .chat_id_u64 = chat_id
     };
     coze_chat_retrieve_response_t retrieve_resp = {0};
     const coze_error_t retrieve_err = coze_chat_retrieve(&retrieve_req, &retrieve_resp);
@@ -0,0 +1,88 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "coze.h"
+
+// Compression benchmark: lists one conversation's messages repeatedly with response compression off and on, and
+// reports the bytes received over the network versus decoded (coze_transfer_stats_get) and request latency.
+//
+// COZE_API_TOKEN, COZE_CONVERSATION_ID  required
+// COZE_API_BASE                         target, e.g. a local mock server; default api.coze.cn
+// COZE_COMPRESSION_BENCH_ROUNDS         requests per mode, default 50
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+}
+
+static int compare_double(const void *a, const void *b) {
+    const double x = *(const double *) a;
+    const double y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+static bool list_messages(const char *api_token, const char *api_base, const char *conversation_id) {
+    const coze_conversations_messages_list_request_t req = {
+        .api_token = api_token, .api_base = api_base, .conversation_id = conversation_id, .limit = 50
+    };
+    coze_conversations_messages_list_response_t resp = {0};
+    const coze_error_t err = coze_conversations_messages_list(&req, &resp);
+    const bool ok = err == COZE_OK && resp.code == 0;
+    coze_free_conversations_messages_list_response(&resp);
+    return ok;
+}
+
+static bool bench(bool compression, const char *api_token, const char *api_base, const char *conversation_id,
+                  double *latencies, int rounds) {
+    coze_set_response_compression(compression);
+    if (!list_messages(api_token, api_base, conversation_id)) { // 预热, 同时检查参数
+        fprintf(stderr, "Error: conversations_messages_list failed\n");
+        return false;
+    }
+
+    coze_transfer_stats_reset();
+    for (int i = 0; i < rounds; i++) {
+        const double start = now_seconds();
+        if (!list_messages(api_token, api_base, conversation_id)) {
+            fprintf(stderr, "Error: conversations_messages_list failed\n");
+            return false;
+        }
+        latencies[i] = now_seconds() - start;
+    }
+    coze_transfer_stats_t stats;
+    coze_transfer_stats_get(&stats);
+    qsort(latencies, rounds, sizeof(double), compare_double);
+
+    printf("%-12s wire %8.1f KB/response  decoded %8.1f KB/response  compressed %3zu/%-3zu  "
+           "p50 %7.2f ms  p90 %7.2f ms\n", compression ? "compressed" : "identity",
+           stats.wire_bytes / 1024.0 / rounds, stats.body_bytes / 1024.0 / rounds, stats.compressed_requests,
+           stats.requests, latencies[rounds / 2] * 1e3, latencies[(int) (rounds * 0.9)] * 1e3);
+    return true;
+}
+
+int main() {
+    const char *api_token = getenv("COZE_API_TOKEN");
+    const char *api_base = getenv("COZE_API_BASE");
+    const char *conversation_id = getenv("COZE_CONVERSATION_ID");
+    const char *rounds_env = getenv("COZE_COMPRESSION_BENCH_ROUNDS");
+    if (!api_token || !conversation_id) {
+        fprintf(stderr, "Error: COZE_API_TOKEN and COZE_CONVERSATION_ID environment variables must be set\n");
+        return 1;
+    }
+    const int rounds = rounds_env && atoi(rounds_env) > 0 ? atoi(rounds_env) : 50;
+
+    coze_log_enable(false); // 报告写 stdout, 不和 SDK 的请求日志混在一起
+
+    double *latencies = calloc(rounds, sizeof(double));
+    if (!latencies) {
+        fprintf(stderr, "Error: out of memory\n");
+        return 1;
+    }
+    const bool ok = bench(false, api_token, api_base, conversation_id, latencies, rounds) &&
+                    bench(true, api_token, api_base, conversation_id, latencies, rounds);
+    coze_set_response_compression(true);
+    free(latencies);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,184 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "coze.h"
+
+// JSON decoding microbenchmark: serves chat-like payloads (long UTF-8 answers with markdown, code, quotes and
+// newline escapes) through a fake transport and reports decode throughput for message lists (buffered and
+// streamed) and for chat streams with long deltas and with many short token deltas. No network is involved.
+//
+// COZE_SIMD=scalar|sse2           caps the string scanner level; unset uses the best one the CPU supports
+// COZE_JSON_BENCH_ROUNDS          repetitions per case, default 200
+
+#define LIST_MESSAGES 50
+#define STREAM_DELTAS 500
+#define TOKEN_DELTAS 20000
+#define CHUNK_SIZE 16384 // 与 curl 默认的写回调块大小一致
+
+// 一段回答, 按 JSON 转义后的形式; 重复拼接成更长的消息内容
+static const char *ANSWER_JSON =
+        "## 快速排序\\n\\n快速排序是一种分治算法, 平均时间复杂度为 O(n log n)。下面是一个 C 语言实现:\\n\\n"
+        "```c\\nvoid quick_sort(int *a, int lo, int hi) {\\n    if (lo >= hi) {\\n        return;\\n    }\\n"
+        "    int p = partition(a, lo, hi);\\n    quick_sort(a, lo, p - 1);\\n"
+        "    quick_sort(a, p + 1, hi);\\n}\\n```\\n\\n"
+        "调用方式为 `quick_sort(a, 0, n - 1)`, 其中 \\\"n\\\" 是数组长度。The pivot choice matters: picking the "
+        "median of three avoids the O(n^2) worst case on sorted input \\u2014 see \\\"Engineering a Sort Function\\\"."
+        "\\n\\n";
+
+static struct {
+    char *list_body;
+    size_t list_size;
+    char *stream_body;
+    size_t stream_size;
+    char *token_body; // 高频的短 delta, 主要开销在 SSE 分帧
+    size_t token_size;
+    const char *served_stream; // 本轮返回的流
+    size_t served_stream_size;
+    size_t chunk; // 每次交给 SDK 的字节数
+    int rounds;
+} g_bench;
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+}
+
+static void append(char **buffer, size_t *size, const char *data) {
+    const size_t len = strlen(data);
+    *buffer = realloc(*buffer, *size + len + 1);
+    memcpy(*buffer + *size, data, len + 1);
+    *size += len;
+}
+
+static void append_message(char **buffer, size_t *size, int id, int repeat, const char *content) {
+    char head[256];
+    snprintf(head, sizeof(head),
+             "{\"id\":\"%d\",\"conversation_id\":\"7400000000000000002\",\"bot_id\":\"7400000000000000003\","
+             "\"chat_id\":\"7400000000000000004\",\"role\":\"assistant\",\"type\":\"answer\",\"content\":\"",
+             7400000 + id);
+    append(buffer, size, head);
+    for (int i = 0; i < repeat; i++) {
+        append(buffer, size, content);
+    }
+    append(buffer, size, "\",\"content_type\":\"text\",\"created_at\":1700000000,\"updated_at\":1700000001}");
+}
+
+static void build_payloads(void) {
+    append(&g_bench.list_body, &g_bench.list_size, "{\"code\":0,\"msg\":\"\",\"data\":[");
+    for (int i = 0; i < LIST_MESSAGES; i++) {
+        if (i > 0) {
+            append(&g_bench.list_body, &g_bench.list_size, ",");
+        }
+        append_message(&g_bench.list_body, &g_bench.list_size, i, 8, ANSWER_JSON);
+    }
+    append(&g_bench.list_body, &g_bench.list_size, "],\"first_id\":\"1\",\"last_id\":\"50\",\"has_more\":true}");
+
+    for (int i = 0; i < STREAM_DELTAS; i++) {
+        append(&g_bench.stream_body, &g_bench.stream_size, "event:conversation.message.delta\ndata:");
+        append_message(&g_bench.stream_body, &g_bench.stream_size, i, 1, ANSWER_JSON);
+        append(&g_bench.stream_body, &g_bench.stream_size, "\n\n");
+    }
+    append(&g_bench.stream_body, &g_bench.stream_size, "event:done\ndata:\"[DONE]\"\n\n");
+
+    for (int i = 0; i < TOKEN_DELTAS; i++) {
+        append(&g_bench.token_body, &g_bench.token_size, "event:conversation.message.delta\ndata:");
+        append_message(&g_bench.token_body, &g_bench.token_size, i, 1, "排序");
+        append(&g_bench.token_body, &g_bench.token_size, "\n\n");
+    }
+    append(&g_bench.token_body, &g_bench.token_size, "event:done\ndata:\"[DONE]\"\n\n");
+}
+
+static void sink_chunks(coze_transport_sink_t *sink, const char *data, size_t size) {
+    for (size_t i = 0; i < size; i += g_bench.chunk) {
+        coze_transport_sink_body(sink, data + i, size - i < g_bench.chunk ? size - i : g_bench.chunk);
+    }
+}
+
+static coze_error_t fake_transport(const coze_transport_request_t *req, coze_transport_sink_t *sink, void *ctx) {
+    (void) ctx;
+    coze_transport_sink_header(sink, "HTTP/1.1 200 OK", strlen("HTTP/1.1 200 OK"));
+    if (req->stream) {
+        sink_chunks(sink, g_bench.served_stream, g_bench.served_stream_size);
+    } else {
+        sink_chunks(sink, g_bench.list_body, g_bench.list_size);
+    }
+    return COZE_OK;
+}
+
+static bool run_list(bool zero_copy) {
+    const coze_conversations_messages_list_request_t req = {
+        .api_token = "bench", .conversation_id = "7400000000000000002", .zero_copy = zero_copy
+    };
+    coze_conversations_messages_list_response_t resp = {0};
+    const coze_error_t err = coze_conversations_messages_list(&req, &resp);
+    const bool ok = err == COZE_OK && resp.data.messages_count == LIST_MESSAGES;
+    coze_free_conversations_messages_list_response(&resp);
+    return ok;
+}
+
+static bool run_list_buffered(void) {
+    return run_list(true);
+}
+
+static bool run_list_streamed(void) {
+    return run_list(false);
+}
+
+static void on_event(const coze_chat_event_t *event) {
+    (void) event;
+}
+
+static bool run_chat_stream(void) {
+    const coze_chat_stream_request_t req = {
+        .api_token = "bench", .bot_id = "7400000000000000003", .user_id = "bench", .on_event = on_event
+    };
+    coze_chat_stream_response_t resp = {0};
+    const coze_error_t err = coze_chat_stream(&req, &resp);
+    coze_free_chat_stream_response(&resp);
+    return err == COZE_OK;
+}
+
+static void bench(const char *name, bool (*run)(void), size_t bytes) {
+    run(); // 预热
+    const double start = now_seconds();
+    for (int i = 0; i < g_bench.rounds; i++) {
+        if (!run()) {
+            fprintf(stderr, "Error: %s failed\n", name);
+            exit(1);
+        }
+    }
+    const double elapsed = now_seconds() - start;
+    printf("%-28s %8.1f KB/response %8.1f us/response %8.1f MB/s\n", name, bytes / 1024.0,
+           elapsed * 1e6 / g_bench.rounds, bytes * (double) g_bench.rounds / elapsed / 1e6);
+}
+
+int main() {
+    const char *rounds = getenv("COZE_JSON_BENCH_ROUNDS");
+    const char *simd = getenv("COZE_SIMD");
+    g_bench.rounds = rounds && atoi(rounds) > 0 ? atoi(rounds) : 200;
+    g_bench.chunk = CHUNK_SIZE;
+
+    coze_log_enable(false); // 报告写 stdout, 不和 SDK 的请求日志混在一起
+
+    build_payloads();
+    coze_set_transport(fake_transport, NULL);
+
+    printf("string scanner             %s\n", simd ? simd : "auto");
+    bench("messages_list (buffered)", run_list_buffered, g_bench.list_size);
+    bench("messages_list (streamed)", run_list_streamed, g_bench.list_size);
+    g_bench.served_stream = g_bench.stream_body;
+    g_bench.served_stream_size = g_bench.stream_size;
+    bench("chat_stream (long deltas)", run_chat_stream, g_bench.stream_size);
+    g_bench.served_stream = g_bench.token_body;
+    g_bench.served_stream_size = g_bench.token_size;
+    g_bench.rounds = g_bench.rounds / 10 > 0 ? g_bench.rounds / 10 : 1;
+    bench("chat_stream (token deltas)", run_chat_stream, g_bench.token_size);
+
+    coze_set_transport(NULL, NULL);
+    free(g_bench.list_body);
+    free(g_bench.stream_body);
+    free(g_bench.token_body);
+    return 0;
+}
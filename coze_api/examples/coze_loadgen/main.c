@@ -0,0 +1,226 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/resource.h>
+#include "coze.h"
+
+// Load generator: opens chat streams at a target arrival rate with at most N in flight, and reports achieved
+// QPS, time-to-first-delta and completion latency percentiles, error rates and CPU spent inside the SDK.
+//
+// COZE_API_TOKEN, COZE_BOT_ID     required (unless replaying)
+// COZE_API_BASE                   target, e.g. a local mock server; default api.coze.cn
+// COZE_LOADGEN_CONCURRENCY        max concurrent streams, default 8
+// COZE_LOADGEN_RATE               target arrivals per second, default 10
+// COZE_LOADGEN_REQUESTS           total sessions, default 100
+// COZE_LOADGEN_REPLAY             optional VCR file served instead of the network (see coze_vcr_replay_start)
+
+typedef struct {
+    double scheduled_at; // 计划开始时间, 延迟从这里开始计算, 避免协调遗漏
+    double first_delta_at; // 首个 conversation.message.delta 到达时间, 0 表示没有
+    double completed_at;
+    double sdk_cpu; // 本次会话在 coze_chat_stream 内消耗的线程 CPU 时间
+    int deltas;
+    bool failed;
+} session_t;
+
+static struct {
+    const char *api_token;
+    const char *api_base;
+    const char *bot_id;
+    int concurrency;
+    double rate;
+    int requests;
+
+    double start;
+    session_t *sessions;
+    int next; // 下一个待发起的会话
+    pthread_mutex_t lock;
+} g_load = {.lock = PTHREAD_MUTEX_INITIALIZER};
+
+static __thread session_t *t_session;
+
+static double now_seconds(int clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+}
+
+static void sleep_until(double at) {
+    const double wait = at - now_seconds(CLOCK_MONOTONIC);
+    if (wait > 0) {
+        struct timespec ts = {.tv_sec = (time_t) wait, .tv_nsec = (long) ((wait - (time_t) wait) * 1e9)};
+        nanosleep(&ts, NULL);
+    }
+}
+
+static int env_int(const char *name, int fallback) {
+    const char *value = getenv(name);
+    return value && atoi(value) > 0 ? atoi(value) : fallback;
+}
+
+static void handle_chat_event(const coze_chat_event_t *chat_event) {
+    session_t *session = t_session;
+    if (!session || !chat_event->event) {
+        return;
+    }
+    if (strcmp(chat_event->event, COZE_EVENT_TYPE_CONVERSATION_MESSAGE_DELTA) == 0) {
+        if (session->deltas++ == 0) {
+            session->first_delta_at = now_seconds(CLOCK_MONOTONIC);
+        }
+    } else if (strcmp(chat_event->event, COZE_EVENT_TYPE_ERROR) == 0 ||
+               strcmp(chat_event->event, COZE_EVENT_TYPE_CONVERSATION_CHAT_FAILED) == 0) {
+        session->failed = true;
+    }
+}
+
+static void run_session(session_t *session) {
+    coze_message_t message = {
+        .role = COZE_MESSAGE_ROLE_USER,
+        .type = COZE_MESSAGE_TYPE_QUESTION,
+        .content = "Hello!",
+        .content_type = COZE_MESSAGE_CONTENT_TYPE_TEXT,
+    };
+    const coze_chat_stream_request_t req = {
+        .api_token = g_load.api_token,
+        .api_base = g_load.api_base,
+        .bot_id = g_load.bot_id,
+        .user_id = "coze_loadgen",
+        .additional_messages_count = 1,
+        .additional_messages = (coze_message_t[]){message},
+
+        .on_event = handle_chat_event
+    };
+    coze_chat_stream_response_t resp = {0};
+
+    t_session = session;
+    const double cpu_start = now_seconds(CLOCK_THREAD_CPUTIME_ID);
+    const coze_error_t err = coze_chat_stream(&req, &resp);
+    session->sdk_cpu = now_seconds(CLOCK_THREAD_CPUTIME_ID) - cpu_start;
+    session->completed_at = now_seconds(CLOCK_MONOTONIC);
+    t_session = NULL;
+
+    if (err != COZE_OK || session->deltas == 0) {
+        session->failed = true;
+    }
+    coze_free_chat_stream_response(&resp);
+}
+
+static void *worker(void *arg) {
+    (void) arg;
+    for (;;) {
+        pthread_mutex_lock(&g_load.lock);
+        const int index = g_load.next < g_load.requests ? g_load.next++ : -1;
+        pthread_mutex_unlock(&g_load.lock);
+        if (index < 0) {
+            return NULL;
+        }
+
+        session_t *session = &g_load.sessions[index];
+        session->scheduled_at = g_load.start + index / g_load.rate;
+        sleep_until(session->scheduled_at);
+        run_session(session);
+    }
+}
+
+static int compare_double(const void *a, const void *b) {
+    const double x = *(const double *) a;
+    const double y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+static void report_latency(const char *name, double *values, int count) {
+    if (count == 0) {
+        printf("%-22s n/a\n", name);
+        return;
+    }
+    qsort(values, count, sizeof(double), compare_double);
+    printf("%-22s p50 %8.1f ms  p90 %8.1f ms  p99 %8.1f ms  max %8.1f ms\n", name, values[(int) (count * 0.50)] * 1e3,
+           values[(int) (count * 0.90)] * 1e3, values[(int) (count * 0.99)] * 1e3, values[count - 1] * 1e3);
+}
+
+static double cpu_seconds(void) {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (double) usage.ru_utime.tv_sec + (double) usage.ru_utime.tv_usec / 1e6 +
+           (double) usage.ru_stime.tv_sec + (double) usage.ru_stime.tv_usec / 1e6;
+}
+
+int main() {
+    const char *replay = getenv("COZE_LOADGEN_REPLAY");
+    g_load.api_token = getenv("COZE_API_TOKEN");
+    g_load.api_base = getenv("COZE_API_BASE");
+    g_load.bot_id = getenv("COZE_BOT_ID");
+    if (!replay && (!g_load.api_token || !g_load.bot_id)) {
+        fprintf(stderr, "Error: COZE_API_TOKEN and COZE_BOT_ID environment variables must be set\n");
+        return 1;
+    }
+    if (!g_load.api_token) {
+        g_load.api_token = "replay";
+    }
+    g_load.concurrency = env_int("COZE_LOADGEN_CONCURRENCY", 8);
+    g_load.rate = env_int("COZE_LOADGEN_RATE", 10);
+    g_load.requests = env_int("COZE_LOADGEN_REQUESTS", 100);
+
+    if (replay && coze_vcr_replay_start(replay, COZE_VCR_PACING_ORIGINAL) != COZE_OK) {
+        fprintf(stderr, "Error: failed to load replay file %s\n", replay);
+        return 1;
+    }
+
+    coze_log_enable(false); // 报告写 stdout, 不和 SDK 的请求日志混在一起
+
+    g_load.sessions = calloc(g_load.requests, sizeof(session_t));
+    pthread_t *threads = calloc(g_load.concurrency, sizeof(pthread_t));
+    if (!g_load.sessions || !threads) {
+        fprintf(stderr, "Error: out of memory\n");
+        return 1;
+    }
+
+    const double cpu_start = cpu_seconds();
+    g_load.start = now_seconds(CLOCK_MONOTONIC);
+    for (int i = 0; i < g_load.concurrency; i++) {
+        pthread_create(&threads[i], NULL, worker, NULL);
+    }
+    for (int i = 0; i < g_load.concurrency; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    const double wall = now_seconds(CLOCK_MONOTONIC) - g_load.start;
+    const double process_cpu = cpu_seconds() - cpu_start;
+
+    double *ttft = calloc(g_load.requests, sizeof(double));
+    double *completion = calloc(g_load.requests, sizeof(double));
+    int ttft_count = 0;
+    int completion_count = 0;
+    int failed = 0;
+    double sdk_cpu = 0;
+    for (int i = 0; i < g_load.requests; i++) {
+        const session_t *session = &g_load.sessions[i];
+        sdk_cpu += session->sdk_cpu;
+        if (session->failed) {
+            failed++;
+            continue;
+        }
+        ttft[ttft_count++] = session->first_delta_at - session->scheduled_at;
+        completion[completion_count++] = session->completed_at - session->scheduled_at;
+    }
+
+    printf("target                 %s%s\n", replay ? "replay " : "",
+           replay ? replay : g_load.api_base ? g_load.api_base : "https://api.coze.cn");
+    printf("sessions               %d (concurrency %d, target rate %.1f/s)\n", g_load.requests, g_load.concurrency,
+           g_load.rate);
+    printf("achieved qps           %.2f over %.2f s\n", g_load.requests / wall, wall);
+    printf("errors                 %d (%.2f%%)\n", failed, 100.0 * failed / g_load.requests);
+    report_latency("time to first delta", ttft, ttft_count);
+    report_latency("completion", completion, completion_count);
+    printf("sdk cpu                %.3f s total, %.3f ms/session, %.1f%% of one core\n", sdk_cpu,
+           sdk_cpu * 1e3 / g_load.requests, 100.0 * sdk_cpu / wall);
+    printf("process cpu            %.3f s (%.1f%% of one core)\n", process_cpu, 100.0 * process_cpu / wall);
+
+    coze_vcr_stop();
+    free(ttft);
+    free(completion);
+    free(threads);
+    free(g_load.sessions);
+    return failed == g_load.requests ? 1 : 0;
+}
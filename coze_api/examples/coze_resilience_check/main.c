@@ -0,0 +1,386 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "coze.h"
+
+// Resilience check: serves scripted responses (status codes, Retry-After, unreachable endpoints, slow responses)
+// through a fake transport and checks that retries, rate limits, adaptive concurrency, circuit breaking, endpoint
+// failover and deadlines behave as documented, using the call results, the number of requests the transport saw and
+// coze_transfer_stats. Jitter is off and every wait is an explicit, generous bound, so the result does not depend on
+// the machine. Exits non-zero if any expectation fails.
+// 用 fake transport 按脚本返回响应, 逐项检查重试、限流、自适应并发、熔断、端点切换和调用时限。
+
+#define BOT_JSON \
+        "{\"code\":0,\"msg\":\"\",\"data\":{\"bot_id\":\"7400000000000000003\",\"name\":\"bot\"," \
+        "\"description\":\"description\",\"icon_url\":\"https://example.com/icon.png\",\"create_time\":1700000000," \
+        "\"update_time\":1700000001,\"version\":\"1\"}}"
+
+#define DISCONNECT (-1)
+
+typedef struct {
+    int statuses[8]; // 第 n 个请求的状态码, DISCONNECT 表示收到响应前断开; 之后的请求重复最后一项, 全空时为 200
+    const char *retry_after; // 非 NULL 时非 2xx 响应带上 Retry-After
+    const char *unreachable; // URL 含有它的端点连不上
+    int delay_ms; // 响应 (或报告连不上) 之前等待的时间
+    int calls; // transport 收到的请求数
+    int unreachable_calls; // 其中发给连不上的端点的请求数
+    int last_timeout_ms; // 最近一个请求带的剩余时限
+} fake_script_t;
+
+static fake_script_t g_fake;
+
+// hang 期间到达的请求在 transport 里挂起 (上游接受连接后不响应, 请求又没有时限), 直到 release_hung
+static struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    bool hang;
+    bool released;
+    int hung; // 正挂起的请求数
+} g_hang = {.lock = PTHREAD_MUTEX_INITIALIZER, .cond = PTHREAD_COND_INITIALIZER};
+
+static struct {
+    const char *name; // 当前检查项
+    int failures;
+} g_check;
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec * 1e3 + (double) ts.tv_nsec / 1e6;
+}
+
+static void sleep_ms(int ms) {
+    const struct timespec ts = {.tv_sec = ms / 1000, .tv_nsec = (long) (ms % 1000) * 1000000L};
+    nanosleep(&ts, NULL);
+}
+
+static void sink_header(coze_transport_sink_t *sink, const char *line) {
+    coze_transport_sink_header(sink, line, strlen(line));
+}
+
+static coze_error_t fake_transport(const coze_transport_request_t *req, coze_transport_sink_t *sink, void *ctx) {
+    (void) ctx;
+    pthread_mutex_lock(&g_hang.lock);
+    const int index = g_fake.calls++;
+    g_fake.last_timeout_ms = req->timeout_ms;
+    if (g_hang.hang) {
+        g_hang.hung++;
+        pthread_cond_broadcast(&g_hang.cond);
+        while (!g_hang.released) {
+            pthread_cond_wait(&g_hang.cond, &g_hang.lock);
+        }
+        g_hang.hung--;
+    }
+    pthread_mutex_unlock(&g_hang.lock);
+    if (g_fake.delay_ms > 0) {
+        sleep_ms(g_fake.delay_ms);
+    }
+    if (g_fake.unreachable && strstr(req->url, g_fake.unreachable)) {
+        g_fake.unreachable_calls++;
+        coze_transport_sink_connect_failed(sink);
+        return COZE_ERROR_NETWORK;
+    }
+
+    int status = 200;
+    for (int i = 0; i <= index && i < (int) (sizeof(g_fake.statuses) / sizeof(g_fake.statuses[0])); i++) {
+        status = g_fake.statuses[i] ? g_fake.statuses[i] : status;
+    }
+    if (status == DISCONNECT) {
+        return COZE_ERROR_NETWORK;
+    }
+
+    char line[64];
+    snprintf(line, sizeof(line), "HTTP/1.1 %d %s", status, status == 200 ? "OK" : "Error");
+    sink_header(sink, line);
+    sink_header(sink, "x-tt-logid: 20241210000000000000000000000000");
+    if (status != 200 && g_fake.retry_after) {
+        snprintf(line, sizeof(line), "Retry-After: %s", g_fake.retry_after);
+        sink_header(sink, line);
+    }
+    const char *body = status == 200 ? BOT_JSON : "{\"code\":5000,\"msg\":\"unavailable\"}";
+    coze_transport_sink_body(sink, body, strlen(body));
+    return COZE_OK;
+}
+
+// 开始一个检查项: 换上新的脚本并清零统计
+static void begin(const char *name, fake_script_t script) {
+    g_check.name = name;
+    g_fake = script;
+    coze_transfer_stats_reset();
+}
+
+static coze_transfer_stats_t stats(void) {
+    coze_transfer_stats_t stats = {0};
+    coze_transfer_stats_get(&stats);
+    return stats;
+}
+
+#define EXPECT(cond) \
+    do { \
+        if (!(cond)) { \
+            fprintf(stderr, "FAIL %s: %s (line %d)\n", g_check.name, #cond, __LINE__); \
+            g_check.failures++; \
+        } \
+    } while (0)
+
+// 只读请求, 默认重试策略会重试它
+static coze_error_t get_bot(const char *api_base, const char *api_token, int timeout_ms) {
+    const coze_bots_retrieve_request_t req = {
+        .api_base = api_base,
+        .api_token = api_token,
+        .timeout_ms = timeout_ms,
+        .bot_id = "7400000000000000003",
+    };
+    coze_bots_retrieve_response_t resp = {0};
+    const coze_error_t err = coze_bots_retrieve(&req, &resp);
+    coze_free_bots_retrieve_response(&resp);
+    return err;
+}
+
+static const coze_retry_policy_t RETRY_POLICY = {
+    .max_attempts = 3,
+    .base_delay_ms = 10,
+    .max_delay_ms = 2000,
+    .jitter = 0,
+    .retry_network_errors = true,
+    .retry_server_errors = true,
+    .retry_throttled = true,
+    .honor_retry_after = true,
+};
+
+static const coze_retry_policy_t NO_RETRY = {.max_attempts = 1};
+
+static void check_retries(void) {
+    coze_set_retry_policy(NULL, &RETRY_POLICY);
+    const char *base = "http://retry.fake";
+
+    begin("retry 5xx then success", (fake_script_t){.statuses = {503, 503, 200}});
+    EXPECT(get_bot(base, "pat_retry", 0) == COZE_OK);
+    EXPECT(g_fake.calls == 3);
+    EXPECT(stats().retries == 2 && stats().retry_giveups == 0);
+
+    begin("retry gives up after max_attempts", (fake_script_t){.statuses = {503}});
+    EXPECT(get_bot(base, "pat_retry", 0) != COZE_OK);
+    EXPECT(g_fake.calls == 3);
+    EXPECT(stats().retries == 2 && stats().retry_giveups == 1);
+
+    begin("retry network error", (fake_script_t){.statuses = {DISCONNECT, 200}});
+    EXPECT(get_bot(base, "pat_retry", 0) == COZE_OK);
+    EXPECT(g_fake.calls == 2);
+
+    begin("retry honors Retry-After", (fake_script_t){.statuses = {429, 200}, .retry_after = "1"});
+    const double start = now_ms();
+    EXPECT(get_bot(base, "pat_retry", 0) == COZE_OK);
+    EXPECT(now_ms() - start >= 1000);
+    EXPECT(g_fake.calls == 2);
+    EXPECT(stats().retries == 1);
+
+    begin("no retry when Retry-After exceeds max_delay_ms", (fake_script_t){.statuses = {503}, .retry_after = "5"});
+    EXPECT(get_bot(base, "pat_retry", 0) != COZE_OK);
+    EXPECT(g_fake.calls == 1);
+    EXPECT(stats().retries == 0);
+
+    coze_set_retry_policy(NULL, NULL);
+}
+
+static void check_rate_limits(void) {
+    coze_set_retry_policy(NULL, &NO_RETRY);
+    const char *base = "http://limit.fake";
+    coze_rate_limit_state_t state = {0};
+
+    coze_set_rate_limit("/v1/bot", &(coze_rate_limit_t){.requests_per_second = 1, .burst = 2});
+    begin("rate limit burst", (fake_script_t){0});
+    EXPECT(get_bot(base, "pat_burst", 0) == COZE_OK);
+    EXPECT(get_bot(base, "pat_burst", 0) == COZE_OK);
+    EXPECT(get_bot(base, "pat_burst", 0) == COZE_ERROR_RATE_LIMITED);
+    EXPECT(g_fake.calls == 2);
+    EXPECT(stats().rate_limited == 1);
+
+    coze_set_rate_limit("/v1/bot", &(coze_rate_limit_t){
+            .requests_per_second = 100, .burst = 100, .adapt_to_throttling = true});
+    begin("rate limit adapts to 429", (fake_script_t){.statuses = {429}});
+    EXPECT(get_bot(base, "pat_throttled", 0) != COZE_OK);
+    EXPECT(coze_get_rate_limit_state("pat_throttled", "/v1/bot", &state) == COZE_OK);
+    EXPECT(state.requests_per_second > 69 && state.requests_per_second < 71);
+
+    coze_set_rate_limit("/v1/bot", &(coze_rate_limit_t){.adaptive_concurrency = true});
+    begin("adaptive concurrency backs off on 5xx", (fake_script_t){.statuses = {503}});
+    for (int i = 0; i < 5; i++) {
+        EXPECT(get_bot(base, "pat_adaptive", 0) != COZE_OK);
+    }
+    EXPECT(coze_get_rate_limit_state("pat_adaptive", "/v1/bot", &state) == COZE_OK);
+    EXPECT(state.in_flight_limit == 4); // 8 * 0.9^5
+    EXPECT(state.in_flight == 0);
+
+    coze_set_rate_limit("/v1/bot", NULL);
+    coze_set_retry_policy(NULL, NULL);
+}
+
+static void *hung_probe(void *api_base) {
+    get_bot(api_base, "pat_circuit", 0);
+    return NULL;
+}
+
+// 在另一个线程发一个请求, 等它挂在 transport 里再返回; 之后的请求正常响应
+static void start_hung_probe(pthread_t *thread, const char *api_base) {
+    pthread_mutex_lock(&g_hang.lock);
+    g_hang.hang = true;
+    g_hang.released = false;
+    pthread_mutex_unlock(&g_hang.lock);
+    pthread_create(thread, NULL, hung_probe, (void *) api_base);
+    pthread_mutex_lock(&g_hang.lock);
+    while (g_hang.hung == 0) {
+        pthread_cond_wait(&g_hang.cond, &g_hang.lock);
+    }
+    g_hang.hang = false;
+    pthread_mutex_unlock(&g_hang.lock);
+}
+
+static void release_hung(void) {
+    pthread_mutex_lock(&g_hang.lock);
+    g_hang.released = true;
+    pthread_cond_broadcast(&g_hang.cond);
+    pthread_mutex_unlock(&g_hang.lock);
+}
+
+static void check_circuit(void) {
+    coze_set_retry_policy(NULL, &NO_RETRY);
+    coze_set_circuit_breaker(&(coze_circuit_breaker_t){
+            .window = 4, .min_requests = 4, .failure_percent = 50, .open_ms = 100, .probes = 2});
+    const char *base = "http://circuit.fake";
+
+    begin("circuit opens", (fake_script_t){.statuses = {503}});
+    for (int i = 0; i < 4; i++) {
+        EXPECT(get_bot(base, "pat_circuit", 0) != COZE_OK);
+    }
+    EXPECT(stats().circuit_trips == 1);
+    EXPECT(get_bot(base, "pat_circuit", 0) == COZE_ERROR_CIRCUIT_OPEN);
+    EXPECT(g_fake.calls == 4);
+    EXPECT(stats().circuit_rejected == 1);
+
+    begin("circuit reopens on a failed probe", (fake_script_t){.statuses = {503}});
+    sleep_ms(150);
+    EXPECT(get_bot(base, "pat_circuit", 0) != COZE_OK);
+    EXPECT(g_fake.calls == 1);
+    EXPECT(stats().circuit_trips == 1);
+    EXPECT(get_bot(base, "pat_circuit", 0) == COZE_ERROR_CIRCUIT_OPEN);
+
+    begin("circuit closes after probes succeed", (fake_script_t){0});
+    sleep_ms(150);
+    for (int i = 0; i < 6; i++) {
+        EXPECT(get_bot(base, "pat_circuit", 0) == COZE_OK);
+    }
+    EXPECT(g_fake.calls == 6);
+    EXPECT(stats().circuit_rejected == 0 && stats().circuit_trips == 0);
+
+    // 唯一的探测挂起不返回时, 下一个 open_ms 之后应当放行新一轮探测, 而不是一直半开
+    coze_set_circuit_breaker(&(coze_circuit_breaker_t){
+            .window = 4, .min_requests = 4, .failure_percent = 50, .open_ms = 100, .probes = 1});
+    begin("circuit recovers from a hung probe", (fake_script_t){.statuses = {503}});
+    for (int i = 0; i < 4; i++) {
+        EXPECT(get_bot(base, "pat_circuit", 0) != COZE_OK);
+    }
+    sleep_ms(150);
+    g_fake.statuses[0] = 200;
+    pthread_t probe;
+    start_hung_probe(&probe, base);
+    EXPECT(get_bot(base, "pat_circuit", 0) == COZE_ERROR_CIRCUIT_OPEN);
+    sleep_ms(150);
+    EXPECT(get_bot(base, "pat_circuit", 0) == COZE_OK);
+    EXPECT(get_bot(base, "pat_circuit", 0) == COZE_OK);
+    release_hung();
+    pthread_join(probe, NULL);
+    EXPECT(get_bot(base, "pat_circuit", 0) == COZE_OK);
+    EXPECT(g_fake.calls == 8);
+    EXPECT(stats().circuit_trips == 1);
+
+    coze_set_circuit_breaker(NULL);
+    coze_set_retry_policy(NULL, NULL);
+}
+
+static void check_failover(void) {
+    coze_set_retry_policy(NULL, &NO_RETRY);
+    const char *base = "http://failover.fake";
+    const char *endpoints[] = {"http://a.failover.fake", "http://b.failover.fake"};
+    coze_set_endpoints(base, endpoints, 2);
+
+    begin("failover on connect failure", (fake_script_t){.unreachable = "a.failover"});
+    EXPECT(get_bot(base, "pat_failover", 0) == COZE_OK);
+    EXPECT(g_fake.calls == 2 && g_fake.unreachable_calls == 1);
+    EXPECT(stats().failovers == 1);
+
+    begin("failover skips the paused endpoint", (fake_script_t){.unreachable = "a.failover"});
+    EXPECT(get_bot(base, "pat_failover", 0) == COZE_OK);
+    EXPECT(g_fake.calls == 1 && g_fake.unreachable_calls == 0);
+    EXPECT(stats().failovers == 0);
+
+    coze_set_endpoints(base, NULL, 0);
+    const char *down[] = {"http://a.down.fake", "http://b.down.fake"};
+    coze_set_endpoints("http://down.fake", down, 2);
+
+    begin("failover runs out of endpoints", (fake_script_t){.unreachable = "down.fake"});
+    EXPECT(get_bot("http://down.fake", "pat_failover", 0) == COZE_ERROR_NETWORK);
+    EXPECT(g_fake.calls == 2);
+    EXPECT(stats().failovers == 1);
+
+    coze_set_endpoints("http://down.fake", NULL, 0);
+    coze_set_retry_policy(NULL, NULL);
+}
+
+static void check_deadlines(void) {
+    const char *base = "http://deadline.fake";
+    double start = 0;
+
+    coze_set_retry_policy(NULL, &NO_RETRY);
+    begin("deadline reaches the transport", (fake_script_t){0});
+    EXPECT(get_bot(base, "pat_deadline", 5000) == COZE_OK);
+    EXPECT(g_fake.last_timeout_ms > 0 && g_fake.last_timeout_ms <= 5000);
+
+    const char *endpoints[] = {"http://a.deadline.fake", "http://b.deadline.fake"};
+    coze_set_endpoints(base, endpoints, 2);
+    begin("deadline exceeded before failover", (fake_script_t){.unreachable = "a.deadline", .delay_ms = 50});
+    EXPECT(get_bot(base, "pat_deadline", 10) == COZE_ERROR_DEADLINE_EXCEEDED);
+    EXPECT(g_fake.calls == 1);
+    coze_set_endpoints(base, NULL, 0);
+
+    coze_set_retry_policy(NULL, &RETRY_POLICY);
+    begin("deadline exceeded before retry", (fake_script_t){.statuses = {503}, .retry_after = "1"});
+    start = now_ms();
+    EXPECT(get_bot(base, "pat_deadline", 200) == COZE_ERROR_DEADLINE_EXCEEDED);
+    EXPECT(now_ms() - start < 1000);
+    EXPECT(g_fake.calls == 1);
+    EXPECT(stats().retry_giveups == 1);
+
+    coze_set_retry_policy(NULL, &NO_RETRY);
+    coze_set_rate_limit("/v1/bot", &(coze_rate_limit_t){.requests_per_second = 1, .burst = 1, .max_wait_ms = -1});
+    begin("deadline exceeded while queued", (fake_script_t){0});
+    EXPECT(get_bot(base, "pat_deadline", 0) == COZE_OK);
+    start = now_ms();
+    EXPECT(get_bot(base, "pat_deadline", 50) == COZE_ERROR_DEADLINE_EXCEEDED);
+    EXPECT(now_ms() - start < 500);
+    EXPECT(g_fake.calls == 1);
+
+    coze_set_rate_limit("/v1/bot", NULL);
+    coze_set_retry_policy(NULL, NULL);
+}
+
+int main() {
+    coze_log_enable(false); // 报告写 stdout, 不和 SDK 的请求日志混在一起
+    coze_set_transport(fake_transport, NULL);
+
+    check_retries();
+    check_rate_limits();
+    check_circuit();
+    check_failover();
+    check_deadlines();
+
+    coze_set_transport(NULL, NULL);
+
+    if (g_check.failures > 0) {
+        fprintf(stderr, "%d resilience check failures\n", g_check.failures);
+        return 1;
+    }
+    printf("all resilience checks passed\n");
+    return 0;
+}
@@ -2,6 +2,8 @@
 #define COZE_H
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
 // *** coze common ***
 typedef enum {
@@ -9,11 +11,28 @@ typedef enum {
     COZE_ERROR_INVALID_PARAM, // 无效参数
     COZE_ERROR_NETWORK, // 网络错误
     COZE_ERROR_API, // API 错误
-    COZE_ERROR_MEMORY // 内存分配错误
+    COZE_ERROR_MEMORY, // 内存分配错误
+    COZE_ERROR_RATE_LIMITED, // 本地限流, 请求没有发出, 见 coze_set_rate_limit
+    COZE_ERROR_CIRCUIT_OPEN, // api_base 已熔断, 请求没有发出, 见 coze_set_circuit_breaker
+    COZE_ERROR_DEADLINE_EXCEEDED // 超过请求的 timeout_ms, 之后的重试、对冲和排队中的请求都不再发出
 } coze_error_t;
 
+// Custom allocator, see coze_set_allocator and coze_client_config_t.
+// 自定义分配器
+typedef struct {
+    void *(*malloc_fn)(size_t size, void *ctx);
+    void *(*realloc_fn)(void *ptr, size_t size, void *ctx);
+    void (*free_fn)(void *ptr, void *ctx);
+    void *ctx;
+} coze_allocator_t;
+
+// Client holding api_token/api_base defaults and an optional allocator, see coze_client_create.
+// 客户端, 保存 api_token/api_base 默认值和可选的分配器
+typedef struct coze_client coze_client_t;
+
 typedef struct {
     const char *logid; // x-tt-logid header 值
+    const coze_allocator_t *allocator; // 内部使用: 分配该响应所用的分配器
 } coze_response_t;
 
 // *** coze common ***
@@ -125,6 +144,81 @@ typedef struct {
 // 中断。表示工作流中断，此时 data 字段中包含具体的中断信息。
 #define COZE_WORKFLOW_EVENT_TYPE_INTERRUPT "Interrupt"
 
+// workspace.role_type
+#define COZE_WORKSPACE_ROLE_TYPE_OWNER "owner"
+#define COZE_WORKSPACE_ROLE_TYPE_ADMIN "admin"
+#define COZE_WORKSPACE_ROLE_TYPE_MEMBER "member"
+
+// workspace.workspace_type
+#define COZE_WORKSPACE_TYPE_PERSONAL "personal"
+#define COZE_WORKSPACE_TYPE_TEAM "team"
+
+// Parsed responses point known values of the fields above at shared static strings and set the matching *_kind
+// field; compare the *_kind field instead of calling strcmp. Unknown values are kept as-is with kind 0 (UNKNOWN).
+// 解析响应时, 上述字段的已知取值指向共享的静态字符串, 并设置对应的 *_kind 字段; 未知取值保留原字符串, kind 为 0。
+
+typedef enum {
+    COZE_MESSAGE_ROLE_KIND_UNKNOWN = 0,
+    COZE_MESSAGE_ROLE_KIND_USER,
+    COZE_MESSAGE_ROLE_KIND_ASSISTANT
+} coze_message_role_kind_t;
+
+typedef enum {
+    COZE_MESSAGE_TYPE_KIND_UNKNOWN = 0,
+    COZE_MESSAGE_TYPE_KIND_QUESTION,
+    COZE_MESSAGE_TYPE_KIND_ANSWER,
+    COZE_MESSAGE_TYPE_KIND_FUNCTION_CALL,
+    COZE_MESSAGE_TYPE_KIND_TOOL_OUTPUT,
+    COZE_MESSAGE_TYPE_KIND_TOOL_RESPONSE,
+    COZE_MESSAGE_TYPE_KIND_FOLLOW_UP,
+    COZE_MESSAGE_TYPE_KIND_VERBOSE
+} coze_message_type_kind_t;
+
+typedef enum {
+    COZE_MESSAGE_CONTENT_TYPE_KIND_UNKNOWN = 0,
+    COZE_MESSAGE_CONTENT_TYPE_KIND_TEXT,
+    COZE_MESSAGE_CONTENT_TYPE_KIND_OBJECT_STRING,
+    COZE_MESSAGE_CONTENT_TYPE_KIND_CARD,
+    COZE_MESSAGE_CONTENT_TYPE_KIND_AUDIO
+} coze_message_content_type_kind_t;
+
+typedef enum {
+    COZE_CHAT_STATUS_KIND_UNKNOWN = 0,
+    COZE_CHAT_STATUS_KIND_CREATED,
+    COZE_CHAT_STATUS_KIND_IN_PROGRESS,
+    COZE_CHAT_STATUS_KIND_COMPLETED,
+    COZE_CHAT_STATUS_KIND_FAILED,
+    COZE_CHAT_STATUS_KIND_REQUIRES_ACTION,
+    COZE_CHAT_STATUS_KIND_CANCELED
+} coze_chat_status_kind_t;
+
+typedef enum {
+    COZE_EVENT_TYPE_KIND_UNKNOWN = 0,
+    COZE_EVENT_TYPE_KIND_CONVERSATION_CHAT_CREATED,
+    COZE_EVENT_TYPE_KIND_CONVERSATION_CHAT_IN_PROGRESS,
+    COZE_EVENT_TYPE_KIND_CONVERSATION_MESSAGE_DELTA,
+    COZE_EVENT_TYPE_KIND_CONVERSATION_MESSAGE_COMPLETED,
+    COZE_EVENT_TYPE_KIND_CONVERSATION_CHAT_COMPLETED,
+    COZE_EVENT_TYPE_KIND_CONVERSATION_CHAT_FAILED,
+    COZE_EVENT_TYPE_KIND_CONVERSATION_CHAT_REQUIRES_ACTION,
+    COZE_EVENT_TYPE_KIND_CONVERSATION_AUDIO_DELTA,
+    COZE_EVENT_TYPE_KIND_ERROR,
+    COZE_EVENT_TYPE_KIND_DONE
+} coze_event_type_kind_t;
+
+typedef enum {
+    COZE_WORKSPACE_ROLE_TYPE_KIND_UNKNOWN = 0,
+    COZE_WORKSPACE_ROLE_TYPE_KIND_OWNER,
+    COZE_WORKSPACE_ROLE_TYPE_KIND_ADMIN,
+    COZE_WORKSPACE_ROLE_TYPE_KIND_MEMBER
+} coze_workspace_role_type_kind_t;
+
+typedef enum {
+    COZE_WORKSPACE_TYPE_KIND_UNKNOWN = 0,
+    COZE_WORKSPACE_TYPE_KIND_PERSONAL,
+    COZE_WORKSPACE_TYPE_KIND_TEAM
+} coze_workspace_type_kind_t;
+
 // *** common ***
 
 typedef struct {
@@ -137,13 +231,37 @@ typedef struct {
 
     // response message
     const char *id; // 消息 ID
+    uint64_t id_u64; // id 的数值形式, 不是数字时为 0
     const char *conversation_id; // 会话 ID
+    uint64_t conversation_id_u64; // conversation_id 的数值形式, 不是数字时为 0
     const char *bot_id; // Bot ID
+    uint64_t bot_id_u64; // bot_id 的数值形式, 不是数字时为 0
     const char *chat_id; // 聊天 ID
+    uint64_t chat_id_u64; // chat_id 的数值形式, 不是数字时为 0
     long created_at; // 创建时间
     long updated_at; // 更新时间
+    coze_message_role_kind_t role_kind; // 仅响应: role 对应的枚举值
+    coze_message_type_kind_t type_kind; // 仅响应: type 对应的枚举值
+    coze_message_content_type_kind_t content_type_kind; // 仅响应: content_type 对应的枚举值
 } coze_message_t;
 
+// 列式的消息列表 (struct of arrays), 请求设置 columnar 时代替 messages 返回, 便于对大量消息做过滤和统计。
+// 每一列是 count 个元素的连续数组; 字符串内容统一放在 content_pool 中, 以 '\0' 结尾。
+typedef struct {
+    int count; // 消息数量
+    uint64_t *id; // 消息 ID 的数值形式, 不是数字时为 0
+    uint64_t *chat_id; // 聊天 ID 的数值形式, 不是数字时为 0
+    long *created_at; // 创建时间
+    long *updated_at; // 更新时间
+    uint8_t *role_kind; // coze_message_role_kind_t
+    uint8_t *type_kind; // coze_message_type_kind_t
+    uint8_t *content_type_kind; // coze_message_content_type_kind_t
+    uint32_t *content_offset; // 消息内容在 content_pool 中的偏移, 没有 content 时为 0 (空字符串)
+    uint32_t *content_length; // 消息内容的字节数, 不含结尾的 '\0'
+    char *content_pool;
+    size_t content_pool_size;
+} coze_message_columns_t;
+
 // *** common ***
 
 // *** auth.web_oauth.get_oauth_url ***
@@ -167,7 +285,9 @@ typedef struct {
 } coze_oauth_token_t;
 
 typedef struct {
+    coze_client_t *client; // 可选, 未设置 api_token/api_base 时使用 client 的配置
     const char *api_base; // API 基础 URL
+    int timeout_ms; // 可选, 整个调用 (连接、排队、重试和对冲) 的时限, 0 使用 client 的 timeout_ms
 
     const char *client_id; // 客户端 ID
     const char *client_secret; // 客户端密钥
@@ -194,7 +314,9 @@ typedef struct {
 } coze_web_oauth_refresh_access_token_response_t;
 
 typedef struct {
+    coze_client_t *client; // 可选, 未设置 api_token/api_base 时使用 client 的配置
     const char *api_base; // API 基础 URL
+    int timeout_ms; // 可选, 整个调用 (连接、排队、重试和对冲) 的时限, 0 使用 client 的 timeout_ms
 
     const char *client_id; // 客户端 ID
     const char *client_secret; // 客户端密钥
@@ -237,6 +359,7 @@ typedef struct {
 
 typedef struct {
     const char *bot_id; // Bot ID
+    uint64_t bot_id_u64; // bot_id 的数值形式, 不是数字时为 0
     const char *name; // Bot 名称
     const char *description; // Bot 描述
     const char *icon_url; // 图标 URL
@@ -259,8 +382,10 @@ typedef struct {
 } coze_bots_create_response_t;
 
 typedef struct {
+    coze_client_t *client; // 可选, 未设置 api_token/api_base 时使用 client 的配置
     const char *api_token;
     const char *api_base; // default: api.coze.cn
+    int timeout_ms; // 可选, 整个调用 (连接、排队、重试和对冲) 的时限, 0 使用 client 的 timeout_ms
 
     const char *space_id; // 工作空间 ID
     const char *name; // Bot 名称
@@ -281,10 +406,13 @@ typedef struct {
 } coze_bots_update_response_t;
 
 typedef struct {
+    coze_client_t *client; // 可选, 未设置 api_token/api_base 时使用 client 的配置
     const char *api_token;
     const char *api_base; // default: api.coze.cn
+    int timeout_ms; // 可选, 整个调用 (连接、排队、重试和对冲) 的时限, 0 使用 client 的 timeout_ms
 
     const char *bot_id; // Bot ID
+    uint64_t bot_id_u64; // bot_id 为 NULL 时使用的数值形式
     const char *name; // Bot 名称
     const char *description; // Bot 描述
     const char *icon_file_id; // 图标文件 ID
@@ -304,10 +432,13 @@ typedef struct {
 } coze_bots_publish_response_t;
 
 typedef struct {
+    coze_client_t *client; // 可选, 未设置 api_token/api_base 时使用 client 的配置
     const char *api_token;
     const char *api_base; // default: api.coze.cn
+    int timeout_ms; // 可选, 整个调用 (连接、排队、重试和对冲) 的时限, 0 使用 client 的 timeout_ms
 
     const char *bot_id; // Bot ID
+    uint64_t bot_id_u64; // bot_id 为 NULL 时使用的数值形式
     const char **connector_ids; // 连接器 ID 列表
     int connector_ids_count; // 连接器 ID 数量
 } coze_bots_publish_request_t;
@@ -318,6 +449,7 @@ typedef struct {
 
 typedef struct {
     const char *bot_id; // Bot ID
+    uint64_t bot_id_u64; // bot_id 的数值形式, 不是数字时为 0
     const char *bot_name; // Bot 名称
     const char *description; // Bot 描述
     const char *icon_url; // 图标 URL
@@ -338,12 +470,15 @@ typedef struct {
 } coze_bots_list_response_t;
 
 typedef struct {
+    coze_client_t *client; // 可选, 未设置 api_token/api_base 时使用 client 的配置
     const char *api_token;
     const char *api_base; // default: api.coze.cn
+    int timeout_ms; // 可选, 整个调用 (连接、排队、重试和对冲) 的时限, 0 使用 client 的 timeout_ms
 
     const char *space_id; // 空间 ID
     int page_num; // 页码，从 1 开始
     int page_size; // 每页数量
+    bool zero_copy; // 字符串字段直接指向保留的响应体, 不逐个复制
 } coze_bots_list_request_t;
 
 // *** bots.list ***
@@ -358,10 +493,13 @@ typedef struct {
 } coze_bots_retrieve_response_t;
 
 typedef struct {
+    coze_client_t *client; // 可选, 未设置 api_token/api_base 时使用 client 的配置
     const char *api_token;
     const char *api_base; // default: api.coze.cn
+    int timeout_ms; // 可选, 整个调用 (连接、排队、重试和对冲) 的时限, 0 使用 client 的 timeout_ms
 
     const char *bot_id; // Bot ID
+    uint64_t bot_id_u64; // bot_id 为 NULL 时使用的数值形式
 } coze_bots_retrieve_request_t;
 
 // *** bots.retrieve ***
@@ -374,6 +512,8 @@ typedef struct {
     const char *icon_url; // 图标 URL
     const char *role_type; // 角色类型
     const char *workspace_type; // 工作空间类型
+    coze_workspace_role_type_kind_t role_type_kind;
+    coze_workspace_type_kind_t workspace_type_kind;
 } coze_workspace_t;
 
 typedef struct {
@@ -390,11 +530,14 @@ typedef struct {
 } coze_workspaces_list_response_t;
 
 typedef struct {
+    coze_client_t *client; // 可选, 未设置 api_token/api_base 时使用 client 的配置
     const char *api_token;
     const char *api_base; // default: api.coze.cn
+    int timeout_ms; // 可选, 整个调用 (连接、排队、重试和对冲) 的时限, 0 使用 client 的 timeout_ms
 
     int page_num; // 页码，从 1 开始
     int page_size; // 每页数量
+    bool zero_copy; // 字符串字段直接指向保留的响应体, 不逐个复制
 } coze_workspaces_list_request_t;
 
 // *** workspaces list ***
@@ -403,6 +546,7 @@ typedef struct {
 
 typedef struct {
     const char *id; // 会话 ID
+    uint64_t id_u64; // id 的数值形式, 不是数字时为 0
     long created_at; // 创建时间
     const char *last_section_id; // 最后一个 section ID
     // const char *meta_data;
@@ -420,11 +564,14 @@ typedef struct {
 } coze_conversations_create_response_t;
 
 typedef struct {
+    coze_client_t *client; // 可选, 未设置 api_token/api_base 时使用 client 的配置
     const char *api_token;
     const char *api_base; // default: api.coze.cn
+    int timeout_ms; // 可选, 整个调用 (连接、排队、重试和对冲) 的时限, 0 使用 client 的 timeout_ms
 
 
     const char *bot_id; // Bot ID
+    uint64_t bot_id_u64; // bot_id 为 NULL 时使用的数值形式
     coze_message_t *messages; // 消息列表
     int message_count; // 消息数量
     // const char *meta_data; // 元数据，可选的键值对
@@ -442,10 +589,13 @@ typedef struct {
 } coze_conversations_retrieve_response_t;
 
 typedef struct {
+    coze_client_t *client; // 可选, 未设置 api_token/api_base 时使用 client 的配置
     const char *api_token;
     const char *api_base; // default: api.coze.cn
+    int timeout_ms; // 可选, 整个调用 (连接、排队、重试和对冲) 的时限, 0 使用 client 的 timeout_ms
 
     const char *conversation_id; // 会话 ID
+    uint64_t conversation_id_u64; // conversation_id 为 NULL 时使用的数值形式
 } coze_conversations_retrieve_request_t;
 
 // *** conversations.retrieve ***
@@ -460,11 +610,14 @@ typedef struct {
 } coze_conversations_messages_create_response_t;
 
 typedef struct {
+    coze_client_t *client; // 可选, 未设置 api_token/api_base 时使用 client 的配置
     const char *api_token;
     const char *api_base; // default: api.coze.cn
+    int timeout_ms; // 可选, 整个调用 (连接、排队、重试和对冲) 的时限, 0 使用 client 的 timeout_ms
 
 
     const char *conversation_id; // 会话 ID
+    uint64_t conversation_id_u64; // conversation_id 为 NULL 时使用的数值形式
     const char *role; // COZE_MESSAGE_ROLE_USER 或 COZE_MESSAGE_ROLE_ASSISTANT
     const char *content; // 消息内容
     const char *content_type; // COZE_MESSAGE_CONTENT_TYPE_TEXT 或 COZE_MESSAGE_CONTENT_TYPE_OBJECT_STRING
@@ -481,6 +634,7 @@ typedef struct {
     const char *first_id; // 返回的消息列表中，第一条消息的 Message ID。
     const char *last_id; // 返回的消息列表中，最后一条消息的 Message ID。
     bool has_more; // 是否已返回全部消息。
+    coze_message_columns_t columns; // 请求设置 columnar 时的列式结果
 } coze_conversations_messages_list_data_t;
 
 typedef struct {
@@ -491,15 +645,21 @@ typedef struct {
 } coze_conversations_messages_list_response_t;
 
 typedef struct {
+    coze_client_t *client; // 可选, 未设置 api_token/api_base 时使用 client 的配置
     const char *api_token;
     const char *api_base; // default: api.coze.cn
+    int timeout_ms; // 可选, 整个调用 (连接、排队、重试和对冲) 的时限, 0 使用 client 的 timeout_ms
 
     const char *conversation_id; // 会话 ID
+    uint64_t conversation_id_u64; // conversation_id 为 NULL 时使用的数值形式
     const char *order; // COZE_ORDER_DESC 或 COZE_ORDER_ASC
     const char *chat_id; // 待查看的 Chat ID。
+    uint64_t chat_id_u64; // chat_id 为 NULL 时使用的数值形式
     const char *before_id; // 查看指定位置之前的消息。
     const char *after_id; // 查看指定位置之后的消息。
     int limit; // 每次查询返回的数据量。默认为 50，取值范围为 1~50。
+    bool zero_copy; // 字符串字段直接指向保留的响应体, 不逐个复制
+    bool columnar; // 解码为 data.columns, 不填充 messages
 } coze_conversations_messages_list_request_t;
 
 // *** conversations.messages.list ***
@@ -514,11 +674,15 @@ typedef struct {
 } coze_conversations_messages_retrieve_response_t;
 
 typedef struct {
+    coze_client_t *client; // 可选, 未设置 api_token/api_base 时使用 client 的配置
     const char *api_token;
     const char *api_base; // default: api.coze.cn
+    int timeout_ms; // 可选, 整个调用 (连接、排队、重试和对冲) 的时限, 0 使用 client 的 timeout_ms
 
     const char *conversation_id; // 会话 ID
+    uint64_t conversation_id_u64; // conversation_id 为 NULL 时使用的数值形式
     const char *message_id; // 消息 ID
+    uint64_t message_id_u64; // message_id 为 NULL 时使用的数值形式
 } coze_conversations_messages_retrieve_request_t;
 
 // *** conversations.messages.retrieve ***
@@ -533,11 +697,15 @@ typedef struct {
 } coze_conversations_messages_update_response_t;
 
 typedef struct {
+    coze_client_t *client; // 可选, 未设置 api_token/api_base 时使用 client 的配置
     const char *api_token;
     const char *api_base; // default: api.coze.cn
+    int timeout_ms; // 可选, 整个调用 (连接、排队、重试和对冲) 的时限, 0 使用 client 的 timeout_ms
 
     const char *conversation_id; // 会话 ID
+    uint64_t conversation_id_u64; // conversation_id 为 NULL 时使用的数值形式
     const char *message_id; // 消息 ID
+    uint64_t message_id_u64; // message_id 为 NULL 时使用的数值形式
     const char *content; // 消息内容
     const char *content_type; // COZE_MESSAGE_CONTENT_TYPE_TEXT 或 COZE_MESSAGE_CONTENT_TYPE_OBJECT_STRING
 } coze_conversations_messages_update_request_t;
@@ -554,11 +722,15 @@ typedef struct {
 } coze_conversations_messages_delete_response_t;
 
 typedef struct {
+    coze_client_t *client; // 可选, 未设置 api_token/api_base 时使用 client 的配置
     const char *api_token;
     const char *api_base; // default: api.coze.cn
+    int timeout_ms; // 可选, 整个调用 (连接、排队、重试和对冲) 的时限, 0 使用 client 的 timeout_ms
 
     const char *conversation_id; // 会话 ID
+    uint64_t conversation_id_u64; // conversation_id 为 NULL 时使用的数值形式
     const char *message_id; // 消息 ID
+    uint64_t message_id_u64; // message_id 为 NULL 时使用的数值形式
 } coze_conversations_messages_delete_request_t;
 
 // *** conversations.messages.delete ***
@@ -600,8 +772,11 @@ typedef struct {
 
 typedef struct {
     const char *id; // 对话 ID
+    uint64_t id_u64; // id 的数值形式, 不是数字时为 0
     const char *conversation_id; // 会话 ID
+    uint64_t conversation_id_u64; // conversation_id 的数值形式, 不是数字时为 0
     const char *bot_id; // Bot ID
+    uint64_t bot_id_u64; // bot_id 的数值形式, 不是数字时为 0
     long created_at; // 创建时间
     long completed_at; // 结束时间
     // const char *meta_data; // 元数据
@@ -610,6 +785,7 @@ typedef struct {
     // 状态: COZE_CHAT_STATUS_CREATED, COZE_CHAT_STATUS_IN_PROGRESS, COZE_CHAT_STATUS_COMPLETED, COZE_CHAT_STATUS_FAILED, COZE_CHAT_STATUS_REQUIRES_ACTION, COZE_CHAT_STATUS_CANCELED
     coze_chat_required_action_t required_action; // 需要运行的信息详情
     coze_chat_usage_t usage; // Token 消耗的详细信息
+    coze_chat_status_kind_t status_kind; // status 对应的枚举值
 } coze_chat_t;
 
 typedef struct {
@@ -620,11 +796,15 @@ typedef struct {
 } coze_chat_create_response_t;
 
 typedef struct {
+    coze_client_t *client; // 可选, 未设置 api_token/api_base 时使用 client 的配置
     const char *api_token;
     const char *api_base; // default: api.coze.cn
+    int timeout_ms; // 可选, 整个调用 (连接、排队、重试和对冲) 的时限, 0 使用 client 的 timeout_ms
 
     const char *conversation_id; // 会话 ID
+    uint64_t conversation_id_u64; // conversation_id 为 NULL 时使用的数值形式
     const char *bot_id; // Bot ID
+    uint64_t bot_id_u64; // bot_id 为 NULL 时使用的数值形式
     const char *user_id; // 用户 ID
     coze_message_t *additional_messages; // 消息内容
     int additional_messages_count; // 消息数量
@@ -639,6 +819,7 @@ typedef struct {
     // COZE_EVENT_TYPE_CONVERSATION_CHAT_CREATED, COZE_EVENT_TYPE_CONVERSATION_CHAT_IN_PROGRESS, COZE_EVENT_TYPE_CONVERSATION_CHAT_COMPLETED, COZE_EVENT_TYPE_CONVERSATION_CHAT_FAILED, COZE_EVENT_TYPE_CONVERSATION_CHAT_REQUIRES_ACTION, COZE_EVENT_TYPE_CONVERSATION_CHAT_CANCELED
     coze_chat_t *chat; // 对话信息
     coze_message_t *message; // 消息信息，可选
+    coze_event_type_kind_t event_kind; // event 对应的枚举值
 } coze_chat_event_t;
 
 typedef struct {
@@ -648,17 +829,27 @@ typedef struct {
 } coze_chat_stream_response_t;
 
 typedef struct {
+    coze_client_t *client; // 可选, 未设置 api_token/api_base 时使用 client 的配置
     const char *api_token;
     const char *api_base; // default: api.coze.cn
+    int timeout_ms; // 可选, 整个调用 (连接、排队、重试和对冲) 的时限, 0 使用 client 的 timeout_ms
 
     const char *conversation_id; // 会话 ID
+    uint64_t conversation_id_u64; // conversation_id 为 NULL 时使用的数值形式
     const char *bot_id; // Bot ID
+    uint64_t bot_id_u64; // bot_id 为 NULL 时使用的数值形式
     const char *user_id; // 用户 ID
     coze_message_t *additional_messages; // 消息内容
     int additional_messages_count; // 消息数量
     bool auto_save_history; // 是否自动保存历史
-
-    void (*on_event)(const coze_chat_event_t *event);
+    // Time-to-first-token hedging: if no conversation.message.delta arrives within this many ms, a second stream
+    // with auto_save_history disabled is started; the first stream to produce a delta wins and the other is
+    // aborted and cancelled as soon as its chat id is known. 0 disables. Only applies to the built-in curl
+    // transport, and is ignored while coze_vcr_record_start is recording.
+    // 首 token 对冲: 超过该毫秒数没有 delta 时再开一个不保存历史的流, 先出 delta 的胜出, 另一个中止并取消。0 关闭
+    int hedge_ttft_ms;
+
+    void (*on_event)(const coze_chat_event_t *event); // event 只在回调期间有效, 需要保留的字段请自行复制
 } coze_chat_stream_request_t;
 
 // *** chat.stream ***
@@ -673,11 +864,15 @@ typedef struct {
 } coze_chat_retrieve_response_t;
 
 typedef struct {
+    coze_client_t *client; // 可选, 未设置 api_token/api_base 时使用 client 的配置
     const char *api_token;
     const char *api_base; // default: api.coze.cn
+    int timeout_ms; // 可选, 整个调用 (连接、排队、重试和对冲) 的时限, 0 使用 client 的 timeout_ms
 
     const char *conversation_id; // 会话 ID
+    uint64_t conversation_id_u64; // conversation_id 为 NULL 时使用的数值形式
     const char *chat_id; // 对话 ID
+    uint64_t chat_id_u64; // chat_id 为 NULL 时使用的数值形式
 } coze_chat_retrieve_request_t;
 
 // *** chat.retrieve ***
@@ -687,6 +882,7 @@ typedef struct {
 typedef struct {
     coze_message_t *messages; // 消息列表
     int messages_count; // 消息数量
+    coze_message_columns_t columns; // 请求设置 columnar 时的列式结果
 } coze_chat_messages_list_data_t;
 
 typedef struct {
@@ -697,11 +893,17 @@ typedef struct {
 } coze_chat_messages_list_response_t;
 
 typedef struct {
+    coze_client_t *client; // 可选, 未设置 api_token/api_base 时使用 client 的配置
     const char *api_token;
     const char *api_base; // default: api.coze.cn
+    int timeout_ms; // 可选, 整个调用 (连接、排队、重试和对冲) 的时限, 0 使用 client 的 timeout_ms
 
     const char *conversation_id; // 会话 ID
+    uint64_t conversation_id_u64; // conversation_id 为 NULL 时使用的数值形式
     const char *chat_id; // 对话 ID
+    uint64_t chat_id_u64; // chat_id 为 NULL 时使用的数值形式
+    bool zero_copy; // 字符串字段直接指向保留的响应体, 不逐个复制
+    bool columnar; // 解码为 data.columns, 不填充 messages
 } coze_chat_messages_list_request_t;
 
 // *** chat.messages.list ***
@@ -721,11 +923,15 @@ typedef struct {
 } coze_chat_submit_tool_outputs_create_response_t;
 
 typedef struct {
+    coze_client_t *client; // 可选, 未设置 api_token/api_base 时使用 client 的配置
     const char *api_token;
     const char *api_base; // default: api.coze.cn
+    int timeout_ms; // 可选, 整个调用 (连接、排队、重试和对冲) 的时限, 0 使用 client 的 timeout_ms
 
     const char *conversation_id; // 会话 ID
+    uint64_t conversation_id_u64; // conversation_id 为 NULL 时使用的数值形式
     const char *chat_id; // 对话 ID
+    uint64_t chat_id_u64; // chat_id 为 NULL 时使用的数值形式
     coze_tool_output_t *tool_outputs; // 工具输出列表
     int tool_outputs_count; // 工具输出数量
 } coze_chat_submit_tool_outputs_create_request_t;
@@ -742,11 +948,15 @@ typedef struct {
 } coze_chat_cancel_response_t;
 
 typedef struct {
+    coze_client_t *client; // 可选, 未设置 api_token/api_base 时使用 client 的配置
     const char *api_token;
     const char *api_base; // default: api.coze.cn
+    int timeout_ms; // 可选, 整个调用 (连接、排队、重试和对冲) 的时限, 0 使用 client 的 timeout_ms
 
     const char *conversation_id; // 会话 ID
+    uint64_t conversation_id_u64; // conversation_id 为 NULL 时使用的数值形式
     const char *chat_id; // 对话 ID
+    uint64_t chat_id_u64; // chat_id 为 NULL 时使用的数值形式
 } coze_chat_cancel_request_t;
 
 // *** chat.cancel ***
@@ -755,6 +965,7 @@ typedef struct {
 
 typedef struct {
     const char *id; // 文件 ID
+    uint64_t id_u64; // id 的数值形式, 不是数字时为 0
     const char *file_name; // 文件名
     int created_at; // 创建时间
     long bytes; // 文件大小
@@ -768,8 +979,10 @@ typedef struct {
 } coze_files_upload_response_t;
 
 typedef struct {
+    coze_client_t *client; // 可选, 未设置 api_token/api_base 时使用 client 的配置
     const char *api_token;
     const char *api_base; // default: api.coze.cn
+    int timeout_ms; // 可选, 整个调用 (连接、排队、重试和对冲) 的时限, 0 使用 client 的 timeout_ms
 
     const char *file; // 文件路径
 } coze_files_upload_request_t;
@@ -786,10 +999,13 @@ typedef struct {
 } coze_files_retrieve_response_t;
 
 typedef struct {
+    coze_client_t *client; // 可选, 未设置 api_token/api_base 时使用 client 的配置
     const char *api_token;
     const char *api_base; // default: api.coze.cn
+    int timeout_ms; // 可选, 整个调用 (连接、排队、重试和对冲) 的时限, 0 使用 client 的 timeout_ms
 
     const char *file_id; // 文件 ID
+    uint64_t file_id_u64; // file_id 为 NULL 时使用的数值形式
 } coze_files_retrieve_request_t;
 
 // *** files.retrieve ***
@@ -810,11 +1026,14 @@ typedef struct {
 } coze_workflows_runs_create_response_t;
 
 typedef struct {
+    coze_client_t *client; // 可选, 未设置 api_token/api_base 时使用 client 的配置
     const char *api_token;
     const char *api_base; // default: api.coze.cn
+    int timeout_ms; // 可选, 整个调用 (连接、排队、重试和对冲) 的时限, 0 使用 client 的 timeout_ms
 
     const char *workflow_id; // 工作流 ID
     const char *bot_id; // Bot ID
+    uint64_t bot_id_u64; // bot_id 为 NULL 时使用的数值形式
     bool is_async; // 是否异步执行
 } coze_workflows_runs_create_request_t;
 
@@ -862,13 +1081,16 @@ typedef struct {
 } coze_workflows_runs_stream_response_t;
 
 typedef struct {
+    coze_client_t *client; // 可选, 未设置 api_token/api_base 时使用 client 的配置
     const char *api_token;
     const char *api_base; // default: api.coze.cn
+    int timeout_ms; // 可选, 整个调用 (连接、排队、重试和对冲) 的时限, 0 使用 client 的 timeout_ms
 
     const char *workflow_id; // 工作流 ID
     const char *bot_id; // Bot ID
+    uint64_t bot_id_u64; // bot_id 为 NULL 时使用的数值形式
 
-    void (*on_event)(const coze_workflow_event_t *event);
+    void (*on_event)(const coze_workflow_event_t *event); // event 只在回调期间有效, 需要保留的字段请自行复制
 } coze_workflows_runs_stream_request_t;
 
 // *** workflows.runs.stream ***
@@ -882,13 +1104,16 @@ typedef struct {
 } coze_workflows_runs_resume_response_t;
 
 typedef struct {
+    coze_client_t *client; // 可选, 未设置 api_token/api_base 时使用 client 的配置
     const char *api_token;
     const char *api_base; // default: api.coze.cn
+    int timeout_ms; // 可选, 整个调用 (连接、排队、重试和对冲) 的时限, 0 使用 client 的 timeout_ms
 
     const char *workflow_id; // 工作流 ID
     const char *bot_id; // Bot ID
+    uint64_t bot_id_u64; // bot_id 为 NULL 时使用的数值形式
 
-    void (*on_event)(const coze_workflow_event_t *event);
+    void (*on_event)(const coze_workflow_event_t *event); // event 只在回调期间有效, 需要保留的字段请自行复制
 } coze_workflows_runs_resume_request_t;
 
 // *** workflows.runs.resume ***
@@ -922,12 +1147,15 @@ typedef struct {
 } coze_audio_voices_list_response_t;
 
 typedef struct {
+    coze_client_t *client; // 可选, 未设置 api_token/api_base 时使用 client 的配置
     const char *api_token;
     const char *api_base; // default: api.coze.cn
+    int timeout_ms; // 可选, 整个调用 (连接、排队、重试和对冲) 的时限, 0 使用 client 的 timeout_ms
 
     bool filter_system_voice; // 是否过滤系统语音, 默认不过滤
     int page_num; // 页码, 从 1 开始
     int page_size; // 每页数量, 不传默认 100，传值需要(0, 100]
+    bool zero_copy; // 字符串字段直接指向保留的响应体, 不逐个复制
 } coze_audio_voices_list_request_t;
 
 // *** audio.voices.list ***
@@ -949,11 +1177,15 @@ typedef struct {
 } coze_audio_rooms_create_response_t;
 
 typedef struct {
+    coze_client_t *client; // 可选, 未设置 api_token/api_base 时使用 client 的配置
     const char *api_token;
     const char *api_base; // default: api.coze.cn
+    int timeout_ms; // 可选, 整个调用 (连接、排队、重试和对冲) 的时限, 0 使用 client 的 timeout_ms
 
     const char *bot_id; // Bot ID
+    uint64_t bot_id_u64; // bot_id 为 NULL 时使用的数值形式
     const char *conversation_id; // 会话 ID
+    uint64_t conversation_id_u64; // conversation_id 为 NULL 时使用的数值形式
     const char *voice_id; // 语音 ID
 } coze_audio_rooms_create_request_t;
 
@@ -1175,4 +1407,290 @@ coze_error_t coze_audio_rooms_create(const coze_audio_rooms_create_request_t *re
 
 void coze_free_audio_rooms_create_response(coze_audio_rooms_create_response_t *resp);
 
+// *** logging ***
+
+// The SDK logs every request, response, retry, failover, circuit change and chat stream event to stdout.
+// Enabled by default; tools that write their own report to stdout turn it off. Safe to call at any time.
+// SDK 把请求、响应、重试、故障转移、熔断和对话流事件的日志打印到 stdout, 默认打开, 可随时关闭。
+void coze_log_enable(bool enabled);
+
+// *** logging ***
+
+// *** transport ***
+
+// The SDK hands every request to a transport and receives the response through a sink. By default requests go
+// through curl; coze_set_transport replaces it, e.g. with a fake transport serving canned responses.
+// SDK 的所有请求都交给 transport 执行, 响应经 sink 回到 SDK。默认使用 curl, 可替换为自定义实现。
+
+typedef struct coze_transport_sink coze_transport_sink_t;
+
+typedef struct {
+    const char *method; // "GET" 或 "POST"
+    const char *url; // 完整 URL
+    const char *path; // 请求路径, 包含 query
+    const char *api_token; // Bearer token, 可能为 NULL
+    const char *body; // JSON 请求体, 可能为 NULL
+    const char *upload_file; // 非 NULL 时以 multipart/form-data 上传该文件 (字段名 "file"), body 为 NULL
+    bool stream; // 是否为 SSE 请求
+    int timeout_ms; // 距离调用时限的剩余时间, 0 表示不限; 超时应返回 COZE_ERROR_DEADLINE_EXCEEDED
+} coze_transport_request_t;
+
+// Returns COZE_OK once the whole response has been delivered to the sink.
+// 响应全部交给 sink 后返回 COZE_OK, 连接失败返回 COZE_ERROR_NETWORK
+typedef coze_error_t (*coze_transport_fn)(const coze_transport_request_t *req, coze_transport_sink_t *sink,
+                                          void *ctx);
+
+// Deliver one response header line (status line included, "\r\n" optional) to the SDK.
+// 交给 SDK 一行响应头
+size_t coze_transport_sink_header(coze_transport_sink_t *sink, const char *line, size_t len);
+
+// Deliver one chunk of the response body to the SDK. Returns len on success.
+// 交给 SDK 一段响应体, 成功时返回 len
+size_t coze_transport_sink_body(coze_transport_sink_t *sink, const char *data, size_t len);
+
+// Report that no connection could be made, so nothing was sent; then return COZE_ERROR_NETWORK. Like curl's connect
+// failures this pauses the endpoint and moves the request to the next one of its coze_set_endpoints group.
+// 没有连上服务端、请求一定没有发出时调用, 之后返回 COZE_ERROR_NETWORK; 请求会换到端点组中的下一个端点
+void coze_transport_sink_connect_failed(coze_transport_sink_t *sink);
+
+// Replace the transport for all subsequent requests; NULL restores curl. Not thread-safe, call before issuing requests.
+// 替换之后所有请求使用的 transport, 传 NULL 恢复 curl。非线程安全, 需在发起请求前调用。
+void coze_set_transport(coze_transport_fn transport, void *ctx);
+
+// Non-streaming requests advertise Accept-Encoding (gzip, deflate, and br/zstd when curl has them) and the
+// response is decompressed incrementally as it arrives. SSE streams are never compressed. Enabled by default;
+// like coze_set_transport, call before issuing requests.
+// 非 SSE 请求默认接受压缩响应, 由 curl 边接收边解压; 传 false 关闭。需在发起请求前调用。
+void coze_set_response_compression(bool enabled);
+
+// *** transport ***
+
+// *** retry ***
+
+typedef struct {
+    int max_attempts; // 含首次请求的总次数, <= 1 表示不重试
+    int base_delay_ms; // 第 n 次重试前等待 base_delay_ms * 2^(n-1), 不超过 max_delay_ms
+    int max_delay_ms;
+    double jitter; // 0~1, 等待时间随机缩短的最大比例; 1 为 full jitter
+    bool retry_network_errors; // 连接失败, 或收到响应体之前断开
+    bool retry_server_errors; // HTTP 5xx
+    bool retry_throttled; // HTTP 429
+    bool honor_retry_after; // 按 Retry-After 等待; 超过 max_delay_ms 时不重试
+    bool retry_non_idempotent; // 也重试 create/update/chat 等非幂等接口
+} coze_retry_policy_t;
+
+// Non-streaming requests are retried according to the policy of their endpoint path (without query, e.g.
+// "/v1/bot/get_online_info"), or the default policy when path is NULL. Out of the box, reads (GET endpoints and
+// message lists) are tried up to 3 times on network errors, 5xx and 429 with jittered exponential backoff and
+// Retry-After; other endpoints only when their policy sets retry_non_idempotent. A response is never retried once
+// part of its body has been decoded. A NULL policy removes a path's override or restores the default.
+// Not thread-safe, call before issuing requests.
+// 非 SSE 请求按接口路径 (不含 query) 的策略自动重试, path 为 NULL 时设置默认策略。默认只重试只读接口。
+coze_error_t coze_set_retry_policy(const char *path, const coze_retry_policy_t *policy);
+
+// *** retry ***
+
+// *** rate limit ***
+
+typedef struct {
+    double requests_per_second; // 令牌桶速率, <= 0 不限速率
+    int burst; // 桶容量, <= 0 时为 1
+    int max_in_flight; // 同时进行的请求数上限, <= 0 不限
+    int max_wait_ms; // 拿不到许可时最多排队多久, 0 立即失败, < 0 一直等
+    bool adapt_to_throttling; // 收到 429 时速率降到 70% 并在 Retry-After 内暂停, 之后回升并停在触发 429 的速率以下
+    bool adaptive_concurrency; // 并发上限从 8 开始按首字节延迟和 429/5xx/网络错误自动调整, 不超过 max_in_flight
+} coze_rate_limit_t;
+
+typedef struct {
+    double requests_per_second; // 当前速率, 0 表示不限
+    int in_flight_limit; // 当前并发上限, 0 表示不限
+    int in_flight;
+    int queued; // 正在排队等许可的请求数
+} coze_rate_limit_state_t;
+
+// Limit requests per (api_token, endpoint family). The family is the first two path segments, e.g. "/v3/chat"
+// covers chat create/stream/retrieve/cancel and "/v1/conversation" covers conversations and their messages;
+// NULL sets the limit for families without their own. Each token and family pair gets a token bucket and an
+// in-flight counter; requests wait up to max_wait_ms and then fail with COZE_ERROR_RATE_LIMITED without being
+// sent. Every retry attempt takes its own permit; a hedged read shares one. A NULL limit removes it.
+// Changing a limit while requests run applies to existing buckets in place; permits already held stay valid.
+// 按 (api_token, 接口族) 限制速率和并发, 接口族为路径前两段; family 为 NULL 时设置默认限制。
+coze_error_t coze_set_rate_limit(const char *family, const coze_rate_limit_t *limit);
+
+// Current rate, in-flight limit, in-flight count and queue depth of one (api_token, endpoint family) pair, e.g.
+// to export as metrics; all zero when no limited request has used the pair yet.
+// 查询一个 (api_token, 接口族) 的限流状态。
+coze_error_t coze_get_rate_limit_state(const char *api_token, const char *family, coze_rate_limit_state_t *state);
+
+// *** rate limit ***
+
+// *** circuit breaker ***
+
+typedef struct {
+    int window; // 统计最近多少个请求, 默认 20, 最多 100
+    int min_requests; // 窗口内至少有多少个请求才判断, 默认 10
+    int failure_percent; // 网络错误和 5xx 的占比达到该值时断开, 默认 50
+    int slow_call_ms; // 首字节晚于该时间的请求算慢请求, <= 0 不统计
+    int slow_percent; // 慢请求的占比达到该值时断开, 默认 80
+    int open_ms; // 断开多久后进入半开, 默认 5000
+    int probes; // 半开时放行的探测请求数, 全部成功才闭合, 任一失败重新断开, 默认 3
+} coze_circuit_breaker_t;
+
+// Give every api_base a circuit breaker. While closed, the outcomes of the last `window` requests are tracked; once the
+// share of network errors and 5xx responses, or of calls slower than slow_call_ms to the first byte, crosses its
+// threshold the circuit opens and requests to that api_base fail immediately with COZE_ERROR_CIRCUIT_OPEN without being
+// sent. After open_ms it lets `probes` requests through: if they all succeed it closes again, otherwise it reopens.
+// Probes still outstanding after another open_ms (an upstream that accepts and then hangs) are written off and a new
+// set is let through. 429 responses are throttling, not failures, and do not count. Zero fields take the defaults
+// above; a NULL policy turns circuit breaking off. Changing the policy closes every circuit.
+// 按 api_base 熔断, policy 为 NULL 时关闭。
+void coze_set_circuit_breaker(const coze_circuit_breaker_t *policy);
+
+// *** circuit breaker ***
+
+// *** endpoints ***
+
+// Serve requests for api_base (NULL for the default https://api.coze.cn) through up to 8 equivalent endpoints, e.g.
+// regional gateways or proxies. Each request picks the endpoint with the lowest latency EWMA (time to first byte)
+// weighted by its requests in flight; endpoints that have not been used for 2 s get one request to refresh their
+// estimate, and 5xx responses count as 1 s. A connect failure pauses the endpoint with exponential backoff (1 s up
+// to 30 s) and the request moves to the next endpoint at once, as does a request whose endpoint's circuit is open;
+// nothing was sent, so this is safe for non-idempotent requests too and does not use up retries. Circuit breakers
+// are kept per endpoint. count 0 removes the group.
+// 为 api_base 配置一组等价端点, 每个请求按健康状况和延迟选择, 连接失败时切换到下一个。
+coze_error_t coze_set_endpoints(const char *api_base, const char *const *endpoints, int count);
+
+// *** endpoints ***
+
+// *** hedging ***
+
+typedef struct {
+    bool enabled;
+    double percentile; // 对冲延迟取该接口最近 128 次延迟的这个分位数, 如 95
+    int initial_delay_ms; // 样本不足 16 个时使用的对冲延迟
+    int min_delay_ms; // 对冲延迟下限
+    double max_hedge_percent; // 对冲请求最多占读请求的百分比, 如 5
+} coze_hedging_policy_t;
+
+// Hedge idempotent reads (the requests coze_set_retry_policy treats as reads): when no response body has arrived
+// after the endpoint's recent latency percentile, send a duplicate on another connection, use whichever response
+// starts first and abort the other. Hedges are capped at max_hedge_percent of reads. Only applies to the built-in
+// curl transport. NULL disables hedging. Call before issuing requests.
+// 对冲只读请求: 超过该接口最近延迟的分位数仍未收到响应体时在另一个连接上重发, 先响应的胜出, 另一个中止。
+void coze_set_hedging_policy(const coze_hedging_policy_t *policy);
+
+// *** hedging ***
+
+// *** transfer stats ***
+
+typedef struct {
+    size_t requests; // 经 curl 完成的请求数
+    size_t compressed_requests; // 其中响应带 Content-Encoding 的请求数
+    size_t wire_bytes; // 网络上收到的响应体字节数 (解压前)
+    size_t body_bytes; // 交给 SDK 解码的响应体字节数 (解压后)
+    size_t retries; // 自动重试的次数
+    size_t retry_giveups; // 用完重试次数后仍然失败的请求数
+    size_t hedges; // 发出的对冲请求数
+    size_t hedge_wins; // 对冲请求先于原请求收到响应的次数
+    size_t throttled; // 收到 HTTP 429 的次数
+    size_t rate_limited; // 被本地限流拒绝、没有发出的请求数
+    uint64_t rate_limit_wait_us; // 在本地限流中排队的总时间
+    size_t circuit_trips; // 熔断器断开的次数
+    size_t circuit_rejected; // 因熔断直接失败、没有发出的请求数
+    size_t failovers; // 连不上或已熔断, 换到同组其他端点重发的次数
+    size_t new_connections; // 请求新建的连接数, 用上连接池里的连接时不增加; 预热和保活建立的不计入
+} coze_transfer_stats_t;
+
+// Response body bytes received over the network versus decoded, summed over every curl request.
+// 累计所有 curl 请求的响应体字节数: 网络上收到的和解压后交给 SDK 的
+void coze_transfer_stats_reset(void);
+
+void coze_transfer_stats_get(coze_transfer_stats_t *stats);
+
+// *** transfer stats ***
+
+// *** vcr ***
+
+typedef enum {
+    COZE_VCR_PACING_ORIGINAL = 0, // 按录制时的到达时间回放
+    COZE_VCR_PACING_FULL_SPEED // 不等待, 全速回放
+} coze_vcr_pacing_t;
+
+// Record every request (method, path, body) and its response headers and body/SSE chunks, with arrival
+// timestamps, into a compact binary file. The api token is never written.
+// 录制之后所有请求的 method、path、body, 以及响应头和响应体分片(含到达时间)到二进制文件, 不记录 api_token
+coze_error_t coze_vcr_record_start(const char *path);
+
+// Serve recorded responses instead of the network. Requests are matched by method + path; repeated recordings
+// of the same request are replayed in turn. Unmatched requests fail with COZE_ERROR_NETWORK.
+// 回放录制文件, 不再访问网络。按 method + path 匹配, 同一请求的多次录制依次轮流回放。
+coze_error_t coze_vcr_replay_start(const char *path, coze_vcr_pacing_t pacing);
+
+// Stop recording or replaying. Call only when no request is in flight.
+// 停止录制或回放, 需在没有进行中的请求时调用
+void coze_vcr_stop(void);
+
+// *** vcr ***
+
+// *** allocation stats ***
+
+typedef struct {
+    size_t allocations; // malloc/calloc 次数, 含 cJSON
+    size_t reallocs;
+    size_t frees;
+    size_t bytes; // 累计申请字节数
+    size_t live; // allocations - frees, 未释放的分配数
+} coze_alloc_stats_t;
+
+// Count every heap allocation made by the SDK, including cJSON's (installed through cJSON_InitHooks).
+// Enable or disable only while no request is in flight.
+// 统计 SDK 的所有堆分配, 包括 cJSON 的分配。只能在没有进行中的请求时切换。
+void coze_alloc_stats_enable(bool enabled);
+
+void coze_alloc_stats_reset(void);
+
+void coze_alloc_stats_get(coze_alloc_stats_t *stats);
+
+// *** allocation stats ***
+
+// *** allocator ***
+
+// Replace the allocator used for all SDK allocations, including cJSON's. Pass NULL functions to restore libc.
+// Call only while no request is in flight; responses must be freed under the allocator that created them.
+// 替换 SDK (包括 cJSON) 的全局分配器, 传 NULL 恢复 libc。只能在没有进行中的请求时调用。
+void coze_set_allocator(void *(*malloc_fn)(size_t size, void *ctx),
+                        void *(*realloc_fn)(void *ptr, size_t size, void *ctx),
+                        void (*free_fn)(void *ptr, void *ctx), void *ctx);
+
+// *** allocator ***
+
+// *** client ***
+
+typedef struct {
+    const char *api_token; // 请求未设置 api_token 时使用
+    const char *api_base; // default: api.coze.cn
+    const coze_allocator_t *allocator; // 可选, 该 client 的请求和响应都用它分配; NULL 使用全局分配器
+    int timeout_ms; // 请求未设置 timeout_ms 时使用, 0 表示不限
+    int warm_connections; // 可选, 创建时预热并保持的连接数, 见 coze_client_warmup
+} coze_client_config_t;
+
+// Requests with .client set allocate through the client's allocator; free their responses before destroying it.
+// 设置了 .client 的请求使用 client 的分配器; 销毁 client 前需先释放其响应。
+// The client also keeps its request and response buffers (up to 1 MB each) between requests.
+// client 在请求之间保留请求体和响应体缓冲区 (各不超过 1 MB), 避免每次重新分配。
+coze_client_t *coze_client_create(const coze_client_config_t *config);
+
+// Destroying the last client also closes the pooled idle connections; later requests open new ones.
+// 销毁最后一个 client 时一并关闭连接池中的空闲连接。
+void coze_client_destroy(coze_client_t *client);
+
+// Open connections (DNS, TCP and TLS) to the client's api_base ahead of traffic, or to each endpoint when
+// coze_set_endpoints configured several. Blocks until they are up, then a background thread keeps at least this many
+// open: it replaces connections the server closed and sends a HEAD on ones idle for 20 s. 0 stops keeping them.
+// Requests reuse pooled keep-alive connections to the same host whether or not it was warmed.
+// 预热: 提前建好到 api_base (或端点组每个端点) 的连接并由后台线程保持; 一个都没连上时返回 COZE_ERROR_NETWORK。
+coze_error_t coze_client_warmup(coze_client_t *client, int connections);
+
+// *** client ***
+
 #endif //COZE_H
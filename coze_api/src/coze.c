@@ -3,364 +3,5107 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <limits.h>
+#include <time.h>
+#include <pthread.h>
 #include <curl/curl.h>
 #include "cJSON.h"
 
-static coze_error_t parse_response_code(cJSON *json, char **msg, int *code);
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define COZE_SIMD_X86
+#endif
+
+// *** logging ***
+
+static bool g_log_enabled = true;
+
+void coze_log_enable(bool enabled) {
+    __atomic_store_n(&g_log_enabled, enabled, __ATOMIC_RELAXED);
+}
+
+// SDK 日志写 stdout, 每行以 "[coze_api] " 开头; 第一个参数须为格式字符串字面量
+#define COZE_LOG(...) \
+    do { \
+        if (__atomic_load_n(&g_log_enabled, __ATOMIC_RELAXED)) { \
+            printf("[coze_api] " __VA_ARGS__); \
+        } \
+    } while (0)
+
+// *** logging ***
+
+// *** allocation ***
+
+// SDK 内部所有堆内存都经过这里: 当前线程的分配器 (请求所属 client 的分配器) 优先, 否则使用全局分配器。
+// 安装了 cJSON hooks 后 cJSON 的分配也走这里。打开统计后计入 g_alloc_stats。
+static struct {
+    bool enabled;
+    size_t allocations;
+    size_t reallocs;
+    size_t frees;
+    size_t bytes;
+} g_alloc_stats;
+
+#define ALLOC_STAT_ADD(field, value) \
+    do { \
+        if (g_alloc_stats.enabled) { \
+            __atomic_fetch_add(&g_alloc_stats.field, (value), __ATOMIC_RELAXED); \
+        } \
+    } while (0)
+
+static coze_allocator_t g_allocator; // malloc_fn 为 NULL 时使用 libc
+static int g_clients; // 存活的 client 数, 都销毁后释放连接池
+static __thread const coze_allocator_t *t_allocator; // 当前线程正在执行的请求的分配器
+
+static const coze_allocator_t *current_allocator(void) {
+    const coze_allocator_t *allocator = t_allocator ? t_allocator : &g_allocator;
+    return allocator->malloc_fn ? allocator : NULL;
+}
+
+static const coze_allocator_t *allocator_scope_enter(const coze_allocator_t *allocator) {
+    const coze_allocator_t *previous = t_allocator;
+    t_allocator = allocator;
+    return previous;
+}
+
+static void allocator_scope_leave(const coze_allocator_t **previous) {
+    t_allocator = *previous;
+}
+
+// 在当前作用域内使用 allocator 分配和释放, NULL 表示全局分配器; 离开作用域 (包括 return) 时自动恢复
+#define ALLOCATOR_SCOPE(allocator) \
+    const coze_allocator_t *allocator_scope_previous_ __attribute__((cleanup(allocator_scope_leave))) = \
+        allocator_scope_enter(allocator)
+
+static void *coze_malloc(size_t size) {
+    const coze_allocator_t *allocator = current_allocator();
+    void *ptr = allocator ? allocator->malloc_fn(size, allocator->ctx) : malloc(size);
+    if (ptr) {
+        ALLOC_STAT_ADD(allocations, 1);
+        ALLOC_STAT_ADD(bytes, size);
+    }
+    return ptr;
+}
+
+static void *coze_calloc(size_t count, size_t size) {
+    const coze_allocator_t *allocator = current_allocator();
+    if (!allocator) {
+        void *ptr = calloc(count, size);
+        if (ptr) {
+            ALLOC_STAT_ADD(allocations, 1);
+            ALLOC_STAT_ADD(bytes, count * size);
+        }
+        return ptr;
+    }
+    if (size && count > (size_t) -1 / size) {
+        return NULL;
+    }
+    void *ptr = coze_malloc(count * size);
+    if (ptr) {
+        memset(ptr, 0, count * size);
+    }
+    return ptr;
+}
+
+static void *coze_realloc(void *ptr, size_t size) {
+    const coze_allocator_t *allocator = current_allocator();
+    void *new_ptr = allocator ? allocator->realloc_fn(ptr, size, allocator->ctx) : realloc(ptr, size);
+    if (new_ptr) {
+        // realloc(NULL) 等同于一次新分配
+        if (ptr) {
+            ALLOC_STAT_ADD(reallocs, 1);
+        } else {
+            ALLOC_STAT_ADD(allocations, 1);
+        }
+        ALLOC_STAT_ADD(bytes, size);
+    }
+    return new_ptr;
+}
+
+static char *coze_strdup(const char *str) {
+    if (!str) {
+        return NULL;
+    }
+    const size_t len = strlen(str) + 1;
+    char *copy = coze_malloc(len);
+    if (copy) {
+        memcpy(copy, str, len);
+    }
+    return copy;
+}
+
+static void coze_free(void *ptr) {
+    if (ptr) {
+        ALLOC_STAT_ADD(frees, 1);
+        const coze_allocator_t *allocator = current_allocator();
+        if (allocator) {
+            allocator->free_fn(ptr, allocator->ctx);
+        } else {
+            free(ptr);
+        }
+    }
+}
+
+// cJSON 的分配总是经过 coze_malloc/coze_free, 没有统计和自定义分配器时它们就是 libc。
+// hooks 只在第一次解析前安装一次, 运行中再改会和其他线程的解析竞争
+static pthread_once_t g_cjson_hooks_once = PTHREAD_ONCE_INIT;
+
+static void cjson_hooks_init(void) {
+    cJSON_Hooks hooks = {.malloc_fn = coze_malloc, .free_fn = coze_free};
+    cJSON_InitHooks(&hooks);
+}
+
+static cJSON *cjson_parse(const char *text) {
+    pthread_once(&g_cjson_hooks_once, cjson_hooks_init);
+    return cJSON_Parse(text);
+}
+
+void coze_set_allocator(void *(*malloc_fn)(size_t size, void *ctx),
+                        void *(*realloc_fn)(void *ptr, size_t size, void *ctx),
+                        void (*free_fn)(void *ptr, void *ctx), void *ctx) {
+    if (malloc_fn && realloc_fn && free_fn) {
+        g_allocator = (coze_allocator_t){.malloc_fn = malloc_fn, .realloc_fn = realloc_fn, .free_fn = free_fn,
+                                         .ctx = ctx};
+    } else {
+        g_allocator = (coze_allocator_t){0};
+    }
+}
+
+void coze_alloc_stats_enable(bool enabled) {
+    g_alloc_stats.enabled = enabled;
+}
+
+void coze_alloc_stats_reset(void) {
+    __atomic_store_n(&g_alloc_stats.allocations, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&g_alloc_stats.reallocs, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&g_alloc_stats.frees, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&g_alloc_stats.bytes, 0, __ATOMIC_RELAXED);
+}
+
+void coze_alloc_stats_get(coze_alloc_stats_t *stats) {
+    if (!stats) {
+        return;
+    }
+    stats->allocations = __atomic_load_n(&g_alloc_stats.allocations, __ATOMIC_RELAXED);
+    stats->reallocs = __atomic_load_n(&g_alloc_stats.reallocs, __ATOMIC_RELAXED);
+    stats->frees = __atomic_load_n(&g_alloc_stats.frees, __ATOMIC_RELAXED);
+    stats->bytes = __atomic_load_n(&g_alloc_stats.bytes, __ATOMIC_RELAXED);
+    stats->live = stats->allocations >= stats->frees ? stats->allocations - stats->frees : 0;
+}
+
+// *** client ***
+
+// client 在请求之间保留的缓冲区; 同一时刻只借给一个请求, 并发的其他请求自行分配
+struct client_buffer {
+    char *data;
+    size_t capacity;
+    bool busy;
+};
+
+#define CLIENT_BUFFER_MAX_RETAINED (1 << 20) // 超过的缓冲区用完即释放, 避免偶发的大响应长期占用内存
+
+struct coze_client {
+    char *api_token;
+    char *api_base;
+    coze_allocator_t allocator; // malloc_fn 为 NULL 时使用全局分配器
+    struct client_buffer request_buffer; // 请求体, 见 json_writer_begin
+    struct client_buffer response_buffer; // 响应体或流式解码的 scratch, 见 make_http_json_request
+    int timeout_ms; // 请求未设置 timeout_ms 时的调用时限
+};
+
+// 借用缓冲区: 成功时 *data/*capacity 为缓冲区当前的内存, 用完后用 client_buffer_release 归还
+static bool client_buffer_acquire(struct client_buffer *buffer, char **data, size_t *capacity) {
+    if (!buffer || __atomic_exchange_n(&buffer->busy, true, __ATOMIC_ACQUIRE)) {
+        return false;
+    }
+    *data = buffer->data;
+    *capacity = buffer->capacity;
+    return true;
+}
+
+// data 为 NULL 表示内存已交给别处 (例如零拷贝的列表响应), 下次借用时重新分配
+static void client_buffer_release(struct client_buffer *buffer, char *data, size_t capacity) {
+    if (data && capacity > CLIENT_BUFFER_MAX_RETAINED) {
+        coze_free(data);
+        data = NULL;
+    }
+    buffer->data = data;
+    buffer->capacity = data ? capacity : 0;
+    __atomic_store_n(&buffer->busy, false, __ATOMIC_RELEASE);
+}
+
+// client 自身及其字符串用 client 的分配器分配
+coze_client_t *coze_client_create(const coze_client_config_t *config) {
+    if (!config) {
+        return NULL;
+    }
+    const coze_allocator_t *allocator = config->allocator;
+    if (allocator && (!allocator->malloc_fn || !allocator->realloc_fn || !allocator->free_fn)) {
+        return NULL;
+    }
+
+    ALLOCATOR_SCOPE(allocator);
+    coze_client_t *client = coze_calloc(1, sizeof(coze_client_t));
+    if (!client) {
+        return NULL;
+    }
+    if (allocator) {
+        client->allocator = *allocator;
+    }
+    client->api_token = coze_strdup(config->api_token);
+    client->api_base = coze_strdup(config->api_base);
+    client->timeout_ms = config->timeout_ms;
+    __atomic_fetch_add(&g_clients, 1, __ATOMIC_RELAXED);
+    if (config->warm_connections > 0) {
+        coze_client_warmup(client, config->warm_connections); // 连不上不影响创建, 之后由 keeper 补
+    }
+    return client;
+}
+
+void coze_client_destroy(coze_client_t *client) {
+    if (!client) {
+        return;
+    }
+    const coze_allocator_t allocator = client->allocator;
+    ALLOCATOR_SCOPE(allocator.malloc_fn ? &allocator : NULL);
+    __atomic_fetch_sub(&g_clients, 1, __ATOMIC_RELAXED);
+    coze_client_warmup(client, 0); // 最后一个 client 时顺带释放连接池
+    coze_free(client->api_token);
+    coze_free(client->api_base);
+    coze_free(client->request_buffer.data);
+    coze_free(client->response_buffer.data);
+    coze_free(client);
+}
+
+static const coze_allocator_t *client_allocator(const coze_client_t *client) {
+    return client && client->allocator.malloc_fn ? &client->allocator : NULL;
+}
+
+// 请求中的 api_token/api_base 优先, 未设置时使用 client 的配置
+static const char *request_api_token(const coze_client_t *client, const char *api_token) {
+    return api_token ? api_token : client ? client->api_token : NULL;
+}
+
+static const char *request_api_base(const coze_client_t *client, const char *api_base) {
+    return api_base ? api_base : client ? client->api_base : NULL;
+}
+
+#define REQ_API_TOKEN(req) request_api_token((req)->client, (req)->api_token)
+#define REQ_API_BASE(req) request_api_base((req)->client, (req)->api_base)
+#define REQ_DEADLINE(req) request_deadline_us((req)->client, (req)->timeout_ms) // 见 request_deadline_us
+
+// *** interned strings ***
+
+// 取值固定的字段 (role, type, status, event ...) 的已知取值指向这里的静态字符串, 只有未知取值才分配。
+// 对应的 *_kind 字段为 0 表示字符串是分配的, 释放时据此区分。
+struct interned_string {
+    const char *value;
+    size_t len;
+    int kind;
+};
+
+#define INTERNED(value, kind) {value, sizeof(value) - 1, kind}
+
+static const struct interned_string message_roles[] = {
+    INTERNED(COZE_MESSAGE_ROLE_USER, COZE_MESSAGE_ROLE_KIND_USER),
+    INTERNED(COZE_MESSAGE_ROLE_ASSISTANT, COZE_MESSAGE_ROLE_KIND_ASSISTANT),
+    {NULL, 0, 0}
+};
+
+static const struct interned_string message_types[] = {
+    INTERNED(COZE_MESSAGE_TYPE_ANSWER, COZE_MESSAGE_TYPE_KIND_ANSWER),
+    INTERNED(COZE_MESSAGE_TYPE_QUESTION, COZE_MESSAGE_TYPE_KIND_QUESTION),
+    INTERNED(COZE_MESSAGE_TYPE_FUNCTION_CALL, COZE_MESSAGE_TYPE_KIND_FUNCTION_CALL),
+    INTERNED(COZE_MESSAGE_TYPE_TOOL_OUTPUT, COZE_MESSAGE_TYPE_KIND_TOOL_OUTPUT),
+    INTERNED(COZE_MESSAGE_TYPE_TOOL_RESPONSE, COZE_MESSAGE_TYPE_KIND_TOOL_RESPONSE),
+    INTERNED(COZE_MESSAGE_TYPE_FOLLOW_UP, COZE_MESSAGE_TYPE_KIND_FOLLOW_UP),
+    INTERNED(COZE_MESSAGE_TYPE_VERBOSE, COZE_MESSAGE_TYPE_KIND_VERBOSE),
+    {NULL, 0, 0}
+};
+
+static const struct interned_string message_content_types[] = {
+    INTERNED(COZE_MESSAGE_CONTENT_TYPE_TEXT, COZE_MESSAGE_CONTENT_TYPE_KIND_TEXT),
+    INTERNED(COZE_MESSAGE_CONTENT_TYPE_OBJECT_STRING, COZE_MESSAGE_CONTENT_TYPE_KIND_OBJECT_STRING),
+    INTERNED(COZE_MESSAGE_CONTENT_TYPE_CARD, COZE_MESSAGE_CONTENT_TYPE_KIND_CARD),
+    INTERNED(COZE_MESSAGE_CONTENT_TYPE_AUDIO, COZE_MESSAGE_CONTENT_TYPE_KIND_AUDIO),
+    {NULL, 0, 0}
+};
+
+static const struct interned_string chat_statuses[] = {
+    INTERNED(COZE_CHAT_STATUS_CREATED, COZE_CHAT_STATUS_KIND_CREATED),
+    INTERNED(COZE_CHAT_STATUS_IN_PROGRESS, COZE_CHAT_STATUS_KIND_IN_PROGRESS),
+    INTERNED(COZE_CHAT_STATUS_COMPLETED, COZE_CHAT_STATUS_KIND_COMPLETED),
+    INTERNED(COZE_CHAT_STATUS_FAILED, COZE_CHAT_STATUS_KIND_FAILED),
+    INTERNED(COZE_CHAT_STATUS_REQUIRES_ACTION, COZE_CHAT_STATUS_KIND_REQUIRES_ACTION),
+    INTERNED(COZE_CHAT_STATUS_CANCELED, COZE_CHAT_STATUS_KIND_CANCELED),
+    {NULL, 0, 0}
+};
+
+// 按出现频率排列, delta 最常见
+static const struct interned_string event_types[] = {
+    INTERNED(COZE_EVENT_TYPE_CONVERSATION_MESSAGE_DELTA, COZE_EVENT_TYPE_KIND_CONVERSATION_MESSAGE_DELTA),
+    INTERNED(COZE_EVENT_TYPE_CONVERSATION_AUDIO_DELTA, COZE_EVENT_TYPE_KIND_CONVERSATION_AUDIO_DELTA),
+    INTERNED(COZE_EVENT_TYPE_CONVERSATION_MESSAGE_COMPLETED, COZE_EVENT_TYPE_KIND_CONVERSATION_MESSAGE_COMPLETED),
+    INTERNED(COZE_EVENT_TYPE_CONVERSATION_CHAT_CREATED, COZE_EVENT_TYPE_KIND_CONVERSATION_CHAT_CREATED),
+    INTERNED(COZE_EVENT_TYPE_CONVERSATION_CHAT_IN_PROGRESS, COZE_EVENT_TYPE_KIND_CONVERSATION_CHAT_IN_PROGRESS),
+    INTERNED(COZE_EVENT_TYPE_CONVERSATION_CHAT_COMPLETED, COZE_EVENT_TYPE_KIND_CONVERSATION_CHAT_COMPLETED),
+    INTERNED(COZE_EVENT_TYPE_CONVERSATION_CHAT_FAILED, COZE_EVENT_TYPE_KIND_CONVERSATION_CHAT_FAILED),
+    INTERNED(COZE_EVENT_TYPE_CONVERSATION_CHAT_REQUIRES_ACTION,
+             COZE_EVENT_TYPE_KIND_CONVERSATION_CHAT_REQUIRES_ACTION),
+    INTERNED(COZE_EVENT_TYPE_ERROR, COZE_EVENT_TYPE_KIND_ERROR),
+    INTERNED(COZE_EVENT_TYPE_DONE, COZE_EVENT_TYPE_KIND_DONE),
+    {NULL, 0, 0}
+};
+
+static const struct interned_string workspace_role_types[] = {
+    INTERNED(COZE_WORKSPACE_ROLE_TYPE_OWNER, COZE_WORKSPACE_ROLE_TYPE_KIND_OWNER),
+    INTERNED(COZE_WORKSPACE_ROLE_TYPE_ADMIN, COZE_WORKSPACE_ROLE_TYPE_KIND_ADMIN),
+    INTERNED(COZE_WORKSPACE_ROLE_TYPE_MEMBER, COZE_WORKSPACE_ROLE_TYPE_KIND_MEMBER),
+    {NULL, 0, 0}
+};
+
+static const struct interned_string workspace_types[] = {
+    INTERNED(COZE_WORKSPACE_TYPE_PERSONAL, COZE_WORKSPACE_TYPE_KIND_PERSONAL),
+    INTERNED(COZE_WORKSPACE_TYPE_TEAM, COZE_WORKSPACE_TYPE_KIND_TEAM),
+    {NULL, 0, 0}
+};
+
+static const struct interned_string *interned_find(const struct interned_string *table, const char *value,
+                                                   size_t len) {
+    for (; table->value; table++) {
+        if (table->len == len && memcmp(table->value, value, len) == 0) {
+            return table;
+        }
+    }
+    return NULL;
+}
+
+// 已知取值返回静态字符串, 未知取值复制一份; *kind 为对应的枚举值, 未知为 0
+static const char *intern_string(const struct interned_string *table, const char *value, int *kind) {
+    const struct interned_string *known = value ? interned_find(table, value, strlen(value)) : NULL;
+    *kind = known ? known->kind : 0;
+    return known ? known->value : coze_strdup(value);
+}
+
+// object.field = intern_string(...), 同时设置 object.field_kind
+#define INTERN_FIELD(object, field, table, value) \
+    do { \
+        int kind_; \
+        (object).field = intern_string(table, value, &kind_); \
+        (object).field##_kind = kind_; \
+    } while (0)
+
+// 只释放 intern_string 复制出来的字符串
+static void intern_free(const char *value, int kind) {
+    if (kind == 0) {
+        coze_free((void *) value);
+    }
+}
+
+// *** ids ***
+
+// Coze 的 bot/conversation/chat/message/file ID 都是十进制数字字符串, 响应中同时给出 uint64_t 形式,
+// 请求可以只传数值形式, 拼路径和请求体时格式化到栈上, 不需要分配
+#define ID_BUFFER_SIZE 21 // UINT64_MAX 为 20 位
+
+// 只接受不溢出的纯数字, 否则返回 0
+static uint64_t parse_id_len(const char *id, size_t len) {
+    if (!id || len == 0 || len >= ID_BUFFER_SIZE) {
+        return 0;
+    }
+    uint64_t value = 0;
+    for (size_t i = 0; i < len; i++) {
+        const unsigned digit = (unsigned) (id[i] - '0');
+        if (digit > 9 || value > (UINT64_MAX - digit) / 10) {
+            return 0;
+        }
+        value = value * 10 + digit;
+    }
+    return value;
+}
+
+static const char *format_id(uint64_t id, char *buffer) {
+    char *p = buffer + ID_BUFFER_SIZE - 1;
+    *p = '\0';
+    do {
+        *--p = (char) ('0' + id % 10);
+        id /= 10;
+    } while (id);
+    return p;
+}
+
+// 字符串形式优先, 否则格式化数值形式 (0 表示未设置) 到 buffer
+static const char *request_id(const char *id, uint64_t id_u64, char *buffer) {
+    return id ? id : id_u64 ? format_id(id_u64, buffer) : NULL;
+}
+
+#define REQ_HAS_ID(req, field) ((req)->field || (req)->field##_u64)
+#define REQ_ID(req, field, buffer) request_id((req)->field, (req)->field##_u64, buffer)
+
+// *** json writer ***
+
+// 请求体直接序列化到一块缓冲区, 不建 cJSON 树。设置了 client 的请求复用 client 的缓冲区,
+// 该缓冲区正被其他线程使用时退回为本次请求单独分配。
+struct json_writer {
+    char *data;
+    size_t len;
+    size_t capacity;
+    bool comma; // 下一个值前需要逗号
+    bool failed; // 分配失败, json_writer_finish 返回 NULL
+    struct client_buffer *buffer; // 非 NULL 表示 data 借自该 client 缓冲区
+};
+
+static bool json_writer_reserve(struct json_writer *writer, size_t size) {
+    if (writer->failed) {
+        return false;
+    }
+    if (writer->len + size <= writer->capacity) {
+        return true;
+    }
+    size_t capacity = writer->capacity ? writer->capacity * 2 : 256;
+    while (capacity < writer->len + size) {
+        capacity *= 2;
+    }
+    char *data = coze_realloc(writer->data, capacity);
+    if (!data) {
+        writer->failed = true;
+        return false;
+    }
+    writer->data = data;
+    writer->capacity = capacity;
+    return true;
+}
+
+static void json_writer_raw(struct json_writer *writer, const char *data, size_t len) {
+    if (json_writer_reserve(writer, len)) {
+        memcpy(writer->data + writer->len, data, len);
+        writer->len += len;
+    }
+}
+
+static void json_writer_char(struct json_writer *writer, char c) {
+    if (json_writer_reserve(writer, 1)) {
+        writer->data[writer->len++] = c;
+    }
+}
+
+static void json_writer_separator(struct json_writer *writer) {
+    if (writer->comma) {
+        json_writer_char(writer, ',');
+    }
+    writer->comma = true;
+}
+
+// 与 cJSON 一致: 只转义 '"', '\\' 和控制字符, UTF-8 原样输出
+static void json_writer_quoted(struct json_writer *writer, const char *value) {
+    static const char hex[] = "0123456789abcdef";
+    json_writer_char(writer, '"');
+    const char *run = value;
+    for (const char *p = value;; p++) {
+        const unsigned char c = (unsigned char) *p;
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            continue;
+        }
+        json_writer_raw(writer, run, p - run);
+        if (c == '\0') {
+            break;
+        }
+        char escaped[6] = {'\\', (char) c};
+        size_t escaped_len = 2;
+        switch (c) {
+            case '"':
+            case '\\':
+                break;
+            case '\b': escaped[1] = 'b'; break;
+            case '\f': escaped[1] = 'f'; break;
+            case '\n': escaped[1] = 'n'; break;
+            case '\r': escaped[1] = 'r'; break;
+            case '\t': escaped[1] = 't'; break;
+            default:
+                memcpy(escaped + 1, "u00", 3);
+                escaped[4] = hex[c >> 4];
+                escaped[5] = hex[c & 0xf];
+                escaped_len = 6;
+        }
+        json_writer_raw(writer, escaped, escaped_len);
+        run = p + 1;
+    }
+    json_writer_char(writer, '"');
+}
+
+static void json_writer_key(struct json_writer *writer, const char *key) {
+    json_writer_separator(writer);
+    json_writer_quoted(writer, key);
+    json_writer_char(writer, ':');
+    writer->comma = false;
+}
+
+static void json_writer_object_begin(struct json_writer *writer) {
+    json_writer_separator(writer);
+    json_writer_char(writer, '{');
+    writer->comma = false;
+}
+
+static void json_writer_object_end(struct json_writer *writer) {
+    json_writer_char(writer, '}');
+    writer->comma = true;
+}
+
+static void json_writer_array_end(struct json_writer *writer) {
+    json_writer_char(writer, ']');
+    writer->comma = true;
+}
+
+static void json_writer_string(struct json_writer *writer, const char *value) {
+    json_writer_separator(writer);
+    json_writer_quoted(writer, value ? value : "");
+}
+
+static void json_writer_object_field(struct json_writer *writer, const char *key) {
+    json_writer_key(writer, key);
+    json_writer_char(writer, '{');
+}
+
+static void json_writer_array_field(struct json_writer *writer, const char *key) {
+    json_writer_key(writer, key);
+    json_writer_char(writer, '[');
+}
+
+static void json_writer_string_field(struct json_writer *writer, const char *key, const char *value) {
+    json_writer_key(writer, key);
+    json_writer_quoted(writer, value ? value : "");
+    writer->comma = true;
+}
+
+static void json_writer_long_field(struct json_writer *writer, const char *key, long value) {
+    char number[24];
+    const int len = snprintf(number, sizeof(number), "%ld", value);
+    json_writer_key(writer, key);
+    json_writer_raw(writer, number, (size_t) len);
+    writer->comma = true;
+}
+
+static void json_writer_bool_field(struct json_writer *writer, const char *key, bool value) {
+    json_writer_key(writer, key);
+    json_writer_raw(writer, value ? "true" : "false", value ? 4 : 5);
+    writer->comma = true;
+}
+
+// 开始写一个顶层对象
+static void json_writer_begin(struct json_writer *writer, coze_client_t *client) {
+    *writer = (struct json_writer){0};
+    if (client && client_buffer_acquire(&client->request_buffer, &writer->data, &writer->capacity)) {
+        writer->buffer = &client->request_buffer;
+    }
+    json_writer_char(writer, '{');
+}
+
+// 结束顶层对象, 返回 '\0' 结尾的请求体; 分配失败返回 NULL
+static const char *json_writer_finish(struct json_writer *writer) {
+    json_writer_char(writer, '}');
+    json_writer_char(writer, '\0');
+    return writer->failed ? NULL : writer->data;
+}
+
+// 请求发送完后调用: 借来的缓冲区还给 client, 否则释放
+static void json_writer_release(struct json_writer *writer) {
+    if (writer->buffer) {
+        client_buffer_release(writer->buffer, writer->data, writer->capacity);
+    } else {
+        coze_free(writer->data);
+    }
+    *writer = (struct json_writer){0};
+}
+
+// *** string scan ***
+
+// 字节扫描: scan_string 在 JSON 字符串内容中查找第一个 '"', '\\' 或控制字符 (< 0x20),
+// scan_newline 查找第一个 '\n' 或 '\r' (SSE 分行); 都在没有时返回 end。
+// x86 上按 CPU 在运行时选择 AVX2 (每次 32 字节) 或 SSE2 (每次 16 字节), 其他平台逐字节扫描;
+// 环境变量 COZE_SIMD=scalar|sse2 可以降级。
+typedef const char *(*scan_fn)(const char *p, const char *end);
+
+static const char *scan_string_scalar(const char *p, const char *end) {
+    while (p < end && *p != '"' && *p != '\\' && (unsigned char) *p >= 0x20) {
+        p++;
+    }
+    return p;
+}
+
+static const char *scan_newline_scalar(const char *p, const char *end) {
+    while (p < end && *p != '\n' && *p != '\r') {
+        p++;
+    }
+    return p;
+}
+
+#ifdef COZE_SIMD_X86
+__attribute__((target("sse2")))
+static const char *scan_string_sse2(const char *p, const char *end) {
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i control = _mm_set1_epi8(0x1F);
+    for (; end - p >= 16; p += 16) {
+        const __m128i v = _mm_loadu_si128((const __m128i *) p);
+        // max(v, 0x1F) == 0x1F 即无符号 v <= 0x1F
+        const __m128i hit = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)),
+                                         _mm_cmpeq_epi8(_mm_max_epu8(v, control), control));
+        const int mask = _mm_movemask_epi8(hit);
+        if (mask) {
+            return p + __builtin_ctz((unsigned int) mask);
+        }
+    }
+    return scan_string_scalar(p, end);
+}
+
+__attribute__((target("sse2")))
+static const char *scan_newline_sse2(const char *p, const char *end) {
+    const __m128i lf = _mm_set1_epi8('\n');
+    const __m128i cr = _mm_set1_epi8('\r');
+    for (; end - p >= 16; p += 16) {
+        const __m128i v = _mm_loadu_si128((const __m128i *) p);
+        const int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, lf), _mm_cmpeq_epi8(v, cr)));
+        if (mask) {
+            return p + __builtin_ctz((unsigned int) mask);
+        }
+    }
+    return scan_newline_scalar(p, end);
+}
+
+__attribute__((target("avx2")))
+static const char *scan_string_avx2(const char *p, const char *end) {
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i control = _mm256_set1_epi8(0x1F);
+    for (; end - p >= 32; p += 32) {
+        const __m256i v = _mm256_loadu_si256((const __m256i *) p);
+        const __m256i hit = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, quote), _mm256_cmpeq_epi8(v, backslash)),
+            _mm256_cmpeq_epi8(_mm256_max_epu8(v, control), control));
+        const unsigned int mask = (unsigned int) _mm256_movemask_epi8(hit);
+        if (mask) {
+            return p + __builtin_ctz(mask);
+        }
+    }
+    return scan_string_sse2(p, end);
+}
+
+__attribute__((target("avx2")))
+static const char *scan_newline_avx2(const char *p, const char *end) {
+    const __m256i lf = _mm256_set1_epi8('\n');
+    const __m256i cr = _mm256_set1_epi8('\r');
+    for (; end - p >= 32; p += 32) {
+        const __m256i v = _mm256_loadu_si256((const __m256i *) p);
+        const unsigned int mask = (unsigned int) _mm256_movemask_epi8(
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, lf), _mm256_cmpeq_epi8(v, cr)));
+        if (mask) {
+            return p + __builtin_ctz(mask);
+        }
+    }
+    return scan_newline_sse2(p, end);
+}
+#endif
+
+static struct {
+    scan_fn string;
+    scan_fn newline;
+} g_scan = {scan_string_scalar, scan_newline_scalar};
+
+static pthread_once_t g_scan_once = PTHREAD_ONCE_INIT;
+
+static void scan_init(void) {
+#ifdef COZE_SIMD_X86
+    const char *level = getenv("COZE_SIMD");
+    const bool scalar = level && strcmp(level, "scalar") == 0;
+    const bool sse2 = level && strcmp(level, "sse2") == 0;
+    __builtin_cpu_init();
+    if (!scalar && !sse2 && __builtin_cpu_supports("avx2")) {
+        g_scan.string = scan_string_avx2;
+        g_scan.newline = scan_newline_avx2;
+    } else if (!scalar && __builtin_cpu_supports("sse2")) {
+        g_scan.string = scan_string_sse2;
+        g_scan.newline = scan_newline_sse2;
+    }
+#endif
+}
+
+static const char *scan_string(const char *p, const char *end) {
+    pthread_once(&g_scan_once, scan_init);
+    return g_scan.string(p, end);
+}
+
+static const char *scan_newline(const char *p, const char *end) {
+    pthread_once(&g_scan_once, scan_init);
+    return g_scan.newline(p, end);
+}
+
+// *** json tokens ***
+
+// 列表响应使用的原地解析: 只记录 token 的位置, 字符串在响应体内原地反转义并以 '\0' 结尾。
+// 反转义不会变长, 结尾的 '\0' 最多覆盖字符串的右引号。
+typedef enum {
+    JSON_TOKEN_OBJECT,
+    JSON_TOKEN_ARRAY,
+    JSON_TOKEN_STRING,
+    JSON_TOKEN_PRIMITIVE // number, true, false, null
+} json_token_type_t;
+
+struct json_token {
+    json_token_type_t type;
+    const char *start; // 字符串为反转义后的内容
+    size_t len;
+    int end; // 该 token 子树之后的下一个 token 下标
+};
+
+struct json_document {
+    struct json_token *tokens;
+    int count;
+    int capacity;
+    char **body; // 零拷贝解码时交给第一个列表 arena 的响应体, 见 json_decode_array
+};
+
+#define JSON_MAX_DEPTH 64
+
+static int json_push_token(struct json_document *doc, json_token_type_t type, const char *start, size_t len) {
+    if (doc->count == doc->capacity) {
+        const int capacity = doc->capacity ? doc->capacity * 2 : 64;
+        struct json_token *tokens = coze_realloc(doc->tokens, capacity * sizeof(struct json_token));
+        if (!tokens) {
+            return -1;
+        }
+        doc->tokens = tokens;
+        doc->capacity = capacity;
+    }
+    struct json_token *token = &doc->tokens[doc->count];
+    token->type = type;
+    token->start = start;
+    token->len = len;
+    token->end = doc->count + 1;
+    return doc->count++;
+}
+
+static int json_hex(const char *p) {
+    int value = 0;
+    for (int i = 0; i < 4; i++) {
+        const char c = p[i];
+        value <<= 4;
+        if (c >= '0' && c <= '9') {
+            value |= c - '0';
+        } else if (c >= 'a' && c <= 'f') {
+            value |= c - 'a' + 10;
+        } else if (c >= 'A' && c <= 'F') {
+            value |= c - 'A' + 10;
+        } else {
+            return -1;
+        }
+    }
+    return value;
+}
+
+static char *json_put_utf8(char *dst, unsigned int cp) {
+    if (cp < 0x80) {
+        *dst++ = (char) cp;
+    } else if (cp < 0x800) {
+        *dst++ = (char) (0xC0 | (cp >> 6));
+        *dst++ = (char) (0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        *dst++ = (char) (0xE0 | (cp >> 12));
+        *dst++ = (char) (0x80 | ((cp >> 6) & 0x3F));
+        *dst++ = (char) (0x80 | (cp & 0x3F));
+    } else {
+        *dst++ = (char) (0xF0 | (cp >> 18));
+        *dst++ = (char) (0x80 | ((cp >> 12) & 0x3F));
+        *dst++ = (char) (0x80 | ((cp >> 6) & 0x3F));
+        *dst++ = (char) (0x80 | (cp & 0x3F));
+    }
+    return dst;
+}
+
+// p 指向左引号之后; 成功时返回右引号之后的位置, 内容写回 p 开始处并以 '\0' 结尾。
+// 转义之间的普通字符由 scan_string 成段跳过, 遇到第一个转义之前不需要移动
+static char *json_unescape_in_place(char *p, const char *end, size_t *len) {
+    char *src = p;
+    char *dst = p;
+    for (;;) {
+        const char *run = scan_string(src, end);
+        if (dst != src) {
+            memmove(dst, src, run - src);
+        }
+        dst += run - src;
+        src = (char *) run;
+        if (src == end || *src == '"') {
+            break;
+        }
+        if (*src != '\\' || end - src < 2) {
+            return NULL;
+        }
+        switch (src[1]) {
+            case '"': *dst++ = '"'; break;
+            case '\\': *dst++ = '\\'; break;
+            case '/': *dst++ = '/'; break;
+            case 'b': *dst++ = '\b'; break;
+            case 'f': *dst++ = '\f'; break;
+            case 'n': *dst++ = '\n'; break;
+            case 'r': *dst++ = '\r'; break;
+            case 't': *dst++ = '\t'; break;
+            case 'u': {
+                int cp = end - src >= 6 ? json_hex(src + 2) : -1;
+                if (cp < 0) {
+                    return NULL;
+                }
+                if (cp >= 0xD800 && cp < 0xDC00) {
+                    // 代理对, 需要紧跟低位 \uDC00-\uDFFF
+                    const int low = end - src >= 12 && src[6] == '\\' && src[7] == 'u' ? json_hex(src + 8) : -1;
+                    if (low < 0xDC00 || low > 0xDFFF) {
+                        return NULL;
+                    }
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                    src += 6;
+                }
+                dst = json_put_utf8(dst, (unsigned int) cp);
+                src += 4;
+                break;
+            }
+            default:
+                return NULL;
+        }
+        src += 2;
+    }
+    if (src >= end) {
+        return NULL;
+    }
+    *len = dst - p;
+    *dst = '\0';
+    return src + 1;
+}
+
+// 解析 buffer 并原地修改, 结构错误时返回 false。只校验括号配对, 不校验逗号和冒号的位置。
+static bool json_tokenize(char *buffer, size_t size, struct json_document *doc) {
+    int stack[JSON_MAX_DEPTH];
+    int depth = 0;
+    char *p = buffer;
+    const char *end = buffer + size;
+
+    memset(doc, 0, sizeof(*doc));
+    while (p < end) {
+        const char c = *p;
+        if (c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == ',' || c == ':') {
+            p++;
+        } else if (c == '{' || c == '[') {
+            const int index = json_push_token(doc, c == '{' ? JSON_TOKEN_OBJECT : JSON_TOKEN_ARRAY, p, 0);
+            if (index < 0 || depth == JSON_MAX_DEPTH) {
+                return false;
+            }
+            stack[depth++] = index;
+            p++;
+        } else if (c == '}' || c == ']') {
+            if (depth == 0) {
+                return false;
+            }
+            struct json_token *token = &doc->tokens[stack[--depth]];
+            if (token->type != (c == '}' ? JSON_TOKEN_OBJECT : JSON_TOKEN_ARRAY)) {
+                return false;
+            }
+            token->len = p + 1 - token->start;
+            token->end = doc->count;
+            p++;
+        } else if (c == '"') {
+            size_t len = 0;
+            char *next = json_unescape_in_place(p + 1, end, &len);
+            if (!next || json_push_token(doc, JSON_TOKEN_STRING, p + 1, len) < 0) {
+                return false;
+            }
+            p = next;
+        } else if (c == '-' || (c >= '0' && c <= '9') || c == 't' || c == 'f' || c == 'n') {
+            char *start = p;
+            while (p < end && *p != ',' && *p != '}' && *p != ']' && *p != ' ' && *p != '\t' && *p != '\r' &&
+                   *p != '\n') {
+                p++;
+            }
+            if (json_push_token(doc, JSON_TOKEN_PRIMITIVE, start, p - start) < 0) {
+                return false;
+            }
+        } else {
+            return false;
+        }
+    }
+    return depth == 0 && doc->count > 0;
+}
+
+static void json_document_free(struct json_document *doc) {
+    coze_free(doc->tokens);
+    memset(doc, 0, sizeof(*doc));
+}
+
+// 返回对象中 key 对应值的 token 下标, 不存在返回 -1
+static int json_object_get(const struct json_document *doc, int object, const char *key) {
+    if (object < 0 || doc->tokens[object].type != JSON_TOKEN_OBJECT) {
+        return -1;
+    }
+    const size_t key_len = strlen(key);
+    for (int i = object + 1; i + 1 < doc->tokens[object].end; i = doc->tokens[i + 1].end) {
+        const struct json_token *name = &doc->tokens[i];
+        if (name->len == key_len && memcmp(name->start, key, key_len) == 0) {
+            return i + 1;
+        }
+    }
+    return -1;
+}
+
+static int json_array_size(const struct json_document *doc, int array) {
+    if (array < 0 || doc->tokens[array].type != JSON_TOKEN_ARRAY) {
+        return 0;
+    }
+    int count = 0;
+    for (int i = array + 1; i < doc->tokens[array].end; i = doc->tokens[i].end) {
+        count++;
+    }
+    return count;
+}
+
+// 字符串 token 的内容, 非字符串返回 NULL
+static const char *json_token_string(const struct json_token *token) {
+    return token->type == JSON_TOKEN_STRING ? token->start : NULL;
+}
+
+static long json_token_long(const struct json_token *token) {
+    return token->type == JSON_TOKEN_PRIMITIVE ? (long) strtod(token->start, NULL) : 0;
+}
+
+static bool json_token_bool(const struct json_token *token) {
+    return token->type == JSON_TOKEN_PRIMITIVE && token->start[0] == 't';
+}
+
+static const char *json_string(const struct json_document *doc, int index) {
+    return index >= 0 ? json_token_string(&doc->tokens[index]) : NULL;
+}
+
+static long json_long(const struct json_document *doc, int index) {
+    return index >= 0 ? json_token_long(&doc->tokens[index]) : 0;
+}
+
+static coze_error_t json_parse_response_code(const struct json_document *doc, char **msg, int *code) {
+    const int code_index = json_object_get(doc, 0, "code");
+    const int msg_index = json_object_get(doc, 0, "msg");
+    const int error_code_index = json_object_get(doc, 0, "error_code");
+    const int error_message_index = json_object_get(doc, 0, "error_message");
+
+    // error_message 优先
+    if (msg) {
+        *msg = coze_strdup(json_string(doc, error_message_index >= 0 ? error_message_index : msg_index));
+    }
+
+    if (code_index >= 0) {
+        const int value = (int) json_long(doc, code_index);
+        if (code) {
+            *code = value;
+        }
+        if (value != 0) {
+            return COZE_ERROR_API;
+        }
+    } else if (error_code_index >= 0) {
+        if (code) {
+            *code = -1; // auth code not int
+        }
+        return COZE_ERROR_API;
+    }
+
+    return COZE_OK;
+}
+
+// *** arena ***
+
+// 列表响应的数组和数组元素的字符串字段放在同一块内存里: [arena 头 | 数组 | 字符串...]
+// 公开结构体中的数组指针指向头部之后, 释放整个列表只需一次 free。
+// 零拷贝模式下 arena 接管响应体, 字符串字段直接指向其中, 不再复制。
+// 流式解码时元素个数和字符串长度事先未知, 数组按需扩容, 字符串写进挂在头部的 chunk 链表。
+struct arena_chunk {
+    struct arena_chunk *next;
+};
+
+struct coze_arena {
+    char *body; // 零拷贝时保留的响应体, 否则为 NULL
+    char *next; // 下一个字符串的写入位置
+    char *end;
+    struct arena_chunk *chunks; // 流式解码时存放字符串的额外内存块
+};
+
+#define ARENA_HEADER_SIZE ((sizeof(struct coze_arena) + 15) & ~(size_t) 15)
+#define ARENA_CHUNK_SIZE 4096
+
+static struct coze_arena *arena_of(const void *items) {
+    return (struct coze_arena *) ((char *) items - ARENA_HEADER_SIZE);
+}
+
+// 为 json 数组分配 count 个元素并清零。复制模式下按数组内所有字符串 token 预留空间;
+// 零拷贝模式下 arena 接管 body, 调用方不再释放它。
+static void *arena_create_array(const struct json_document *doc, int array, int count, size_t item_size,
+                                char *body) {
+    size_t strings_size = 0;
+    if (!body) {
+        for (int i = array + 1; i < doc->tokens[array].end; i++) {
+            if (doc->tokens[i].type == JSON_TOKEN_STRING) {
+                strings_size += doc->tokens[i].len + 1;
+            }
+        }
+    }
+
+    const size_t items_size = (size_t) (count > 0 ? count : 0) * item_size;
+    char *block = coze_malloc(ARENA_HEADER_SIZE + items_size + strings_size);
+    if (!block) {
+        return NULL;
+    }
+    char *items = block + ARENA_HEADER_SIZE;
+    memset(items, 0, items_size);
+
+    struct coze_arena *arena = (struct coze_arena *) block;
+    arena->body = body;
+    arena->next = items + items_size;
+    arena->end = arena->next + strings_size;
+    arena->chunks = NULL;
+    return items;
+}
+
+// 流式解码用: 把 items (NULL 时新建) 调整为 capacity 个元素, 新增的元素清零。失败时返回 NULL, 原数组不变
+static void *arena_resize_array(void *items, int old_capacity, int capacity, size_t item_size) {
+    char *block = items ? (char *) arena_of(items) : NULL;
+    char *resized = coze_realloc(block, ARENA_HEADER_SIZE + (size_t) capacity * item_size);
+    if (!resized) {
+        return NULL;
+    }
+    if (!block) {
+        memset(resized, 0, ARENA_HEADER_SIZE);
+    }
+    if (capacity > old_capacity) {
+        memset(resized + ARENA_HEADER_SIZE + (size_t) old_capacity * item_size, 0,
+               (size_t) (capacity - old_capacity) * item_size);
+    }
+    return resized + ARENA_HEADER_SIZE;
+}
+
+// 字符串字段: 零拷贝时直接指向响应体, 否则复制进 items 所在的 arena, 预留空间不够时新开 chunk; 非字符串返回 NULL
+static const char *arena_string(void *items, const struct json_token *token) {
+    const char *value = json_token_string(token);
+    if (!items || !value) {
+        return NULL;
+    }
+    struct coze_arena *arena = arena_of(items);
+    if (arena->body) {
+        return value;
+    }
+    const size_t len = token->len + 1;
+    if (!arena->next || len > (size_t) (arena->end - arena->next)) {
+        const size_t size = len > ARENA_CHUNK_SIZE ? len : ARENA_CHUNK_SIZE;
+        struct arena_chunk *chunk = coze_malloc(sizeof(struct arena_chunk) + size);
+        if (!chunk) {
+            return NULL;
+        }
+        chunk->next = arena->chunks;
+        arena->chunks = chunk;
+        arena->next = (char *) (chunk + 1);
+        arena->end = arena->next + size;
+    }
+    char *copy = arena->next;
+    memcpy(copy, value, len);
+    arena->next += len;
+    return copy;
+}
+
+static void arena_free(void *items) {
+    if (items) {
+        struct coze_arena *arena = arena_of(items);
+        while (arena->chunks) {
+            struct arena_chunk *next = arena->chunks->next;
+            coze_free(arena->chunks);
+            arena->chunks = next;
+        }
+        coze_free(arena->body);
+        coze_free(arena);
+    }
+}
+
+// *** json schema ***
+
+// 响应结构体的字段表 (key, offset, kind)。解码时每个 JSON 对象只遍历一次,
+// 成员名经哈希直接定位到字段, 按 offset 写入结构体; 释放时按同一张表释放复制出来的字符串。
+typedef enum {
+    JSON_FIELD_STRING,
+    JSON_FIELD_ID, // 字符串, 数值形式写入 aux_offset 处的 uint64_t
+    JSON_FIELD_INTERNED, // 已知取值指向 aux 表中的静态字符串, kind 写入 aux_offset 处的枚举
+    JSON_FIELD_LONG,
+    JSON_FIELD_INT,
+    JSON_FIELD_BOOL,
+    JSON_FIELD_OBJECT, // 内嵌结构体, aux 为其 schema
+    JSON_FIELD_ARRAY, // 对象数组, 放进一块 arena; 元素个数写入 aux_offset 处的 int, aux 为元素的 schema
+    JSON_FIELD_COLUMNS // 消息数组按列解码进 coze_message_columns_t, aux 为列的 schema, 见 json_columns_resize
+} json_field_kind_t;
+
+struct json_field {
+    const char *key;
+    size_t key_len;
+    json_field_kind_t kind;
+    size_t offset;
+    size_t aux_offset;
+    const void *aux;
+};
+
+#define JSON_SCHEMA_SLOTS 32 // 2 的幂, 不小于字段数的两倍
+
+struct json_schema {
+    const struct json_field *fields;
+    int count;
+    size_t size; // 结构体大小, 数组元素按它排列
+    uint32_t hashes[JSON_SCHEMA_SLOTS];
+    uint8_t slots[JSON_SCHEMA_SLOTS]; // 字段下标 + 1, 0 表示空槽
+};
+
+#define FIELD(type, key, member, kind) {key, sizeof(key) - 1, kind, offsetof(type, member), 0, NULL}
+#define FIELD_STRING(type, key, member) FIELD(type, key, member, JSON_FIELD_STRING)
+#define FIELD_LONG(type, key, member) FIELD(type, key, member, JSON_FIELD_LONG)
+#define FIELD_INT(type, key, member) FIELD(type, key, member, JSON_FIELD_INT)
+#define FIELD_BOOL(type, key, member) FIELD(type, key, member, JSON_FIELD_BOOL)
+#define FIELD_ID(type, key, member) \
+    {key, sizeof(key) - 1, JSON_FIELD_ID, offsetof(type, member), offsetof(type, member##_u64), NULL}
+#define FIELD_INTERNED(type, key, member, table) \
+    {key, sizeof(key) - 1, JSON_FIELD_INTERNED, offsetof(type, member), offsetof(type, member##_kind), table}
+#define FIELD_OBJECT(type, key, member, schema) \
+    {key, sizeof(key) - 1, JSON_FIELD_OBJECT, offsetof(type, member), 0, schema}
+#define FIELD_ARRAY(type, key, member, count, schema) \
+    {key, sizeof(key) - 1, JSON_FIELD_ARRAY, offsetof(type, member), offsetof(type, count), schema}
+#define FIELD_COLUMNS(type, key, member, schema) \
+    {key, sizeof(key) - 1, JSON_FIELD_COLUMNS, offsetof(type, member), 0, schema}
+#define SCHEMA(type, fields_) {.fields = fields_, .count = sizeof(fields_) / sizeof(fields_[0]), .size = sizeof(type)}
+
+// 列的 schema: offset 处是列数组的指针, 元素类型由 kind 决定 (ID 为 uint64_t, INTERNED 为 uint8_t 的 kind);
+// STRING 列的 offset 处为 content_pool 中的偏移, aux_offset 处为长度, 均为 uint32_t
+#define COLUMN(key, member, kind, table) \
+    {key, sizeof(key) - 1, kind, offsetof(coze_message_columns_t, member), 0, table}
+#define COLUMN_STRING(key, member) \
+    {key, sizeof(key) - 1, JSON_FIELD_STRING, offsetof(coze_message_columns_t, member##_offset), \
+     offsetof(coze_message_columns_t, member##_length), NULL}
+
+static const struct json_field message_fields[] = {
+    FIELD_ID(coze_message_t, "id", id),
+    FIELD_ID(coze_message_t, "conversation_id", conversation_id),
+    FIELD_ID(coze_message_t, "bot_id", bot_id),
+    FIELD_ID(coze_message_t, "chat_id", chat_id),
+    FIELD_INTERNED(coze_message_t, "role", role, message_roles),
+    FIELD_STRING(coze_message_t, "content", content),
+    FIELD_INTERNED(coze_message_t, "content_type", content_type, message_content_types),
+    FIELD_INTERNED(coze_message_t, "type", type, message_types),
+    FIELD_LONG(coze_message_t, "created_at", created_at),
+    FIELD_LONG(coze_message_t, "updated_at", updated_at),
+};
+
+static struct json_schema message_schema = SCHEMA(coze_message_t, message_fields);
+
+static const struct json_field message_columns_fields[] = {
+    COLUMN("id", id, JSON_FIELD_ID, NULL),
+    COLUMN("chat_id", chat_id, JSON_FIELD_ID, NULL),
+    COLUMN("created_at", created_at, JSON_FIELD_LONG, NULL),
+    COLUMN("updated_at", updated_at, JSON_FIELD_LONG, NULL),
+    COLUMN("role", role_kind, JSON_FIELD_INTERNED, message_roles),
+    COLUMN("type", type_kind, JSON_FIELD_INTERNED, message_types),
+    COLUMN("content_type", content_type_kind, JSON_FIELD_INTERNED, message_content_types),
+    COLUMN_STRING("content", content),
+};
+
+static struct json_schema message_columns_schema = SCHEMA(coze_message_columns_t, message_columns_fields);
+
+static const struct json_field last_error_fields[] = {
+    FIELD_INT(coze_last_error_t, "code", code),
+    FIELD_STRING(coze_last_error_t, "msg", msg),
+};
+
+static struct json_schema last_error_schema = SCHEMA(coze_last_error_t, last_error_fields);
+
+static const struct json_field chat_usage_fields[] = {
+    FIELD_INT(coze_chat_usage_t, "token_count", token_count),
+    FIELD_INT(coze_chat_usage_t, "output_count", output_count),
+    FIELD_INT(coze_chat_usage_t, "input_count", input_count),
+};
+
+static struct json_schema chat_usage_schema = SCHEMA(coze_chat_usage_t, chat_usage_fields);
+
+static const struct json_field chat_fields[] = {
+    FIELD_ID(coze_chat_t, "id", id),
+    FIELD_ID(coze_chat_t, "conversation_id", conversation_id),
+    FIELD_ID(coze_chat_t, "bot_id", bot_id),
+    FIELD_LONG(coze_chat_t, "created_at", created_at),
+    FIELD_LONG(coze_chat_t, "completed_at", completed_at),
+    FIELD_INTERNED(coze_chat_t, "status", status, chat_statuses),
+    FIELD_OBJECT(coze_chat_t, "last_error", last_error, &last_error_schema),
+    FIELD_OBJECT(coze_chat_t, "usage", usage, &chat_usage_schema),
+};
+
+static struct json_schema chat_schema = SCHEMA(coze_chat_t, chat_fields);
+
+static const struct json_field conversation_fields[] = {
+    FIELD_ID(coze_conversation_t, "id", id),
+    FIELD_LONG(coze_conversation_t, "created_at", created_at),
+    FIELD_STRING(coze_conversation_t, "last_section_id", last_section_id),
+};
+
+static struct json_schema conversation_schema = SCHEMA(coze_conversation_t, conversation_fields);
+
+static const struct json_field file_fields[] = {
+    FIELD_ID(coze_file_t, "id", id),
+    FIELD_STRING(coze_file_t, "file_name", file_name),
+    FIELD_INT(coze_file_t, "created_at", created_at),
+    FIELD_LONG(coze_file_t, "bytes", bytes),
+};
+
+static struct json_schema file_schema = SCHEMA(coze_file_t, file_fields);
+
+static const struct json_field bot_fields[] = {
+    FIELD_ID(coze_bot_t, "bot_id", bot_id),
+    FIELD_STRING(coze_bot_t, "name", name),
+    FIELD_STRING(coze_bot_t, "description", description),
+    FIELD_STRING(coze_bot_t, "icon_url", icon_url),
+    FIELD_LONG(coze_bot_t, "create_time", create_time),
+    FIELD_LONG(coze_bot_t, "update_time", update_time),
+    FIELD_STRING(coze_bot_t, "version", version),
+};
+
+static struct json_schema bot_schema = SCHEMA(coze_bot_t, bot_fields);
+
+static const struct json_field simple_bot_fields[] = {
+    FIELD_ID(coze_simple_bot_t, "bot_id", bot_id),
+    FIELD_STRING(coze_simple_bot_t, "bot_name", bot_name),
+    FIELD_STRING(coze_simple_bot_t, "description", description),
+    FIELD_STRING(coze_simple_bot_t, "icon_url", icon_url),
+    FIELD_STRING(coze_simple_bot_t, "publish_time", publish_time),
+};
+
+static struct json_schema simple_bot_schema = SCHEMA(coze_simple_bot_t, simple_bot_fields);
+
+static const struct json_field workspace_fields[] = {
+    FIELD_STRING(coze_workspace_t, "id", id),
+    FIELD_STRING(coze_workspace_t, "name", name),
+    FIELD_STRING(coze_workspace_t, "icon_url", icon_url),
+    FIELD_INTERNED(coze_workspace_t, "role_type", role_type, workspace_role_types),
+    FIELD_INTERNED(coze_workspace_t, "workspace_type", workspace_type, workspace_types),
+};
+
+static struct json_schema workspace_schema = SCHEMA(coze_workspace_t, workspace_fields);
+
+static const struct json_field voice_fields[] = {
+    FIELD_STRING(coze_voice_t, "voice_id", voice_id),
+    FIELD_STRING(coze_voice_t, "name", name),
+    FIELD_STRING(coze_voice_t, "language_code", language_code),
+    FIELD_STRING(coze_voice_t, "language_name", language_name),
+    FIELD_STRING(coze_voice_t, "preview_text", preview_text),
+    FIELD_STRING(coze_voice_t, "preview_audio", preview_audio),
+    FIELD_BOOL(coze_voice_t, "is_system_voice", is_system_voice),
+    FIELD_INT(coze_voice_t, "create_time", create_time),
+    FIELD_INT(coze_voice_t, "update_time", update_time),
+    FIELD_INT(coze_voice_t, "available_training_times", available_training_times),
+};
+
+static struct json_schema voice_schema = SCHEMA(coze_voice_t, voice_fields);
+
+static const struct json_field oauth_token_fields[] = {
+    FIELD_STRING(coze_oauth_token_t, "access_token", access_token),
+    FIELD_STRING(coze_oauth_token_t, "refresh_token", refresh_token),
+    FIELD_LONG(coze_oauth_token_t, "expires_in", expires_in),
+    FIELD_STRING(coze_oauth_token_t, "token_type", token_type),
+};
+
+static struct json_schema oauth_token_schema = SCHEMA(coze_oauth_token_t, oauth_token_fields);
+
+static const struct json_field workflow_run_result_fields[] = {
+    FIELD_STRING(coze_workflow_run_result_t, "data", data),
+    FIELD_STRING(coze_workflow_run_result_t, "debug_url", debug_url),
+    FIELD_STRING(coze_workflow_run_result_t, "execute_id", execute_id),
+};
+
+static struct json_schema workflow_run_result_schema = SCHEMA(coze_workflow_run_result_t, workflow_run_result_fields);
+
+static const struct json_field audio_room_fields[] = {
+    FIELD_STRING(coze_audio_rooms_create_data_t, "room_id", room_id),
+    FIELD_STRING(coze_audio_rooms_create_data_t, "app_id", app_id),
+    FIELD_STRING(coze_audio_rooms_create_data_t, "token", token),
+    FIELD_STRING(coze_audio_rooms_create_data_t, "uid", uid),
+};
+
+static struct json_schema audio_room_schema = SCHEMA(coze_audio_rooms_create_data_t, audio_room_fields);
+
+static const struct json_field workspaces_data_fields[] = {
+    FIELD_ARRAY(coze_workspaces_data_t, "workspaces", workspaces, workspace_count, &workspace_schema),
+    FIELD_INT(coze_workspaces_data_t, "total_count", total_count),
+};
+
+static struct json_schema workspaces_data_schema = SCHEMA(coze_workspaces_data_t, workspaces_data_fields);
+
+static const struct json_field bots_list_data_fields[] = {
+    FIELD_ARRAY(coze_bots_list_data_t, "space_bots", space_bots, space_bot_count, &simple_bot_schema),
+    FIELD_INT(coze_bots_list_data_t, "total", total),
+};
+
+static struct json_schema bots_list_data_schema = SCHEMA(coze_bots_list_data_t, bots_list_data_fields);
+
+// 会话消息列表的分页字段和 data 数组都在顶层
+static const struct json_field conversations_messages_list_fields[] = {
+    FIELD_ARRAY(coze_conversations_messages_list_data_t, "data", messages, messages_count, &message_schema),
+    FIELD_STRING(coze_conversations_messages_list_data_t, "first_id", first_id),
+    FIELD_STRING(coze_conversations_messages_list_data_t, "last_id", last_id),
+    FIELD_BOOL(coze_conversations_messages_list_data_t, "has_more", has_more),
+};
+
+static struct json_schema conversations_messages_list_schema =
+    SCHEMA(coze_conversations_messages_list_data_t, conversations_messages_list_fields);
+
+static const struct json_field chat_messages_list_fields[] = {
+    FIELD_ARRAY(coze_chat_messages_list_data_t, "data", messages, messages_count, &message_schema),
+};
+
+static struct json_schema chat_messages_list_schema = SCHEMA(coze_chat_messages_list_data_t, chat_messages_list_fields);
+
+// columnar 请求使用的列表 schema, data 数组按列解码
+static const struct json_field conversations_messages_columns_fields[] = {
+    FIELD_COLUMNS(coze_conversations_messages_list_data_t, "data", columns, &message_columns_schema),
+    FIELD_STRING(coze_conversations_messages_list_data_t, "first_id", first_id),
+    FIELD_STRING(coze_conversations_messages_list_data_t, "last_id", last_id),
+    FIELD_BOOL(coze_conversations_messages_list_data_t, "has_more", has_more),
+};
+
+static struct json_schema conversations_messages_columns_schema =
+    SCHEMA(coze_conversations_messages_list_data_t, conversations_messages_columns_fields);
+
+static const struct json_field chat_messages_columns_fields[] = {
+    FIELD_COLUMNS(coze_chat_messages_list_data_t, "data", columns, &message_columns_schema),
+};
+
+static struct json_schema chat_messages_columns_schema =
+    SCHEMA(coze_chat_messages_list_data_t, chat_messages_columns_fields);
+
+static const struct json_field voices_list_data_fields[] = {
+    FIELD_ARRAY(coze_audio_voices_list_data_t, "voice_list", voices, voices_count, &voice_schema),
+    FIELD_BOOL(coze_audio_voices_list_data_t, "has_more", has_more),
+};
+
+static struct json_schema voices_list_data_schema = SCHEMA(coze_audio_voices_list_data_t, voices_list_data_fields);
+
+static struct json_schema *const g_json_schemas[] = {
+    &message_schema, &last_error_schema, &chat_usage_schema, &chat_schema, &conversation_schema, &file_schema,
+    &bot_schema, &simple_bot_schema, &workspace_schema, &voice_schema, &oauth_token_schema,
+    &workflow_run_result_schema, &audio_room_schema, &workspaces_data_schema, &bots_list_data_schema,
+    &conversations_messages_list_schema, &chat_messages_list_schema, &voices_list_data_schema,
+    &message_columns_schema, &conversations_messages_columns_schema, &chat_messages_columns_schema,
+};
+
+static pthread_once_t g_json_schemas_once = PTHREAD_ONCE_INIT;
+
+static uint32_t json_key_hash(const char *key, size_t len) {
+    uint32_t hash = 2166136261u; // FNV-1a
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ (unsigned char) key[i]) * 16777619u;
+    }
+    return hash;
+}
+
+// 首次解码前为所有 schema 建哈希槽
+static void json_schemas_init(void) {
+    for (size_t i = 0; i < sizeof(g_json_schemas) / sizeof(g_json_schemas[0]); i++) {
+        struct json_schema *schema = g_json_schemas[i];
+        for (int field = 0; field < schema->count; field++) {
+            const uint32_t hash = json_key_hash(schema->fields[field].key, schema->fields[field].key_len);
+            unsigned slot = hash & (JSON_SCHEMA_SLOTS - 1);
+            while (schema->slots[slot]) {
+                slot = (slot + 1) & (JSON_SCHEMA_SLOTS - 1);
+            }
+            schema->hashes[slot] = hash;
+            schema->slots[slot] = (uint8_t) (field + 1);
+        }
+    }
+}
+
+static const struct json_field *json_schema_find(const struct json_schema *schema, const char *key, size_t len) {
+    const uint32_t hash = json_key_hash(key, len);
+    for (unsigned slot = hash & (JSON_SCHEMA_SLOTS - 1); schema->slots[slot];
+         slot = (slot + 1) & (JSON_SCHEMA_SLOTS - 1)) {
+        const struct json_field *field = &schema->fields[schema->slots[slot] - 1];
+        if (schema->hashes[slot] == hash && field->key_len == len && memcmp(field->key, key, len) == 0) {
+            return field;
+        }
+    }
+    return NULL;
+}
+
+// items 非 NULL 时字符串放进 items 所在的 arena, 否则逐个复制
+static const char *json_decode_string(const struct json_token *token, void *items) {
+    return items ? arena_string(items, token) : coze_strdup(json_token_string(token));
+}
+
+// 把一个字符串或数值 token 写入字段, 原地解析和流式解析共用; 类型不符的值按缺省处理
+static void json_store_value(const struct json_field *field, char *object, const struct json_token *token,
+                             void *items) {
+    void *target = object + field->offset;
+    switch (field->kind) {
+        case JSON_FIELD_STRING:
+        case JSON_FIELD_ID:
+            if (!*(const char **) target) { // 重复的 key 以第一个为准
+                *(const char **) target = json_decode_string(token, items);
+            }
+            if (field->kind == JSON_FIELD_ID && token->type != JSON_TOKEN_OBJECT && token->type != JSON_TOKEN_ARRAY) {
+                *(uint64_t *) (object + field->aux_offset) = parse_id_len(token->start, token->len);
+            }
+            break;
+        case JSON_FIELD_INTERNED:
+            if (!*(const char **) target) {
+                const char *value = json_token_string(token);
+                const struct interned_string *known = value ? interned_find(field->aux, value, token->len) : NULL;
+                *(const char **) target = known ? known->value : json_decode_string(token, items);
+                *(int *) (object + field->aux_offset) = known ? known->kind : 0; // *_kind 为枚举, 按 int 存储
+            }
+            break;
+        case JSON_FIELD_LONG:
+            *(long *) target = json_token_long(token);
+            break;
+        case JSON_FIELD_INT:
+            *(int *) target = (int) json_token_long(token);
+            break;
+        case JSON_FIELD_BOOL:
+            *(bool *) target = json_token_bool(token);
+            break;
+        default:
+            break;
+    }
+}
+
+#define COLUMN_POOL_MIN_SIZE 256
+
+// content_pool 的容量不单独记录: 总是不小于已用大小的最小的 2 的幂, 解码结束时收缩到已用大小
+static size_t json_pool_capacity(size_t size) {
+    size_t capacity = COLUMN_POOL_MIN_SIZE;
+    while (capacity < size) {
+        capacity *= 2;
+    }
+    return capacity;
+}
+
+// 开始按列解码: content_pool 以一个空字符串开头, 没有 content 的行指向它。已经解码过 (重复的 key) 时返回 false
+static bool json_columns_begin(coze_message_columns_t *columns) {
+    if (columns->content_pool) {
+        return false;
+    }
+    columns->content_pool = coze_malloc(COLUMN_POOL_MIN_SIZE);
+    if (!columns->content_pool) {
+        return false;
+    }
+    columns->content_pool[0] = '\0';
+    columns->content_pool_size = 1;
+    return true;
+}
+
+// 把每一列调整为 capacity 行, 新增的行清零。失败时已调整的列保持更大的容量, 数据不变
+static bool json_columns_resize(const struct json_schema *schema, coze_message_columns_t *columns,
+                                int old_capacity, int capacity) {
+    if (capacity == 0) {
+        return true;
+    }
+    for (int i = 0; i < schema->count; i++) {
+        const struct json_field *field = &schema->fields[i];
+        const size_t size = field->kind == JSON_FIELD_ID     ? sizeof(uint64_t)
+                            : field->kind == JSON_FIELD_LONG ? sizeof(long)
+                            : field->kind == JSON_FIELD_INTERNED ? sizeof(uint8_t)
+                            : sizeof(uint32_t);
+        for (int pass = 0; pass < (field->kind == JSON_FIELD_STRING ? 2 : 1); pass++) {
+            char **column = (char **) ((char *) columns + (pass ? field->aux_offset : field->offset));
+            char *resized = coze_realloc(*column, (size_t) capacity * size);
+            if (!resized) {
+                return false;
+            }
+            if (capacity > old_capacity) {
+                memset(resized + (size_t) old_capacity * size, 0, (size_t) (capacity - old_capacity) * size);
+            }
+            *column = resized;
+        }
+    }
+    return true;
+}
+
+// 追加一行, 返回行号; 列满时翻倍扩容, 容量同样由行数推出 (0 或不小于 8 的 2 的幂时已满)。失败返回 -1
+static int json_columns_push(const struct json_schema *schema, coze_message_columns_t *columns) {
+    const int count = columns->count;
+    if (count == 0 || (count >= 8 && (count & (count - 1)) == 0)) {
+        if (!json_columns_resize(schema, columns, count, count ? count * 2 : 8)) {
+            return -1;
+        }
+    }
+    return columns->count++;
+}
+
+// 收缩到实际行数
+static void json_columns_end(const struct json_schema *schema, coze_message_columns_t *columns) {
+    json_columns_resize(schema, columns, columns->count, columns->count);
+    char *pool = coze_realloc(columns->content_pool, columns->content_pool_size);
+    if (pool) {
+        columns->content_pool = pool;
+    }
+}
+
+// 把字符串复制进 content_pool, 返回偏移; 失败或超出 uint32_t 时返回 0
+static uint32_t json_pool_append(coze_message_columns_t *columns, const char *value, size_t len) {
+    const size_t size = columns->content_pool_size;
+    if (size + len + 1 > UINT32_MAX) {
+        return 0;
+    }
+    if (size + len + 1 > json_pool_capacity(size)) {
+        char *pool = coze_realloc(columns->content_pool, json_pool_capacity(size + len + 1));
+        if (!pool) {
+            return 0;
+        }
+        columns->content_pool = pool;
+    }
+    memcpy(columns->content_pool + size, value, len + 1);
+    columns->content_pool_size = size + len + 1;
+    return (uint32_t) size;
+}
+
+// 把一个字符串或数值 token 写入列 field 的第 row 行, 与 json_store_value 对应; 类型不符的值按缺省处理
+static void json_column_store(const struct json_field *field, coze_message_columns_t *columns, int row,
+                              const struct json_token *token) {
+    if (token->type == JSON_TOKEN_OBJECT || token->type == JSON_TOKEN_ARRAY) {
+        return;
+    }
+    void *column = *(void **) ((char *) columns + field->offset);
+    switch (field->kind) {
+        case JSON_FIELD_ID:
+            ((uint64_t *) column)[row] = parse_id_len(token->start, token->len);
+            break;
+        case JSON_FIELD_LONG:
+            ((long *) column)[row] = json_token_long(token);
+            break;
+        case JSON_FIELD_INTERNED: {
+            const char *value = json_token_string(token);
+            const struct interned_string *known = value ? interned_find(field->aux, value, token->len) : NULL;
+            ((uint8_t *) column)[row] = known ? (uint8_t) known->kind : 0;
+            break;
+        }
+        case JSON_FIELD_STRING: {
+            const char *value = json_token_string(token);
+            uint32_t *offsets = column;
+            if (value && offsets[row] == 0) { // 重复的 key 以第一个为准
+                offsets[row] = json_pool_append(columns, value, token->len);
+                if (offsets[row]) {
+                    (*(uint32_t **) ((char *) columns + field->aux_offset))[row] = (uint32_t) token->len;
+                }
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+static void json_columns_free(const struct json_schema *schema, coze_message_columns_t *columns) {
+    for (int i = 0; i < schema->count; i++) {
+        coze_free(*(void **) ((char *) columns + schema->fields[i].offset));
+        if (schema->fields[i].kind == JSON_FIELD_STRING) {
+            coze_free(*(void **) ((char *) columns + schema->fields[i].aux_offset));
+        }
+    }
+    coze_free(columns->content_pool);
+    memset(columns, 0, sizeof(*columns));
+}
+
+static void json_decode_object(const struct json_document *doc, int object, const struct json_schema *schema,
+                               void *out, void *items);
+
+static void *json_decode_array(const struct json_document *doc, int array, const struct json_schema *schema,
+                               char **body, int *count);
+
+// 消息数组按列解码, 行数事先已知, 每列只分配一次
+static void json_decode_columns(const struct json_document *doc, int array, const struct json_schema *schema,
+                                coze_message_columns_t *columns) {
+    if (array < 0 || doc->tokens[array].type != JSON_TOKEN_ARRAY || !json_columns_begin(columns)) {
+        return;
+    }
+    const int rows = json_array_size(doc, array);
+    if (!json_columns_resize(schema, columns, 0, rows)) {
+        return;
+    }
+    columns->count = rows;
+
+    int item = array + 1;
+    for (int row = 0; row < rows; row++, item = doc->tokens[item].end) {
+        if (doc->tokens[item].type != JSON_TOKEN_OBJECT) {
+            continue;
+        }
+        for (int i = item + 1; i + 1 < doc->tokens[item].end; i = doc->tokens[i + 1].end) {
+            const struct json_field *field = json_schema_find(schema, doc->tokens[i].start, doc->tokens[i].len);
+            if (field) {
+                json_column_store(field, columns, row, &doc->tokens[i + 1]);
+            }
+        }
+    }
+    json_columns_end(schema, columns);
+}
+
+static void json_decode_field(const struct json_document *doc, int index, const struct json_field *field,
+                              char *object, void *items) {
+    void *target = object + field->offset;
+    switch (field->kind) {
+        case JSON_FIELD_OBJECT:
+            json_decode_object(doc, index, field->aux, target, items);
+            break;
+        case JSON_FIELD_ARRAY:
+            if (!*(void **) target) {
+                *(void **) target = json_decode_array(doc, index, field->aux, doc->body,
+                                                      (int *) (object + field->aux_offset));
+            }
+            break;
+        case JSON_FIELD_COLUMNS:
+            json_decode_columns(doc, index, field->aux, target);
+            break;
+        default:
+            json_store_value(field, object, &doc->tokens[index], items);
+            break;
+    }
+}
+
+// 按 schema 把 object 下标处的 JSON 对象解码到 out, 未知的 key 跳过; object 不是对象时什么也不做
+static void json_decode_object(const struct json_document *doc, int object, const struct json_schema *schema,
+                               void *out, void *items) {
+    if (object < 0 || doc->tokens[object].type != JSON_TOKEN_OBJECT) {
+        return;
+    }
+    pthread_once(&g_json_schemas_once, json_schemas_init);
+    for (int i = object + 1; i + 1 < doc->tokens[object].end; i = doc->tokens[i + 1].end) {
+        const struct json_field *field = json_schema_find(schema, doc->tokens[i].start, doc->tokens[i].len);
+        if (field) {
+            json_decode_field(doc, i + 1, field, out, items);
+        }
+    }
+}
+
+// 对象数组解码进一块 arena, 见 arena_create_array; body 非 NULL 时为零拷贝模式, arena 接管 *body 并将其置 NULL
+static void *json_decode_array(const struct json_document *doc, int array, const struct json_schema *schema,
+                               char **body, int *count) {
+    *count = 0;
+    if (array < 0 || doc->tokens[array].type != JSON_TOKEN_ARRAY) {
+        return NULL;
+    }
+    const int items_count = json_array_size(doc, array);
+    char *items = arena_create_array(doc, array, items_count, schema->size, body ? *body : NULL);
+    if (!items) {
+        return NULL;
+    }
+    if (body) {
+        *body = NULL;
+    }
+    *count = items_count;
+
+    int item = array + 1;
+    for (int i = 0; i < items_count; i++, item = doc->tokens[item].end) {
+        json_decode_object(doc, item, schema, items + i * schema->size, items);
+    }
+    return items;
+}
+
+// 释放 json_decode_object 逐个复制出来的字符串和列表 arena (不适用于 arena 中的列表元素)
+static void json_schema_free(const struct json_schema *schema, void *object) {
+    for (int i = 0; i < schema->count; i++) {
+        const struct json_field *field = &schema->fields[i];
+        void *target = (char *) object + field->offset;
+        switch (field->kind) {
+            case JSON_FIELD_STRING:
+            case JSON_FIELD_ID:
+                coze_free(*(void **) target);
+                break;
+            case JSON_FIELD_INTERNED:
+                intern_free(*(const char **) target, *(int *) ((char *) object + field->aux_offset));
+                break;
+            case JSON_FIELD_OBJECT:
+                json_schema_free(field->aux, target);
+                break;
+            case JSON_FIELD_ARRAY:
+                arena_free(*(void **) target);
+                break;
+            case JSON_FIELD_COLUMNS:
+                json_columns_free(field->aux, target);
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+// 响应 {"code": 0, "msg": "", "data": {...}} 的解码目标
+struct json_target {
+    int *code;
+    const char **msg;
+    const char *data_key; // 按 schema 解码的字段, NULL 时解码顶层对象
+    const struct json_schema *schema; // NULL 时只检查 code
+    void *data;
+    bool zero_copy; // 缓存整个响应体并原地解析, 列表字符串直接指向响应体
+    coze_client_t *client; // 非 NULL 时借用 client 的 response_buffer 接收响应体或作为 scratch
+    bool idempotent; // 只读的 POST 接口, 可以和 GET 一样自动重试
+};
+
+// 原地切分 body 并检查 code/msg, 成功时按 target 解码; 零拷贝时 body 交给列表 arena 并置 NULL
+static coze_error_t json_decode_response(char **body, size_t size, const struct json_target *target) {
+    struct json_document doc;
+    if (!json_tokenize(*body, size, &doc)) {
+        json_document_free(&doc);
+        return COZE_ERROR_API;
+    }
+    doc.body = target->zero_copy ? body : NULL;
+
+    char *tmp_msg = NULL;
+    const coze_error_t err = json_parse_response_code(&doc, &tmp_msg, target->code);
+    *target->msg = tmp_msg;
+    if (err == COZE_OK && target->schema) {
+        json_decode_object(&doc, target->data_key ? json_object_get(&doc, 0, target->data_key) : 0, target->schema,
+                           target->data, NULL);
+    }
+    json_document_free(&doc);
+    return err;
+}
+
+// 解码一条 SSE 事件的 data (原地切分), 返回新分配的结构体; data 不是 JSON 对象时返回 NULL
+static void *json_decode_event(char *data, const struct json_schema *schema, size_t object_size) {
+    struct json_document doc;
+    void *object = NULL;
+    if (json_tokenize(data, strlen(data), &doc) && doc.tokens[0].type == JSON_TOKEN_OBJECT) {
+        object = coze_calloc(1, object_size);
+        if (object) {
+            json_decode_object(&doc, 0, schema, object, NULL);
+        }
+    }
+    json_document_free(&doc);
+    return object;
+}
+
+// *** json stream ***
+
+// 流式解码: curl 的写回调逐块喂入响应体, 边接收边按 json_target 写入响应结构体, 不缓存整个响应体。
+// scratch 中只有正在读的一个字符串或数值; 与 json_tokenize 一样只校验括号配对, 不校验逗号和冒号。
+typedef enum {
+    JSON_STREAM_VALUE, // token 之间
+    JSON_STREAM_STRING,
+    JSON_STREAM_ESCAPE, // 字符串中 '\\' 之后
+    JSON_STREAM_UNICODE, // \uXXXX 的十六进制部分
+    JSON_STREAM_SURROGATE, // 高位代理之后, 等待低位代理的 '\\'
+    JSON_STREAM_SURROGATE_U, // 等待低位代理的 'u'
+    JSON_STREAM_PRIMITIVE
+} json_stream_state_t;
+
+typedef enum {
+    JSON_ENVELOPE_NONE,
+    JSON_ENVELOPE_CODE,
+    JSON_ENVELOPE_MSG,
+    JSON_ENVELOPE_ERROR_MESSAGE
+} json_envelope_key_t;
+
+struct json_stream_frame {
+    bool array;
+    bool key; // 对象帧: 下一个字符串是 key
+    const struct json_schema *schema; // 对象帧为对象的 schema, 数组帧为元素的 schema; NULL 时跳过内容
+    char *object; // 对象帧: 写入的结构体; 数组帧: 数组字段所在的结构体
+    const struct json_field *field; // 对象帧: 上一个 key 对应的字段; 数组帧: 数组字段
+    void **items; // 字符串所在 arena 的数组指针的位置, NULL 时逐个复制
+    int capacity; // 数组帧: 已分配的元素个数
+    bool columns; // 按列解码, object 为 coze_message_columns_t
+    int row; // 按列解码的对象帧: 写入的行
+};
+
+struct json_stream {
+    const struct json_target *target;
+    struct json_field data_field; // target->data_key 对应的伪字段
+    json_stream_state_t state;
+    char *scratch;
+    size_t len;
+    size_t capacity;
+    struct client_buffer *buffer; // 非 NULL 表示 scratch 借自该 client 缓冲区
+    unsigned int unicode;
+    int unicode_digits;
+    unsigned int high_surrogate;
+    struct json_stream_frame frames[JSON_MAX_DEPTH];
+    int depth;
+    bool seen; // 读到过完整的值
+    bool failed;
+    size_t received;
+
+    // 顶层的 code/msg/error_code/error_message, 重复的 key 以第一个为准
+    json_envelope_key_t envelope;
+    bool has_code;
+    bool has_msg;
+    bool has_error_code;
+    bool has_error_message;
+    long code;
+    char *msg;
+    char *error_message;
+};
+
+static void json_stream_init(struct json_stream *stream, const struct json_target *target) {
+    memset(stream, 0, sizeof(*stream));
+    stream->target = target;
+    if (target->data_key) {
+        const struct json_field data_field = {
+            target->data_key, strlen(target->data_key), JSON_FIELD_OBJECT, 0, 0, target->schema
+        };
+        stream->data_field = data_field;
+    }
+    if (target->client &&
+        client_buffer_acquire(&target->client->response_buffer, &stream->scratch, &stream->capacity)) {
+        stream->buffer = &target->client->response_buffer;
+    }
+    pthread_once(&g_json_schemas_once, json_schemas_init);
+}
+
+static bool json_stream_reserve(struct json_stream *stream, size_t extra) {
+    if (stream->len + extra + 1 <= stream->capacity) {
+        return true;
+    }
+    size_t capacity = stream->capacity ? stream->capacity * 2 : 256;
+    while (capacity < stream->len + extra + 1) {
+        capacity *= 2;
+    }
+    char *scratch = coze_realloc(stream->scratch, capacity);
+    if (!scratch) {
+        stream->failed = true;
+        return false;
+    }
+    stream->scratch = scratch;
+    stream->capacity = capacity;
+    return true;
+}
+
+static void json_stream_append(struct json_stream *stream, const char *data, size_t len) {
+    if (len > 0 && json_stream_reserve(stream, len)) {
+        memcpy(stream->scratch + stream->len, data, len);
+        stream->len += len;
+    }
+}
+
+static void json_stream_append_utf8(struct json_stream *stream, unsigned int cp) {
+    if (json_stream_reserve(stream, 4)) {
+        stream->len = json_put_utf8(stream->scratch + stream->len, cp) - stream->scratch;
+    }
+}
+
+// 一个值读完: 所在对象回到等待 key 的状态
+static void json_stream_value_done(struct json_stream *stream) {
+    stream->seen = true;
+    if (stream->depth > 0 && !stream->frames[stream->depth - 1].array) {
+        struct json_stream_frame *frame = &stream->frames[stream->depth - 1];
+        frame->key = true;
+        frame->field = NULL;
+    }
+    if (stream->depth == 1) {
+        stream->envelope = JSON_ENVELOPE_NONE;
+    }
+}
+
+static bool json_stream_key_is(const struct json_token *key, const char *name) {
+    return key->len == strlen(name) && memcmp(key->start, name, key->len) == 0;
+}
+
+static void json_stream_key(struct json_stream *stream, struct json_stream_frame *frame, const struct json_token *key) {
+    frame->key = false;
+    frame->field = NULL;
+    if (stream->depth == 1) {
+        if (json_stream_key_is(key, "code")) {
+            stream->envelope = stream->has_code ? JSON_ENVELOPE_NONE : JSON_ENVELOPE_CODE;
+            stream->has_code = true;
+            return;
+        }
+        if (json_stream_key_is(key, "msg")) {
+            stream->envelope = stream->has_msg ? JSON_ENVELOPE_NONE : JSON_ENVELOPE_MSG;
+            stream->has_msg = true;
+            return;
+        }
+        if (json_stream_key_is(key, "error_message")) {
+            stream->envelope = stream->has_error_message ? JSON_ENVELOPE_NONE : JSON_ENVELOPE_ERROR_MESSAGE;
+            stream->has_error_message = true;
+            return;
+        }
+        if (json_stream_key_is(key, "error_code")) {
+            stream->has_error_code = true;
+            return;
+        }
+        if (stream->target->data_key && stream->target->schema &&
+            json_stream_key_is(key, stream->target->data_key)) {
+            frame->field = &stream->data_field;
+            return;
+        }
+    }
+    if (frame->schema) {
+        frame->field = json_schema_find(frame->schema, key->start, key->len);
+    }
+}
+
+// 数组帧追加一个清零的元素, 数组满时翻倍扩容。与 json_decode_array 一致, 不是对象的元素也占一个位置
+static char *json_stream_push_item(struct json_stream *stream, struct json_stream_frame *frame) {
+    int *count = (int *) (frame->object + frame->field->aux_offset);
+    const size_t item_size = frame->schema->size;
+    if (*count == frame->capacity) {
+        const int capacity = frame->capacity ? frame->capacity * 2 : 8;
+        void *items = arena_resize_array(*frame->items, frame->capacity, capacity, item_size);
+        if (!items) {
+            stream->failed = true;
+            return NULL;
+        }
+        *frame->items = items;
+        frame->capacity = capacity;
+    }
+    return (char *) *frame->items + (size_t) (*count)++ * item_size;
+}
+
+// 字符串或数值读完, 内容在 scratch 中
+static void json_stream_token(struct json_stream *stream, json_token_type_t type) {
+    if (!json_stream_reserve(stream, 0)) {
+        return;
+    }
+    stream->scratch[stream->len] = '\0';
+    const struct json_token token = {type, stream->scratch, stream->len, 0};
+    if (stream->depth == 0) {
+        stream->seen = true;
+        return;
+    }
+
+    struct json_stream_frame *frame = &stream->frames[stream->depth - 1];
+    if (frame->array) {
+        if (frame->columns) {
+            stream->failed = json_columns_push(frame->schema, (coze_message_columns_t *) frame->object) < 0;
+        } else if (frame->schema) {
+            json_stream_push_item(stream, frame);
+        }
+        return;
+    }
+    if (frame->key) {
+        json_stream_key(stream, frame, &token);
+        return;
+    }
+
+    if (stream->envelope == JSON_ENVELOPE_CODE) {
+        stream->code = json_token_long(&token);
+    } else if (stream->envelope == JSON_ENVELOPE_MSG) {
+        stream->msg = coze_strdup(json_token_string(&token));
+    } else if (stream->envelope == JSON_ENVELOPE_ERROR_MESSAGE) {
+        stream->error_message = coze_strdup(json_token_string(&token));
+    } else if (frame->field && frame->columns) {
+        json_column_store(frame->field, (coze_message_columns_t *) frame->object, frame->row, &token);
+    } else if (frame->field && frame->field->kind != JSON_FIELD_OBJECT && frame->field->kind != JSON_FIELD_ARRAY &&
+               frame->field->kind != JSON_FIELD_COLUMNS) {
+        json_store_value(frame->field, frame->object, &token, frame->items ? *frame->items : NULL);
+    }
+    json_stream_value_done(stream);
+}
+
+static void json_stream_begin(struct json_stream *stream, bool array) {
+    if (stream->depth == JSON_MAX_DEPTH) {
+        stream->failed = true;
+        return;
+    }
+    struct json_stream_frame frame = {.array = array, .key = !array};
+    struct json_stream_frame *parent = stream->depth > 0 ? &stream->frames[stream->depth - 1] : NULL;
+    if (!parent) {
+        if (!array && stream->target->schema) {
+            frame.object = stream->target->data;
+            frame.schema = stream->target->data_key ? NULL : stream->target->schema;
+        }
+    } else if (parent->columns && parent->array) {
+        const int row = json_columns_push(parent->schema, (coze_message_columns_t *) parent->object);
+        if (row < 0) {
+            stream->failed = true;
+            return;
+        }
+        if (!array) {
+            frame.schema = parent->schema;
+            frame.object = parent->object;
+            frame.columns = true;
+            frame.row = row;
+        }
+    } else if (parent->array) {
+        if (parent->schema) {
+            char *item = json_stream_push_item(stream, parent);
+            if (!item) {
+                return;
+            }
+            if (!array) {
+                frame.schema = parent->schema;
+                frame.object = item;
+                frame.items = parent->items;
+            }
+        }
+    } else if (parent->field) {
+        const struct json_field *field = parent->field;
+        void **target = (void **) (parent->object + field->offset);
+        if (!array && field->kind == JSON_FIELD_OBJECT) {
+            frame.schema = field->aux;
+            frame.object = (char *) target;
+            frame.items = parent->items;
+        } else if (array && field->kind == JSON_FIELD_ARRAY && !*target) {
+            // 与 json_decode_array 一致, 空数组也分配 arena
+            *target = arena_resize_array(NULL, 0, 0, ((const struct json_schema *) field->aux)->size);
+            if (!*target) {
+                stream->failed = true;
+                return;
+            }
+            frame.schema = field->aux;
+            frame.object = parent->object;
+            frame.field = field;
+            frame.items = target;
+        } else if (array && field->kind == JSON_FIELD_COLUMNS && !((coze_message_columns_t *) target)->content_pool) {
+            if (!json_columns_begin((coze_message_columns_t *) target)) {
+                stream->failed = true;
+                return;
+            }
+            frame.schema = field->aux;
+            frame.object = (char *) target;
+            frame.field = field;
+            frame.columns = true;
+        }
+    }
+    stream->frames[stream->depth++] = frame;
+}
+
+static void json_stream_end(struct json_stream *stream, bool array) {
+    if (stream->depth == 0 || stream->frames[stream->depth - 1].array != array) {
+        stream->failed = true;
+        return;
+    }
+    const struct json_stream_frame *frame = &stream->frames[--stream->depth];
+    if (array && frame->columns) {
+        json_columns_end(frame->schema, (coze_message_columns_t *) frame->object);
+    } else if (array && frame->schema) {
+        // 收缩到实际元素个数
+        const int count = *(int *) (frame->object + frame->field->aux_offset);
+        void *items = arena_resize_array(*frame->items, frame->capacity, count, frame->schema->size);
+        if (items) {
+            *frame->items = items;
+        }
+    }
+    json_stream_value_done(stream);
+}
+
+static void json_stream_escape(struct json_stream *stream, char c) {
+    static const char escapes[][2] = {
+        {'"', '"'}, {'\\', '\\'}, {'/', '/'}, {'b', '\b'}, {'f', '\f'}, {'n', '\n'}, {'r', '\r'}, {'t', '\t'}
+    };
+    if (c == 'u') {
+        stream->unicode = 0;
+        stream->unicode_digits = 0;
+        stream->state = JSON_STREAM_UNICODE;
+        return;
+    }
+    for (size_t i = 0; i < sizeof(escapes) / sizeof(escapes[0]); i++) {
+        if (escapes[i][0] == c) {
+            json_stream_append(stream, &escapes[i][1], 1);
+            stream->state = JSON_STREAM_STRING;
+            return;
+        }
+    }
+    stream->failed = true;
+}
+
+static void json_stream_unicode(struct json_stream *stream, char c) {
+    const int digit = c >= '0' && c <= '9' ? c - '0'
+                      : c >= 'a' && c <= 'f' ? c - 'a' + 10
+                      : c >= 'A' && c <= 'F' ? c - 'A' + 10
+                      : -1;
+    if (digit < 0) {
+        stream->failed = true;
+        return;
+    }
+    stream->unicode = stream->unicode << 4 | (unsigned int) digit;
+    if (++stream->unicode_digits < 4) {
+        return;
+    }
+
+    unsigned int cp = stream->unicode;
+    if (stream->high_surrogate) {
+        if (cp < 0xDC00 || cp > 0xDFFF) {
+            stream->failed = true;
+            return;
+        }
+        cp = 0x10000 + ((stream->high_surrogate - 0xD800) << 10) + (cp - 0xDC00);
+        stream->high_surrogate = 0;
+    } else if (cp >= 0xD800 && cp < 0xDC00) {
+        stream->high_surrogate = cp; // 代理对, 需要紧跟低位 \uDC00-\uDFFF
+        stream->state = JSON_STREAM_SURROGATE;
+        return;
+    }
+    json_stream_append_utf8(stream, cp);
+    stream->state = JSON_STREAM_STRING;
+}
+
+static bool json_primitive_end(char c) {
+    return c == ',' || c == '}' || c == ']' || c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static void json_stream_feed(struct json_stream *stream, const char *data, size_t len) {
+    const char *p = data;
+    const char *end = data + len;
+    stream->received += len;
+    while (p < end && !stream->failed) {
+        switch (stream->state) {
+            case JSON_STREAM_STRING: {
+                // 普通字符成段复制
+                const char *run = p;
+                p = scan_string(p, end);
+                json_stream_append(stream, run, p - run);
+                if (p == end) {
+                    break;
+                }
+                if (*p == '"') {
+                    stream->state = JSON_STREAM_VALUE;
+                    json_stream_token(stream, JSON_TOKEN_STRING);
+                } else if (*p == '\\') {
+                    stream->state = JSON_STREAM_ESCAPE;
+                } else {
+                    stream->failed = true;
+                }
+                p++;
+                break;
+            }
+            case JSON_STREAM_ESCAPE:
+                json_stream_escape(stream, *p++);
+                break;
+            case JSON_STREAM_UNICODE:
+                json_stream_unicode(stream, *p++);
+                break;
+            case JSON_STREAM_SURROGATE:
+                stream->failed = *p++ != '\\';
+                stream->state = JSON_STREAM_SURROGATE_U;
+                break;
+            case JSON_STREAM_SURROGATE_U:
+                stream->failed = *p++ != 'u';
+                stream->unicode = 0;
+                stream->unicode_digits = 0;
+                stream->state = JSON_STREAM_UNICODE;
+                break;
+            case JSON_STREAM_PRIMITIVE: {
+                const char *run = p;
+                while (p < end && !json_primitive_end(*p)) {
+                    p++;
+                }
+                json_stream_append(stream, run, p - run);
+                if (p < end) {
+                    stream->state = JSON_STREAM_VALUE; // 分隔符留给下一轮处理
+                    json_stream_token(stream, JSON_TOKEN_PRIMITIVE);
+                }
+                break;
+            }
+            case JSON_STREAM_VALUE: {
+                const char c = *p;
+                if (c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == ',' || c == ':') {
+                    p++;
+                } else if (c == '{' || c == '[') {
+                    json_stream_begin(stream, c == '[');
+                    p++;
+                } else if (c == '}' || c == ']') {
+                    json_stream_end(stream, c == ']');
+                    p++;
+                } else if (c == '"') {
+                    stream->len = 0;
+                    stream->state = JSON_STREAM_STRING;
+                    p++;
+                } else if (c == '-' || (c >= '0' && c <= '9') || c == 't' || c == 'f' || c == 'n') {
+                    stream->len = 0;
+                    stream->state = JSON_STREAM_PRIMITIVE;
+                } else {
+                    stream->failed = true;
+                }
+                break;
+            }
+        }
+    }
+}
+
+static size_t json_stream_write_callback(void *contents, size_t size, size_t nmemb, void *userp) {
+    json_stream_feed(userp, contents, size * nmemb);
+    return size * nmemb;
+}
+
+// 结束解码并检查 code/msg, 与 json_decode_response 的结果一致。
+// err 为传输结果; 传输失败, 响应体不完整或 code 非 0 时丢弃已写入 target->data 的数据
+static coze_error_t json_stream_finish(struct json_stream *stream, coze_error_t err) {
+    const struct json_target *target = stream->target;
+    if (err == COZE_OK && stream->state == JSON_STREAM_PRIMITIVE && !stream->failed) {
+        stream->state = JSON_STREAM_VALUE;
+        json_stream_token(stream, JSON_TOKEN_PRIMITIVE);
+    }
+    if (err == COZE_OK &&
+        (stream->failed || stream->state != JSON_STREAM_VALUE || stream->depth != 0 || !stream->seen)) {
+        err = COZE_ERROR_API;
+    } else if (err == COZE_OK) {
+        // error_message 优先
+        if (stream->has_error_message) {
+            *target->msg = stream->error_message;
+            stream->error_message = NULL;
+        } else {
+            *target->msg = stream->msg;
+            stream->msg = NULL;
+        }
+
+        if (stream->has_code) {
+            if (target->code) {
+                *target->code = (int) stream->code;
+            }
+            if (stream->code != 0) {
+                err = COZE_ERROR_API;
+            }
+        } else if (stream->has_error_code) {
+            if (target->code) {
+                *target->code = -1; // auth code not int
+            }
+            err = COZE_ERROR_API;
+        }
+    }
+
+    if (err != COZE_OK && target->schema && target->data) {
+        json_schema_free(target->schema, target->data);
+        memset(target->data, 0, target->schema->size);
+    }
+    coze_free(stream->msg);
+    coze_free(stream->error_message);
+    if (stream->buffer) {
+        client_buffer_release(stream->buffer, stream->scratch, stream->capacity);
+    } else {
+        coze_free(stream->scratch);
+    }
+    return err;
+}
+
 
 void coze_free_response(coze_response_t *resp);
 
-void coze_free_bot(coze_bot_t *bot);
+void coze_free_bot(coze_bot_t *bot);
+
+void coze_free_conversation(coze_conversation_t *conversation);
+
+void coze_free_message(coze_message_t *message);
+
+void coze_free_chat(coze_chat_t *chat);
+
+void coze_free_file(coze_file_t *file);
+
+void coze_free_voice(coze_voice_t *voice);
+
+void coze_free_oauth_token(coze_oauth_token_t *token);
+
+void coze_free_response_header(coze_response_t *coze_response) {
+    if (!coze_response) {
+        return;
+    }
+    coze_free((void *) coze_response->logid);
+    coze_response->logid = NULL;
+}
+
+void pure_log(const char *title, const char *data) {
+    if (!__atomic_load_n(&g_log_enabled, __ATOMIC_RELAXED)) {
+        return;
+    }
+    char *escaped = coze_malloc(strlen(data) * 2 + 1);
+    char *p = escaped;
+    for (const char *s = data; *s; s++) {
+        if (*s == '\n') {
+            *p++ = '\\';
+            *p++ = 'n';
+        } else if (*s == '\r') {
+            *p++ = '\\';
+            *p++ = 'r';
+        } else if (*s == '\t') {
+            *p++ = '\\';
+            *p++ = 't';
+        } else if (*s == '"') {
+            *p++ = '\\';
+            *p++ = '"';
+        } else {
+            *p++ = *s;
+        }
+    }
+    *p = '\0';
+    printf("%s: %s\n", title, escaped);
+    coze_free(escaped);
+}
+
+struct MemoryStruct {
+    char *memory;
+    size_t size;
+    size_t capacity; // 已分配的字节数, 含结尾的 '\0'
+};
+
+#define BODY_RESERVE_MAX (64 << 20) // Content-Length 超过时不预分配, 按实际收到的数据增长
+
+// 保证 memory 至少有 capacity 字节, 失败时不变
+static bool memory_reserve(struct MemoryStruct *mem, size_t capacity) {
+    if (capacity <= mem->capacity) {
+        return true;
+    }
+    char *ptr = coze_realloc(mem->memory, capacity);
+    if (!ptr) {
+        return false;
+    }
+    mem->memory = ptr;
+    mem->capacity = capacity;
+    return true;
+}
+
+// 响应头给出 Content-Length 时一次分配到位 (gzip 等编码下只是下限)
+static void ReserveMemoryCallback(void *userp, size_t content_length) {
+    if (content_length < BODY_RESERVE_MAX) {
+        memory_reserve(userp, content_length + 1);
+    }
+}
+
+static size_t WriteMemoryCallback(void *contents, size_t size, size_t nmemb, void *userp) {
+    size_t realsize = size * nmemb;
+    struct MemoryStruct *mem = (struct MemoryStruct *) userp;
+
+    // 没有 Content-Length 或它偏小时按倍数增长
+    const size_t needed = mem->size + realsize + 1;
+    if (needed > mem->capacity) {
+        size_t capacity = mem->capacity ? mem->capacity * 2 : 4096;
+        while (capacity < needed) {
+            capacity *= 2;
+        }
+        if (!memory_reserve(mem, capacity)) {
+            return 0;
+        }
+    }
+
+    memcpy(&(mem->memory[mem->size]), contents, realsize);
+    mem->size += realsize;
+    mem->memory[mem->size] = 0;
+
+    return realsize;
+}
+
+// 回调函数，用于处理响应头数据
+static size_t header_callback(char *buffer, size_t size, size_t nitems, void *userdata) {
+    size_t total_size = size * nitems;
+    coze_response_t *coze_response = (coze_response_t *) userdata;
+
+    // 将响应头行转换为字符串便于处理
+    char header_line[1024] = {0};
+    strncpy(header_line, buffer, total_size < sizeof(header_line) ? total_size : sizeof(header_line) - 1);
+
+    // 查找 x-tt-logid header
+    if (strncasecmp(header_line, "x-tt-logid:", 11) == 0) {
+        char *logid_start = header_line + 11;
+        // 跳过空格
+        while (*logid_start == ' ') {
+            logid_start++;
+        }
+        // 移除末尾的换行符和回车符
+        char *logid_end = logid_start;
+        while (*logid_end && *logid_end != '\r' && *logid_end != '\n') {
+            logid_end++;
+        }
+        *logid_end = '\0';
+
+        // 保存 logid 到 header 结构体
+        if (coze_response) {
+            coze_free((char *) coze_response->logid); // 重试时会收到多次
+            coze_response->logid = coze_strdup(logid_start);
+        }
+    }
+
+    return total_size;
+}
+
+static char *build_url(const char *api_base, const char *path) {
+    const char *base_url = api_base && strlen(api_base) > 0 ? api_base : "https://api.coze.cn";
+    size_t base_len = strlen(base_url);
+    if (base_url[base_len - 1] == '/') {
+        base_len--;
+    }
+
+    const size_t path_len = strlen(path);
+    char *url = coze_malloc(base_len + path_len + 1);
+    if (!url) {
+        return NULL;
+    }
+    memcpy(url, base_url, base_len);
+    memcpy(url + base_len, path, path_len + 1);
+    return url;
+}
+
+#define API_BASE_KEY_SIZE 256
+
+// 与 build_url 一致: 空 api_base 为默认地址, 去掉末尾的 '/'; 过长的截断
+static void api_base_key(const char *api_base, char *key) {
+    const char *base = api_base && strlen(api_base) > 0 ? api_base : "https://api.coze.cn";
+    size_t len = strlen(base);
+    len -= base[len - 1] == '/';
+    len = len < API_BASE_KEY_SIZE ? len : API_BASE_KEY_SIZE - 1;
+    memcpy(key, base, len);
+    key[len] = '\0';
+}
+
+// data: id: xx\ndata: xx\n
+// 一条 SSE 事件的字段, 只在回调期间有效; data 可以原地修改
+struct sse_event {
+    const char *id; // 没有对应的行时为 NULL
+    const char *event;
+    char *data; // 多个 data 行以 '\n' 连接
+    size_t data_len;
+};
+
+typedef void (*sse_event_callback_t)(const struct sse_event *event, void *biz_ctx);
+
+struct sse_buffer {
+    char *data;
+    size_t len;
+    size_t capacity;
+    bool present; // 当前事件中出现过该字段
+};
+
+// SSE 数据处理回调: 每个数据块只扫描一遍, 按 '\n', '\r' 或 "\r\n" 分行, 空行结束一个事件。
+// 完整的行直接在数据块中解析, 只有跨块的半行复制进 line; 字段缓冲在事件之间复用。
+struct SSEContext {
+    struct sse_buffer line; // 跨块的未完整行
+    struct sse_buffer id;
+    struct sse_buffer event;
+    struct sse_buffer data;
+    bool skip_lf; // 上一块以 '\r' 结尾, 下一块开头的 '\n' 属于同一个换行
+    bool failed;
+    sse_event_callback_t sse_event_callback;
+    void *biz_ctx;
+};
+
+static bool sse_buffer_append(struct sse_buffer *buffer, const char *data, size_t len) {
+    if (buffer->len + len + 1 > buffer->capacity) {
+        size_t capacity = buffer->capacity ? buffer->capacity * 2 : 256;
+        while (capacity < buffer->len + len + 1) {
+            capacity *= 2;
+        }
+        char *resized = coze_realloc(buffer->data, capacity);
+        if (!resized) {
+            return false;
+        }
+        buffer->data = resized;
+        buffer->capacity = capacity;
+    }
+    memcpy(buffer->data + buffer->len, data, len);
+    buffer->len += len;
+    buffer->data[buffer->len] = '\0';
+    return true;
+}
+
+static void sse_buffer_set(struct sse_buffer *buffer, const char *data, size_t len, bool *ok) {
+    buffer->len = 0;
+    buffer->present = true;
+    *ok = sse_buffer_append(buffer, data, len) && *ok;
+}
+
+static void sse_dispatch(struct SSEContext *ctx) {
+    if ((ctx->event.present || ctx->data.present) && ctx->sse_event_callback) {
+        const struct sse_event event = {
+            ctx->id.present ? ctx->id.data : NULL,
+            ctx->event.present ? ctx->event.data : NULL,
+            ctx->data.present ? ctx->data.data : NULL,
+            ctx->data.len
+        };
+        ctx->sse_event_callback(&event, ctx->biz_ctx);
+    }
+    ctx->id.present = false;
+    ctx->event.present = false;
+    ctx->data.present = false;
+    ctx->data.len = 0;
+}
+
+// 处理一行 (不含换行符): "field:value", 冒号后的一个空格不算在值里; 空行分发事件, 注释和未知字段忽略
+static void sse_process_line(struct SSEContext *ctx, const char *line, size_t len) {
+    if (len == 0) {
+        sse_dispatch(ctx);
+        return;
+    }
+    const char *colon = memchr(line, ':', len);
+    const size_t name_len = colon ? (size_t) (colon - line) : len;
+    const char *value = colon ? colon + 1 : line + len;
+    size_t value_len = line + len - value;
+    if (value_len > 0 && *value == ' ') {
+        value++;
+        value_len--;
+    }
+
+    bool ok = true;
+    if (name_len == 4 && memcmp(line, "data", 4) == 0) {
+        if (ctx->data.present) {
+            ok = sse_buffer_append(&ctx->data, "\n", 1);
+        }
+        ctx->data.present = true;
+        ok = ok && sse_buffer_append(&ctx->data, value, value_len);
+    } else if (name_len == 5 && memcmp(line, "event", 5) == 0) {
+        sse_buffer_set(&ctx->event, value, value_len, &ok);
+    } else if (name_len == 2 && memcmp(line, "id", 2) == 0) {
+        sse_buffer_set(&ctx->id, value, value_len, &ok);
+    }
+    ctx->failed = ctx->failed || !ok;
+}
+
+static size_t sse_write_callback(void *contents, size_t size, size_t nmemb, void *userp) {
+    const size_t realsize = size * nmemb;
+    struct SSEContext *ctx = userp;
+    const char *p = contents;
+    const char *end = p + realsize;
+
+    if (ctx->skip_lf && p < end) {
+        p += *p == '\n';
+        ctx->skip_lf = false;
+    }
+    while (p < end && !ctx->failed) {
+        const char *eol = scan_newline(p, end);
+        if (eol == end) {
+            ctx->failed = !sse_buffer_append(&ctx->line, p, end - p);
+            break;
+        }
+        if (ctx->line.len > 0) {
+            ctx->failed = !sse_buffer_append(&ctx->line, p, eol - p);
+            sse_process_line(ctx, ctx->line.data, ctx->line.len);
+            ctx->line.len = 0;
+        } else {
+            sse_process_line(ctx, p, eol - p);
+        }
+        if (*eol == '\r') {
+            if (eol + 1 == end) {
+                ctx->skip_lf = true;
+            } else {
+                eol += eol[1] == '\n';
+            }
+        }
+        p = eol + 1;
+    }
+
+    return ctx->failed ? 0 : realsize;
+}
+
+// 传输结束: 处理没有以换行结尾的最后一行和没有以空行结尾的最后一个事件, 释放缓冲
+static void sse_finish(struct SSEContext *ctx) {
+    if (!ctx->failed) {
+        if (ctx->line.len > 0) {
+            sse_process_line(ctx, ctx->line.data, ctx->line.len);
+        }
+        sse_dispatch(ctx);
+    }
+    coze_free(ctx->line.data);
+    coze_free(ctx->id.data);
+    coze_free(ctx->event.data);
+    coze_free(ctx->data.data);
+}
+
+// *** transport ***
+
+// 响应接收端: curl、VCR 回放和自定义 transport 都通过它把响应头和响应体交给 SDK
+struct coze_transport_sink {
+    coze_response_t *coze_response;
+    size_t (*write_body)(void *contents, size_t size, size_t nmemb, void *userp);
+    void (*reserve_body)(void *userp, size_t content_length); // 可选, 收到 Content-Length 时调用
+    void *body_userp;
+    size_t body_bytes; // 已交给 write_body 的字节数, 压缩响应为解压后的字节数
+    bool compressed; // 响应带 Content-Encoding
+    int http_status; // 最后一个状态行的状态码
+    uint64_t retry_after_us; // Retry-After (秒数形式), 0 表示没有
+    const coze_retry_policy_t *retry; // 本次之后还能重试时的策略, 否则为 NULL
+    bool body_started;
+    uint64_t first_byte_us; // 收到第一个响应体分片的时间
+    bool discard_body; // 响应将被重试, 响应体不交给 write_body
+    bool connect_failed; // 没有连上服务端, 请求一定没有发出, 可以换端点重发
+
+    uint32_t vcr_id; // 录制中的交互 ID, 0 表示未录制
+    uint64_t vcr_start_us; // 交互开始时间
+};
+
+static struct {
+    coze_transport_fn fn;
+    void *ctx;
+} g_transport = {0};
+
+// 非 SSE 请求默认带 Accept-Encoding, 由 curl 边接收边解压
+static bool g_response_compression = true;
+
+static struct {
+    size_t requests;
+    size_t compressed_requests;
+    size_t wire_bytes;
+    size_t body_bytes;
+    size_t retries;
+    size_t retry_giveups;
+    size_t hedges;
+    size_t hedge_wins;
+    size_t throttled;
+    size_t rate_limited;
+    uint64_t rate_limit_wait_us;
+    size_t circuit_trips;
+    size_t circuit_rejected;
+    size_t failovers;
+    size_t new_connections;
+} g_transfer_stats;
+
+void coze_set_response_compression(bool enabled) {
+    g_response_compression = enabled;
+}
+
+void coze_transfer_stats_reset(void) {
+    __atomic_store_n(&g_transfer_stats.requests, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&g_transfer_stats.compressed_requests, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&g_transfer_stats.wire_bytes, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&g_transfer_stats.body_bytes, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&g_transfer_stats.retries, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&g_transfer_stats.retry_giveups, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&g_transfer_stats.hedges, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&g_transfer_stats.hedge_wins, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&g_transfer_stats.throttled, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&g_transfer_stats.rate_limited, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&g_transfer_stats.rate_limit_wait_us, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&g_transfer_stats.circuit_trips, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&g_transfer_stats.circuit_rejected, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&g_transfer_stats.failovers, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&g_transfer_stats.new_connections, 0, __ATOMIC_RELAXED);
+}
+
+void coze_transfer_stats_get(coze_transfer_stats_t *stats) {
+    if (!stats) {
+        return;
+    }
+    stats->requests = __atomic_load_n(&g_transfer_stats.requests, __ATOMIC_RELAXED);
+    stats->compressed_requests = __atomic_load_n(&g_transfer_stats.compressed_requests, __ATOMIC_RELAXED);
+    stats->wire_bytes = __atomic_load_n(&g_transfer_stats.wire_bytes, __ATOMIC_RELAXED);
+    stats->body_bytes = __atomic_load_n(&g_transfer_stats.body_bytes, __ATOMIC_RELAXED);
+    stats->retries = __atomic_load_n(&g_transfer_stats.retries, __ATOMIC_RELAXED);
+    stats->retry_giveups = __atomic_load_n(&g_transfer_stats.retry_giveups, __ATOMIC_RELAXED);
+    stats->hedges = __atomic_load_n(&g_transfer_stats.hedges, __ATOMIC_RELAXED);
+    stats->hedge_wins = __atomic_load_n(&g_transfer_stats.hedge_wins, __ATOMIC_RELAXED);
+    stats->throttled = __atomic_load_n(&g_transfer_stats.throttled, __ATOMIC_RELAXED);
+    stats->rate_limited = __atomic_load_n(&g_transfer_stats.rate_limited, __ATOMIC_RELAXED);
+    stats->rate_limit_wait_us = __atomic_load_n(&g_transfer_stats.rate_limit_wait_us, __ATOMIC_RELAXED);
+    stats->circuit_trips = __atomic_load_n(&g_transfer_stats.circuit_trips, __ATOMIC_RELAXED);
+    stats->circuit_rejected = __atomic_load_n(&g_transfer_stats.circuit_rejected, __ATOMIC_RELAXED);
+    stats->failovers = __atomic_load_n(&g_transfer_stats.failovers, __ATOMIC_RELAXED);
+    stats->new_connections = __atomic_load_n(&g_transfer_stats.new_connections, __ATOMIC_RELAXED);
+}
+
+static void transfer_stats_add(const coze_transport_sink_t *sink, size_t wire_bytes) {
+    __atomic_fetch_add(&g_transfer_stats.requests, 1, __ATOMIC_RELAXED);
+    if (sink->compressed) {
+        __atomic_fetch_add(&g_transfer_stats.compressed_requests, 1, __ATOMIC_RELAXED);
+    }
+    if (sink->http_status == 429) {
+        __atomic_fetch_add(&g_transfer_stats.throttled, 1, __ATOMIC_RELAXED);
+    }
+    __atomic_fetch_add(&g_transfer_stats.wire_bytes, wire_bytes, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&g_transfer_stats.body_bytes, sink->body_bytes, __ATOMIC_RELAXED);
+}
+
+static uint64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000u + (uint64_t) ts.tv_nsec / 1000u;
+}
+
+// 调用时限 (CLOCK_MONOTONIC 微秒): 请求的 timeout_ms 优先, 未设置时使用 client 的; 0 表示不限
+static uint64_t request_deadline_us(const coze_client_t *client, int timeout_ms) {
+    if (timeout_ms <= 0 && client) {
+        timeout_ms = client->timeout_ms;
+    }
+    return timeout_ms > 0 ? now_us() + (uint64_t) timeout_ms * 1000u : 0;
+}
+
+// 距离时限的剩余毫秒数, 至少为 1; 不限时为 0, 已经到期时为 -1
+static int deadline_remaining_ms(uint64_t deadline_us) {
+    if (!deadline_us) {
+        return 0;
+    }
+    const uint64_t now = now_us();
+    if (now >= deadline_us) {
+        return -1;
+    }
+    const uint64_t remaining = (deadline_us - now + 999) / 1000u;
+    return remaining < INT_MAX ? (int) remaining : INT_MAX;
+}
+
+static void sleep_us(uint64_t us) {
+    struct timespec ts = {
+        .tv_sec = (time_t) (us / 1000000u),
+        .tv_nsec = (long) (us % 1000000u) * 1000L,
+    };
+    while (nanosleep(&ts, &ts) != 0) {
+    }
+}
+
+// *** retry ***
+
+#define RETRY_POLICY_MAX_PATHS 32
+
+// 幂等接口默认的策略: 最多 3 次, 网络错误 / 5xx / 429 时重试
+#define RETRY_POLICY_DEFAULT { \
+        .max_attempts = 3, \
+        .base_delay_ms = 100, \
+        .max_delay_ms = 2000, \
+        .jitter = 1.0, \
+        .retry_network_errors = true, \
+        .retry_server_errors = true, \
+        .retry_throttled = true, \
+        .honor_retry_after = true, \
+    }
+
+// fallback 用于没有单独配置的接口
+static struct {
+    coze_retry_policy_t fallback;
+    int count;
+    struct {
+        char path[128];
+        coze_retry_policy_t policy;
+    } paths[RETRY_POLICY_MAX_PATHS];
+} g_retry = {.fallback = RETRY_POLICY_DEFAULT};
+
+// path 不含 query 的部分与 endpoint 相同时匹配
+static bool retry_path_matches(const char *endpoint, const char *path) {
+    const size_t len = strlen(endpoint);
+    return strncmp(endpoint, path, len) == 0 && (path[len] == '\0' || path[len] == '?');
+}
+
+coze_error_t coze_set_retry_policy(const char *path, const coze_retry_policy_t *policy) {
+    if (!path) {
+        g_retry.fallback = policy ? *policy : (coze_retry_policy_t) RETRY_POLICY_DEFAULT;
+        return COZE_OK;
+    }
+    if (strlen(path) >= sizeof(g_retry.paths[0].path)) {
+        return COZE_ERROR_INVALID_PARAM;
+    }
+    for (int i = 0; i < g_retry.count; i++) {
+        if (strcmp(g_retry.paths[i].path, path) != 0) {
+            continue;
+        }
+        if (policy) {
+            g_retry.paths[i].policy = *policy;
+        } else {
+            g_retry.paths[i] = g_retry.paths[--g_retry.count];
+        }
+        return COZE_OK;
+    }
+    if (!policy) {
+        return COZE_OK;
+    }
+    if (g_retry.count == RETRY_POLICY_MAX_PATHS) {
+        return COZE_ERROR_INVALID_PARAM;
+    }
+    strcpy(g_retry.paths[g_retry.count].path, path);
+    g_retry.paths[g_retry.count++].policy = *policy;
+    return COZE_OK;
+}
+
+// 返回 NULL 表示该请求不自动重试
+static const coze_retry_policy_t *retry_policy_for(const char *path, bool idempotent) {
+    const coze_retry_policy_t *policy = &g_retry.fallback;
+    for (int i = 0; i < g_retry.count; i++) {
+        if (retry_path_matches(g_retry.paths[i].path, path)) {
+            policy = &g_retry.paths[i].policy;
+            break;
+        }
+    }
+    if (policy->max_attempts <= 1 || (!idempotent && !policy->retry_non_idempotent)) {
+        return NULL;
+    }
+    return policy;
+}
+
+// 服务端要求的等待超过 max_delay_ms 时不再重试, 直接返回这次的响应
+static bool retry_status_wanted(const coze_retry_policy_t *policy, const coze_transport_sink_t *sink) {
+    const int status = sink->http_status;
+    if (!((status == 429 && policy->retry_throttled) ||
+          (status >= 500 && status < 600 && policy->retry_server_errors))) {
+        return false;
+    }
+    return !policy->honor_retry_after || sink->retry_after_us <= (uint64_t) policy->max_delay_ms * 1000u;
+}
+
+// 只有在响应体还没交给解码器时才能重试, 否则已解码的部分无法撤回
+static bool retry_wanted(const coze_retry_policy_t *policy, const coze_transport_sink_t *sink, coze_error_t err) {
+    if (sink->body_bytes > 0) {
+        return false;
+    }
+    return err != COZE_OK ? policy->retry_network_errors : retry_status_wanted(policy, sink);
+}
+
+static __thread uint64_t t_retry_seed;
+
+static double retry_random(void) {
+    if (t_retry_seed == 0) {
+        t_retry_seed = now_us() ^ (uint64_t) (uintptr_t) &t_retry_seed ^ 0x9e3779b97f4a7c15ull;
+    }
+    t_retry_seed ^= t_retry_seed >> 12;
+    t_retry_seed ^= t_retry_seed << 25;
+    t_retry_seed ^= t_retry_seed >> 27;
+    return (double) ((t_retry_seed * 0x2545f4914f6cdd1dull) >> 11) / (double) (1ull << 53);
+}
+
+// 第 attempt 次失败后的等待: 指数退避加抖动, Retry-After 更长时以它为准
+static uint64_t retry_delay_us(const coze_retry_policy_t *policy, const coze_transport_sink_t *sink, int attempt) {
+    const uint64_t max_us = (uint64_t) policy->max_delay_ms * 1000u;
+    uint64_t delay = (uint64_t) policy->base_delay_ms * 1000u << (attempt - 1 < 20 ? attempt - 1 : 20);
+    if (delay > max_us) {
+        delay = max_us;
+    }
+    const double jitter = policy->jitter < 0 ? 0 : policy->jitter > 1 ? 1 : policy->jitter;
+    delay -= (uint64_t) ((double) delay * jitter * retry_random());
+    if (policy->honor_retry_after && sink->retry_after_us > delay) {
+        delay = sink->retry_after_us;
+    }
+    return delay;
+}
+
+// *** retry ***
+
+// *** rate limit ***
+
+#define RATE_LIMIT_MAX_FAMILIES 32
+#define RATE_LIMIT_MAX_BUCKETS 64 // (token, family) 组合数上限, 超出后新的组合不限流
+#define RATE_LIMIT_FAMILY_SIZE 64
+#define RATE_LIMIT_MAX_CONCURRENCY 1000 // 自适应并发没有设置 max_in_flight 时的上限
+#define RATE_LIMIT_INITIAL_CONCURRENCY 8
+
+// 每个 (api_token, 接口族) 一个令牌桶和一个并发计数; token 只保存哈希
+struct rate_bucket {
+    uint64_t token_hash;
+    char family[RATE_LIMIT_FAMILY_SIZE];
+    coze_rate_limit_t limit;
+    double rate; // 当前速率, 收到 429 时下调, 之后逐步恢复到 limit.requests_per_second
+    double safe_rate; // 上次触发 429 时速率的 95%, 恢复时先快速回到这里, 再缓慢试探
+    uint64_t cut_us; // 上次下调的时间, 同一波 429 只下调一次
+    double tokens;
+    uint64_t refill_us;
+    uint64_t blocked_until_us; // Retry-After 期间不发请求
+    int in_flight;
+    int queued; // 正在排队等许可的请求数
+    // 自适应并发 (gradient): 首字节延迟的短期均值明显高于长期均值, 说明请求开始在服务端排队
+    double concurrency; // 当前并发上限
+    double latency_long_us;
+    double latency_short_us;
+};
+
+// 一次请求持有的许可, bucket 为 NULL 表示不限流
+struct rate_permit {
+    struct rate_bucket *bucket;
+    uint64_t start_us;
+};
+
+static struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond; // 桶有余量或并发释放时广播
+    coze_rate_limit_t fallback; // 没有单独配置的接口族使用, 默认不限
+    int family_count;
+    struct {
+        char family[RATE_LIMIT_FAMILY_SIZE];
+        coze_rate_limit_t limit;
+    } families[RATE_LIMIT_MAX_FAMILIES];
+    int bucket_count;
+    struct rate_bucket buckets[RATE_LIMIT_MAX_BUCKETS];
+} g_rate_limit = {.lock = PTHREAD_MUTEX_INITIALIZER};
+
+static pthread_once_t g_rate_limit_once = PTHREAD_ONCE_INIT;
+
+static void rate_limit_init(void) {
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&g_rate_limit.cond, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+static bool rate_limit_enabled(const coze_rate_limit_t *limit) {
+    return limit->requests_per_second > 0 || limit->max_in_flight > 0 || limit->adaptive_concurrency;
+}
+
+static int rate_limit_concurrency_ceiling(const coze_rate_limit_t *limit) {
+    return limit->max_in_flight > 0 ? limit->max_in_flight : RATE_LIMIT_MAX_CONCURRENCY;
+}
+
+// 当前生效的并发上限, 0 表示不限
+static int rate_bucket_max_in_flight(const struct rate_bucket *bucket) {
+    return bucket->limit.adaptive_concurrency ? (int) bucket->concurrency : bucket->limit.max_in_flight;
+}
+
+// 需持有 g_rate_limit.lock; 按接口族查当前配置
+static const coze_rate_limit_t *rate_limit_config(const char *family) {
+    for (int i = 0; i < g_rate_limit.family_count; i++) {
+        if (strcmp(g_rate_limit.families[i].family, family) == 0) {
+            return &g_rate_limit.families[i].limit;
+        }
+    }
+    return &g_rate_limit.fallback;
+}
+
+// 需持有 g_rate_limit.lock; 桶套用新配置, 已有的桶不删除 (在途许可和排队的请求还指向它), 关闭限流后只放行
+static void rate_bucket_configure(struct rate_bucket *bucket, const coze_rate_limit_t *limit) {
+    const double burst = limit->burst > 0 ? limit->burst : 1;
+    const int ceiling = rate_limit_concurrency_ceiling(limit);
+    if (bucket->limit.requests_per_second != limit->requests_per_second) {
+        bucket->rate = limit->requests_per_second;
+        bucket->safe_rate = limit->requests_per_second;
+    }
+    if (!bucket->limit.adaptive_concurrency && limit->adaptive_concurrency) {
+        bucket->concurrency = RATE_LIMIT_INITIAL_CONCURRENCY;
+    }
+    bucket->concurrency = bucket->concurrency < ceiling ? bucket->concurrency : ceiling;
+    bucket->tokens = bucket->tokens < burst ? bucket->tokens : burst;
+    bucket->limit = *limit;
+}
+
+coze_error_t coze_set_rate_limit(const char *family, const coze_rate_limit_t *limit) {
+    if (family && strlen(family) >= RATE_LIMIT_FAMILY_SIZE) {
+        return COZE_ERROR_INVALID_PARAM;
+    }
+    pthread_mutex_lock(&g_rate_limit.lock);
+    coze_error_t err = COZE_OK;
+    if (!family) {
+        g_rate_limit.fallback = limit ? *limit : (coze_rate_limit_t){0};
+    } else {
+        int i = 0;
+        while (i < g_rate_limit.family_count && strcmp(g_rate_limit.families[i].family, family) != 0) {
+            i++;
+        }
+        if (i < g_rate_limit.family_count && !limit) {
+            g_rate_limit.families[i] = g_rate_limit.families[--g_rate_limit.family_count];
+        } else if (i == RATE_LIMIT_MAX_FAMILIES) {
+            err = COZE_ERROR_INVALID_PARAM;
+        } else if (limit) {
+            strcpy(g_rate_limit.families[i].family, family);
+            g_rate_limit.families[i].limit = *limit;
+            g_rate_limit.family_count += i == g_rate_limit.family_count;
+        }
+    }
+    for (int i = 0; i < g_rate_limit.bucket_count; i++) {
+        struct rate_bucket *bucket = &g_rate_limit.buckets[i];
+        rate_bucket_configure(bucket, rate_limit_config(bucket->family));
+    }
+    pthread_cond_broadcast(&g_rate_limit.cond); // 排队的请求按新配置重新判断
+    pthread_mutex_unlock(&g_rate_limit.lock);
+    return err;
+}
+
+// 接口族为路径的前两段, 例如 "/v3/chat/message/list" 属于 "/v3/chat"
+static void rate_limit_family(const char *path, char *family) {
+    size_t len = strcspn(path, "?");
+    const char *second = len > 1 ? memchr(path + 1, '/', len - 1) : NULL;
+    const char *third = second ? memchr(second + 1, '/', len - (size_t) (second + 1 - path)) : NULL;
+    if (third) {
+        len = (size_t) (third - path);
+    }
+    len = len < RATE_LIMIT_FAMILY_SIZE ? len : RATE_LIMIT_FAMILY_SIZE - 1;
+    memcpy(family, path, len);
+    family[len] = '\0';
+}
+
+static uint64_t rate_limit_token_hash(const char *api_token) {
+    uint64_t hash = 0xcbf29ce484222325ull; // FNV-1a
+    for (const char *p = api_token ? api_token : ""; *p; p++) {
+        hash = (hash ^ (uint8_t) *p) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+// 需持有 g_rate_limit.lock; 不限流时返回 NULL
+static struct rate_bucket *rate_limit_bucket(uint64_t token_hash, const char *family) {
+    for (int i = 0; i < g_rate_limit.bucket_count; i++) {
+        struct rate_bucket *bucket = &g_rate_limit.buckets[i];
+        if (bucket->token_hash == token_hash && strcmp(bucket->family, family) == 0) {
+            return bucket;
+        }
+    }
+    const coze_rate_limit_t *limit = rate_limit_config(family);
+    if (!rate_limit_enabled(limit) || g_rate_limit.bucket_count == RATE_LIMIT_MAX_BUCKETS) {
+        return NULL;
+    }
+    struct rate_bucket *bucket = &g_rate_limit.buckets[g_rate_limit.bucket_count++];
+    *bucket = (struct rate_bucket){
+        .token_hash = token_hash,
+        .tokens = limit->burst > 0 ? limit->burst : 1,
+        .refill_us = now_us(),
+        .concurrency = RATE_LIMIT_INITIAL_CONCURRENCY,
+    };
+    strcpy(bucket->family, family);
+    rate_bucket_configure(bucket, limit);
+    return bucket;
+}
+
+static void rate_limit_refill(struct rate_bucket *bucket, uint64_t now) {
+    const double burst = bucket->limit.burst > 0 ? bucket->limit.burst : 1;
+    bucket->tokens += bucket->rate * (double) (now - bucket->refill_us) / 1e6;
+    bucket->tokens = bucket->tokens > burst ? burst : bucket->tokens;
+    bucket->refill_us = now;
+}
+
+// 拿到发送许可; 超过 max_wait_ms 仍拿不到时返回 COZE_ERROR_RATE_LIMITED, 请求不发出。调用时限 deadline_us
+// 先到时返回 COZE_ERROR_DEADLINE_EXCEEDED, 排队中的请求直接丢弃
+static coze_error_t rate_limit_acquire(const char *api_token, const char *path, uint64_t deadline_us,
+                                       struct rate_permit *permit) {
+    *permit = (struct rate_permit){0};
+    pthread_once(&g_rate_limit_once, rate_limit_init);
+    char family[RATE_LIMIT_FAMILY_SIZE];
+    rate_limit_family(path, family);
+    const uint64_t token_hash = rate_limit_token_hash(api_token);
+
+    pthread_mutex_lock(&g_rate_limit.lock);
+    struct rate_bucket *bucket = rate_limit_bucket(token_hash, family);
+    const uint64_t start = now_us();
+    const int max_wait_ms = bucket ? bucket->limit.max_wait_ms : 0;
+    uint64_t deadline = max_wait_ms < 0 ? UINT64_MAX : start + (uint64_t) max_wait_ms * 1000u;
+    coze_error_t limited = COZE_ERROR_RATE_LIMITED;
+    if (deadline_us && deadline_us <= deadline) {
+        deadline = deadline_us;
+        limited = COZE_ERROR_DEADLINE_EXCEEDED;
+    }
+    coze_error_t err = COZE_OK;
+    while (bucket) {
+        const uint64_t now = now_us();
+        if (deadline_us && now >= deadline_us) {
+            err = COZE_ERROR_DEADLINE_EXCEEDED;
+            break;
+        }
+        rate_limit_refill(bucket, now);
+        uint64_t wake = UINT64_MAX; // 并发已满时等待广播
+        if (now < bucket->blocked_until_us) {
+            wake = bucket->blocked_until_us;
+        } else if (rate_bucket_max_in_flight(bucket) > 0 && bucket->in_flight >= rate_bucket_max_in_flight(bucket)) {
+        } else if (bucket->rate > 0 && bucket->tokens < 1) {
+            wake = now + (uint64_t) ((1 - bucket->tokens) / bucket->rate * 1e6) + 1;
+        } else {
+            bucket->tokens -= bucket->rate > 0 ? 1 : 0;
+            bucket->in_flight++;
+            *permit = (struct rate_permit){.bucket = bucket, .start_us = now};
+            break;
+        }
+        if (now >= deadline || (wake != UINT64_MAX && wake > deadline)) {
+            err = limited; // 等到截止也拿不到, 直接失败
+            __atomic_fetch_add(&g_transfer_stats.rate_limited, 1, __ATOMIC_RELAXED);
+            break;
+        }
+        const uint64_t until = wake < deadline ? wake : deadline;
+        bucket->queued++;
+        if (until == UINT64_MAX) {
+            pthread_cond_wait(&g_rate_limit.cond, &g_rate_limit.lock);
+        } else {
+            // now_us 与 CLOCK_MONOTONIC 同源
+            const struct timespec ts = {.tv_sec = (time_t) (until / 1000000u),
+                                        .tv_nsec = (long) (until % 1000000u) * 1000L};
+            pthread_cond_timedwait(&g_rate_limit.cond, &g_rate_limit.lock, &ts);
+        }
+        bucket->queued--;
+        bucket = rate_limit_bucket(token_hash, family); // 等待期间配置可能已变
+    }
+    pthread_mutex_unlock(&g_rate_limit.lock);
+    __atomic_fetch_add(&g_transfer_stats.rate_limit_wait_us, now_us() - start, __ATOMIC_RELAXED);
+    return err;
+}
+
+// 按一次请求的结果调整并发上限: 429、5xx 和网络错误乘性下调; 否则按延迟梯度 (短期均值允许到长期均值的 1.5 倍)
+// 收缩, 没有排队时放宽 sqrt(上限) 的余量
+static void rate_limit_adapt_concurrency(struct rate_bucket *bucket, const struct rate_permit *held,
+                                         const coze_transport_sink_t *sink) {
+    const double ceiling = rate_limit_concurrency_ceiling(&bucket->limit);
+    double limit = bucket->concurrency;
+    if (sink->http_status == 0 || sink->http_status == 429 || sink->http_status >= 500) {
+        limit *= 0.9;
+        bucket->latency_long_us *= 0.9; // 基准里已经含有排队时间, 一起下调
+    } else if (sink->first_byte_us > held->start_us) {
+        const double sample = (double) (sink->first_byte_us - held->start_us);
+        if (bucket->latency_long_us == 0) {
+            bucket->latency_long_us = sample;
+            bucket->latency_short_us = sample;
+        }
+        bucket->latency_short_us += (sample - bucket->latency_short_us) * 0.1;
+        bucket->latency_long_us += (sample - bucket->latency_long_us) * 0.01;
+        if (bucket->latency_long_us > bucket->latency_short_us * 2) {
+            bucket->latency_long_us *= 0.95; // 负载下降后基准跟着回落
+        }
+        double gradient = bucket->latency_long_us * 1.5 / bucket->latency_short_us;
+        gradient = gradient < 0.5 ? 0.5 : gradient > 1 ? 1 : gradient;
+        int headroom = 1; // sqrt(上限), 实际并发不到上限一半时不放宽, 避免空闲时上限无限增长
+        while ((headroom + 1) * (headroom + 1) <= (int) limit) {
+            headroom++;
+        }
+        headroom = gradient == 1 && bucket->in_flight + 1 >= limit / 2 ? headroom : 0;
+        limit += (limit * gradient + headroom - limit) * 0.2 / limit; // 每轮 (约 limit 个响应) 调整 20%
+    }
+    bucket->concurrency = limit < 1 ? 1 : limit > ceiling ? ceiling : limit;
+}
+
+// 归还许可; adapt_to_throttling 时按响应调整速率: 429 乘性下调并在 Retry-After 内暂停,
+// 之后快速回到触发 429 前的安全速率, 超过后只缓慢试探, 使速率停在服务端上限附近而不是来回振荡
+static void rate_limit_release(const struct rate_permit *held, const coze_transport_sink_t *sink) {
+    struct rate_bucket *permit = held->bucket;
+    if (!permit) {
+        return;
+    }
+    pthread_mutex_lock(&g_rate_limit.lock);
+    permit->in_flight--;
+    if (permit->limit.adaptive_concurrency) {
+        rate_limit_adapt_concurrency(permit, held, sink);
+    }
+    const double ceiling = permit->limit.requests_per_second;
+    if (permit->limit.adapt_to_throttling && ceiling > 0) {
+        const uint64_t now = now_us();
+        if (sink->http_status == 429) {
+            if (now - permit->cut_us >= 1000000u) { // 并发中的请求会一起收到 429, 只算一次
+                permit->safe_rate = permit->rate * 0.95;
+                permit->rate = permit->rate * 0.7 > ceiling * 0.05 ? permit->rate * 0.7 : ceiling * 0.05;
+                permit->cut_us = now;
+            }
+            permit->tokens = permit->tokens < 0 ? permit->tokens : 0;
+            if (now + sink->retry_after_us > permit->blocked_until_us) {
+                permit->blocked_until_us = now + sink->retry_after_us;
+            }
+        } else if (sink->http_status > 0 && sink->http_status < 500) {
+            const double step = permit->rate < permit->safe_rate ? (permit->safe_rate - permit->rate) * 0.1 : 0;
+            permit->rate += step > ceiling * 0.0003 ? step : ceiling * 0.0003;
+            permit->rate = permit->rate < ceiling ? permit->rate : ceiling;
+        }
+    }
+    pthread_cond_broadcast(&g_rate_limit.cond);
+    pthread_mutex_unlock(&g_rate_limit.lock);
+}
+
+coze_error_t coze_get_rate_limit_state(const char *api_token, const char *family, coze_rate_limit_state_t *state) {
+    if (!family || !state) {
+        return COZE_ERROR_INVALID_PARAM;
+    }
+    *state = (coze_rate_limit_state_t){0};
+    const uint64_t token_hash = rate_limit_token_hash(api_token);
+    pthread_mutex_lock(&g_rate_limit.lock);
+    for (int i = 0; i < g_rate_limit.bucket_count; i++) {
+        const struct rate_bucket *bucket = &g_rate_limit.buckets[i];
+        if (bucket->token_hash == token_hash && strcmp(bucket->family, family) == 0) {
+            state->requests_per_second = bucket->rate;
+            state->in_flight_limit = rate_bucket_max_in_flight(bucket);
+            state->in_flight = bucket->in_flight;
+            state->queued = bucket->queued;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&g_rate_limit.lock);
+    return COZE_OK;
+}
+
+// *** rate limit ***
+
+// *** circuit breaker ***
+
+#define CIRCUIT_MAX_BASES 16 // api_base 数上限, 超出后新的 api_base 不熔断
+#define CIRCUIT_MAX_WINDOW 100
+
+#define CIRCUIT_OUTCOME_FAILED 1
+#define CIRCUIT_OUTCOME_SLOW 2
+
+enum circuit_state {
+    CIRCUIT_CLOSED,
+    CIRCUIT_OPEN,
+    CIRCUIT_HALF_OPEN,
+};
+
+// 每个 api_base 一个熔断器, 闭合时按最近 window 个请求的失败率和慢请求率判断是否断开
+struct circuit {
+    char base[API_BASE_KEY_SIZE];
+    enum circuit_state state;
+    uint8_t outcomes[CIRCUIT_MAX_WINDOW]; // 环形窗口, CIRCUIT_OUTCOME_* 的组合
+    int next;
+    int count;
+    int failures;
+    int slow;
+    uint64_t opened_us;
+    uint64_t half_open_us; // 本轮半开开始的时间
+    int probes_in_flight; // 半开时放行的探测请求
+    int probes_ok;
+    uint32_t generation; // 进入半开或配置变化时加一, 之前发出的请求结果不再计入
+};
+
+// 一次请求通过熔断器的凭证, circuit 为 NULL 表示没有熔断
+struct circuit_permit {
+    struct circuit *circuit;
+    uint32_t generation;
+    uint64_t start_us;
+    bool probe;
+};
+
+static struct {
+    pthread_mutex_t lock;
+    bool enabled;
+    coze_circuit_breaker_t policy; // 已填好默认值
+    int count;
+    struct circuit circuits[CIRCUIT_MAX_BASES];
+} g_circuit = {.lock = PTHREAD_MUTEX_INITIALIZER};
+
+static void circuit_reset_window(struct circuit *circuit) {
+    circuit->next = 0;
+    circuit->count = 0;
+    circuit->failures = 0;
+    circuit->slow = 0;
+}
+
+void coze_set_circuit_breaker(const coze_circuit_breaker_t *policy) {
+    pthread_mutex_lock(&g_circuit.lock);
+    __atomic_store_n(&g_circuit.enabled, policy != NULL, __ATOMIC_RELAXED);
+    if (policy) {
+        coze_circuit_breaker_t p = *policy;
+        p.window = p.window > 0 ? p.window < CIRCUIT_MAX_WINDOW ? p.window : CIRCUIT_MAX_WINDOW : 20;
+        p.min_requests = p.min_requests > 0 ? p.min_requests < p.window ? p.min_requests : p.window : 10;
+        p.failure_percent = p.failure_percent > 0 ? p.failure_percent : 50;
+        p.slow_percent = p.slow_percent > 0 ? p.slow_percent : 80;
+        p.open_ms = p.open_ms > 0 ? p.open_ms : 5000;
+        p.probes = p.probes > 0 ? p.probes : 3;
+        g_circuit.policy = p;
+    }
+    // 配置变了, 所有 api_base 重新从闭合开始; 熔断器原地重置, 在途请求的凭证还指向它们
+    for (int i = 0; i < g_circuit.count; i++) {
+        struct circuit *circuit = &g_circuit.circuits[i];
+        circuit->state = CIRCUIT_CLOSED;
+        circuit->probes_in_flight = 0;
+        circuit->probes_ok = 0;
+        circuit->generation++;
+        circuit_reset_window(circuit);
+    }
+    pthread_mutex_unlock(&g_circuit.lock);
+}
+
+// 需持有 g_circuit.lock
+static void circuit_open(struct circuit *circuit, const char *reason) {
+    circuit->state = CIRCUIT_OPEN;
+    circuit->opened_us = now_us();
+    circuit_reset_window(circuit);
+    __atomic_fetch_add(&g_transfer_stats.circuit_trips, 1, __ATOMIC_RELAXED);
+    COZE_LOG("circuit open: %s, %s\n", circuit->base, reason);
+}
+
+// 需持有 g_circuit.lock; 开始新一轮半开, 上一轮还没返回的探测不再占用名额
+static void circuit_half_open(struct circuit *circuit, uint64_t now) {
+    circuit->state = CIRCUIT_HALF_OPEN;
+    circuit->half_open_us = now;
+    circuit->probes_in_flight = 0;
+    circuit->probes_ok = 0;
+    circuit->generation++;
+}
+
+// 断开时直接返回 COZE_ERROR_CIRCUIT_OPEN, 请求不发出; 断开 open_ms 后半开, 只放行 probes 个探测请求。
+// 一轮半开 open_ms 内没有凑齐结果 (例如上游接受连接后不响应, 请求又没有超时) 时重新开始一轮
+static coze_error_t circuit_acquire(const char *api_base, struct circuit_permit *permit) {
+    *permit = (struct circuit_permit){0};
+    if (!__atomic_load_n(&g_circuit.enabled, __ATOMIC_RELAXED)) { // 不加锁的快速判断, 加锁后再确认
+        return COZE_OK;
+    }
+    char key[API_BASE_KEY_SIZE];
+    api_base_key(api_base, key);
+
+    pthread_mutex_lock(&g_circuit.lock);
+    struct circuit *circuit = NULL;
+    for (int i = 0; i < g_circuit.count; i++) {
+        if (strcmp(g_circuit.circuits[i].base, key) == 0) {
+            circuit = &g_circuit.circuits[i];
+            break;
+        }
+    }
+    if (!circuit && g_circuit.count < CIRCUIT_MAX_BASES) {
+        circuit = &g_circuit.circuits[g_circuit.count++];
+        *circuit = (struct circuit){0};
+        strcpy(circuit->base, key);
+    }
+    if (!circuit || !g_circuit.enabled) {
+        pthread_mutex_unlock(&g_circuit.lock);
+        return COZE_OK;
+    }
+    const uint64_t now = now_us();
+    const uint64_t open_us = (uint64_t) g_circuit.policy.open_ms * 1000u;
+    if (circuit->state == CIRCUIT_OPEN && now - circuit->opened_us >= open_us) {
+        circuit_half_open(circuit, now);
+    } else if (circuit->state == CIRCUIT_HALF_OPEN && now - circuit->half_open_us >= open_us &&
+               circuit->probes_in_flight + circuit->probes_ok >= g_circuit.policy.probes) {
+        circuit_half_open(circuit, now);
+    }
+    coze_error_t err = COZE_OK;
+    if (circuit->state == CIRCUIT_CLOSED) {
+        *permit = (struct circuit_permit){.circuit = circuit, .generation = circuit->generation, .start_us = now};
+    } else if (circuit->state == CIRCUIT_HALF_OPEN &&
+               circuit->probes_in_flight + circuit->probes_ok < g_circuit.policy.probes) {
+        circuit->probes_in_flight++;
+        *permit = (struct circuit_permit){
+                .circuit = circuit, .generation = circuit->generation, .start_us = now, .probe = true};
+    } else {
+        err = COZE_ERROR_CIRCUIT_OPEN;
+        __atomic_fetch_add(&g_transfer_stats.circuit_rejected, 1, __ATOMIC_RELAXED);
+    }
+    pthread_mutex_unlock(&g_circuit.lock);
+    return err;
+}
+
+// 请求没有发出或被限流 (429), 不计入统计, 只让出探测名额
+static void circuit_skip(const struct circuit_permit *permit) {
+    if (permit->circuit && permit->probe) {
+        pthread_mutex_lock(&g_circuit.lock);
+        if (permit->generation == permit->circuit->generation) {
+            permit->circuit->probes_in_flight--;
+        }
+        pthread_mutex_unlock(&g_circuit.lock);
+    }
+}
+
+// 记录一次请求的结果: 网络错误和 5xx 算失败, 429 是限流不算; 首字节 (没有响应体时为结束) 晚于 slow_call_ms 算慢
+static void circuit_release(const struct circuit_permit *permit, const coze_transport_sink_t *sink, coze_error_t err) {
+    struct circuit *circuit = permit->circuit;
+    if (!circuit || (err == COZE_OK && sink->http_status == 429)) {
+        circuit_skip(permit);
+        return;
+    }
+    const uint64_t end = sink->first_byte_us > permit->start_us ? sink->first_byte_us : now_us();
+    pthread_mutex_lock(&g_circuit.lock);
+    const coze_circuit_breaker_t *policy = &g_circuit.policy;
+    const bool failed = err != COZE_OK || sink->http_status >= 500;
+    const bool slow = policy->slow_call_ms > 0 && end - permit->start_us > (uint64_t) policy->slow_call_ms * 1000u;
+    if (permit->generation != circuit->generation) {
+        // 发出后配置变了或已进入新一轮半开, 结果作废
+    } else if (permit->probe) {
+        circuit->probes_in_flight--;
+        if (circuit->state != CIRCUIT_HALF_OPEN) {
+        } else if (failed || slow) {
+            circuit_open(circuit, failed ? "probe failed" : "probe slow");
+        } else if (++circuit->probes_ok >= policy->probes) {
+            circuit->state = CIRCUIT_CLOSED;
+            circuit_reset_window(circuit);
+            COZE_LOG("circuit closed: %s\n", circuit->base);
+        }
+    } else if (circuit->state == CIRCUIT_CLOSED) {
+        // 滑动窗口: 先移出最旧的结果
+        if (circuit->count == policy->window) {
+            const uint8_t oldest = circuit->outcomes[circuit->next];
+            circuit->failures -= (oldest & CIRCUIT_OUTCOME_FAILED) != 0;
+            circuit->slow -= (oldest & CIRCUIT_OUTCOME_SLOW) != 0;
+        } else {
+            circuit->count++;
+        }
+        circuit->outcomes[circuit->next] = (uint8_t) ((failed ? CIRCUIT_OUTCOME_FAILED : 0) |
+                                                      (slow ? CIRCUIT_OUTCOME_SLOW : 0));
+        circuit->next = (circuit->next + 1) % policy->window;
+        circuit->failures += failed;
+        circuit->slow += slow;
+        if (circuit->count >= policy->min_requests) {
+            if (circuit->failures * 100 >= policy->failure_percent * circuit->count) {
+                circuit_open(circuit, "error rate over threshold");
+            } else if (policy->slow_call_ms > 0 && circuit->slow * 100 >= policy->slow_percent * circuit->count) {
+                circuit_open(circuit, "slow call rate over threshold");
+            }
+        }
+    }
+    pthread_mutex_unlock(&g_circuit.lock);
+}
+
+// *** circuit breaker ***
+
+// *** endpoints ***
+
+#define ENDPOINT_MAX_GROUPS 8
+#define ENDPOINT_MAX_PER_GROUP 8
+#define ENDPOINT_PROBE_INTERVAL_US 2000000u // 每个端点至少这么久被选中一次, 保持延迟估计是新的
+#define ENDPOINT_ERROR_LATENCY_US 1000000.0 // 5xx 和中途断开按 1 秒计入延迟, 让出流量但不摘除
+#define ENDPOINT_DOWN_MAX_US 30000000u
+
+// 一个 api_base 对应的一组端点, 每个请求按健康状况和首字节延迟的 EWMA 选一个
+struct endpoint {
+    char base[API_BASE_KEY_SIZE];
+    double latency_us; // 首字节延迟的 EWMA, 0 表示还没有样本
+    uint64_t last_used_us;
+    int in_flight;
+    int failures; // 连续连接失败次数
+    uint64_t down_until_us; // 连接失败后按指数退避暂停选择
+};
+
+struct endpoint_group {
+    char base[API_BASE_KEY_SIZE];
+    int count;
+    struct endpoint endpoints[ENDPOINT_MAX_PER_GROUP];
+};
+
+// 一次请求选中的端点; group 为 -1 表示 api_base 没有配置端点组, 直接使用 base
+struct endpoint_pick {
+    int group;
+    int index;
+    uint32_t generation;
+    uint64_t start_us;
+    char base[API_BASE_KEY_SIZE];
+};
+
+static struct {
+    pthread_mutex_t lock;
+    uint32_t generation; // 每次修改配置加一, 旧配置下选中的端点不再回写
+    int count;
+    struct endpoint_group groups[ENDPOINT_MAX_GROUPS];
+} g_endpoints = {.lock = PTHREAD_MUTEX_INITIALIZER};
+
+coze_error_t coze_set_endpoints(const char *api_base, const char *const *endpoints, int count) {
+    if (count < 0 || count > ENDPOINT_MAX_PER_GROUP || (count > 0 && !endpoints)) {
+        return COZE_ERROR_INVALID_PARAM;
+    }
+    for (int i = 0; i < count; i++) {
+        if (!endpoints[i] || strlen(endpoints[i]) == 0 || strlen(endpoints[i]) >= API_BASE_KEY_SIZE) {
+            return COZE_ERROR_INVALID_PARAM;
+        }
+    }
+    char key[API_BASE_KEY_SIZE];
+    api_base_key(api_base, key);
+
+    pthread_mutex_lock(&g_endpoints.lock);
+    int i = 0;
+    while (i < g_endpoints.count && strcmp(g_endpoints.groups[i].base, key) != 0) {
+        i++;
+    }
+    coze_error_t err = COZE_OK;
+    if (count == 0) {
+        if (i < g_endpoints.count) {
+            g_endpoints.groups[i] = g_endpoints.groups[--g_endpoints.count];
+        }
+    } else if (i == ENDPOINT_MAX_GROUPS) {
+        err = COZE_ERROR_INVALID_PARAM;
+    } else {
+        struct endpoint_group *group = &g_endpoints.groups[i];
+        *group = (struct endpoint_group){.count = count};
+        strcpy(group->base, key);
+        for (int j = 0; j < count; j++) {
+            api_base_key(endpoints[j], group->endpoints[j].base);
+        }
+        g_endpoints.count += i == g_endpoints.count;
+    }
+    g_endpoints.generation++;
+    pthread_mutex_unlock(&g_endpoints.lock);
+    return err;
+}
+
+// 选端点: 跳过 exclude 中的端点 (本次请求已经连不上的) 和暂停中的端点, 太久没用的先探测一次,
+// 其余按 延迟 × (进行中请求数 + 1) 取最小; 都在暂停时选最早恢复的。exclude 排除了所有端点时返回 false
+static bool endpoint_select(const char *api_base, uint32_t exclude, struct endpoint_pick *pick) {
+    *pick = (struct endpoint_pick){.group = -1};
+    api_base_key(api_base, pick->base);
+    pthread_mutex_lock(&g_endpoints.lock);
+    struct endpoint_group *group = NULL;
+    for (int i = 0; i < g_endpoints.count; i++) {
+        if (strcmp(g_endpoints.groups[i].base, pick->base) == 0) {
+            group = &g_endpoints.groups[i];
+            pick->group = i;
+            break;
+        }
+    }
+    if (!group) {
+        pthread_mutex_unlock(&g_endpoints.lock);
+        return true;
+    }
+    const uint64_t now = now_us();
+    int best = -1;
+    int unsampled = -1;
+    int earliest = -1;
+    double best_score = 0;
+    for (int i = 0; i < group->count; i++) {
+        const struct endpoint *endpoint = &group->endpoints[i];
+        if (exclude & (1u << i)) {
+            continue;
+        }
+        if (endpoint->down_until_us > now) {
+            if (earliest < 0 || endpoint->down_until_us < group->endpoints[earliest].down_until_us) {
+                earliest = i;
+            }
+            continue;
+        }
+        if (now - endpoint->last_used_us >= ENDPOINT_PROBE_INTERVAL_US) {
+            best = i;
+            break;
+        }
+        const double score = endpoint->latency_us * (endpoint->in_flight + 1);
+        if (endpoint->latency_us > 0 && (best < 0 || score < best_score)) {
+            best = i;
+            best_score = score;
+        } else if (endpoint->latency_us == 0 && unsampled < 0) {
+            unsampled = i; // 探测还没有结果, 没有别的选择时才用
+        }
+    }
+    best = best >= 0 ? best : unsampled >= 0 ? unsampled : earliest;
+    if (best >= 0) {
+        struct endpoint *endpoint = &group->endpoints[best];
+        endpoint->in_flight++;
+        endpoint->last_used_us = now;
+        pick->index = best;
+        pick->generation = g_endpoints.generation;
+        pick->start_us = now;
+        strcpy(pick->base, endpoint->base);
+    }
+    pthread_mutex_unlock(&g_endpoints.lock);
+    return best >= 0;
+}
+
+// 记录结果; sent 为 false 表示请求被熔断或限流拦下, 没有发出
+static void endpoint_release(const struct endpoint_pick *pick, const coze_transport_sink_t *sink, coze_error_t err,
+                             bool sent) {
+    if (pick->group < 0) {
+        return;
+    }
+    pthread_mutex_lock(&g_endpoints.lock);
+    if (pick->generation != g_endpoints.generation) {
+        pthread_mutex_unlock(&g_endpoints.lock);
+        return;
+    }
+    struct endpoint *endpoint = &g_endpoints.groups[pick->group].endpoints[pick->index];
+    endpoint->in_flight--;
+    const uint64_t now = now_us();
+    if (sent && sink->connect_failed) {
+        const int shift = endpoint->failures < 5 ? endpoint->failures : 5;
+        const uint64_t pause = 1000000u << shift;
+        endpoint->failures++;
+        endpoint->down_until_us = now + (pause < ENDPOINT_DOWN_MAX_US ? pause : ENDPOINT_DOWN_MAX_US);
+        COZE_LOG("endpoint down: %s, retry after %llu ms\n", endpoint->base,
+                 (unsigned long long) ((endpoint->down_until_us - now) / 1000u));
+    } else if (sent) {
+        const bool failed = err != COZE_OK || sink->http_status >= 500;
+        const uint64_t end = sink->first_byte_us > pick->start_us ? sink->first_byte_us : now;
+        double sample = (double) (end - pick->start_us);
+        sample = failed && sample < ENDPOINT_ERROR_LATENCY_US ? ENDPOINT_ERROR_LATENCY_US : sample;
+        endpoint->latency_us = endpoint->latency_us > 0 ? endpoint->latency_us + (sample - endpoint->latency_us) * 0.2
+                                                        : sample;
+        endpoint->failures = 0;
+        endpoint->down_until_us = 0;
+    }
+    pthread_mutex_unlock(&g_endpoints.lock);
+}
+
+// 连不上或已熔断, 且组里还有本次请求没试过的端点时换过去: 把当前端点加入 exclude 并返回 true
+static bool endpoint_failover(const struct endpoint_pick *pick, const coze_transport_sink_t *sink, coze_error_t err,
+                              uint32_t *exclude) {
+    if (pick->group < 0 || (err != COZE_ERROR_CIRCUIT_OPEN && (err != COZE_ERROR_NETWORK || !sink->connect_failed))) {
+        return false;
+    }
+    pthread_mutex_lock(&g_endpoints.lock);
+    const int count = pick->generation == g_endpoints.generation ? g_endpoints.groups[pick->group].count : 0;
+    pthread_mutex_unlock(&g_endpoints.lock);
+    const uint32_t tried = *exclude | 1u << pick->index;
+    const bool left = count > 0 && tried != (1u << count) - 1;
+    if (left) {
+        *exclude = tried;
+    }
+    return left;
+}
+
+// api_base 对应的端点, 没有配置端点组时就是 api_base 本身; 返回个数
+static int endpoint_bases(const char *api_base, char bases[][API_BASE_KEY_SIZE]) {
+    char key[API_BASE_KEY_SIZE];
+    api_base_key(api_base, key);
+    int count = 0;
+    pthread_mutex_lock(&g_endpoints.lock);
+    for (int i = 0; i < g_endpoints.count && !count; i++) {
+        const struct endpoint_group *group = &g_endpoints.groups[i];
+        if (strcmp(group->base, key) == 0) {
+            for (; count < group->count; count++) {
+                strcpy(bases[count], group->endpoints[count].base);
+            }
+        }
+    }
+    pthread_mutex_unlock(&g_endpoints.lock);
+    if (!count) {
+        strcpy(bases[count++], key);
+    }
+    return count;
+}
+
+// *** endpoints ***
+
+// VCR 文件格式 (小端):
+//   文件头: "CZVCR" + 版本号 1
+//   记录:   u8 类型 | u32 交互 ID | u64 距交互开始的微秒数 | u32 长度 | 数据
+// 类型: Q 请求 (method\0path\0body), H 响应头行, B 响应体分片, E 结束 (u32 coze_error_t)
+#define VCR_MAGIC "CZVCR\x01"
+#define VCR_MAGIC_LEN 6
+#define VCR_RECORD_HEADER_LEN 17
+
+enum {
+    VCR_RECORD_REQUEST = 'Q',
+    VCR_RECORD_HEADER = 'H',
+    VCR_RECORD_BODY = 'B',
+    VCR_RECORD_END = 'E',
+};
+
+static struct {
+    pthread_mutex_t lock;
+    FILE *file;
+    uint32_t next_id;
+} g_vcr_recorder = {PTHREAD_MUTEX_INITIALIZER, NULL, 0};
+
+static void put_u32(unsigned char *p, uint32_t v) {
+    for (int i = 0; i < 4; i++) {
+        p[i] = (unsigned char) (v >> (8 * i));
+    }
+}
+
+static void put_u64(unsigned char *p, uint64_t v) {
+    for (int i = 0; i < 8; i++) {
+        p[i] = (unsigned char) (v >> (8 * i));
+    }
+}
+
+static uint32_t get_u32(const unsigned char *p) {
+    uint32_t v = 0;
+    for (int i = 0; i < 4; i++) {
+        v |= (uint32_t) p[i] << (8 * i);
+    }
+    return v;
+}
+
+static uint64_t get_u64(const unsigned char *p) {
+    uint64_t v = 0;
+    for (int i = 0; i < 8; i++) {
+        v |= (uint64_t) p[i] << (8 * i);
+    }
+    return v;
+}
+
+static void vcr_record_write(uint8_t type, uint32_t id, uint64_t offset_us, const void *data, uint32_t len) {
+    unsigned char header[VCR_RECORD_HEADER_LEN];
+    header[0] = type;
+    put_u32(header + 1, id);
+    put_u64(header + 5, offset_us);
+    put_u32(header + 13, len);
+
+    pthread_mutex_lock(&g_vcr_recorder.lock);
+    if (g_vcr_recorder.file) {
+        fwrite(header, 1, sizeof(header), g_vcr_recorder.file);
+        if (len > 0) {
+            fwrite(data, 1, len, g_vcr_recorder.file);
+        }
+    }
+    pthread_mutex_unlock(&g_vcr_recorder.lock);
+}
+
+static bool vcr_recording(void) {
+    pthread_mutex_lock(&g_vcr_recorder.lock);
+    const bool recording = g_vcr_recorder.file != NULL;
+    pthread_mutex_unlock(&g_vcr_recorder.lock);
+    return recording;
+}
+
+static void vcr_record_begin(const coze_transport_request_t *req, coze_transport_sink_t *sink) {
+    pthread_mutex_lock(&g_vcr_recorder.lock);
+    const uint32_t id = g_vcr_recorder.file ? ++g_vcr_recorder.next_id : 0;
+    pthread_mutex_unlock(&g_vcr_recorder.lock);
+    if (!id) {
+        return;
+    }
+    sink->vcr_id = id;
+    sink->vcr_start_us = now_us();
+
+    // api_token 不落盘
+    const size_t method_len = strlen(req->method) + 1;
+    const size_t path_len = strlen(req->path) + 1;
+    const size_t body_len = req->body ? strlen(req->body) : 0;
+    char *payload = coze_malloc(method_len + path_len + body_len);
+    if (!payload) {
+        return;
+    }
+    memcpy(payload, req->method, method_len);
+    memcpy(payload + method_len, req->path, path_len);
+    if (body_len > 0) {
+        memcpy(payload + method_len + path_len, req->body, body_len);
+    }
+    vcr_record_write(VCR_RECORD_REQUEST, id, 0, payload, (uint32_t) (method_len + path_len + body_len));
+    coze_free(payload);
+}
+
+static void vcr_record_chunk(const coze_transport_sink_t *sink, uint8_t type, const char *data, size_t len) {
+    if (!sink->vcr_id) {
+        return;
+    }
+    vcr_record_write(type, sink->vcr_id, now_us() - sink->vcr_start_us, data, (uint32_t) len);
+}
+
+static void vcr_record_end(const coze_transport_sink_t *sink, coze_error_t err) {
+    if (!sink->vcr_id) {
+        return;
+    }
+    unsigned char result[4];
+    put_u32(result, (uint32_t) err);
+    vcr_record_write(VCR_RECORD_END, sink->vcr_id, now_us() - sink->vcr_start_us, result, sizeof(result));
+}
+
+size_t coze_transport_sink_header(coze_transport_sink_t *sink, const char *line, size_t len) {
+    if (!sink) {
+        return 0;
+    }
+    vcr_record_chunk(sink, VCR_RECORD_HEADER, line, len);
+    if (len > 5 && strncmp(line, "HTTP/", 5) == 0) {
+        // 1xx 和重定向也有状态行, 以最后一个为准
+        const char *space = memchr(line, ' ', len);
+        sink->http_status = space ? atoi(space + 1) : 0;
+        sink->retry_after_us = 0;
+    } else if (len > 12 && strncasecmp(line, "retry-after:", 12) == 0) {
+        uint64_t seconds = 0;
+        size_t i = 12;
+        while (i < len && line[i] == ' ') {
+            i++;
+        }
+        for (; i < len && line[i] >= '0' && line[i] <= '9' && seconds < 86400; i++) {
+            seconds = seconds * 10 + (uint64_t) (line[i] - '0');
+        }
+        sink->retry_after_us = seconds * 1000000u;
+    } else if (len > 17 && strncasecmp(line, "content-encoding:", 17) == 0) {
+        sink->compressed = true;
+    }
+    if (sink->reserve_body && len > 15 && strncasecmp(line, "content-length:", 15) == 0) {
+        size_t content_length = 0;
+        size_t i = 15;
+        while (i < len && line[i] == ' ') {
+            i++;
+        }
+        for (; i < len && line[i] >= '0' && line[i] <= '9' && content_length < BODY_RESERVE_MAX; i++) {
+            content_length = content_length * 10 + (size_t) (line[i] - '0');
+        }
+        sink->reserve_body(sink->body_userp, content_length);
+    }
+    return header_callback((char *) line, 1, len, sink->coze_response);
+}
+
+size_t coze_transport_sink_body(coze_transport_sink_t *sink, const char *data, size_t len) {
+    if (!sink) {
+        return 0;
+    }
+    vcr_record_chunk(sink, VCR_RECORD_BODY, data, len);
+    if (!sink->body_started) {
+        // 响应头已经收齐, 决定这次响应是交给解码器还是丢弃后重试
+        sink->body_started = true;
+        sink->first_byte_us = now_us();
+        sink->discard_body = sink->retry && retry_status_wanted(sink->retry, sink);
+    }
+    if (sink->discard_body) {
+        return len;
+    }
+    sink->body_bytes += len;
+    return sink->write_body((void *) data, 1, len, sink->body_userp);
+}
+
+void coze_transport_sink_connect_failed(coze_transport_sink_t *sink) {
+    if (sink) {
+        sink->connect_failed = true;
+    }
+}
+
+void coze_set_transport(coze_transport_fn transport, void *ctx) {
+    g_transport.fn = transport;
+    g_transport.ctx = ctx;
+}
+
+static size_t transport_curl_header_callback(char *buffer, size_t size, size_t nitems, void *userdata) {
+    return coze_transport_sink_header(userdata, buffer, size * nitems);
+}
+
+static size_t transport_curl_write_callback(char *contents, size_t size, size_t nmemb, void *userp) {
+    return coze_transport_sink_body(userp, contents, size * nmemb);
+}
+
+// *** connection pool ***
+
+#define CONN_POOL_MAX_IDLE 64 // 所有源站合计保留的空闲句柄数, 满了关闭最久没用的
+#define CONN_POOL_MAX_WARM 16 // 预热目标数上限
+#define CONN_WARM_TIMEOUT_MS 10000L // client 没有设置 timeout_ms 时, 预热和保活请求的时限
+#define CONN_KEEPER_INTERVAL_US 1000000u
+#define CONN_KEEPALIVE_US 20000000u // 空闲这么久的预热连接发一次 HEAD, 赶在服务端常见的 60 秒空闲超时之前
+#define CONN_WARM_RETRY_US 5000000u // 预热失败后隔这么久再补
+
+// curl 的连接缓存在 multi 句柄里 (curl_easy_perform 用的是 easy 句柄内部的 multi, 别的 multi 看不到), 所以池中
+// 每个连接配一个自己的 multi, 请求时把 easy 句柄加进去执行, 结束后连同长连接放回池中, 同一源站
+// (scheme://host:port) 的下一个请求直接复用; 对冲的请求加进同一个 multi, 和第一个请求共用缓存的连接。
+// DNS 缓存和 TLS 会话通过 share 句柄在所有句柄间共享, 新建的连接也省去解析和完整握手。
+// 连接缓存本身不放进 share, libcurl 不支持多个线程并发使用共享的连接
+struct pooled_conn {
+    CURL *curl;
+    CURLM *multi;
+};
+
+struct idle_handle {
+    struct pooled_conn conn;
+    char origin[API_BASE_KEY_SIZE];
+    uint64_t idle_since_us;
+};
+
+// coze_client_warmup 登记的目标, keeper 线程保持源站至少有 connections 个连接
+struct warm_target {
+    const coze_client_t *owner;
+    char base[API_BASE_KEY_SIZE];
+    char origin[API_BASE_KEY_SIZE];
+    int connections;
+    int in_use; // 借出还没放回的句柄
+    int opening; // 正在新建的连接
+    long timeout_ms;
+    uint64_t next_open_us; // 上次一个都没连上, 到这个时间前不再补
+};
+
+static struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond; // 目标变化时唤醒 keeper
+    CURLSH *share;
+    pthread_mutex_t share_locks[CURL_LOCK_DATA_LAST];
+    struct idle_handle idle[CONN_POOL_MAX_IDLE]; // 按放回的先后排列
+    int idle_count;
+    struct warm_target warm[CONN_POOL_MAX_WARM];
+    int warm_count;
+    bool keeper_running;
+} g_conn_pool = {.lock = PTHREAD_MUTEX_INITIALIZER, .cond = PTHREAD_COND_INITIALIZER};
+
+static pthread_once_t g_conn_pool_once = PTHREAD_ONCE_INIT;
+
+static void conn_share_lock(CURL *curl, curl_lock_data data, curl_lock_access access, void *userptr) {
+    (void) curl;
+    (void) access;
+    (void) userptr;
+    pthread_mutex_lock(&g_conn_pool.share_locks[data]);
+}
+
+static void conn_share_unlock(CURL *curl, curl_lock_data data, void *userptr) {
+    (void) curl;
+    (void) userptr;
+    pthread_mutex_unlock(&g_conn_pool.share_locks[data]);
+}
 
-void coze_free_conversation(coze_conversation_t *conversation);
+static void conn_pool_init(void) {
+    for (int i = 0; i < CURL_LOCK_DATA_LAST; i++) {
+        pthread_mutex_init(&g_conn_pool.share_locks[i], NULL);
+    }
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+}
 
-void coze_free_message(coze_message_t *message);
+// 让句柄使用 share, share 在释放连接池后按需重建。在池锁内设置, 释放时 curl_share_cleanup 才能可靠地看到
+// 还有句柄在用
+static void conn_pool_attach(CURL *curl) {
+    pthread_once(&g_conn_pool_once, conn_pool_init);
+    pthread_mutex_lock(&g_conn_pool.lock);
+    if (!g_conn_pool.share && (g_conn_pool.share = curl_share_init())) {
+        curl_share_setopt(g_conn_pool.share, CURLSHOPT_LOCKFUNC, conn_share_lock);
+        curl_share_setopt(g_conn_pool.share, CURLSHOPT_UNLOCKFUNC, conn_share_unlock);
+        curl_share_setopt(g_conn_pool.share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+        curl_share_setopt(g_conn_pool.share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    }
+    curl_easy_setopt(curl, CURLOPT_SHARE, g_conn_pool.share);
+    pthread_mutex_unlock(&g_conn_pool.lock);
+}
 
-void coze_free_chat(coze_chat_t *chat);
+// URL 的 scheme://host[:port] 部分, 连接按它复用
+static void url_origin(const char *url, char *origin) {
+    const char *host = strstr(url, "://");
+    host = host ? host + 3 : url;
+    size_t len = (size_t) (host - url) + strcspn(host, "/?#");
+    len = len < API_BASE_KEY_SIZE ? len : API_BASE_KEY_SIZE - 1;
+    memcpy(origin, url, len);
+    origin[len] = '\0';
+}
 
-void coze_free_file(coze_file_t *file);
+// 调用时持有 g_conn_pool.lock
+static int conn_pool_idle_locked(const char *origin) {
+    int count = 0;
+    for (int i = 0; i < g_conn_pool.idle_count; i++) {
+        count += strcmp(g_conn_pool.idle[i].origin, origin) == 0;
+    }
+    return count;
+}
 
-void coze_free_voice(coze_voice_t *voice);
+// 借出或放回一个句柄时更新同源站预热目标的 in_use; 调用时持有 g_conn_pool.lock
+static void conn_pool_count_in_use(const char *origin, int delta) {
+    for (int i = 0; i < g_conn_pool.warm_count; i++) {
+        struct warm_target *target = &g_conn_pool.warm[i];
+        if (strcmp(target->origin, origin) == 0 && target->in_use + delta >= 0) {
+            target->in_use += delta;
+        }
+    }
+}
 
-void coze_free_oauth_token(coze_oauth_token_t *token);
+static bool conn_open(struct pooled_conn *conn) {
+    conn->curl = curl_easy_init();
+    conn->multi = curl_multi_init();
+    return conn->curl && conn->multi;
+}
 
-void coze_free_response_header(coze_response_t *coze_response) {
-    if (!coze_response) {
-        return;
+// 关闭 multi 中缓存的连接; easy 句柄此时不在 multi 里
+static void conn_close(const struct pooled_conn *conn) {
+    if (conn->multi) {
+        curl_multi_cleanup(conn->multi);
     }
-    free((void *) coze_response->logid);
-    coze_response->logid = NULL;
+    curl_easy_cleanup(conn->curl);
 }
 
-void pure_log(const char *title, const char *data) {
-    char *escaped = malloc(strlen(data) * 2 + 1);
-    char *p = escaped;
-    for (const char *s = data; *s; s++) {
-        if (*s == '\n') {
-            *p++ = '\\';
-            *p++ = 'n';
-        } else if (*s == '\r') {
-            *p++ = '\\';
-            *p++ = 'r';
-        } else if (*s == '\t') {
-            *p++ = '\\';
-            *p++ = 't';
-        } else if (*s == '"') {
-            *p++ = '\\';
-            *p++ = '"';
-        } else {
-            *p++ = *s;
+// 在连接自己的 multi 里执行 easy 句柄, 等同于 curl_easy_perform
+static CURLcode conn_perform(const struct pooled_conn *conn) {
+    if (curl_multi_add_handle(conn->multi, conn->curl) != CURLM_OK) {
+        return CURLE_FAILED_INIT;
+    }
+    CURLcode res = CURLE_FAILED_INIT;
+    for (int running = 1; running;) {
+        if (curl_multi_perform(conn->multi, &running) != CURLM_OK) {
+            break;
+        }
+        CURLMsg *msg;
+        int queued;
+        while ((msg = curl_multi_info_read(conn->multi, &queued))) {
+            if (msg->msg == CURLMSG_DONE && msg->easy_handle == conn->curl) {
+                res = msg->data.result;
+            }
+        }
+        if (running) {
+            curl_multi_poll(conn->multi, NULL, 0, 1000, NULL); // 实际等待不超过 curl 自己的超时
         }
     }
-    *p = '\0';
-    printf("%s: %s\n", title, escaped);
-    free(escaped);
+    curl_multi_remove_handle(conn->multi, conn->curl);
+    return res;
 }
 
-struct MemoryStruct {
-    char *memory;
-    size_t size;
-};
+static void conn_pool_store(const struct pooled_conn *conn, const char *origin) {
+    struct pooled_conn evicted = {0};
+    pthread_mutex_lock(&g_conn_pool.lock);
+    if (g_conn_pool.idle_count == CONN_POOL_MAX_IDLE) {
+        evicted = g_conn_pool.idle[0].conn;
+        memmove(&g_conn_pool.idle[0], &g_conn_pool.idle[1], (CONN_POOL_MAX_IDLE - 1) * sizeof(struct idle_handle));
+        g_conn_pool.idle_count--;
+    }
+    struct idle_handle *idle = &g_conn_pool.idle[g_conn_pool.idle_count++];
+    idle->conn = *conn;
+    strcpy(idle->origin, origin);
+    idle->idle_since_us = now_us();
+    pthread_mutex_unlock(&g_conn_pool.lock);
+    conn_close(&evicted);
+}
 
-static size_t WriteMemoryCallback(void *contents, size_t size, size_t nmemb, void *userp) {
-    size_t realsize = size * nmemb;
-    struct MemoryStruct *mem = (struct MemoryStruct *) userp;
+// 正常结束的连接放回池中, 否则连接状态不确定, 直接关闭
+static void conn_pool_put(const struct pooled_conn *conn, const char *url, bool reusable) {
+    char origin[API_BASE_KEY_SIZE];
+    url_origin(url, origin);
+    pthread_mutex_lock(&g_conn_pool.lock);
+    conn_pool_count_in_use(origin, -1);
+    pthread_mutex_unlock(&g_conn_pool.lock);
+    if (reusable) {
+        conn_pool_store(conn, origin);
+    } else {
+        conn_close(conn);
+    }
+}
 
-    char *ptr = realloc(mem->memory, mem->size + realsize + 1);
-    if (!ptr) {
-        return 0;
+// 取一个连着 url 源站的空闲连接, 没有时新建; 用完交给 conn_pool_put
+static bool conn_pool_take(const char *url, struct pooled_conn *conn) {
+    pthread_once(&g_conn_pool_once, conn_pool_init); // curl_global_init 要早于第一个 curl_easy_init
+    char origin[API_BASE_KEY_SIZE];
+    url_origin(url, origin);
+    bool found = false;
+    pthread_mutex_lock(&g_conn_pool.lock);
+    // 从最近放回的找, 它的连接最可能还活着
+    for (int i = g_conn_pool.idle_count - 1; i >= 0 && !found; i--) {
+        if (strcmp(g_conn_pool.idle[i].origin, origin) == 0) {
+            *conn = g_conn_pool.idle[i].conn;
+            memmove(&g_conn_pool.idle[i], &g_conn_pool.idle[i + 1],
+                    (size_t) (g_conn_pool.idle_count - i - 1) * sizeof(struct idle_handle));
+            g_conn_pool.idle_count--;
+            found = true;
+        }
+    }
+    conn_pool_count_in_use(origin, 1);
+    pthread_mutex_unlock(&g_conn_pool.lock);
+    if (found) {
+        curl_easy_reset(conn->curl); // 保留连接、DNS 缓存和 TLS 会话, 清掉上个请求的选项
+        return true;
     }
+    if (conn_open(conn)) {
+        return true;
+    }
+    conn_pool_put(conn, url, false);
+    return false;
+}
 
-    mem->memory = ptr;
-    memcpy(&(mem->memory[mem->size]), contents, realsize);
-    mem->size += realsize;
-    mem->memory[mem->size] = 0;
+static void transfer_stats_connects(CURL *curl) {
+    long connects = 0;
+    curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &connects);
+    __atomic_fetch_add(&g_transfer_stats.new_connections, (size_t) connects, __ATOMIC_RELAXED);
+}
 
-    return realsize;
+// 对 base 发一个 HEAD, 建立或保活连接; 响应状态无所谓, 只要连接留下
+static bool conn_ping(const struct pooled_conn *conn, const char *base, long timeout_ms) {
+    curl_easy_reset(conn->curl);
+    curl_easy_setopt(conn->curl, CURLOPT_URL, base);
+    curl_easy_setopt(conn->curl, CURLOPT_NOBODY, 1L);
+    conn_pool_attach(conn->curl);
+    curl_easy_setopt(conn->curl, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(conn->curl, CURLOPT_TIMEOUT_MS, timeout_ms);
+    return conn_perform(conn) == CURLE_OK;
 }
 
-// 回调函数，用于处理响应头数据
-static size_t header_callback(char *buffer, size_t size, size_t nitems, void *userdata) {
-    size_t total_size = size * nitems;
-    coze_response_t *coze_response = (coze_response_t *) userdata;
+struct conn_warm_job {
+    struct pooled_conn conn;
+    const char *base;
+    long timeout_ms;
+    bool ok;
+};
 
-    // 将响应头行转换为字符串便于处理
-    char header_line[1024] = {0};
-    strncpy(header_line, buffer, total_size < sizeof(header_line) ? total_size : sizeof(header_line) - 1);
+static void *conn_warm_main(void *arg) {
+    struct conn_warm_job *job = arg;
+    job->ok = conn_ping(&job->conn, job->base, job->timeout_ms);
+    return NULL;
+}
 
-    // 查找 x-tt-logid header
-    if (strncasecmp(header_line, "x-tt-logid:", 11) == 0) {
-        char *logid_start = header_line + 11;
-        // 跳过空格
-        while (*logid_start == ' ') {
-            logid_start++;
+// 新建 count 个到 base 的连接放进池中, 返回成功的个数。每个连接在自己的 multi 里握手, 各用一个线程并发
+static int conn_pool_open(const char *base, int count, long timeout_ms) {
+    pthread_once(&g_conn_pool_once, conn_pool_init);
+    struct conn_warm_job jobs[CONN_POOL_MAX_IDLE];
+    pthread_t threads[CONN_POOL_MAX_IDLE];
+    bool started[CONN_POOL_MAX_IDLE];
+    count = count < CONN_POOL_MAX_IDLE ? count : CONN_POOL_MAX_IDLE;
+    for (int i = 0; i < count; i++) {
+        jobs[i] = (struct conn_warm_job){.base = base, .timeout_ms = timeout_ms};
+        started[i] = conn_open(&jobs[i].conn) && pthread_create(&threads[i], NULL, conn_warm_main, &jobs[i]) == 0;
+    }
+    char origin[API_BASE_KEY_SIZE];
+    url_origin(base, origin);
+    int opened = 0;
+    for (int i = 0; i < count; i++) {
+        if (started[i]) {
+            pthread_join(threads[i], NULL);
         }
-        // 移除末尾的换行符和回车符
-        char *logid_end = logid_start;
-        while (*logid_end && *logid_end != '\r' && *logid_end != '\n') {
-            logid_end++;
+        if (started[i] && jobs[i].ok) {
+            conn_pool_store(&jobs[i].conn, origin);
+            opened++;
+        } else {
+            conn_close(&jobs[i].conn);
         }
-        *logid_end = '\0';
+    }
+    return opened;
+}
 
-        // 保存 logid 到 header 结构体
-        if (coze_response) {
-            coze_response->logid = strdup(logid_start);
+// 调用时持有 g_conn_pool.lock
+static struct warm_target *conn_warm_target_locked(const coze_client_t *owner, const char *base) {
+    for (int i = 0; i < g_conn_pool.warm_count; i++) {
+        if (g_conn_pool.warm[i].owner == owner && strcmp(g_conn_pool.warm[i].base, base) == 0) {
+            return &g_conn_pool.warm[i];
         }
     }
+    return NULL;
+}
 
-    return total_size;
+// 补足一个目标的连接数, 空闲太久的先 HEAD 保活; 调用时持有 g_conn_pool.lock, 网络操作期间释放
+static void conn_keep_target_locked(int index) {
+    const struct warm_target target = g_conn_pool.warm[index];
+    const uint64_t now = now_us();
+    struct pooled_conn stale[CONN_POOL_MAX_IDLE];
+    int stale_count = 0;
+    for (int i = 0; i < g_conn_pool.idle_count;) {
+        const struct idle_handle *idle = &g_conn_pool.idle[i];
+        if (strcmp(idle->origin, target.origin) == 0 && now - idle->idle_since_us >= CONN_KEEPALIVE_US) {
+            stale[stale_count++] = idle->conn;
+            memmove(&g_conn_pool.idle[i], &g_conn_pool.idle[i + 1],
+                    (size_t) (g_conn_pool.idle_count - i - 1) * sizeof(struct idle_handle));
+            g_conn_pool.idle_count--;
+        } else {
+            i++;
+        }
+    }
+    int missing = target.connections - conn_pool_idle_locked(target.origin) - stale_count - target.in_use -
+                  target.opening;
+    missing = now < target.next_open_us ? 0 : missing;
+    if (!stale_count && missing <= 0) {
+        return;
+    }
+    g_conn_pool.warm[index].opening += missing > 0 ? missing : 0;
+    pthread_mutex_unlock(&g_conn_pool.lock);
+    for (int i = 0; i < stale_count; i++) {
+        if (conn_ping(&stale[i], target.base, target.timeout_ms)) {
+            conn_pool_store(&stale[i], target.origin);
+        } else {
+            conn_close(&stale[i]);
+        }
+    }
+    const int opened = missing > 0 ? conn_pool_open(target.base, missing, target.timeout_ms) : 0;
+    pthread_mutex_lock(&g_conn_pool.lock);
+    struct warm_target *current = conn_warm_target_locked(target.owner, target.base);
+    if (current && missing > 0) {
+        current->opening -= current->opening >= missing ? missing : current->opening;
+        current->next_open_us = opened ? 0 : now_us() + CONN_WARM_RETRY_US;
+    }
 }
 
-static char *build_url(const char *api_base, const char *path) {
-    const char *base_url;
-    if (api_base && strlen(api_base) > 0) {
-        if (api_base[strlen(api_base) - 1] == '/') {
-            base_url = strdup(api_base);
+// 后台保持预热目标的连接: 补上被服务端关闭或借走的, 保活空闲太久的。没有目标时退出
+static void *conn_keeper_main(void *arg) {
+    (void) arg;
+    pthread_mutex_lock(&g_conn_pool.lock);
+    while (g_conn_pool.warm_count > 0) {
+        const uint64_t until = now_us() + CONN_KEEPER_INTERVAL_US;
+        const struct timespec ts = {.tv_sec = (time_t) (until / 1000000u),
+                                    .tv_nsec = (long) (until % 1000000u) * 1000L};
+        pthread_cond_timedwait(&g_conn_pool.cond, &g_conn_pool.lock, &ts);
+        for (int i = 0; i < g_conn_pool.warm_count; i++) {
+            conn_keep_target_locked(i);
+        }
+    }
+    g_conn_pool.keeper_running = false;
+    pthread_mutex_unlock(&g_conn_pool.lock);
+    return NULL;
+}
+
+// 没有 client 也没有预热目标时关闭所有空闲连接; 没有句柄还在用 share 时一并释放, 之后的请求重新创建。
+// 借出的句柄放回时照常进池
+static void conn_pool_release(void) {
+    struct pooled_conn idle[CONN_POOL_MAX_IDLE];
+    pthread_mutex_lock(&g_conn_pool.lock);
+    const int count = g_conn_pool.idle_count;
+    for (int i = 0; i < count; i++) {
+        idle[i] = g_conn_pool.idle[i].conn;
+    }
+    g_conn_pool.idle_count = 0;
+    pthread_mutex_unlock(&g_conn_pool.lock);
+    for (int i = 0; i < count; i++) {
+        conn_close(&idle[i]);
+    }
+    pthread_mutex_lock(&g_conn_pool.lock);
+    if (g_conn_pool.share && g_conn_pool.idle_count == 0 && curl_share_cleanup(g_conn_pool.share) == CURLSHE_OK) {
+        g_conn_pool.share = NULL;
+    }
+    pthread_mutex_unlock(&g_conn_pool.lock);
+}
+
+coze_error_t coze_client_warmup(coze_client_t *client, int connections) {
+    if (!client || connections < 0 || connections > CONN_POOL_MAX_IDLE) {
+        return COZE_ERROR_INVALID_PARAM;
+    }
+    char bases[ENDPOINT_MAX_PER_GROUP][API_BASE_KEY_SIZE];
+    const int count = endpoint_bases(client->api_base, bases);
+    const long timeout_ms = client->timeout_ms > 0 ? client->timeout_ms : CONN_WARM_TIMEOUT_MS;
+    int missing[ENDPOINT_MAX_PER_GROUP] = {0};
+
+    pthread_mutex_lock(&g_conn_pool.lock);
+    for (int i = 0; i < g_conn_pool.warm_count;) {
+        if (g_conn_pool.warm[i].owner == client) {
+            g_conn_pool.warm[i] = g_conn_pool.warm[--g_conn_pool.warm_count];
         } else {
-            base_url = strdup(api_base);
+            i++;
         }
-    } else {
-        base_url = "https://api.coze.cn";
+    }
+    for (int i = 0; i < count && connections > 0 && g_conn_pool.warm_count < CONN_POOL_MAX_WARM; i++) {
+        struct warm_target *target = &g_conn_pool.warm[g_conn_pool.warm_count++];
+        *target = (struct warm_target){.owner = client, .connections = connections, .timeout_ms = timeout_ms};
+        strcpy(target->base, bases[i]);
+        url_origin(bases[i], target->origin);
+        missing[i] = connections - conn_pool_idle_locked(target->origin);
+        target->opening = missing[i] > 0 ? missing[i] : 0;
+    }
+    const bool start_keeper = g_conn_pool.warm_count > 0 && !g_conn_pool.keeper_running;
+    const bool release = g_conn_pool.warm_count == 0 && __atomic_load_n(&g_clients, __ATOMIC_RELAXED) == 0;
+    g_conn_pool.keeper_running = g_conn_pool.keeper_running || start_keeper;
+    pthread_cond_broadcast(&g_conn_pool.cond);
+    pthread_mutex_unlock(&g_conn_pool.lock);
+    if (connections == 0) {
+        if (release) {
+            conn_pool_release();
+        }
+        return COZE_OK;
     }
 
-    char *url = strdup(base_url);
-    if (url[strlen(url) - 1] == '/') {
-        url[strlen(url) - 1] = '\0';
+    if (start_keeper) {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, conn_keeper_main, NULL) == 0) {
+            pthread_detach(thread);
+        } else {
+            pthread_mutex_lock(&g_conn_pool.lock);
+            g_conn_pool.keeper_running = false;
+            pthread_mutex_unlock(&g_conn_pool.lock);
+        }
     }
-    url = strcat(url, path);
-    return url;
+    // 同步建好连接, 之后交给 keeper 维持
+    coze_error_t err = COZE_OK;
+    for (int i = 0; i < count; i++) {
+        const int opened = missing[i] > 0 ? conn_pool_open(bases[i], missing[i], timeout_ms) : 0;
+        COZE_LOG("warmup: %s, %d/%d new connections\n", bases[i], opened, missing[i] > 0 ? missing[i] : 0);
+        pthread_mutex_lock(&g_conn_pool.lock);
+        struct warm_target *target = conn_warm_target_locked(client, bases[i]);
+        if (target) {
+            target->opening = 0;
+            target->next_open_us = opened || missing[i] <= 0 ? 0 : now_us() + CONN_WARM_RETRY_US;
+        }
+        pthread_mutex_unlock(&g_conn_pool.lock);
+        err = missing[i] > 0 && !opened ? COZE_ERROR_NETWORK : err;
+    }
+    return err;
 }
 
-// 通用的 HTTP 请求函数
-static coze_error_t make_http_request(
-    const char *api_base, const char *api_token,
-    const char *path, const char *method, const char *json_body,
-    struct MemoryStruct *chunk, coze_response_t *coze_response) {
-    CURL *curl = curl_easy_init();
-    if (!curl) return COZE_ERROR_NETWORK;
+// *** connection pool ***
 
+static struct curl_slist *curl_request_headers(const coze_transport_request_t *req) {
     struct curl_slist *headers = NULL;
-    if (api_token) {
+    if (req->api_token) {
         char auth_header[256];
-        snprintf(auth_header, sizeof(auth_header), "Authorization: Bearer %s", api_token);
+        snprintf(auth_header, sizeof(auth_header), "Authorization: Bearer %s", req->api_token);
         headers = curl_slist_append(headers, auth_header);
     }
-    if (json_body) {
+    if (req->stream) {
+        headers = curl_slist_append(headers, "Accept: text/event-stream");
+        headers = curl_slist_append(headers, "Cache-Control: no-cache");
+    }
+    if (req->body) {
         headers = curl_slist_append(headers, "Content-Type: application/json");
     }
-    char *url = build_url(api_base, path);
+    return headers;
+}
 
+// 设置 CURL 选项, 响应头和响应体交给 header_fn/write_fn
+static void curl_request_setup(CURL *curl, const coze_transport_request_t *req, struct curl_slist *headers,
+                               curl_write_callback header_fn, curl_write_callback write_fn, void *userdata) {
     // curl_easy_setopt(curl, CURLOPT_VERBOSE, 1L);
 
-    // 设置 CURL 选项
-    curl_easy_setopt(curl, CURLOPT_URL, url);
+    curl_easy_setopt(curl, CURLOPT_URL, req->url);
     curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteMemoryCallback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void*)chunk);
-    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, header_callback);
-    curl_easy_setopt(curl, CURLOPT_HEADERDATA, coze_response);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_fn);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, userdata);
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, header_fn);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, userdata);
+    conn_pool_attach(curl);
+    if (req->stream) {
+        curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_1_1);
+        curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+    } else if (g_response_compression) {
+        // "" 表示 curl 支持的全部编码 (gzip/deflate, 以及编译进来的 br/zstd); 写回调收到的已是解压后的数据
+        curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "");
+    }
+    // 流式请求同样受调用时限约束, 未设置时不限
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, req->timeout_ms > 0 ? (long) req->timeout_ms : 0L);
 
     // 如果是 POST 请求
-    if (strcmp(method, "POST") == 0) {
+    if (strcmp(req->method, "POST") == 0) {
         curl_easy_setopt(curl, CURLOPT_POST, 1L);
-        if (json_body) {
-            curl_easy_setopt(curl, CURLOPT_POSTFIELDS, json_body);
+        if (req->body) {
+            curl_easy_setopt(curl, CURLOPT_POSTFIELDS, req->body);
         }
     }
+}
+
+// 解析、连接或 TLS 握手失败, 请求还没有发出
+static bool curl_connect_failed(CURLcode res) {
+    return res == CURLE_COULDNT_RESOLVE_HOST || res == CURLE_COULDNT_RESOLVE_PROXY || res == CURLE_COULDNT_CONNECT ||
+           res == CURLE_SSL_CONNECT_ERROR;
+}
 
-    printf("[coze_api] start: %s %s\n", method, url);
-    if (json_body && strcmp(method, "POST") == 0) {
-        printf("[coze_api] body: %s\n", json_body);
+// 设置了调用时限时, curl 的超时就是时限到了
+static coze_error_t curl_result_error(const coze_transport_request_t *req, CURLcode res) {
+    if (res == CURLE_OK) {
+        return COZE_OK;
     }
+    return res == CURLE_OPERATION_TIMEDOUT && req->timeout_ms > 0 ? COZE_ERROR_DEADLINE_EXCEEDED : COZE_ERROR_NETWORK;
+}
 
-    // 执行请求
-    CURLcode res = curl_easy_perform(curl);
+// 默认 transport: 基于 curl 的同步请求
 
-    if (res != CURLE_OK) {
-        free(chunk->memory);
-        curl_slist_free_all(headers);
-        curl_easy_cleanup(curl);
+static coze_error_t curl_transport(const coze_transport_request_t *req, coze_transport_sink_t *sink) {
+    struct pooled_conn conn;
+    if (!conn_pool_take(req->url, &conn)) {
         return COZE_ERROR_NETWORK;
     }
 
-    printf("[coze_api] response: %s, %s\n", coze_response->logid, chunk->memory);
+    struct curl_slist *headers = curl_request_headers(req);
+    curl_request_setup(conn.curl, req, headers, transport_curl_header_callback, transport_curl_write_callback, sink);
+    curl_mime *mime = NULL;
+    if (req->upload_file) {
+        mime = curl_mime_init(conn.curl);
+        curl_mimepart *part = curl_mime_addpart(mime);
+        curl_mime_name(part, "file");
+        curl_mime_filedata(part, req->upload_file);
+        curl_easy_setopt(conn.curl, CURLOPT_MIMEPOST, mime);
+    }
+
+    // 执行请求
+    const CURLcode res = conn_perform(&conn);
+
+    curl_off_t wire_bytes = 0; // 网络上收到的响应体字节数, 压缩时为解压前
+    curl_easy_getinfo(conn.curl, CURLINFO_SIZE_DOWNLOAD_T, &wire_bytes);
+    transfer_stats_add(sink, (size_t) wire_bytes);
+    transfer_stats_connects(conn.curl);
 
     curl_slist_free_all(headers);
-    curl_easy_cleanup(curl);
-    return COZE_OK;
+    curl_mime_free(mime);
+    conn_pool_put(&conn, req->url, res == CURLE_OK);
+
+    sink->connect_failed = curl_connect_failed(res);
+    return curl_result_error(req, res);
 }
 
-// data: id: xx\ndata: xx\n
-typedef void (*sse_event_callback_t)(const char *data, void *biz_ctx);
+// *** hedging ***
+
+#define HEDGE_MAX_PATHS 32
+#define HEDGE_SAMPLES 128 // 每个接口保留的最近延迟样本数
+#define HEDGE_MIN_SAMPLES 16 // 样本少于这个数时使用 initial_delay_ms
+#define HEDGE_BUDGET_BURST 10.0 // 对冲预算最多攒下的次数
+
+static struct {
+    pthread_mutex_t lock;
+    coze_hedging_policy_t policy;
+    double budget; // 每个读请求增加 max_hedge_percent / 100, 每次对冲消耗 1
+    int count;
+    struct {
+        char path[128];
+        uint32_t samples_us[HEDGE_SAMPLES];
+        uint32_t sample_count; // 累计写入的样本数, 环形覆盖
+    } paths[HEDGE_MAX_PATHS];
+} g_hedge = {.lock = PTHREAD_MUTEX_INITIALIZER};
+
+void coze_set_hedging_policy(const coze_hedging_policy_t *policy) {
+    pthread_mutex_lock(&g_hedge.lock);
+    g_hedge.policy = policy ? *policy : (coze_hedging_policy_t){0};
+    g_hedge.budget = 0;
+    g_hedge.count = 0;
+    pthread_mutex_unlock(&g_hedge.lock);
+}
 
-// SSE 数据处理回调
-struct SSEContext {
-    char *buffer; // 用于存储未完整的 SSE 消息
-    size_t buffer_size;
-    size_t buffer_used;
-    sse_event_callback_t sse_event_callback;
-    void *biz_ctx;
+// 需持有 g_hedge.lock; 表满时返回 -1, 该接口不记录样本
+static int hedge_path_index(const char *path) {
+    const size_t len = strcspn(path, "?");
+    for (int i = 0; i < g_hedge.count; i++) {
+        if (strlen(g_hedge.paths[i].path) == len && strncmp(g_hedge.paths[i].path, path, len) == 0) {
+            return i;
+        }
+    }
+    if (g_hedge.count == HEDGE_MAX_PATHS || len >= sizeof(g_hedge.paths[0].path)) {
+        return -1;
+    }
+    const int index = g_hedge.count++;
+    memcpy(g_hedge.paths[index].path, path, len);
+    g_hedge.paths[index].path[len] = '\0';
+    g_hedge.paths[index].sample_count = 0;
+    return index;
+}
+
+static int compare_u32(const void *a, const void *b) {
+    const uint32_t x = *(const uint32_t *) a;
+    const uint32_t y = *(const uint32_t *) b;
+    return (x > y) - (x < y);
+}
+
+// 发起对冲前等待的微秒数: 该接口最近延迟的 percentile 分位数; 同时为本次请求累积预算
+static uint64_t hedge_delay_us(const char *path) {
+    uint32_t samples[HEDGE_SAMPLES];
+    uint32_t count = 0;
+    pthread_mutex_lock(&g_hedge.lock);
+    const coze_hedging_policy_t policy = g_hedge.policy;
+    g_hedge.budget += policy.max_hedge_percent / 100.0;
+    if (g_hedge.budget > HEDGE_BUDGET_BURST) {
+        g_hedge.budget = HEDGE_BUDGET_BURST;
+    }
+    const int index = hedge_path_index(path);
+    if (index >= 0) {
+        count = g_hedge.paths[index].sample_count < HEDGE_SAMPLES ? g_hedge.paths[index].sample_count : HEDGE_SAMPLES;
+        memcpy(samples, g_hedge.paths[index].samples_us, count * sizeof(uint32_t));
+    }
+    pthread_mutex_unlock(&g_hedge.lock);
+
+    uint64_t delay = (uint64_t) policy.initial_delay_ms * 1000u;
+    if (count >= HEDGE_MIN_SAMPLES) {
+        qsort(samples, count, sizeof(uint32_t), compare_u32);
+        const double rank = policy.percentile / 100.0 * (count - 1);
+        delay = samples[rank <= 0 ? 0 : rank >= count - 1 ? count - 1 : (uint32_t) rank];
+    }
+    const uint64_t min_delay = (uint64_t) policy.min_delay_ms * 1000u;
+    return delay < min_delay ? min_delay : delay;
+}
+
+// 预算不足时不对冲, 保证对冲请求不超过读请求的 max_hedge_percent
+static bool hedge_take_budget(void) {
+    pthread_mutex_lock(&g_hedge.lock);
+    const bool allowed = g_hedge.budget >= 1.0;
+    if (allowed) {
+        g_hedge.budget -= 1.0;
+    }
+    pthread_mutex_unlock(&g_hedge.lock);
+    return allowed;
+}
+
+static void hedge_record_latency(const char *path, uint64_t latency_us) {
+    pthread_mutex_lock(&g_hedge.lock);
+    const int index = hedge_path_index(path);
+    if (index >= 0) {
+        g_hedge.paths[index].samples_us[g_hedge.paths[index].sample_count++ % HEDGE_SAMPLES] =
+                (uint32_t) (latency_us < UINT32_MAX ? latency_us : UINT32_MAX);
+    }
+    pthread_mutex_unlock(&g_hedge.lock);
+}
+
+struct hedge;
+
+struct hedge_attempt {
+    struct hedge *hedge;
+    CURL *curl;
+    uint64_t start_us;
+    char *headers; // 胜出前缓存的响应头行, 每行为 u32 长度 + 内容
+    size_t headers_len;
+    size_t headers_capacity;
+    bool done;
+    bool lost; // 出错的响应在另一个请求还在进行时被中止
+    CURLcode result;
+};
+
+struct hedge {
+    coze_transport_sink_t *sink;
+    struct hedge_attempt attempts[2];
+    int count;
+    struct hedge_attempt *winner; // 第一个收到响应体 (或无响应体而完成) 的请求, 之后只有它的数据交给 sink
 };
 
-static void process_sse_message(const struct SSEContext *ctx, const char *message, size_t length) {
-    if (!message || length == 0) return;
+// 选出胜者: 补交它缓存的响应头, 之后其他请求的回调都返回 0 中止
+static void hedge_claim(struct hedge *hedge, struct hedge_attempt *attempt) {
+    hedge->winner = attempt;
+    for (size_t offset = 0; offset < attempt->headers_len;) {
+        uint32_t len;
+        memcpy(&len, attempt->headers + offset, sizeof(len));
+        coze_transport_sink_header(hedge->sink, attempt->headers + offset + sizeof(len), len);
+        offset += sizeof(len) + len;
+    }
+}
 
-    // 创建临时缓冲区存储消息
-    char *temp = malloc(length + 1);
-    memcpy(temp, message, length);
-    temp[length] = '\0';
+static size_t hedge_header_callback(char *buffer, size_t size, size_t nitems, void *userdata) {
+    struct hedge_attempt *attempt = userdata;
+    struct hedge *hedge = attempt->hedge;
+    const size_t len = size * nitems;
+    if (hedge->winner) {
+        return hedge->winner == attempt ? coze_transport_sink_header(hedge->sink, buffer, len) : 0;
+    }
+    const uint32_t line_len = (uint32_t) len;
+    if (attempt->headers_len + sizeof(line_len) + len > attempt->headers_capacity) {
+        const size_t capacity = (attempt->headers_len + sizeof(line_len) + len) * 2;
+        char *headers = coze_realloc(attempt->headers, capacity);
+        if (!headers) {
+            return 0;
+        }
+        attempt->headers = headers;
+        attempt->headers_capacity = capacity;
+    }
+    memcpy(attempt->headers + attempt->headers_len, &line_len, sizeof(line_len));
+    memcpy(attempt->headers + attempt->headers_len + sizeof(line_len), buffer, len);
+    attempt->headers_len += sizeof(line_len) + len;
+    return len;
+}
 
-    if (ctx->sse_event_callback) {
-        ctx->sse_event_callback(temp, ctx->biz_ctx);
+// 429 和 5xx 不急着胜出: 另一个请求还在进行时让它输掉, 等另一个的结果
+static bool hedge_may_claim(const struct hedge *hedge, const struct hedge_attempt *attempt) {
+    long status = 0;
+    curl_easy_getinfo(attempt->curl, CURLINFO_RESPONSE_CODE, &status);
+    if (status != 429 && status < 500) {
+        return true;
+    }
+    for (int i = 0; i < hedge->count; i++) {
+        const struct hedge_attempt *other = &hedge->attempts[i];
+        if (other != attempt && !other->done && !other->lost) {
+            return false;
+        }
     }
+    return true;
+}
 
-    free(temp);
+static size_t hedge_write_callback(char *contents, size_t size, size_t nmemb, void *userp) {
+    struct hedge_attempt *attempt = userp;
+    struct hedge *hedge = attempt->hedge;
+    if (!hedge->winner && !hedge_may_claim(hedge, attempt)) {
+        attempt->lost = true;
+        return 0;
+    }
+    if (!hedge->winner) {
+        hedge_claim(hedge, attempt);
+    }
+    return hedge->winner == attempt ? coze_transport_sink_body(hedge->sink, contents, size * nmemb) : 0;
 }
 
-static size_t sse_write_callback(void *contents, size_t size, size_t nmemb, void *userp) {
-    size_t realsize = size * nmemb;
-    struct SSEContext *ctx = userp;
+// 失败时 curl 仍归调用方
+static bool hedge_start(struct hedge *hedge, CURLM *multi, CURL *curl, const coze_transport_request_t *req,
+                        struct curl_slist *headers) {
+    struct hedge_attempt *attempt = &hedge->attempts[hedge->count];
+    if (!curl) {
+        return false;
+    }
+    attempt->hedge = hedge;
+    attempt->curl = curl;
+    curl_request_setup(curl, req, headers, hedge_header_callback, hedge_write_callback, attempt);
+    curl_easy_setopt(curl, CURLOPT_PRIVATE, attempt);
+    if (curl_multi_add_handle(multi, curl) != CURLM_OK) {
+        return false;
+    }
+    attempt->start_us = now_us();
+    hedge->count++;
+    return true;
+}
 
-    // 确保缓冲区足够大
-    if (ctx->buffer_used + realsize > ctx->buffer_size) {
-        size_t new_size = ctx->buffer_size + realsize + 4096; // 增加额外空间
-        char *new_buffer = realloc(ctx->buffer, new_size);
-        if (!new_buffer) return 0;
+// 幂等读请求: 先发一个, 超过对冲延迟仍未收到响应体时在另一个连接上再发一个, 先收到响应体的胜出,
+// 另一个立即中止并关闭连接。第一个请求用池中的连接, 对冲请求加进同一个 multi, 胜者的连接随它放回池中
+static coze_error_t curl_hedged_transport(const coze_transport_request_t *req, coze_transport_sink_t *sink) {
+    struct pooled_conn conn;
+    if (!conn_pool_take(req->url, &conn)) {
+        return COZE_ERROR_NETWORK;
+    }
+    CURLM *multi = conn.multi;
 
-        ctx->buffer = new_buffer;
-        ctx->buffer_size = new_size;
+    struct curl_slist *headers = curl_request_headers(req);
+    struct hedge hedge = {.sink = sink};
+    const uint64_t hedge_at = now_us() + hedge_delay_us(req->path);
+    bool hedge_decided = false; // 已经发起对冲, 或预算不足放弃
+    if (!hedge_start(&hedge, multi, conn.curl, req, headers)) {
+        curl_slist_free_all(headers);
+        conn_pool_put(&conn, req->url, false);
+        return COZE_ERROR_NETWORK;
     }
 
-    // 添加新数据到缓冲区
-    memcpy(ctx->buffer + ctx->buffer_used, contents, realsize);
-    ctx->buffer_used += realsize;
-    ctx->buffer[ctx->buffer_used] = '\0';
+    for (;;) {
+        int running = 0;
+        if (curl_multi_perform(multi, &running) != CURLM_OK) {
+            break;
+        }
+        CURLMsg *msg;
+        int queued;
+        while ((msg = curl_multi_info_read(multi, &queued))) {
+            struct hedge_attempt *attempt = NULL;
+            if (msg->msg != CURLMSG_DONE || curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE,
+                                                              (char **) &attempt) != CURLE_OK || !attempt) {
+                continue;
+            }
+            attempt->done = true;
+            attempt->result = msg->data.result;
+            if (!hedge.winner && attempt->result == CURLE_OK && hedge_may_claim(&hedge, attempt)) {
+                hedge_claim(&hedge, attempt); // 没有响应体的响应
+            }
+        }
 
-    // 处理完整的 SSE 消息
-    char *start = ctx->buffer;
-    char *end;
-    while ((end = strstr(start, "\n\n")) != NULL) {
-        *end = '\0'; // 临时终止字符串
-        process_sse_message(ctx, start, end - start);
-        start = end + 2; // 跳过两个换行符
+        bool finished = hedge.winner ? hedge.winner->done : true;
+        for (int i = 0; i < hedge.count && !hedge.winner; i++) {
+            finished = finished && hedge.attempts[i].done;
+        }
+        if (!hedge_decided && !hedge.winner && !hedge.attempts[0].done && now_us() >= hedge_at) {
+            // 到了对冲时间还没有响应体, 预算允许时再发一个
+            hedge_decided = true;
+            // 对冲请求只能用调用时限剩下的时间
+            coze_transport_request_t hedge_req = *req;
+            const uint64_t elapsed_ms = (now_us() - hedge.attempts[0].start_us) / 1000u;
+            hedge_req.timeout_ms = req->timeout_ms > 0 ? req->timeout_ms - (int) elapsed_ms : 0;
+            CURL *curl = (req->timeout_ms <= 0 || hedge_req.timeout_ms > 0) && hedge_take_budget()
+                                 ? curl_easy_init()
+                                 : NULL;
+            if (hedge_start(&hedge, multi, curl, &hedge_req, headers)) {
+                __atomic_fetch_add(&g_transfer_stats.hedges, 1, __ATOMIC_RELAXED);
+                COZE_LOG("hedge: %s %s\n", req->method, req->url);
+            } else {
+                curl_easy_cleanup(curl);
+            }
+        }
+        if (finished) {
+            break;
+        }
 
-        size_t remaining = ctx->buffer_used - (start - ctx->buffer);
-        if (remaining > 0) {
-            memmove(ctx->buffer, start, remaining);
+        int timeout_ms = 100;
+        if (!hedge_decided && !hedge.winner) {
+            const uint64_t now = now_us();
+            timeout_ms = hedge_at > now ? (int) ((hedge_at - now + 999) / 1000) : 0;
+            timeout_ms = timeout_ms > 100 ? 100 : timeout_ms;
         }
-        ctx->buffer_used = remaining;
-        ctx->buffer[ctx->buffer_used] = '\0';
-        start = ctx->buffer;
+        curl_multi_poll(multi, NULL, 0, timeout_ms, NULL);
     }
 
-    return realsize;
+    // 没有胜者时优先用完整收到的 (没有响应体的错误响应), 否则以第一个请求为准
+    struct hedge_attempt *result = hedge.winner;
+    for (int i = 0; i < hedge.count && !result; i++) {
+        result = hedge.attempts[i].done && hedge.attempts[i].result == CURLE_OK ? &hedge.attempts[i] : NULL;
+    }
+    result = result ? result : &hedge.attempts[0];
+    if (!hedge.winner && hedge.count > 0) {
+        hedge_claim(&hedge, result);
+    }
+    for (int i = 0; i < hedge.count; i++) {
+        struct hedge_attempt *attempt = &hedge.attempts[i];
+        curl_off_t wire_bytes = 0;
+        curl_easy_getinfo(attempt->curl, CURLINFO_SIZE_DOWNLOAD_T, &wire_bytes);
+        transfer_stats_connects(attempt->curl);
+        if (attempt == result) {
+            transfer_stats_add(sink, (size_t) wire_bytes);
+        } else {
+            __atomic_fetch_add(&g_transfer_stats.wire_bytes, (size_t) wire_bytes, __ATOMIC_RELAXED);
+        }
+        curl_multi_remove_handle(multi, attempt->curl);
+        if (attempt->curl != conn.curl) {
+            curl_easy_cleanup(attempt->curl);
+        }
+        coze_free(attempt->headers);
+    }
+    if (result->done && result->result == CURLE_OK) {
+        // 和对冲时机比较的是首字节时间, 无响应体时才用完成时间
+        const uint64_t end = sink->first_byte_us > result->start_us ? sink->first_byte_us : now_us();
+        hedge_record_latency(req->path, end - result->start_us);
+        if (result != &hedge.attempts[0]) {
+            __atomic_fetch_add(&g_transfer_stats.hedge_wins, 1, __ATOMIC_RELAXED);
+        }
+    }
+    curl_slist_free_all(headers);
+    // 败者的连接已随中止关闭, multi 里留下的是胜者的连接
+    conn_pool_put(&conn, req->url, result->done && result->result == CURLE_OK);
+
+    sink->connect_failed = result->done && curl_connect_failed(result->result);
+    return result->done ? curl_result_error(req, result->result) : COZE_ERROR_NETWORK;
+}
+
+// *** hedging ***
+
+// hedge 为 true 表示幂等读请求, 开启对冲时走 curl_hedged_transport
+static coze_error_t perform_transport(const coze_transport_request_t *req, coze_transport_sink_t *sink, bool hedge) {
+    if (g_transport.fn) {
+        return g_transport.fn(req, sink, g_transport.ctx);
+    }
+
+    vcr_record_begin(req, sink);
+    const coze_error_t err = hedge && g_hedge.policy.enabled ? curl_hedged_transport(req, sink)
+                                                               : curl_transport(req, sink);
+    vcr_record_end(sink, err);
+    return err;
+}
+
+// 通用的 HTTP 请求函数, 响应体交给 write_body
+// upload_file 非 NULL 时以 multipart/form-data 上传该文件, json_body 为 NULL
+static coze_error_t make_http_request(
+    const char *api_base, const char *api_token, uint64_t deadline_us,
+    const char *path, const char *method, const char *json_body, const char *upload_file,
+    size_t (*write_body)(void *contents, size_t size, size_t nmemb, void *userp),
+    void (*reserve_body)(void *userp, size_t content_length), void *body_userp,
+    bool idempotent, coze_response_t *coze_response) {
+    coze_response->allocator = t_allocator; // 释放响应时回到同一个分配器
+
+    coze_transport_request_t transport_req = {
+        .method = method,
+        .path = path,
+        .api_token = api_token,
+        .body = json_body,
+        .upload_file = upload_file,
+        .stream = false,
+    };
+    const coze_retry_policy_t *policy = retry_policy_for(path, idempotent);
+    struct endpoint_pick endpoint;
+    uint32_t unreachable = 0; // 本次请求连不上或已熔断的端点
+    coze_error_t err = COZE_ERROR_NETWORK;
+    for (int attempt = 1; endpoint_select(api_base, unreachable, &endpoint); attempt++) {
+        coze_transport_sink_t sink = {
+            .coze_response = coze_response,
+            .write_body = write_body,
+            .reserve_body = reserve_body,
+            .body_userp = body_userp,
+            .retry = policy && attempt < policy->max_attempts ? policy : NULL,
+        };
+        char *url = build_url(endpoint.base, path);
+        if (!url) {
+            endpoint_release(&endpoint, &sink, COZE_OK, false);
+            err = COZE_ERROR_MEMORY;
+            break;
+        }
+        if (attempt == 1 && !unreachable) {
+            COZE_LOG("start: %s %s\n", method, url);
+            if (json_body && strcmp(method, "POST") == 0) {
+                COZE_LOG("body: %s\n", json_body);
+            } else if (upload_file) {
+                COZE_LOG("upload: %s\n", upload_file);
+            }
+        }
+        transport_req.url = url;
+
+        struct circuit_permit circuit;
+        struct rate_permit permit;
+        bool sent = false;
+        err = deadline_remaining_ms(deadline_us) < 0 ? COZE_ERROR_DEADLINE_EXCEEDED
+                                                     : circuit_acquire(endpoint.base, &circuit);
+        if (err == COZE_OK && (err = rate_limit_acquire(api_token, path, deadline_us, &permit)) != COZE_OK) {
+            circuit_skip(&circuit);
+        } else if (err == COZE_OK) {
+            transport_req.timeout_ms = deadline_remaining_ms(deadline_us);
+            err = perform_transport(&transport_req, &sink, idempotent);
+            rate_limit_release(&permit, &sink);
+            circuit_release(&circuit, &sink, err);
+            sent = true;
+        }
+        endpoint_release(&endpoint, &sink, err, sent);
+
+        uint64_t delay = 0;
+        bool again = false;
+        if (endpoint_failover(&endpoint, &sink, err, &unreachable)) {
+            COZE_LOG("failover: %s %s, %s\n", method, url,
+                     err == COZE_ERROR_CIRCUIT_OPEN ? "circuit open" : "connect failed");
+            __atomic_fetch_add(&g_transfer_stats.failovers, 1, __ATOMIC_RELAXED);
+            attempt--; // 换端点不占重试次数
+            again = true;
+        } else if (policy && err != COZE_ERROR_CIRCUIT_OPEN && err != COZE_ERROR_RATE_LIMITED &&
+                   err != COZE_ERROR_DEADLINE_EXCEEDED) {
+            if (!sink.retry) {
+                if (err != COZE_OK ? policy->retry_network_errors : retry_status_wanted(policy, &sink)) {
+                    __atomic_fetch_add(&g_transfer_stats.retry_giveups, 1, __ATOMIC_RELAXED);
+                }
+            } else if (retry_wanted(policy, &sink, err)) {
+                delay = retry_delay_us(policy, &sink, attempt);
+                again = !deadline_us || now_us() + delay < deadline_us;
+                if (again) {
+                    COZE_LOG("retry %d/%d: %s %s, status %d, after %llu ms\n", attempt, policy->max_attempts - 1,
+                             method, url, sink.http_status, (unsigned long long) (delay / 1000u));
+                    __atomic_fetch_add(&g_transfer_stats.retries, 1, __ATOMIC_RELAXED);
+                    unreachable = 0; // 重试时所有端点重新参与选择
+                } else {
+                    // 退避结束时已经过了调用时限, 不再重试; 这次的响应体已经丢弃, 只能返回超时
+                    COZE_LOG("deadline exceeded: %s %s, status %d\n", method, url, sink.http_status);
+                    __atomic_fetch_add(&g_transfer_stats.retry_giveups, 1, __ATOMIC_RELAXED);
+                    err = COZE_ERROR_DEADLINE_EXCEEDED;
+                }
+            }
+        }
+        coze_free(url);
+        if (!again) {
+            break;
+        }
+        sleep_us(delay);
+    }
+    return err;
+}
+
+// 发送请求并按 target 解码 JSON 响应。默认边接收边解码, 不缓存响应体;
+// 零拷贝时先收下整个响应体再原地解析, 列表的字符串字段直接指向它
+static coze_error_t make_http_json_request(
+    const char *api_base, const char *api_token, uint64_t deadline_us,
+    const char *path, const char *method, const char *json_body,
+    const struct json_target *target, coze_response_t *coze_response) {
+    const bool idempotent = strcmp(method, "GET") == 0 || target->idempotent;
+    if (target->zero_copy) {
+        // 响应体优先放进 client 的 response_buffer; 交给列表 arena 后 client 下次重新分配
+        struct MemoryStruct chunk = {0};
+        struct client_buffer *buffer = target->client ? &target->client->response_buffer : NULL;
+        if (!client_buffer_acquire(buffer, &chunk.memory, &chunk.capacity)) {
+            buffer = NULL;
+        }
+        coze_error_t err = make_http_request(api_base, api_token, deadline_us, path, method, json_body, NULL,
+                                             WriteMemoryCallback, ReserveMemoryCallback, &chunk, idempotent,
+                                             coze_response);
+        if (err == COZE_OK) {
+            COZE_LOG("response: %s, %s\n", coze_response->logid, chunk.size ? chunk.memory : "");
+            err = chunk.size ? json_decode_response(&chunk.memory, chunk.size, target) : COZE_ERROR_API;
+        }
+        if (buffer) {
+            client_buffer_release(buffer, chunk.memory, chunk.capacity);
+        } else {
+            coze_free(chunk.memory);
+        }
+        return err;
+    }
+
+    struct json_stream stream;
+    json_stream_init(&stream, target);
+    const coze_error_t err = make_http_request(api_base, api_token, deadline_us, path, method, json_body, NULL,
+                                               json_stream_write_callback, NULL, &stream, idempotent, coze_response);
+    if (err == COZE_OK) {
+        COZE_LOG("response: %s, %zu bytes\n", coze_response->logid, stream.received);
+    }
+    return json_stream_finish(&stream, err);
 }
 
 // 通用的 HTTP SSE 请求函数
 static coze_error_t make_http_sse_request(
-    const char *api_base, const char *api_token,
+    const char *api_base, const char *api_token, uint64_t deadline_us,
     const char *path, const char *method,
     const char *json_body,
     const sse_event_callback_t sse_event_callback,
     void *biz_ctx,
     coze_response_t *coze_response) {
-    CURL *curl = curl_easy_init();
-    if (!curl) return COZE_ERROR_NETWORK;
-
+    coze_response->allocator = t_allocator;
     struct SSEContext ctx = {0};
-    ctx.buffer = malloc(4096); // 初始分配 4KB
-    ctx.buffer_size = 4096;
-    ctx.buffer_used = 0;
     ctx.sse_event_callback = sse_event_callback;
     ctx.biz_ctx = biz_ctx;
 
-    // 设置请求头
-    struct curl_slist *headers = NULL;
-    char auth_header[256];
-    snprintf(auth_header, sizeof(auth_header), "Authorization: Bearer %s", api_token);
-    headers = curl_slist_append(headers, auth_header);
-    headers = curl_slist_append(headers, "Accept: text/event-stream");
-    headers = curl_slist_append(headers, "Cache-Control: no-cache");
+    coze_transport_request_t transport_req = {
+        .method = method,
+        .path = path,
+        .api_token = api_token,
+        .body = json_body,
+        .stream = true,
+    };
+    struct endpoint_pick endpoint;
+    uint32_t unreachable = 0;
+    coze_error_t err = COZE_ERROR_NETWORK;
+    while (endpoint_select(api_base, unreachable, &endpoint)) {
+        coze_transport_sink_t sink = {
+            .coze_response = coze_response,
+            .write_body = sse_write_callback,
+            .body_userp = &ctx,
+        };
+        char *url = build_url(endpoint.base, path);
+        if (!url) {
+            endpoint_release(&endpoint, &sink, COZE_OK, false);
+            err = COZE_ERROR_MEMORY;
+            break;
+        }
+        if (!unreachable && json_body) {
+            COZE_LOG("start SSE: %s %s, body: %s\n", method, url, json_body);
+        } else if (!unreachable) {
+            COZE_LOG("start SSE: %s %s\n", method, url);
+        }
+        transport_req.url = url;
+
+        struct circuit_permit circuit;
+        struct rate_permit permit;
+        bool sent = false;
+        err = deadline_remaining_ms(deadline_us) < 0 ? COZE_ERROR_DEADLINE_EXCEEDED
+                                                     : circuit_acquire(endpoint.base, &circuit);
+        if (err == COZE_OK && (err = rate_limit_acquire(api_token, path, deadline_us, &permit)) != COZE_OK) {
+            circuit_skip(&circuit);
+        } else if (err == COZE_OK) {
+            transport_req.timeout_ms = deadline_remaining_ms(deadline_us);
+            err = perform_transport(&transport_req, &sink, false);
+            rate_limit_release(&permit, &sink);
+            circuit_release(&circuit, &sink, err);
+            sent = true;
+        }
+        endpoint_release(&endpoint, &sink, err, sent);
+        // 连接失败时请求没有发出, 流式请求也可以换端点
+        const bool failover = endpoint_failover(&endpoint, &sink, err, &unreachable);
+        if (failover) {
+            COZE_LOG("failover: %s %s, %s\n", method, url,
+                     err == COZE_ERROR_CIRCUIT_OPEN ? "circuit open" : "connect failed");
+            __atomic_fetch_add(&g_transfer_stats.failovers, 1, __ATOMIC_RELAXED);
+        }
+        coze_free(url);
+        if (!failover) {
+            break;
+        }
+    }
 
-    if (json_body) {
-        headers = curl_slist_append(headers, "Content-Type: application/json");
+    // 处理剩余的不完整消息
+    sse_finish(&ctx);
+
+    if (err != COZE_OK) {
+        return err;
+    }
+
+    COZE_LOG("SSE completed: %s\n", coze_response->logid);
+    return COZE_OK;
+}
+
+// *** vcr replay ***
+
+struct vcr_event {
+    uint8_t type;
+    uint64_t offset_us;
+    const char *data;
+    uint32_t len;
+};
+
+struct vcr_interaction {
+    const char *method; // NULL 表示文件中缺少该交互的请求记录
+    const char *path;
+    struct vcr_event *events;
+    size_t event_count;
+    size_t event_cap;
+    coze_error_t result;
+};
+
+static struct {
+    pthread_mutex_t lock;
+    char *data; // 整个录制文件, 事件中的指针都指向这里
+    struct vcr_interaction *interactions; // 下标为交互 ID - 1
+    size_t interaction_count;
+    size_t cursor; // 下一次匹配的起点, 同一 method + path 的多次录制按顺序轮流回放
+    coze_vcr_pacing_t pacing;
+} g_vcr_replay = {.lock = PTHREAD_MUTEX_INITIALIZER};
+
+static void vcr_replay_reset(void) {
+    for (size_t i = 0; i < g_vcr_replay.interaction_count; i++) {
+        coze_free(g_vcr_replay.interactions[i].events);
+    }
+    coze_free(g_vcr_replay.interactions);
+    coze_free(g_vcr_replay.data);
+    g_vcr_replay.data = NULL;
+    g_vcr_replay.interactions = NULL;
+    g_vcr_replay.interaction_count = 0;
+    g_vcr_replay.cursor = 0;
+}
+
+static struct vcr_interaction *vcr_replay_interaction(uint32_t id) {
+    if (id == 0) {
+        return NULL;
+    }
+    if (id > g_vcr_replay.interaction_count) {
+        struct vcr_interaction *interactions = coze_realloc(g_vcr_replay.interactions, id * sizeof(*interactions));
+        if (!interactions) {
+            return NULL;
+        }
+        memset(interactions + g_vcr_replay.interaction_count, 0,
+               (id - g_vcr_replay.interaction_count) * sizeof(*interactions));
+        g_vcr_replay.interactions = interactions;
+        g_vcr_replay.interaction_count = id;
     }
+    return &g_vcr_replay.interactions[id - 1];
+}
 
-    char *url = build_url(api_base, url);
+static coze_error_t vcr_replay_load(char *data, size_t size) {
+    if (size < VCR_MAGIC_LEN || memcmp(data, VCR_MAGIC, VCR_MAGIC_LEN) != 0) {
+        return COZE_ERROR_INVALID_PARAM;
+    }
 
-    curl_easy_setopt(curl, CURLOPT_URL, url);
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, header_callback);
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, sse_write_callback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void*)&ctx);
-    curl_easy_setopt(curl, CURLOPT_HEADERDATA, coze_response);
-    curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_1_1);
-    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 0L); // 无超时限制
-    curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+    size_t pos = VCR_MAGIC_LEN;
+    while (pos + VCR_RECORD_HEADER_LEN <= size) {
+        const unsigned char *header = (const unsigned char *) data + pos;
+        const uint8_t type = header[0];
+        const uint32_t id = get_u32(header + 1);
+        const uint64_t offset_us = get_u64(header + 5);
+        const uint32_t len = get_u32(header + 13);
+        char *payload = data + pos + VCR_RECORD_HEADER_LEN;
+        if (len > size - pos - VCR_RECORD_HEADER_LEN) {
+            break; // 录制被中断, 丢弃不完整的尾部
+        }
+        pos += VCR_RECORD_HEADER_LEN + len;
 
-    // 如果是 POST 请求
-    if (strcmp(method, "POST") == 0) {
-        curl_easy_setopt(curl, CURLOPT_POST, 1L);
-        if (json_body) {
-            curl_easy_setopt(curl, CURLOPT_POSTFIELDS, json_body);
+        struct vcr_interaction *interaction = vcr_replay_interaction(id);
+        if (!interaction) {
+            return id == 0 ? COZE_ERROR_INVALID_PARAM : COZE_ERROR_MEMORY;
+        }
+        if (type == VCR_RECORD_REQUEST) {
+            const char *method_end = memchr(payload, '\0', len);
+            const char *path_end = method_end ? memchr(method_end + 1, '\0', len - (method_end + 1 - payload)) : NULL;
+            if (!path_end) {
+                return COZE_ERROR_INVALID_PARAM;
+            }
+            interaction->method = payload;
+            interaction->path = method_end + 1;
+            interaction->result = COZE_ERROR_NETWORK; // 没有结束记录时视为连接中断
+        } else if (type == VCR_RECORD_END) {
+            interaction->result = len >= 4 ? (coze_error_t) get_u32((const unsigned char *) payload) : COZE_OK;
+        } else if (type == VCR_RECORD_HEADER || type == VCR_RECORD_BODY) {
+            if (interaction->event_count == interaction->event_cap) {
+                const size_t cap = interaction->event_cap ? interaction->event_cap * 2 : 16;
+                struct vcr_event *events = coze_realloc(interaction->events, cap * sizeof(*events));
+                if (!events) {
+                    return COZE_ERROR_MEMORY;
+                }
+                interaction->events = events;
+                interaction->event_cap = cap;
+            }
+            interaction->events[interaction->event_count++] = (struct vcr_event){
+                .type = type,
+                .offset_us = offset_us,
+                .data = payload,
+                .len = len,
+            };
         }
     }
+    return COZE_OK;
+}
 
-    if (json_body) {
-        printf("[coze_api] start SSE: %s %s, body: %s\n", method, url, json_body);
-    } else {
-        printf("[coze_api] start SSE: %s %s\n", method, url);
+static const struct vcr_interaction *vcr_replay_match(const char *method, const char *path) {
+    const struct vcr_interaction *found = NULL;
+    pthread_mutex_lock(&g_vcr_replay.lock);
+    const size_t count = g_vcr_replay.interaction_count;
+    for (size_t n = 0; n < count; n++) {
+        const size_t i = (g_vcr_replay.cursor + n) % count;
+        const struct vcr_interaction *interaction = &g_vcr_replay.interactions[i];
+        if (interaction->method && strcmp(interaction->method, method) == 0 &&
+            strcmp(interaction->path, path) == 0) {
+            found = interaction;
+            g_vcr_replay.cursor = i + 1;
+            break;
+        }
     }
+    pthread_mutex_unlock(&g_vcr_replay.lock);
+    return found;
+}
 
-    // 执行请求
-    CURLcode res = curl_easy_perform(curl);
-
-    // 处理剩余的不完整消息
-    if (ctx.buffer_used > 0) {
-        process_sse_message(&ctx, ctx.buffer, ctx.buffer_used);
+static coze_error_t vcr_replay_transport(const coze_transport_request_t *req, coze_transport_sink_t *sink,
+                                         void *ctx) {
+    (void) ctx;
+    const struct vcr_interaction *interaction = vcr_replay_match(req->method, req->path);
+    if (!interaction) {
+        COZE_LOG("vcr: no recorded interaction for %s %s\n", req->method, req->path);
+        return COZE_ERROR_NETWORK;
     }
 
-    free(ctx.buffer);
-    curl_slist_free_all(headers);
-    curl_easy_cleanup(curl);
+    const uint64_t start_us = now_us();
+    for (size_t i = 0; i < interaction->event_count; i++) {
+        const struct vcr_event *event = &interaction->events[i];
+        if (g_vcr_replay.pacing == COZE_VCR_PACING_ORIGINAL) {
+            const uint64_t elapsed_us = now_us() - start_us;
+            if (event->offset_us > elapsed_us) {
+                sleep_us(event->offset_us - elapsed_us);
+            }
+        }
+        if (event->type == VCR_RECORD_HEADER) {
+            coze_transport_sink_header(sink, event->data, event->len);
+        } else if (coze_transport_sink_body(sink, event->data, event->len) != event->len) {
+            return COZE_ERROR_NETWORK; // 与 curl 写回调失败时的行为一致
+        }
+    }
+    return interaction->result;
+}
 
-    if (res != CURLE_OK) {
-        return COZE_ERROR_NETWORK;
+coze_error_t coze_vcr_record_start(const char *path) {
+    if (!path) {
+        return COZE_ERROR_INVALID_PARAM;
+    }
+    FILE *file = fopen(path, "wb");
+    if (!file) {
+        return COZE_ERROR_INVALID_PARAM;
     }
+    fwrite(VCR_MAGIC, 1, VCR_MAGIC_LEN, file);
 
-    printf("[coze_api] SSE completed: %s\n", coze_response->logid);
+    coze_vcr_stop();
+    pthread_mutex_lock(&g_vcr_recorder.lock);
+    g_vcr_recorder.file = file;
+    g_vcr_recorder.next_id = 0;
+    pthread_mutex_unlock(&g_vcr_recorder.lock);
     return COZE_OK;
 }
 
-// 通用的 JSON 响应解析函数
-static coze_error_t parse_response_code(cJSON *json, char **msg, int *code) {
-    cJSON *code_obj = cJSON_GetObjectItem(json, "code");
-    cJSON *msg_obj = cJSON_GetObjectItem(json, "msg");
-    cJSON *error_code_obj = cJSON_GetObjectItem(json, "error_code");
-    cJSON *error_message_obj = cJSON_GetObjectItem(json, "error_message");
-
-    if (msg_obj && msg) {
-        *msg = strdup(msg_obj->valuestring);
+coze_error_t coze_vcr_replay_start(const char *path, coze_vcr_pacing_t pacing) {
+    if (!path) {
+        return COZE_ERROR_INVALID_PARAM;
+    }
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        return COZE_ERROR_INVALID_PARAM;
+    }
+    fseek(file, 0, SEEK_END);
+    const long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    if (size <= 0) {
+        fclose(file);
+        return COZE_ERROR_INVALID_PARAM;
+    }
+    char *data = coze_malloc((size_t) size);
+    if (!data) {
+        fclose(file);
+        return COZE_ERROR_MEMORY;
     }
-    if (error_message_obj && msg) {
-        *msg = strdup(error_message_obj->valuestring);
+    const size_t read = fread(data, 1, (size_t) size, file);
+    fclose(file);
+    if (read != (size_t) size) {
+        coze_free(data);
+        return COZE_ERROR_INVALID_PARAM;
     }
 
-    if (code_obj) {
-        if (code) {
-            *code = code_obj->valueint;
-        }
-        if (code_obj->valueint != 0) {
-            return COZE_ERROR_API;
-        }
-    } else if (error_code_obj) {
-        *code = -1; // auth code not int
-        return COZE_ERROR_API;
+    coze_vcr_stop();
+    pthread_mutex_lock(&g_vcr_replay.lock);
+    g_vcr_replay.data = data;
+    g_vcr_replay.pacing = pacing;
+    const coze_error_t err = vcr_replay_load(data, (size_t) size);
+    if (err != COZE_OK) {
+        vcr_replay_reset();
+    }
+    pthread_mutex_unlock(&g_vcr_replay.lock);
+    if (err != COZE_OK) {
+        return err;
     }
 
+    coze_set_transport(vcr_replay_transport, NULL);
     return COZE_OK;
 }
 
+void coze_vcr_stop(void) {
+    pthread_mutex_lock(&g_vcr_recorder.lock);
+    if (g_vcr_recorder.file) {
+        fclose(g_vcr_recorder.file);
+        g_vcr_recorder.file = NULL;
+    }
+    pthread_mutex_unlock(&g_vcr_recorder.lock);
+
+    if (g_transport.fn == vcr_replay_transport) {
+        coze_set_transport(NULL, NULL);
+    }
+    pthread_mutex_lock(&g_vcr_replay.lock);
+    vcr_replay_reset();
+    pthread_mutex_unlock(&g_vcr_replay.lock);
+}
 
 char *coze_web_oauth_get_oauth_url(const coze_web_oauth_get_oauth_url_request_t *req) {
     if (!req || !req->client_id) {
@@ -386,6 +5129,7 @@ char *coze_web_oauth_get_oauth_url(const coze_web_oauth_get_oauth_url_request_t
         snprintf(url, sizeof(url), "%s&state=%s", url, "");
     }
 
+    // 调用方用 free() 释放, 这里保持 libc 分配
     return strdup(url);
 }
 
@@ -394,77 +5138,42 @@ coze_error_t coze_web_oauth_get_access_token(const coze_web_oauth_get_access_tok
     if (!req || !resp) {
         return COZE_ERROR_INVALID_PARAM;
     }
-
-    struct MemoryStruct chunk = {0};
-    chunk.memory = malloc(1);
-    chunk.size = 0;
+    ALLOCATOR_SCOPE(client_allocator(req->client));
 
     // 构建 URL 和查询参数
     const char *path = "/api/permission/oauth2/token";
 
-    cJSON *body = cJSON_CreateObject();
+    struct json_writer body;
+    json_writer_begin(&body, req->client);
     if (req->client_id) {
-        cJSON_AddStringToObject(body, "client_id", req->client_id);
+        json_writer_string_field(&body, "client_id", req->client_id);
     }
-    cJSON_AddStringToObject(body, "grant_type", "authorization_code");
+    json_writer_string_field(&body, "grant_type", "authorization_code");
     if (req->code) {
-        cJSON_AddStringToObject(body, "code", req->code);
+        json_writer_string_field(&body, "code", req->code);
     }
     if (req->redirect_uri) {
-        cJSON_AddStringToObject(body, "redirect_uri", req->redirect_uri);
+        json_writer_string_field(&body, "redirect_uri", req->redirect_uri);
     }
-    char *json_body = cJSON_PrintUnformatted(body);
-    cJSON_Delete(body);
+    const char *json_body = json_writer_finish(&body);
 
+    const struct json_target target = {
+        .code = &resp->code, .msg = &resp->msg, .schema = &oauth_token_schema, .data = &resp->data
+    };
     coze_response_t coze_response = {0};
-    coze_error_t err = make_http_request(req->api_base, req->client_secret,
-                                         path, "POST", json_body, &chunk, &coze_response);
+    const coze_error_t err = make_http_json_request(REQ_API_BASE(req), req->client_secret, REQ_DEADLINE(req), path,
+                                                    "POST", json_body, &target, &coze_response);
     resp->response = coze_response;
-
-    if (err != COZE_OK) {
-        free(chunk.memory);
-        return err;
-    }
-
-    cJSON *json = cJSON_Parse(chunk.memory);
-    if (!json) {
-        free(chunk.memory);
-        return COZE_ERROR_API;
-    }
-
-    char *tmp_msg = NULL;
-    err = parse_response_code(json, &tmp_msg, &resp->code);
-    resp->msg = tmp_msg;
-    if (err != COZE_OK) {
-        resp->msg = tmp_msg;
-        cJSON_Delete(json);
-        free(chunk.memory);
-        return err;
-    }
-
-    // 解析数据
-    coze_workspaces_data_t workspaces_data = {0};
-
-    cJSON *access_token = cJSON_GetObjectItem(json, "access_token");
-    cJSON *refresh_token = cJSON_GetObjectItem(json, "refresh_token");
-    cJSON *expires_in = cJSON_GetObjectItem(json, "expires_in");
-    cJSON *token_type = cJSON_GetObjectItem(json, "token_type");
-
-    resp->data.access_token = access_token ? strdup(access_token->valuestring) : NULL;
-    resp->data.refresh_token = refresh_token ? strdup(refresh_token->valuestring) : NULL;
-    resp->data.expires_in = expires_in ? expires_in->valueint : 0;
-    resp->data.token_type = token_type ? strdup(token_type->valuestring) : NULL;
-    cJSON_Delete(json);
-    free(chunk.memory);
-
-    return COZE_OK;
+    json_writer_release(&body);
+    return err;
 }
 
 void coze_free_web_oauth_get_access_token_response(coze_web_oauth_get_access_token_response_t *resp) {
     if (!resp) {
         return;
     }
-    free((void *) resp->msg);
+    ALLOCATOR_SCOPE(resp->response.allocator);
+    coze_free((void *) resp->msg);
     coze_free_response(&resp->response);
     coze_free_oauth_token(&resp->data);
 }
@@ -474,74 +5183,39 @@ coze_error_t coze_web_oauth_refresh_access_token(const coze_web_oauth_refresh_ac
     if (!req || !resp) {
         return COZE_ERROR_INVALID_PARAM;
     }
-
-    struct MemoryStruct chunk = {0};
-    chunk.memory = malloc(1);
-    chunk.size = 0;
+    ALLOCATOR_SCOPE(client_allocator(req->client));
 
     // 构建 URL 和查询参数
     const char *path = "/api/permission/oauth2/token";
 
-    cJSON *body = cJSON_CreateObject();
+    struct json_writer body;
+    json_writer_begin(&body, req->client);
     if (req->client_id) {
-        cJSON_AddStringToObject(body, "client_id", req->client_id);
+        json_writer_string_field(&body, "client_id", req->client_id);
     }
-    cJSON_AddStringToObject(body, "grant_type", "refresh_token");
+    json_writer_string_field(&body, "grant_type", "refresh_token");
     if (req->refresh_token) {
-        cJSON_AddStringToObject(body, "refresh_token", req->refresh_token);
+        json_writer_string_field(&body, "refresh_token", req->refresh_token);
     }
-    char *json_body = cJSON_PrintUnformatted(body);
-    cJSON_Delete(body);
+    const char *json_body = json_writer_finish(&body);
 
+    const struct json_target target = {
+        .code = &resp->code, .msg = &resp->msg, .schema = &oauth_token_schema, .data = &resp->data
+    };
     coze_response_t coze_response = {0};
-    coze_error_t err = make_http_request(req->api_base, req->client_secret,
-                                         path, "POST", json_body, &chunk, &coze_response);
+    const coze_error_t err = make_http_json_request(REQ_API_BASE(req), req->client_secret, REQ_DEADLINE(req), path,
+                                                    "POST", json_body, &target, &coze_response);
     resp->response = coze_response;
-
-    if (err != COZE_OK) {
-        free(chunk.memory);
-        return err;
-    }
-
-    cJSON *json = cJSON_Parse(chunk.memory);
-    if (!json) {
-        free(chunk.memory);
-        return COZE_ERROR_API;
-    }
-
-    char *tmp_msg = NULL;
-    err = parse_response_code(json, &tmp_msg, &resp->code);
-    resp->msg = tmp_msg;
-    if (err != COZE_OK) {
-        resp->msg = tmp_msg;
-        cJSON_Delete(json);
-        free(chunk.memory);
-        return err;
-    }
-
-    // 解析数据
-    coze_workspaces_data_t workspaces_data = {0};
-
-    cJSON *access_token = cJSON_GetObjectItem(json, "access_token");
-    cJSON *refresh_token = cJSON_GetObjectItem(json, "refresh_token");
-    cJSON *expires_in = cJSON_GetObjectItem(json, "expires_in");
-    cJSON *token_type = cJSON_GetObjectItem(json, "token_type");
-
-    resp->data.access_token = access_token ? strdup(access_token->valuestring) : NULL;
-    resp->data.refresh_token = refresh_token ? strdup(refresh_token->valuestring) : NULL;
-    resp->data.expires_in = expires_in ? expires_in->valueint : 0;
-    resp->data.token_type = token_type ? strdup(token_type->valuestring) : NULL;
-    cJSON_Delete(json);
-    free(chunk.memory);
-
-    return COZE_OK;
+    json_writer_release(&body);
+    return err;
 }
 
 void coze_free_web_oauth_refresh_access_token_response(coze_web_oauth_refresh_access_token_response_t *resp) {
     if (!resp) {
         return;
     }
-    free((void *) resp->msg);
+    ALLOCATOR_SCOPE(resp->response.allocator);
+    coze_free((void *) resp->msg);
     coze_free_response(&resp->response);
     coze_free_oauth_token(&resp->data);
 }
@@ -549,207 +5223,104 @@ void coze_free_web_oauth_refresh_access_token_response(coze_web_oauth_refresh_ac
 
 coze_error_t coze_workspaces_list(const coze_workspaces_list_request_t *req,
                                   coze_workspaces_list_response_t *resp) {
-    if (!req || !resp || !req->api_token) {
+    if (!req || !resp || !REQ_API_TOKEN(req)) {
         return COZE_ERROR_INVALID_PARAM;
     }
-
-    struct MemoryStruct chunk = {0};
-    chunk.memory = malloc(1);
-    chunk.size = 0;
+    ALLOCATOR_SCOPE(client_allocator(req->client));
 
     char path[512];
     snprintf(path, sizeof(path),
              "/v1/workspaces?page_num=%d&page_size=%d",
              req->page_num, req->page_size);
 
+    const struct json_target target = {
+        .code = &resp->code, .msg = &resp->msg, .data_key = "data", .schema = &workspaces_data_schema,
+        .data = &resp->data, .zero_copy = req->zero_copy, .client = req->client
+    };
     coze_response_t coze_response = {0};
-    coze_error_t err = make_http_request(req->api_base, req->api_token,
-                                         path, "GET", NULL, &chunk, &coze_response);
+    const coze_error_t err = make_http_json_request(REQ_API_BASE(req), REQ_API_TOKEN(req), REQ_DEADLINE(req), path,
+                                                    "GET", NULL, &target, &coze_response);
     resp->response = coze_response;
-
-    if (err != COZE_OK) {
-        free(chunk.memory);
-        return err;
-    }
-
-    cJSON *json = cJSON_Parse(chunk.memory);
-    if (!json) {
-        free(chunk.memory);
-        return COZE_ERROR_API;
-    }
-
-    char *tmp_msg = NULL;
-    err = parse_response_code(json, &tmp_msg, &resp->code);
-    resp->msg = tmp_msg;
-    if (err != COZE_OK) {
-        cJSON_Delete(json);
-        free(chunk.memory);
-        return err;
-    }
-
-    // 解析数据
-    cJSON *data = cJSON_GetObjectItem(json, "data");
-    coze_workspaces_data_t workspaces_data = {0};
-    if (data) {
-        cJSON *total = cJSON_GetObjectItem(data, "total_count");
-        if (total) {
-            workspaces_data.total_count = total->valueint;
-        }
-
-        cJSON *workspaces = cJSON_GetObjectItem(data, "workspaces");
-        if (workspaces) {
-            int workspace_count = cJSON_GetArraySize(workspaces);
-            workspaces_data.workspace_count = workspace_count;
-            workspaces_data.workspaces = calloc(workspace_count, sizeof(coze_workspace_t));
-
-            for (int i = 0; i < workspace_count; i++) {
-                cJSON *workspace = cJSON_GetArrayItem(workspaces, i);
-                if (workspace) {
-                    cJSON *id = cJSON_GetObjectItem(workspace, "id");
-                    cJSON *name = cJSON_GetObjectItem(workspace, "name");
-                    cJSON *icon_url = cJSON_GetObjectItem(workspace, "icon_url");
-                    cJSON *role_type = cJSON_GetObjectItem(workspace, "role_type");
-                    cJSON *workspace_type = cJSON_GetObjectItem(workspace, "workspace_type");
-
-                    workspaces_data.workspaces[i].id = id ? strdup(id->valuestring) : NULL;
-                    workspaces_data.workspaces[i].name = name ? strdup(name->valuestring) : NULL;
-                    workspaces_data.workspaces[i].icon_url = icon_url ? strdup(icon_url->valuestring) : NULL;
-                    workspaces_data.workspaces[i].role_type = role_type ? strdup(role_type->valuestring) : NULL;
-                    workspaces_data.workspaces[i].workspace_type = workspace_type
-                                                                       ? strdup(workspace_type->valuestring)
-                                                                       : NULL;
-                }
-            }
-        }
-    }
-    resp->data = workspaces_data;
-
-    cJSON_Delete(json);
-    free(chunk.memory);
-
-    return COZE_OK;
+    return err;
 }
 
 void coze_free_workspaces_list_response(coze_workspaces_list_response_t *resp) {
     if (!resp) {
         return;
     }
+    ALLOCATOR_SCOPE(resp->response.allocator);
 
-    for (int i = 0; i < resp->data.workspace_count; i++) {
-        free((void *) resp->data.workspaces[i].id);
-        free((void *) resp->data.workspaces[i].name);
-        free((void *) resp->data.workspaces[i].icon_url);
-        free((void *) resp->data.workspaces[i].role_type);
-        free((void *) resp->data.workspaces[i].workspace_type);
-    }
-
-    free(resp->data.workspaces);
-    free((void *) resp->msg);
+    json_schema_free(&workspaces_data_schema, &resp->data);
+    coze_free((void *) resp->msg);
     coze_free_response(&resp->response);
 }
 
 
 coze_error_t coze_bots_create(const coze_bots_create_request_t *req,
                               coze_bots_create_response_t *resp) {
-    if (!req || !resp || !req->api_token) {
+    if (!req || !resp || !REQ_API_TOKEN(req)) {
         return COZE_ERROR_INVALID_PARAM;
     }
-
-    struct MemoryStruct chunk = {0};
-    chunk.memory = malloc(1);
-    chunk.size = 0;
+    ALLOCATOR_SCOPE(client_allocator(req->client));
 
     // 构建完整的 URL
     const char *path = "/v1/bot/create";
 
 
-    cJSON *body = cJSON_CreateObject();
+    struct json_writer body;
+    json_writer_begin(&body, req->client);
     if (req->space_id) {
-        cJSON_AddStringToObject(body, "space_id", req->space_id);
+        json_writer_string_field(&body, "space_id", req->space_id);
     }
     if (req->name) {
-        cJSON_AddStringToObject(body, "name", req->name);
+        json_writer_string_field(&body, "name", req->name);
     }
     if (req->description) {
-        cJSON_AddStringToObject(body, "description", req->description);
+        json_writer_string_field(&body, "description", req->description);
     }
     if (req->icon_file_id) {
-        cJSON_AddStringToObject(body, "icon_file_id", req->icon_file_id);
+        json_writer_string_field(&body, "icon_file_id", req->icon_file_id);
     }
-    cJSON *prompt_info = cJSON_CreateObject();
     if (req->prompt_info) {
+        json_writer_object_field(&body, "prompt_info");
         if (req->prompt_info->prompt) {
-            cJSON_AddStringToObject(prompt_info, "prompt", req->prompt_info->prompt);
+            json_writer_string_field(&body, "prompt", req->prompt_info->prompt);
         }
-        cJSON_AddItemToObject(body, "prompt_info", prompt_info);
+        json_writer_object_end(&body);
     }
-    cJSON *onboarding_info = cJSON_CreateObject();
     if (req->onboarding_info) {
+        json_writer_object_field(&body, "onboarding_info");
         if (req->onboarding_info->prologue) {
-            cJSON_AddStringToObject(onboarding_info, "prologue", req->onboarding_info->prologue);
+            json_writer_string_field(&body, "prologue", req->onboarding_info->prologue);
         }
         if (req->onboarding_info->suggested_questions) {
-            cJSON *suggested_questions = cJSON_CreateArray();
+            json_writer_array_field(&body, "suggested_questions");
             for (int i = 0; i < req->onboarding_info->suggested_questions_count; i++) {
-                cJSON *question = cJSON_CreateString(req->onboarding_info->suggested_questions[i]);
-                cJSON_AddItemToArray(suggested_questions, question);
+                json_writer_string(&body, req->onboarding_info->suggested_questions[i]);
             }
-            cJSON_AddItemToObject(onboarding_info, "suggested_questions", suggested_questions);
+            json_writer_array_end(&body);
         }
-        cJSON_AddItemToObject(body, "onboarding_info", onboarding_info);
+        json_writer_object_end(&body);
     }
-    char *json_body = cJSON_PrintUnformatted(body);
-    cJSON_Delete(body);
-    cJSON_Delete(prompt_info);
-    cJSON_Delete(onboarding_info);
+    const char *json_body = json_writer_finish(&body);
 
+    const struct json_target target = {
+        .msg = &resp->msg, .data_key = "data", .schema = &bot_schema, .data = &resp->data
+    };
     coze_response_t coze_response = {0};
-    coze_error_t err = make_http_request(req->api_base, req->api_token, path, "POST", json_body, &chunk,
-                                         &coze_response);
+    const coze_error_t err = make_http_json_request(REQ_API_BASE(req), REQ_API_TOKEN(req), REQ_DEADLINE(req), path,
+                                                    "POST", json_body, &target, &coze_response);
     resp->response = coze_response;
-
-    if (err != COZE_OK) {
-        free(chunk.memory);
-        return err;
-    }
-
-    cJSON *json = cJSON_Parse(chunk.memory);
-    if (!json) {
-        free(chunk.memory);
-        return COZE_ERROR_API;
-    }
-
-    char *tmp_msg = NULL;
-    err = parse_response_code(json, &tmp_msg, NULL);
-    resp->msg = tmp_msg;
-    if (err != COZE_OK) {
-        cJSON_Delete(json);
-        free(chunk.memory);
-        return err;
-    }
-
-    // 提取数据
-    cJSON *data = cJSON_GetObjectItem(json, "data");
-    coze_bot_t bot_info = {0};
-    if (data) {
-        cJSON *bot_id = cJSON_GetObjectItem(data, "bot_id");
-
-
-        bot_info.bot_id = bot_id ? strdup(bot_id->valuestring) : NULL;
-    }
-    resp->data = bot_info;
-
-    cJSON_Delete(json);
-    free(chunk.memory);
-
-    return COZE_OK;
+    json_writer_release(&body);
+    return err;
 }
 
 void coze_free_bots_create_response(coze_bots_create_response_t *resp) {
     if (!resp) {
         return;
     }
-    free((void *) resp->msg);
+    ALLOCATOR_SCOPE(resp->response.allocator);
+    coze_free((void *) resp->msg);
     coze_free_response(&resp->response);
     coze_free_bot(&resp->data);
 }
@@ -757,175 +5328,115 @@ void coze_free_bots_create_response(coze_bots_create_response_t *resp) {
 
 coze_error_t coze_bots_update(const coze_bots_update_request_t *req,
                               coze_bots_update_response_t *resp) {
-    if (!req || !resp || !req->api_token) {
+    if (!req || !resp || !REQ_API_TOKEN(req)) {
         return COZE_ERROR_INVALID_PARAM;
     }
-
-    struct MemoryStruct chunk = {0};
-    chunk.memory = malloc(1);
-    chunk.size = 0;
+    ALLOCATOR_SCOPE(client_allocator(req->client));
+    char bot_id_buffer[ID_BUFFER_SIZE];
+    const char *req_bot_id = REQ_ID(req, bot_id, bot_id_buffer);
 
     // 构建完整的 URL
     const char *path = "/v1/bot/update";
 
 
-    cJSON *body = cJSON_CreateObject();
-    if (req->bot_id) {
-        cJSON_AddStringToObject(body, "bot_id", req->bot_id);
+    struct json_writer body;
+    json_writer_begin(&body, req->client);
+    if (req_bot_id) {
+        json_writer_string_field(&body, "bot_id", req_bot_id);
     }
     if (req->name) {
-        cJSON_AddStringToObject(body, "name", req->name);
+        json_writer_string_field(&body, "name", req->name);
     }
     if (req->description) {
-        cJSON_AddStringToObject(body, "description", req->description);
+        json_writer_string_field(&body, "description", req->description);
     }
     if (req->icon_file_id) {
-        cJSON_AddStringToObject(body, "icon_file_id", req->icon_file_id);
+        json_writer_string_field(&body, "icon_file_id", req->icon_file_id);
     }
     if (req->prompt_info) {
-        cJSON *prompt_info = cJSON_CreateObject();
+        json_writer_object_field(&body, "prompt_info");
         if (req->prompt_info->prompt) {
-            cJSON_AddStringToObject(prompt_info, "prompt", req->prompt_info->prompt);
+            json_writer_string_field(&body, "prompt", req->prompt_info->prompt);
         }
-        cJSON_AddItemToObject(body, "prompt_info", prompt_info);
+        json_writer_object_end(&body);
     }
     if (req->onboarding_info) {
-        cJSON *onboarding_info = cJSON_CreateObject();
+        json_writer_object_field(&body, "onboarding_info");
         if (req->onboarding_info->prologue) {
-            cJSON_AddStringToObject(onboarding_info, "prologue", req->onboarding_info->prologue);
+            json_writer_string_field(&body, "prologue", req->onboarding_info->prologue);
         }
         if (req->onboarding_info->suggested_questions) {
-            cJSON *suggested_questions = cJSON_CreateArray();
+            json_writer_array_field(&body, "suggested_questions");
             for (int i = 0; i < req->onboarding_info->suggested_questions_count; i++) {
-                cJSON *question = cJSON_CreateString(req->onboarding_info->suggested_questions[i]);
-                cJSON_AddItemToArray(suggested_questions, question);
+                json_writer_string(&body, req->onboarding_info->suggested_questions[i]);
             }
-            cJSON_AddItemToObject(onboarding_info, "suggested_questions", suggested_questions);
+            json_writer_array_end(&body);
         }
-        cJSON_AddItemToObject(body, "onboarding_info", onboarding_info);
+        json_writer_object_end(&body);
     }
-    char *json_body = cJSON_PrintUnformatted(body);
-    cJSON_Delete(body);
+    const char *json_body = json_writer_finish(&body);
 
+    const struct json_target target = {.msg = &resp->msg};
     coze_response_t coze_response = {0};
-    coze_error_t err = make_http_request(req->api_base, req->api_token, path, "POST", json_body, &chunk,
-                                         &coze_response);
+    const coze_error_t err = make_http_json_request(REQ_API_BASE(req), REQ_API_TOKEN(req), REQ_DEADLINE(req), path,
+                                                    "POST", json_body, &target, &coze_response);
     resp->response = coze_response;
-
-    if (err != COZE_OK) {
-        free(chunk.memory);
-        return err;
-    }
-
-    cJSON *json = cJSON_Parse(chunk.memory);
-    if (!json) {
-        free(chunk.memory);
-        return COZE_ERROR_API;
-    }
-
-    char *tmp_msg = NULL;
-    err = parse_response_code(json, &tmp_msg, NULL);
-    resp->msg = tmp_msg;
-    if (err != COZE_OK) {
-        cJSON_Delete(json);
-        free(chunk.memory);
-        return err;
-    }
-
-
-    cJSON_Delete(json);
-    free(chunk.memory);
-
-    return COZE_OK;
+    json_writer_release(&body);
+    return err;
 }
 
 void coze_free_bots_update_response(coze_bots_update_response_t *resp) {
     if (!resp) {
         return;
     }
-    free((void *) resp->msg);
+    ALLOCATOR_SCOPE(resp->response.allocator);
+    coze_free((void *) resp->msg);
     coze_free_response(&resp->response);
 }
 
 coze_error_t coze_bots_publish(const coze_bots_publish_request_t *req,
                                coze_bots_publish_response_t *resp) {
-    if (!req || !resp || !req->api_token) {
+    if (!req || !resp || !REQ_API_TOKEN(req)) {
         return COZE_ERROR_INVALID_PARAM;
     }
-
-    struct MemoryStruct chunk = {0};
-    chunk.memory = malloc(1);
-    chunk.size = 0;
+    ALLOCATOR_SCOPE(client_allocator(req->client));
+    char bot_id_buffer[ID_BUFFER_SIZE];
+    const char *req_bot_id = REQ_ID(req, bot_id, bot_id_buffer);
 
     // 构建完整的 URL
     const char *path = "/v1/bot/publish";
 
-    cJSON *body = cJSON_CreateObject();
-    if (req->bot_id) {
-        cJSON_AddStringToObject(body, "bot_id", req->bot_id);
+    struct json_writer body;
+    json_writer_begin(&body, req->client);
+    if (req_bot_id) {
+        json_writer_string_field(&body, "bot_id", req_bot_id);
     }
-    cJSON *connector_ids = cJSON_CreateArray();
     if (req->connector_ids && req->connector_ids_count > 0) {
+        json_writer_array_field(&body, "connector_ids");
         for (int i = 0; i < req->connector_ids_count; i++) {
-            cJSON *connector_id = cJSON_CreateString(req->connector_ids[i]);
-            cJSON_AddItemToArray(connector_ids, connector_id);
+            json_writer_string(&body, req->connector_ids[i]);
         }
-        cJSON_AddItemToObject(body, "connector_ids", connector_ids);
+        json_writer_array_end(&body);
     }
-    char *json_body = cJSON_PrintUnformatted(body);
-    cJSON_Delete(body);
+    const char *json_body = json_writer_finish(&body);
 
+    const struct json_target target = {
+        .msg = &resp->msg, .data_key = "data", .schema = &bot_schema, .data = &resp->data
+    };
     coze_response_t coze_response = {0};
-    coze_error_t err = make_http_request(req->api_base, req->api_token, path, "POST", json_body, &chunk,
-                                         &coze_response);
+    const coze_error_t err = make_http_json_request(REQ_API_BASE(req), REQ_API_TOKEN(req), REQ_DEADLINE(req), path,
+                                                    "POST", json_body, &target, &coze_response);
     resp->response = coze_response;
-
-    if (err != COZE_OK) {
-        free(chunk.memory);
-        return err;
-    }
-
-    cJSON *json = cJSON_Parse(chunk.memory);
-    if (!json) {
-        free(chunk.memory);
-        return COZE_ERROR_API;
-    }
-
-    char *tmp_msg = NULL;
-    err = parse_response_code(json, &tmp_msg, NULL);
-    resp->msg = tmp_msg;
-    if (err != COZE_OK) {
-        cJSON_Delete(json);
-        free(chunk.memory);
-        return err;
-    }
-
-
-    // 提取数据
-    cJSON *data = cJSON_GetObjectItem(json, "data");
-    coze_bot_t bot_info = {0};
-    if (data) {
-        cJSON *bot_id = cJSON_GetObjectItem(data, "bot_id");
-        cJSON *version = cJSON_GetObjectItem(data, "version");
-
-
-        bot_info.bot_id = bot_id ? strdup(bot_id->valuestring) : NULL;
-        bot_info.version = version ? strdup(version->valuestring) : NULL;
-    }
-    resp->data = bot_info;
-
-
-    cJSON_Delete(json);
-    free(chunk.memory);
-
-    return COZE_OK;
+    json_writer_release(&body);
+    return err;
 }
 
 void coze_free_bots_publish_response(coze_bots_publish_response_t *resp) {
     if (!resp) {
         return;
     }
-    free((void *) resp->msg);
+    ALLOCATOR_SCOPE(resp->response.allocator);
+    coze_free((void *) resp->msg);
     coze_free_response(&resp->response);
     coze_free_bot(&resp->data);
 }
@@ -933,177 +5444,67 @@ void coze_free_bots_publish_response(coze_bots_publish_response_t *resp) {
 
 coze_error_t coze_bots_list(const coze_bots_list_request_t *req,
                             coze_bots_list_response_t *resp) {
-    if (!req || !resp || !req->api_token) {
+    if (!req || !resp || !REQ_API_TOKEN(req)) {
         return COZE_ERROR_INVALID_PARAM;
     }
-
-    struct MemoryStruct chunk = {0};
-    chunk.memory = malloc(1);
-    chunk.size = 0;
+    ALLOCATOR_SCOPE(client_allocator(req->client));
 
     char path[512];
     snprintf(path, sizeof(path),
              "/v1/space/published_bots_list?space_id=%s&page_index=%d&page_size=%d",
              req->space_id, req->page_num, req->page_size);
 
+    const struct json_target target = {
+        .code = &resp->code, .msg = &resp->msg, .data_key = "data", .schema = &bots_list_data_schema,
+        .data = &resp->data, .zero_copy = req->zero_copy, .client = req->client
+    };
     coze_response_t coze_response = {0};
-    coze_error_t err = make_http_request(req->api_base, req->api_token, path, "GET", NULL, &chunk, &coze_response);
+    const coze_error_t err = make_http_json_request(REQ_API_BASE(req), REQ_API_TOKEN(req), REQ_DEADLINE(req), path,
+                                                    "GET", NULL, &target, &coze_response);
     resp->response = coze_response;
-
-    if (err != COZE_OK) {
-        free(chunk.memory);
-        return err;
-    }
-
-    cJSON *json = cJSON_Parse(chunk.memory);
-    if (!json) {
-        free(chunk.memory);
-        return COZE_ERROR_API;
-    }
-
-    char *tmp_msg = NULL;
-    err = parse_response_code(json, &tmp_msg, &resp->code);
-    resp->msg = tmp_msg;
-    if (err != COZE_OK) {
-        cJSON_Delete(json);
-        free(chunk.memory);
-        return err;
-    }
-
-    // 解析数据
-    cJSON *data = cJSON_GetObjectItem(json, "data");
-    coze_bots_list_data_t coze_bots_list_data = {0};
-    if (data) {
-        cJSON *total = cJSON_GetObjectItem(data, "total");
-        if (total) {
-            coze_bots_list_data.total = total->valueint;
-        }
-
-        cJSON *space_bots = cJSON_GetObjectItem(data, "space_bots");
-        if (space_bots) {
-            int space_bot_count = cJSON_GetArraySize(space_bots);
-            coze_bots_list_data.space_bot_count = space_bot_count;
-            coze_bots_list_data.space_bots = calloc(space_bot_count, sizeof(coze_simple_bot_t));
-
-            for (int i = 0; i < space_bot_count; i++) {
-                cJSON *space_bot = cJSON_GetArrayItem(space_bots, i);
-                if (space_bot) {
-                    cJSON *bot_id = cJSON_GetObjectItem(space_bot, "bot_id");
-                    cJSON *bot_name = cJSON_GetObjectItem(space_bot, "bot_name");
-                    cJSON *description = cJSON_GetObjectItem(space_bot, "description");
-                    cJSON *icon_url = cJSON_GetObjectItem(space_bot, "icon_url");
-                    cJSON *publish_time = cJSON_GetObjectItem(space_bot, "publish_time");
-
-                    coze_bots_list_data.space_bots[i].bot_id = bot_id ? strdup(bot_id->valuestring) : NULL;
-                    coze_bots_list_data.space_bots[i].bot_name = bot_name ? strdup(bot_name->valuestring) : NULL;
-                    coze_bots_list_data.space_bots[i].description = description
-                                                                        ? strdup(description->valuestring)
-                                                                        : NULL;
-                    coze_bots_list_data.space_bots[i].icon_url = icon_url ? strdup(icon_url->valuestring) : NULL;
-                    coze_bots_list_data.space_bots[i].publish_time = publish_time
-                                                                         ? strdup(publish_time->valuestring)
-                                                                         : NULL;
-                }
-            }
-        }
-    }
-    resp->data = coze_bots_list_data;
-
-    cJSON_Delete(json);
-    free(chunk.memory);
-
-    return COZE_OK;
+    return err;
 }
 
 void coze_free_bots_list_response(coze_bots_list_response_t *resp) {
     if (!resp) {
         return;
     }
-    free((void *) resp->msg);
-    if (resp->data.space_bots) {
-        for (int i = 0; i < resp->data.space_bot_count; i++) {
-            free((void *) resp->data.space_bots[i].bot_id);
-            free((void *) resp->data.space_bots[i].bot_name);
-            free((void *) resp->data.space_bots[i].description);
-            free((void *) resp->data.space_bots[i].icon_url);
-            free((void *) resp->data.space_bots[i].publish_time);
-        }
-    }
+    ALLOCATOR_SCOPE(resp->response.allocator);
+    coze_free((void *) resp->msg);
+    json_schema_free(&bots_list_data_schema, &resp->data);
     coze_free_response(&resp->response);
 }
 
 coze_error_t coze_bots_retrieve(const coze_bots_retrieve_request_t *req,
                                 coze_bots_retrieve_response_t *resp) {
-    if (!req || !resp || !req->api_token || !req->bot_id) {
+    if (!req || !resp || !REQ_API_TOKEN(req) || !REQ_HAS_ID(req, bot_id)) {
         return COZE_ERROR_INVALID_PARAM;
     }
-
-    struct MemoryStruct chunk = {0};
-    chunk.memory = malloc(1);
-    chunk.size = 0;
+    ALLOCATOR_SCOPE(client_allocator(req->client));
+    char bot_id_buffer[ID_BUFFER_SIZE];
+    const char *req_bot_id = REQ_ID(req, bot_id, bot_id_buffer);
 
     // 构建完整的 URL
     char path[512];
-    snprintf(path, sizeof(path), "/v1/bot/get_online_info?bot_id=%s", req->bot_id);
+    snprintf(path, sizeof(path), "/v1/bot/get_online_info?bot_id=%s", req_bot_id);
 
+    const struct json_target target = {
+        .msg = &resp->msg, .data_key = "data", .schema = &bot_schema, .data = &resp->data
+    };
     coze_response_t coze_response = {0};
-    coze_error_t err = make_http_request(req->api_base, req->api_token, path, "GET", NULL, &chunk, &coze_response);
+    const coze_error_t err = make_http_json_request(REQ_API_BASE(req), REQ_API_TOKEN(req), REQ_DEADLINE(req), path,
+                                                    "GET", NULL, &target, &coze_response);
     resp->response = coze_response;
-
-    if (err != COZE_OK) {
-        free(chunk.memory);
-        return err;
-    }
-
-    cJSON *json = cJSON_Parse(chunk.memory);
-    if (!json) {
-        free(chunk.memory);
-        return COZE_ERROR_API;
-    }
-
-    char *tmp_msg = NULL;
-    err = parse_response_code(json, &tmp_msg, NULL);
-    resp->msg = tmp_msg;
-    if (err != COZE_OK) {
-        cJSON_Delete(json);
-        free(chunk.memory);
-        return err;
-    }
-
-    // 提取数据
-    cJSON *data = cJSON_GetObjectItem(json, "data");
-    coze_bot_t bot_info = {0};
-    if (data) {
-        cJSON *bot_id = cJSON_GetObjectItem(data, "bot_id");
-        cJSON *name = cJSON_GetObjectItem(data, "name");
-        cJSON *description = cJSON_GetObjectItem(data, "description");
-        cJSON *icon_url = cJSON_GetObjectItem(data, "icon_url");
-        cJSON *create_time = cJSON_GetObjectItem(data, "create_time");
-        cJSON *update_time = cJSON_GetObjectItem(data, "update_time");
-        cJSON *version = cJSON_GetObjectItem(data, "version");
-
-        bot_info.bot_id = bot_id ? strdup(bot_id->valuestring) : NULL;
-        bot_info.name = name ? strdup(name->valuestring) : NULL;
-        bot_info.description = description ? strdup(description->valuestring) : NULL;
-        bot_info.icon_url = icon_url ? strdup(icon_url->valuestring) : NULL;
-        bot_info.create_time = create_time ? create_time->valueint : 0;
-        bot_info.update_time = update_time ? update_time->valueint : 0;
-        bot_info.version = version ? strdup(version->valuestring) : NULL;
-    }
-    resp->data = bot_info;
-
-    cJSON_Delete(json);
-    free(chunk.memory);
-
-    return COZE_OK;
+    return err;
 }
 
 void coze_free_bots_retrieve_response(coze_bots_retrieve_response_t *resp) {
     if (!resp) {
         return;
     }
+    ALLOCATOR_SCOPE(resp->response.allocator);
     if (resp->msg) {
-        free((void *) resp->msg);
+        coze_free((void *) resp->msg);
     }
     coze_free_bot(&resp->data);
     coze_free_response(&resp->response);
@@ -1112,178 +5513,97 @@ void coze_free_bots_retrieve_response(coze_bots_retrieve_response_t *resp) {
 
 coze_error_t coze_conversations_create(const coze_conversations_create_request_t *req,
                                        coze_conversations_create_response_t *resp) {
-    if (!req || !resp || !req->api_token) {
+    if (!req || !resp || !REQ_API_TOKEN(req)) {
         return COZE_ERROR_INVALID_PARAM;
     }
-
-    struct MemoryStruct chunk = {0};
-    chunk.memory = malloc(1);
-    chunk.size = 0;
+    ALLOCATOR_SCOPE(client_allocator(req->client));
+    char bot_id_buffer[ID_BUFFER_SIZE];
+    const char *req_bot_id = REQ_ID(req, bot_id, bot_id_buffer);
 
     const char *path = "/v1/conversation/create";
 
     // 构建请求体
-    cJSON *body = cJSON_CreateObject();
-    if (req->bot_id) {
-        cJSON_AddStringToObject(body, "bot_id", req->bot_id);
+    struct json_writer body;
+    json_writer_begin(&body, req->client);
+    if (req_bot_id) {
+        json_writer_string_field(&body, "bot_id", req_bot_id);
     }
     if (req->messages) {
-        cJSON *messages = cJSON_CreateArray();
+        json_writer_array_field(&body, "messages");
         for (int i = 0; i < req->message_count; i++) {
-            cJSON *message = cJSON_CreateObject();
+            json_writer_object_begin(&body);
             if (req->messages[i].role) {
-                cJSON_AddStringToObject(message, "role", req->messages[i].role);
+                json_writer_string_field(&body, "role", req->messages[i].role);
             }
             if (req->messages[i].type) {
-                cJSON_AddStringToObject(message, "type", req->messages[i].type);
-            }
-            if (req->messages[i].content) {
-                cJSON_AddStringToObject(message, "content", req->messages[i].content);
+                json_writer_string_field(&body, "type", req->messages[i].type);
             }
-            if (req->messages[i].content_type) {
-                cJSON_AddStringToObject(message, "content_type", req->messages[i].content_type);
-            }
-            cJSON_AddItemToArray(messages, message);
-        }
-        cJSON_AddItemToObject(body, "messages", messages);
-    }
-    char *json_body = cJSON_PrintUnformatted(body);
-    cJSON_Delete(body);
-
-
-    coze_response_t coze_response = {0};
-    coze_error_t err = make_http_request(req->api_base, req->api_token, path, "POST", json_body, &chunk,
-                                         &coze_response);
-    resp->response = coze_response;
-    free(json_body);
-
-    if (err != COZE_OK) {
-        free(chunk.memory);
-        return err;
-    }
-
-    cJSON *json = cJSON_Parse(chunk.memory);
-    if (!json) {
-        free(chunk.memory);
-        return COZE_ERROR_API;
-    }
-
-    char *tmp_msg = NULL;
-    err = parse_response_code(json, &tmp_msg, &resp->code);
-    resp->msg = tmp_msg;
-    if (err != COZE_OK) {
-        cJSON_Delete(json);
-        free(chunk.memory);
-        return err;
-    }
-
-    // 解析数据
-    cJSON *data = cJSON_GetObjectItem(json, "data");
-    coze_conversation_t conversation_data = {0};
-    if (data) {
-        cJSON *id = cJSON_GetObjectItem(data, "id");
-        cJSON *created_at = cJSON_GetObjectItem(data, "created_at");
-        cJSON *last_section_id = cJSON_GetObjectItem(data, "last_section_id");
-
-        if (id) {
-            conversation_data.id = id ? strdup(id->valuestring) : NULL;
-        }
-        if (created_at) {
-            conversation_data.created_at = created_at ? created_at->valueint : 0;
-        }
-        if (last_section_id) {
-            conversation_data.last_section_id = last_section_id ? strdup(last_section_id->valuestring) : NULL;
+            if (req->messages[i].content) {
+                json_writer_string_field(&body, "content", req->messages[i].content);
+            }
+            if (req->messages[i].content_type) {
+                json_writer_string_field(&body, "content_type", req->messages[i].content_type);
+            }
+            json_writer_object_end(&body);
         }
+        json_writer_array_end(&body);
     }
-    resp->data = conversation_data;
+    const char *json_body = json_writer_finish(&body);
 
-    cJSON_Delete(json);
-    free(chunk.memory);
 
-    return COZE_OK;
+    const struct json_target target = {
+        .code = &resp->code, .msg = &resp->msg, .data_key = "data", .schema = &conversation_schema, .data = &resp->data
+    };
+    coze_response_t coze_response = {0};
+    const coze_error_t err = make_http_json_request(REQ_API_BASE(req), REQ_API_TOKEN(req), REQ_DEADLINE(req), path,
+                                                    "POST", json_body, &target, &coze_response);
+    resp->response = coze_response;
+    json_writer_release(&body);
+    return err;
 }
 
 void coze_free_conversations_create_response(coze_conversations_create_response_t *resp) {
     if (!resp) {
         return;
     }
-    free((void *) resp->msg);
+    ALLOCATOR_SCOPE(resp->response.allocator);
+    coze_free((void *) resp->msg);
     coze_free_response(&resp->response);
     coze_free_conversation(&resp->data);
 }
 
 coze_error_t coze_conversations_retrieve(const coze_conversations_retrieve_request_t *req,
                                          coze_conversations_retrieve_response_t *resp) {
-    if (!req || !resp || !req->api_token) {
+    if (!req || !resp || !REQ_API_TOKEN(req)) {
         return COZE_ERROR_INVALID_PARAM;
     }
-
-    struct MemoryStruct chunk = {0};
-    chunk.memory = malloc(1);
-    chunk.size = 0;
+    ALLOCATOR_SCOPE(client_allocator(req->client));
+    char conversation_id_buffer[ID_BUFFER_SIZE];
+    const char *req_conversation_id = REQ_ID(req, conversation_id, conversation_id_buffer);
 
 
     // 构建 URL
     char path[512];
     snprintf(path, sizeof(path),
              "/v1/conversation/retrieve?conversation_id=%s",
-             req->conversation_id);
+             req_conversation_id);
 
+    const struct json_target target = {
+        .code = &resp->code, .msg = &resp->msg, .data_key = "data", .schema = &conversation_schema, .data = &resp->data
+    };
     coze_response_t coze_response = {0};
-    coze_error_t err = make_http_request(req->api_base, req->api_token, path, "GET", NULL, &chunk, &coze_response);
+    const coze_error_t err = make_http_json_request(REQ_API_BASE(req), REQ_API_TOKEN(req), REQ_DEADLINE(req), path,
+                                                    "GET", NULL, &target, &coze_response);
     resp->response = coze_response;
-
-    if (err != COZE_OK) {
-        free(chunk.memory);
-        return err;
-    }
-
-    cJSON *json = cJSON_Parse(chunk.memory);
-    if (!json) {
-        free(chunk.memory);
-        return COZE_ERROR_API;
-    }
-
-    char *tmp_msg = NULL;
-    err = parse_response_code(json, &tmp_msg, &resp->code);
-    resp->msg = tmp_msg;
-    if (err != COZE_OK) {
-        cJSON_Delete(json);
-        free(chunk.memory);
-        return err;
-    }
-
-    // 解析数据
-    cJSON *data = cJSON_GetObjectItem(json, "data");
-    coze_conversation_t conversation_data = {0};
-    if (data) {
-        cJSON *id = cJSON_GetObjectItem(data, "id");
-        cJSON *created_at = cJSON_GetObjectItem(data, "created_at");
-        cJSON *last_section_id = cJSON_GetObjectItem(data, "last_section_id");
-
-        if (id) {
-            conversation_data.id = id ? strdup(id->valuestring) : NULL;
-        }
-        if (created_at) {
-            conversation_data.created_at = created_at ? created_at->valueint : 0;
-        }
-        if (last_section_id) {
-            conversation_data.last_section_id = last_section_id ? strdup(last_section_id->valuestring) : NULL;
-        }
-    }
-    resp->data = conversation_data;
-
-    cJSON_Delete(json);
-    free(chunk.memory);
-
-    return COZE_OK;
+    return err;
 }
 
 void coze_free_conversations_retrieve_response(coze_conversations_retrieve_response_t *resp) {
     if (!resp) {
         return;
     }
-    free((void *) resp->msg);
+    ALLOCATOR_SCOPE(resp->response.allocator);
+    coze_free((void *) resp->msg);
     coze_free_response(&resp->response);
     coze_free_conversation(&resp->data);
 }
@@ -1291,118 +5611,49 @@ void coze_free_conversations_retrieve_response(coze_conversations_retrieve_respo
 
 coze_error_t coze_conversations_messages_create(const coze_conversations_messages_create_request_t *req,
                                                 coze_conversations_messages_create_response_t *resp) {
-    if (!req || !resp || !req->api_token) {
+    if (!req || !resp || !REQ_API_TOKEN(req)) {
         return COZE_ERROR_INVALID_PARAM;
     }
+    ALLOCATOR_SCOPE(client_allocator(req->client));
+    char conversation_id_buffer[ID_BUFFER_SIZE];
+    const char *req_conversation_id = REQ_ID(req, conversation_id, conversation_id_buffer);
 
-    struct MemoryStruct chunk = {0};
-    chunk.memory = malloc(1);
-    chunk.size = 0;
-
-    cJSON *body = cJSON_CreateObject();
+    struct json_writer body;
+    json_writer_begin(&body, req->client);
     if (req->role) {
-        cJSON_AddStringToObject(body, "role", req->role);
+        json_writer_string_field(&body, "role", req->role);
     }
     if (req->content) {
-        cJSON_AddStringToObject(body, "content", req->content);
+        json_writer_string_field(&body, "content", req->content);
     }
     if (req->content_type) {
-        cJSON_AddStringToObject(body, "content_type", req->content_type);
+        json_writer_string_field(&body, "content_type", req->content_type);
     }
-    char *json_body = cJSON_PrintUnformatted(body);
-    cJSON_Delete(body);
+    const char *json_body = json_writer_finish(&body);
 
     // 构建 URL
     char path[512];
     snprintf(path, sizeof(path),
-             "https://api.coze.cn/v1/conversation/message/create?conversation_id=%s",
-             req->conversation_id);
+             "/v1/conversation/message/create?conversation_id=%s",
+             req_conversation_id);
 
+    const struct json_target target = {
+        .code = &resp->code, .msg = &resp->msg, .data_key = "data", .schema = &message_schema, .data = &resp->data
+    };
     coze_response_t coze_response = {0};
-    coze_error_t err = make_http_request(req->api_base, req->api_token, path, "POST", json_body, &chunk,
-                                         &coze_response);
+    const coze_error_t err = make_http_json_request(REQ_API_BASE(req), REQ_API_TOKEN(req), REQ_DEADLINE(req), path,
+                                                    "POST", json_body, &target, &coze_response);
     resp->response = coze_response;
-    free(json_body);
-
-    if (err != COZE_OK) {
-        free(chunk.memory);
-        return err;
-    }
-
-    cJSON *json = cJSON_Parse(chunk.memory);
-    if (!json) {
-        free(chunk.memory);
-        return COZE_ERROR_API;
-    }
-
-    char *tmp_msg = NULL;
-    err = parse_response_code(json, &tmp_msg, &resp->code);
-    resp->msg = tmp_msg;
-    if (err != COZE_OK) {
-        cJSON_Delete(json);
-        free(chunk.memory);
-        return err;
-    }
-
-    // 解析数据
-    cJSON *data = cJSON_GetObjectItem(json, "data");
-    coze_message_t message_data = {0};
-    if (data) {
-        cJSON *id = cJSON_GetObjectItem(data, "id");
-        cJSON *conversation_id = cJSON_GetObjectItem(data, "conversation_id");
-        cJSON *bot_id = cJSON_GetObjectItem(data, "bot_id");
-        cJSON *chat_id = cJSON_GetObjectItem(data, "chat_id");
-        cJSON *role = cJSON_GetObjectItem(data, "role");
-        cJSON *content = cJSON_GetObjectItem(data, "content");
-        cJSON *content_type = cJSON_GetObjectItem(data, "content_type");
-        cJSON *type = cJSON_GetObjectItem(data, "type");
-        cJSON *created_at = cJSON_GetObjectItem(data, "created_at");
-        cJSON *updated_at = cJSON_GetObjectItem(data, "updated_at");
-
-        if (id) {
-            message_data.id = id ? strdup(id->valuestring) : NULL;
-        }
-        if (conversation_id) {
-            message_data.conversation_id = conversation_id ? strdup(conversation_id->valuestring) : NULL;
-        }
-        if (bot_id) {
-            message_data.bot_id = bot_id ? strdup(bot_id->valuestring) : NULL;
-        }
-        if (chat_id) {
-            message_data.chat_id = chat_id ? strdup(chat_id->valuestring) : NULL;
-        }
-        if (role) {
-            message_data.role = role ? strdup(role->valuestring) : NULL;
-        }
-        if (content) {
-            message_data.content = content ? strdup(content->valuestring) : NULL;
-        }
-        if (content_type) {
-            message_data.content_type = content_type ? strdup(content_type->valuestring) : NULL;
-        }
-        if (type) {
-            message_data.type = type ? strdup(type->valuestring) : NULL;
-        }
-        if (created_at) {
-            message_data.created_at = created_at ? created_at->valueint : 0;
-        }
-        if (updated_at) {
-            message_data.updated_at = updated_at ? updated_at->valueint : 0;
-        }
-    }
-    resp->data = message_data;
-
-    cJSON_Delete(json);
-    free(chunk.memory);
-
-    return COZE_OK;
+    json_writer_release(&body);
+    return err;
 }
 
 void coze_free_conversations_messages_create_response(coze_conversations_messages_create_response_t *resp) {
     if (!resp) {
         return;
     }
-    free((void *) resp->msg);
+    ALLOCATOR_SCOPE(resp->response.allocator);
+    coze_free((void *) resp->msg);
     coze_free_response(&resp->response);
     coze_free_message(&resp->data);
 }
@@ -1410,306 +5661,142 @@ void coze_free_conversations_messages_create_response(coze_conversations_message
 
 coze_error_t coze_conversations_messages_list(const coze_conversations_messages_list_request_t *req,
                                               coze_conversations_messages_list_response_t *resp) {
-    if (!req || !resp || !req->api_token) {
+    if (!req || !resp || !REQ_API_TOKEN(req)) {
         return COZE_ERROR_INVALID_PARAM;
     }
-
-    struct MemoryStruct chunk = {0};
-    chunk.memory = malloc(1);
-    chunk.size = 0;
+    ALLOCATOR_SCOPE(client_allocator(req->client));
+    char conversation_id_buffer[ID_BUFFER_SIZE];
+    const char *req_conversation_id = REQ_ID(req, conversation_id, conversation_id_buffer);
+    char chat_id_buffer[ID_BUFFER_SIZE];
+    const char *req_chat_id = REQ_ID(req, chat_id, chat_id_buffer);
 
     char path[512];
     snprintf(path, sizeof(path),
              "/v1/conversation/message/list?conversation_id=%s",
-             req->conversation_id);
+             req_conversation_id);
 
-    cJSON *body = cJSON_CreateObject();
+    struct json_writer body;
+    json_writer_begin(&body, req->client);
     if (req->order) {
-        cJSON_AddStringToObject(body, "order", req->order);
+        json_writer_string_field(&body, "order", req->order);
     }
-    if (req->chat_id) {
-        cJSON_AddStringToObject(body, "chat_id", req->chat_id);
+    if (req_chat_id) {
+        json_writer_string_field(&body, "chat_id", req_chat_id);
     }
     if (req->before_id) {
-        cJSON_AddStringToObject(body, "before_id", req->before_id);
+        json_writer_string_field(&body, "before_id", req->before_id);
     }
     if (req->after_id) {
-        cJSON_AddStringToObject(body, "after_id", req->after_id);
+        json_writer_string_field(&body, "after_id", req->after_id);
     }
     if (req->limit) {
-        cJSON_AddNumberToObject(body, "limit", req->limit);
+        json_writer_long_field(&body, "limit", req->limit);
     }
-    char *json_body = cJSON_PrintUnformatted(body);
-    cJSON_Delete(body);
+    const char *json_body = json_writer_finish(&body);
 
+    const struct json_target target = {
+        .code = &resp->code, .msg = &resp->msg,
+        .schema = req->columnar ? &conversations_messages_columns_schema : &conversations_messages_list_schema,
+        .data = &resp->data, .zero_copy = req->zero_copy, .client = req->client, .idempotent = true
+    };
     coze_response_t coze_response = {0};
-    coze_error_t err = make_http_request(req->api_base, req->api_token, path, "POST", json_body, &chunk,
-                                         &coze_response);
+    const coze_error_t err = make_http_json_request(REQ_API_BASE(req), REQ_API_TOKEN(req), REQ_DEADLINE(req), path,
+                                                    "POST", json_body, &target, &coze_response);
     resp->response = coze_response;
-    free(json_body);
-    if (err != COZE_OK) {
-        free(chunk.memory);
-        return err;
-    }
-
-    cJSON *json = cJSON_Parse(chunk.memory);
-    if (!json) {
-        free(chunk.memory);
-        return COZE_ERROR_API;
-    }
-
-    char *tmp_msg = NULL;
-    err = parse_response_code(json, &tmp_msg, &resp->code);
-    resp->msg = tmp_msg;
-    if (err != COZE_OK) {
-        cJSON_Delete(json);
-        free(chunk.memory);
-        return err;
-    }
-
-    // 解析数据
-    coze_conversations_messages_list_data_t messages_data = {0};
-    cJSON *has_more = cJSON_GetObjectItem(json, "has_more");
-    if (has_more) {
-        messages_data.has_more = cJSON_IsTrue(has_more);
-    }
-    cJSON *first_id = cJSON_GetObjectItem(json, "first_id");
-    if (first_id) {
-        messages_data.first_id = first_id ? strdup(first_id->valuestring) : NULL;
-    }
-    cJSON *last_id = cJSON_GetObjectItem(json, "last_id");
-    if (last_id) {
-        messages_data.last_id = last_id ? strdup(last_id->valuestring) : NULL;
-    }
-    cJSON *data = cJSON_GetObjectItem(json, "data");
-    if (data) {
-        int messages_count = cJSON_GetArraySize(data);
-        messages_data.messages_count = messages_count;
-        messages_data.messages = calloc(messages_count, sizeof(coze_message_t));
-
-        for (int i = 0; i < messages_count; i++) {
-            cJSON *message = cJSON_GetArrayItem(data, i);
-            if (message) {
-                cJSON *id = cJSON_GetObjectItem(message, "id");
-                cJSON *conversation_id = cJSON_GetObjectItem(message, "conversation_id");
-                cJSON *bot_id = cJSON_GetObjectItem(message, "bot_id");
-                cJSON *chat_id = cJSON_GetObjectItem(message, "chat_id");
-                cJSON *role = cJSON_GetObjectItem(message, "role");
-                cJSON *content = cJSON_GetObjectItem(message, "content");
-                cJSON *content_type = cJSON_GetObjectItem(message, "content_type");
-                cJSON *type = cJSON_GetObjectItem(message, "type");
-                cJSON *created_at = cJSON_GetObjectItem(message, "created_at");
-                cJSON *updated_at = cJSON_GetObjectItem(message, "updated_at");
-
-                messages_data.messages[i].id = id ? strdup(id->valuestring) : NULL;
-                messages_data.messages[i].conversation_id = conversation_id
-                                                                ? strdup(conversation_id->valuestring)
-                                                                : NULL;
-                messages_data.messages[i].bot_id = bot_id ? strdup(bot_id->valuestring) : NULL;
-                messages_data.messages[i].chat_id = chat_id ? strdup(chat_id->valuestring) : NULL;
-                messages_data.messages[i].role = role ? strdup(role->valuestring) : NULL;
-                messages_data.messages[i].content = content ? strdup(content->valuestring) : NULL;
-                messages_data.messages[i].content_type = content_type ? strdup(content_type->valuestring) : NULL;
-                messages_data.messages[i].type = type ? strdup(type->valuestring) : NULL;
-                messages_data.messages[i].created_at = created_at ? created_at->valueint : 0;
-                messages_data.messages[i].updated_at = updated_at ? updated_at->valueint : 0;
-            }
-        }
-    }
-    resp->data = messages_data;
-
-    cJSON_Delete(json);
-    free(chunk.memory);
-
-    return COZE_OK;
+    json_writer_release(&body);
+    return err;
 }
 
 void coze_free_conversations_messages_list_response(coze_conversations_messages_list_response_t *resp) {
     if (!resp) {
         return;
     }
-    free((void *) resp->msg);
+    ALLOCATOR_SCOPE(resp->response.allocator);
+    coze_free((void *) resp->msg);
     coze_free_response(&resp->response);
-    free((void *) resp->data.first_id);
-    free((void *) resp->data.last_id);
-    free((void *) resp->data.has_more);
-    for (int i = 0; i < resp->data.messages_count; i++) {
-        coze_free_message(&resp->data.messages[i]);
-    }
-    free(resp->data.messages);
+    json_schema_free(&conversations_messages_list_schema, &resp->data);
+    json_columns_free(&message_columns_schema, &resp->data.columns);
 }
 
 
 coze_error_t coze_conversations_messages_retrieve(const coze_conversations_messages_retrieve_request_t *req,
                                                   coze_conversations_messages_retrieve_response_t *resp) {
-    if (!req || !resp || !req->api_token) {
+    if (!req || !resp || !REQ_API_TOKEN(req)) {
         return COZE_ERROR_INVALID_PARAM;
     }
-
-    struct MemoryStruct chunk = {0};
-    chunk.memory = malloc(1);
-    chunk.size = 0;
+    ALLOCATOR_SCOPE(client_allocator(req->client));
+    char conversation_id_buffer[ID_BUFFER_SIZE];
+    const char *req_conversation_id = REQ_ID(req, conversation_id, conversation_id_buffer);
+    char message_id_buffer[ID_BUFFER_SIZE];
+    const char *req_message_id = REQ_ID(req, message_id, message_id_buffer);
 
     char path[512];
     snprintf(path, sizeof(path),
              "/v1/conversation/message/retrieve?conversation_id=%s&message_id=%s",
-             req->conversation_id, req->message_id);
+             req_conversation_id, req_message_id);
 
 
+    const struct json_target target = {
+        .code = &resp->code, .msg = &resp->msg, .data_key = "data", .schema = &message_schema, .data = &resp->data
+    };
     coze_response_t coze_response = {0};
-    coze_error_t err = make_http_request(req->api_base, req->api_token, path, "GET", NULL, &chunk, &coze_response);
+    const coze_error_t err = make_http_json_request(REQ_API_BASE(req), REQ_API_TOKEN(req), REQ_DEADLINE(req), path,
+                                                    "GET", NULL, &target, &coze_response);
     resp->response = coze_response;
-
-    if (err != COZE_OK) {
-        free(chunk.memory);
-        return err;
-    }
-
-    cJSON *json = cJSON_Parse(chunk.memory);
-    if (!json) {
-        free(chunk.memory);
-        return COZE_ERROR_API;
-    }
-
-    char *tmp_msg = NULL;
-    err = parse_response_code(json, &tmp_msg, &resp->code);
-    resp->msg = tmp_msg;
-    if (err != COZE_OK) {
-        cJSON_Delete(json);
-        free(chunk.memory);
-        return err;
-    }
-
-    // 解析数据
-    coze_message_t message_data = {0};
-    cJSON *data = cJSON_GetObjectItem(json, "data");
-    if (data) {
-        cJSON *id = cJSON_GetObjectItem(data, "id");
-        cJSON *conversation_id = cJSON_GetObjectItem(data, "conversation_id");
-        cJSON *bot_id = cJSON_GetObjectItem(data, "bot_id");
-        cJSON *chat_id = cJSON_GetObjectItem(data, "chat_id");
-        cJSON *role = cJSON_GetObjectItem(data, "role");
-        cJSON *content = cJSON_GetObjectItem(data, "content");
-        cJSON *content_type = cJSON_GetObjectItem(data, "content_type");
-        cJSON *type = cJSON_GetObjectItem(data, "type");
-        cJSON *created_at = cJSON_GetObjectItem(data, "created_at");
-        cJSON *updated_at = cJSON_GetObjectItem(data, "updated_at");
-
-        message_data.id = id ? strdup(id->valuestring) : NULL;
-        message_data.conversation_id = conversation_id ? strdup(conversation_id->valuestring) : NULL;
-        message_data.bot_id = bot_id ? strdup(bot_id->valuestring) : NULL;
-        message_data.chat_id = chat_id ? strdup(chat_id->valuestring) : NULL;
-        message_data.role = role ? strdup(role->valuestring) : NULL;
-        message_data.content = content ? strdup(content->valuestring) : NULL;
-        message_data.content_type = content_type ? strdup(content_type->valuestring) : NULL;
-        message_data.type = type ? strdup(type->valuestring) : NULL;
-        message_data.created_at = created_at ? created_at->valueint : 0;
-        message_data.updated_at = updated_at ? updated_at->valueint : 0;
-    }
-    resp->data = message_data;
-
-    cJSON_Delete(json);
-    free(chunk.memory);
-
-    return COZE_OK;
+    return err;
 }
 
 void coze_free_conversations_messages_retrieve_response(coze_conversations_messages_retrieve_response_t *resp) {
     if (!resp) return;
+    ALLOCATOR_SCOPE(resp->response.allocator);
 
-    free((void *) resp->msg);
+    coze_free((void *) resp->msg);
     coze_free_response(&resp->response);
     coze_free_message(&resp->data);
 }
 
 coze_error_t coze_conversations_messages_update(const coze_conversations_messages_update_request_t *req,
                                                 coze_conversations_messages_update_response_t *resp) {
-    if (!req || !resp || !req->api_token) {
+    if (!req || !resp || !REQ_API_TOKEN(req)) {
         return COZE_ERROR_INVALID_PARAM;
     }
-
-    struct MemoryStruct chunk = {0};
-    chunk.memory = malloc(1);
-    chunk.size = 0;
+    ALLOCATOR_SCOPE(client_allocator(req->client));
+    char conversation_id_buffer[ID_BUFFER_SIZE];
+    const char *req_conversation_id = REQ_ID(req, conversation_id, conversation_id_buffer);
+    char message_id_buffer[ID_BUFFER_SIZE];
+    const char *req_message_id = REQ_ID(req, message_id, message_id_buffer);
 
     char path[512];
     snprintf(path, sizeof(path),
              "/v1/conversation/message/modify?conversation_id=%s&message_id=%s",
-             req->conversation_id, req->message_id);
+             req_conversation_id, req_message_id);
 
-    cJSON *body = cJSON_CreateObject();
+    struct json_writer body;
+    json_writer_begin(&body, req->client);
     if (req->content) {
-        cJSON_AddStringToObject(body, "content", req->content);
+        json_writer_string_field(&body, "content", req->content);
     }
     if (req->content_type) {
-        cJSON_AddStringToObject(body, "content_type", req->content_type);
+        json_writer_string_field(&body, "content_type", req->content_type);
     }
-    char *json_body = cJSON_PrintUnformatted(body);
-    cJSON_Delete(body);
+    const char *json_body = json_writer_finish(&body);
 
+    const struct json_target target = {
+        .code = &resp->code, .msg = &resp->msg, .data_key = "message", .schema = &message_schema, .data = &resp->data
+    };
     coze_response_t coze_response = {0};
-    coze_error_t err = make_http_request(req->api_base, req->api_token, path, "POST", json_body, &chunk,
-                                         &coze_response);
+    const coze_error_t err = make_http_json_request(REQ_API_BASE(req), REQ_API_TOKEN(req), REQ_DEADLINE(req), path,
+                                                    "POST", json_body, &target, &coze_response);
     resp->response = coze_response;
-    free(json_body);
-    if (err != COZE_OK) {
-        free(chunk.memory);
-        return err;
-    }
-
-    cJSON *json = cJSON_Parse(chunk.memory);
-    if (!json) {
-        free(chunk.memory);
-        return COZE_ERROR_API;
-    }
-
-    char *tmp_msg = NULL;
-    err = parse_response_code(json, &tmp_msg, &resp->code);
-    resp->msg = tmp_msg;
-    if (err != COZE_OK) {
-        cJSON_Delete(json);
-        free(chunk.memory);
-        return err;
-    }
-
-    // 解析数据
-    coze_message_t message_data = {0};
-    const cJSON *data = cJSON_GetObjectItem(json, "message");
-    if (data) {
-        const cJSON *id = cJSON_GetObjectItem(data, "id");
-        const cJSON *conversation_id = cJSON_GetObjectItem(data, "conversation_id");
-        const cJSON *bot_id = cJSON_GetObjectItem(data, "bot_id");
-        const cJSON *chat_id = cJSON_GetObjectItem(data, "chat_id");
-        const cJSON *role = cJSON_GetObjectItem(data, "role");
-        const cJSON *content = cJSON_GetObjectItem(data, "content");
-        const cJSON *content_type = cJSON_GetObjectItem(data, "content_type");
-        const cJSON *type = cJSON_GetObjectItem(data, "type");
-        const cJSON *created_at = cJSON_GetObjectItem(data, "created_at");
-        const cJSON *updated_at = cJSON_GetObjectItem(data, "updated_at");
-
-        message_data.id = id ? strdup(id->valuestring) : NULL;
-        message_data.conversation_id = conversation_id ? strdup(conversation_id->valuestring) : NULL;
-        message_data.bot_id = bot_id ? strdup(bot_id->valuestring) : NULL;
-        message_data.chat_id = chat_id ? strdup(chat_id->valuestring) : NULL;
-        message_data.role = role ? strdup(role->valuestring) : NULL;
-        message_data.content = content ? strdup(content->valuestring) : NULL;
-        message_data.content_type = content_type ? strdup(content_type->valuestring) : NULL;
-        message_data.type = type ? strdup(type->valuestring) : NULL;
-        message_data.created_at = created_at ? created_at->valueint : 0;
-        message_data.updated_at = updated_at ? updated_at->valueint : 0;
-    }
-    resp->data = message_data;
-
-    cJSON_Delete(json);
-    free(chunk.memory);
-
-    return COZE_OK;
+    json_writer_release(&body);
+    return err;
 }
 
 void coze_free_conversations_messages_update_response(coze_conversations_messages_update_response_t *resp) {
     if (!resp) return;
+    ALLOCATOR_SCOPE(resp->response.allocator);
 
-    free((void *) resp->msg);
+    coze_free((void *) resp->msg);
     coze_free_response(&resp->response);
     coze_free_message(&resp->data);
 }
@@ -1717,189 +5804,105 @@ void coze_free_conversations_messages_update_response(coze_conversations_message
 
 coze_error_t coze_conversations_messages_delete(const coze_conversations_messages_delete_request_t *req,
                                                 coze_conversations_messages_delete_response_t *resp) {
-    if (!req || !resp || !req->api_token) {
+    if (!req || !resp || !REQ_API_TOKEN(req)) {
         return COZE_ERROR_INVALID_PARAM;
     }
-
-    struct MemoryStruct chunk = {0};
-    chunk.memory = malloc(1);
-    chunk.size = 0;
+    ALLOCATOR_SCOPE(client_allocator(req->client));
+    char conversation_id_buffer[ID_BUFFER_SIZE];
+    const char *req_conversation_id = REQ_ID(req, conversation_id, conversation_id_buffer);
+    char message_id_buffer[ID_BUFFER_SIZE];
+    const char *req_message_id = REQ_ID(req, message_id, message_id_buffer);
 
     char path[512];
     snprintf(path, sizeof(path),
              "/v1/conversation/message/delete?conversation_id=%s&message_id=%s",
-             req->conversation_id, req->message_id);
+             req_conversation_id, req_message_id);
 
 
+    const struct json_target target = {
+        .code = &resp->code, .msg = &resp->msg, .data_key = "data", .schema = &message_schema, .data = &resp->data
+    };
     coze_response_t coze_response = {0};
-    coze_error_t err = make_http_request(req->api_base, req->api_token, path, "POST", NULL, &chunk, &coze_response);
+    const coze_error_t err = make_http_json_request(REQ_API_BASE(req), REQ_API_TOKEN(req), REQ_DEADLINE(req), path,
+                                                    "POST", NULL, &target, &coze_response);
     resp->response = coze_response;
-
-    if (err != COZE_OK) {
-        free(chunk.memory);
-        return err;
-    }
-
-    cJSON *json = cJSON_Parse(chunk.memory);
-    if (!json) {
-        free(chunk.memory);
-        return COZE_ERROR_API;
-    }
-
-    char *tmp_msg = NULL;
-    err = parse_response_code(json, &tmp_msg, &resp->code);
-    resp->msg = tmp_msg;
-    if (err != COZE_OK) {
-        cJSON_Delete(json);
-        free(chunk.memory);
-        return err;
-    }
-
-    // 解析数据
-    coze_message_t message_data = {0};
-    const cJSON *data = cJSON_GetObjectItem(json, "data");
-    if (data) {
-        const cJSON *id = cJSON_GetObjectItem(data, "id");
-        const cJSON *conversation_id = cJSON_GetObjectItem(data, "conversation_id");
-        const cJSON *bot_id = cJSON_GetObjectItem(data, "bot_id");
-        const cJSON *chat_id = cJSON_GetObjectItem(data, "chat_id");
-        const cJSON *role = cJSON_GetObjectItem(data, "role");
-        const cJSON *content = cJSON_GetObjectItem(data, "content");
-        const cJSON *content_type = cJSON_GetObjectItem(data, "content_type");
-        const cJSON *type = cJSON_GetObjectItem(data, "type");
-        const cJSON *created_at = cJSON_GetObjectItem(data, "created_at");
-        const cJSON *updated_at = cJSON_GetObjectItem(data, "updated_at");
-
-        message_data.id = id ? strdup(id->valuestring) : NULL;
-        message_data.conversation_id = conversation_id ? strdup(conversation_id->valuestring) : NULL;
-        message_data.bot_id = bot_id ? strdup(bot_id->valuestring) : NULL;
-        message_data.chat_id = chat_id ? strdup(chat_id->valuestring) : NULL;
-        message_data.role = role ? strdup(role->valuestring) : NULL;
-        message_data.content = content ? strdup(content->valuestring) : NULL;
-        message_data.content_type = content_type ? strdup(content_type->valuestring) : NULL;
-        message_data.type = type ? strdup(type->valuestring) : NULL;
-        message_data.created_at = created_at ? created_at->valueint : 0;
-        message_data.updated_at = updated_at ? updated_at->valueint : 0;
-    }
-    resp->data = message_data;
-
-    cJSON_Delete(json);
-    free(chunk.memory);
-
-    return COZE_OK;
+    return err;
 }
 
 void coze_free_conversations_messages_delete_response(coze_conversations_messages_delete_response_t *resp) {
     if (!resp) return;
+    ALLOCATOR_SCOPE(resp->response.allocator);
 
-    free((void *) resp->msg);
+    coze_free((void *) resp->msg);
     coze_free_response(&resp->response);
     coze_free_message(&resp->data);
 }
 
 coze_error_t coze_chat_create(const coze_chat_create_request_t *req,
                               coze_chat_create_response_t *resp) {
-    if (!req || !resp || !req->api_token) {
+    if (!req || !resp || !REQ_API_TOKEN(req)) {
         return COZE_ERROR_INVALID_PARAM;
     }
-
-    struct MemoryStruct chunk = {0};
-    chunk.memory = malloc(1);
-    chunk.size = 0;
+    ALLOCATOR_SCOPE(client_allocator(req->client));
+    char bot_id_buffer[ID_BUFFER_SIZE];
+    const char *req_bot_id = REQ_ID(req, bot_id, bot_id_buffer);
+    char conversation_id_buffer[ID_BUFFER_SIZE];
+    const char *req_conversation_id = REQ_ID(req, conversation_id, conversation_id_buffer);
 
     char path[512];
     snprintf(path, sizeof(path), "/v3/chat%s%s",
-             req->conversation_id ? "?conversation_id=" : "",
-             req->conversation_id ? req->conversation_id : "");
+             req_conversation_id ? "?conversation_id=" : "",
+             req_conversation_id ? req_conversation_id : "");
 
 
-    cJSON *body = cJSON_CreateObject();
-    if (req->bot_id) {
-        cJSON_AddStringToObject(body, "bot_id", req->bot_id);
+    struct json_writer body;
+    json_writer_begin(&body, req->client);
+    if (req_bot_id) {
+        json_writer_string_field(&body, "bot_id", req_bot_id);
     }
     if (req->user_id) {
-        cJSON_AddStringToObject(body, "user_id", req->user_id);
+        json_writer_string_field(&body, "user_id", req->user_id);
     }
     if (req->additional_messages && req->additional_messages_count > 0) {
-        cJSON *additional_messages_array = cJSON_CreateArray();
+        json_writer_array_field(&body, "additional_messages");
         for (size_t i = 0; i < req->additional_messages_count; i++) {
-            cJSON *message_obj = cJSON_CreateObject();
+            json_writer_object_begin(&body);
             if (req->additional_messages[i].role) {
-                cJSON_AddStringToObject(message_obj, "role", req->additional_messages[i].role);
+                json_writer_string_field(&body, "role", req->additional_messages[i].role);
             }
             if (req->additional_messages[i].type) {
-                cJSON_AddStringToObject(message_obj, "type", req->additional_messages[i].type);
+                json_writer_string_field(&body, "type", req->additional_messages[i].type);
             }
             if (req->additional_messages[i].content) {
-                cJSON_AddStringToObject(message_obj, "content", req->additional_messages[i].content);
+                json_writer_string_field(&body, "content", req->additional_messages[i].content);
             }
             if (req->additional_messages[i].content_type) {
-                cJSON_AddStringToObject(message_obj, "content_type", req->additional_messages[i].content_type);
+                json_writer_string_field(&body, "content_type", req->additional_messages[i].content_type);
             }
-            cJSON_AddItemToArray(additional_messages_array, message_obj);
+            json_writer_object_end(&body);
         }
-        cJSON_AddItemToObject(body, "additional_messages", additional_messages_array);
+        json_writer_array_end(&body);
     }
-    cJSON_AddFalseToObject(body, "stream");
-    cJSON_AddTrueToObject(body, "auto_save_history");
-    char *json_body = cJSON_PrintUnformatted(body);
-    cJSON_Delete(body);
+    json_writer_bool_field(&body, "stream", false);
+    json_writer_bool_field(&body, "auto_save_history", true);
+    const char *json_body = json_writer_finish(&body);
 
+    const struct json_target target = {
+        .code = &resp->code, .msg = &resp->msg, .data_key = "data", .schema = &chat_schema, .data = &resp->data
+    };
     coze_response_t coze_response = {0};
-    coze_error_t err = make_http_request(req->api_base, req->api_token, path, "POST", json_body, &chunk,
-                                         &coze_response);
+    const coze_error_t err = make_http_json_request(REQ_API_BASE(req), REQ_API_TOKEN(req), REQ_DEADLINE(req), path,
+                                                    "POST", json_body, &target, &coze_response);
     resp->response = coze_response;
-    free(json_body);
-    if (err != COZE_OK) {
-        free(chunk.memory);
-        return err;
-    }
-
-    cJSON *json = cJSON_Parse(chunk.memory);
-    if (!json) {
-        free(chunk.memory);
-        return COZE_ERROR_API;
-    }
-
-    char *tmp_msg = NULL;
-    err = parse_response_code(json, &tmp_msg, &resp->code);
-    resp->msg = tmp_msg;
-    if (err != COZE_OK) {
-        cJSON_Delete(json);
-        free(chunk.memory);
-        return err;
-    }
-
-    // 解析数据
-    coze_chat_t chat_data = {0};
-    const cJSON *data = cJSON_GetObjectItem(json, "data");
-    if (data) {
-        const cJSON *id = cJSON_GetObjectItem(data, "id");
-        const cJSON *conversation_id = cJSON_GetObjectItem(data, "conversation_id");
-        const cJSON *bot_id = cJSON_GetObjectItem(data, "bot_id");
-        const cJSON *created_at = cJSON_GetObjectItem(data, "created_at");
-        const cJSON *completed_at = cJSON_GetObjectItem(data, "completed_at");
-        const cJSON *status = cJSON_GetObjectItem(data, "status");
-
-        chat_data.id = id ? strdup(id->valuestring) : NULL;
-        chat_data.conversation_id = conversation_id ? strdup(conversation_id->valuestring) : NULL;
-        chat_data.bot_id = bot_id ? strdup(bot_id->valuestring) : NULL;
-        chat_data.created_at = created_at ? created_at->valueint : 0;
-        chat_data.completed_at = completed_at ? completed_at->valueint : 0;
-        chat_data.status = status ? strdup(status->valuestring) : NULL;
-    }
-    resp->data = chat_data;
-
-    cJSON_Delete(json);
-    free(chunk.memory);
-
-    return COZE_OK;
+    json_writer_release(&body);
+    return err;
 }
 
 void coze_free_chat_create_response(coze_chat_create_response_t *resp) {
     if (!resp) return;
+    ALLOCATOR_SCOPE(resp->response.allocator);
 
-    free((void *) resp->msg);
+    coze_free((void *) resp->msg);
     coze_free_response(&resp->response);
     coze_free_chat(&resp->data);
 }
@@ -1909,166 +5912,550 @@ struct ChatSSECallbackContext {
     void (*callback)(const coze_chat_event_t *chat_event);
 };
 
-void chat_stream_handler(const char *data, void *biz_ctx) {
-    pure_log("data", data);
+static void free_chat_event(coze_chat_event_t *event) {
+    if (!event) return;
+
+    intern_free(event->event, event->event_kind);
+    if (event->message) {
+        coze_free_message(event->message);
+        coze_free(event->message);
+    }
+    if (event->chat) {
+        coze_free_chat(event->chat);
+        coze_free(event->chat);
+    }
+    coze_free(event);
+}
+
+void chat_stream_handler(const struct sse_event *sse, void *biz_ctx) {
     const struct ChatSSECallbackContext *ctx = (struct ChatSSECallbackContext *) biz_ctx;
+    const char *event = sse->event;
+    char *sse_data = sse->data;
+    pure_log(event ? event : "data", sse_data ? sse_data : "");
+
+    if (!event || !sse_data || !ctx || !ctx->callback) {
+        return;
+    }
+
+    // 在堆上创建事件
+    coze_chat_event_t *event_data = coze_calloc(1, sizeof(coze_chat_event_t));
+    INTERN_FIELD(*event_data, event, event_types, event);
+    const coze_event_type_kind_t event_kind = event_data->event_kind;
+
+    if (event_kind == COZE_EVENT_TYPE_KIND_DONE) {
+    } else if (event_kind == COZE_EVENT_TYPE_KIND_ERROR) {
+        COZE_LOG("SSE error: %s\n", sse_data);
+    } else if (event_kind == COZE_EVENT_TYPE_KIND_CONVERSATION_MESSAGE_DELTA ||
+               event_kind == COZE_EVENT_TYPE_KIND_CONVERSATION_MESSAGE_COMPLETED ||
+               event_kind == COZE_EVENT_TYPE_KIND_CONVERSATION_AUDIO_DELTA) {
+        event_data->message = json_decode_event(sse_data, &message_schema, sizeof(coze_message_t));
+    } else if (event_kind == COZE_EVENT_TYPE_KIND_CONVERSATION_CHAT_CREATED ||
+               event_kind == COZE_EVENT_TYPE_KIND_CONVERSATION_CHAT_IN_PROGRESS ||
+               event_kind == COZE_EVENT_TYPE_KIND_CONVERSATION_CHAT_COMPLETED ||
+               event_kind == COZE_EVENT_TYPE_KIND_CONVERSATION_CHAT_FAILED ||
+               event_kind == COZE_EVENT_TYPE_KIND_CONVERSATION_CHAT_REQUIRES_ACTION) {
+        event_data->chat = json_decode_event(sse_data, &chat_schema, sizeof(coze_chat_t));
+    }
+
+    if (ctx->callback) {
+        ALLOCATOR_SCOPE(NULL); // 用户回调中分配的内存不属于本客户端
+        ctx->callback(event_data);
+    }
+
+    // 事件只在回调期间有效, 回调返回后释放
+    free_chat_event(event_data);
+}
+
+// hedge 为 true 时是首 token 对冲的第二个流, 不保存历史
+static const char *chat_stream_body(struct json_writer *body, const coze_chat_stream_request_t *req,
+                                    const char *bot_id, bool hedge) {
+    if (bot_id) {
+        json_writer_string_field(body, "bot_id", bot_id);
+    }
+    if (req->user_id) {
+        json_writer_string_field(body, "user_id", req->user_id);
+    }
+    if (req->additional_messages && req->additional_messages_count > 0) {
+        json_writer_array_field(body, "additional_messages");
+        for (size_t i = 0; i < req->additional_messages_count; i++) {
+            json_writer_object_begin(body);
+            if (req->additional_messages[i].role) {
+                json_writer_string_field(body, "role", req->additional_messages[i].role);
+            }
+            if (req->additional_messages[i].type) {
+                json_writer_string_field(body, "type", req->additional_messages[i].type);
+            }
+            if (req->additional_messages[i].content) {
+                json_writer_string_field(body, "content", req->additional_messages[i].content);
+            }
+            if (req->additional_messages[i].content_type) {
+                json_writer_string_field(body, "content_type", req->additional_messages[i].content_type);
+            }
+            json_writer_object_end(body);
+        }
+        json_writer_array_end(body);
+    }
+    json_writer_bool_field(body, "stream", true);
+    if (hedge) {
+        json_writer_bool_field(body, "auto_save_history", false);
+    } else if (req->auto_save_history) {
+        json_writer_bool_field(body, "auto_save_history", req->auto_save_history);
+    }
+    return json_writer_finish(body);
+}
+
+// *** chat stream hedging ***
+
+// 首 token 对冲: 主流超过 hedge_ttft_ms 还没有 conversation.message.delta 时, 再开一个不保存历史的流,
+// 先出 delta 的流胜出。胜出前两个流的事件都先缓存, 胜出后补发胜者缓存的事件, 之后直接交给 chat_stream_handler;
+// 败者收到 conversation.chat.created (拿到 chat_id) 后中止连接, 并立即在同一个 multi 里发出 /v3/chat/cancel,
+// 不等胜者的流结束; 取消请求和两个流共用一个熔断凭证和限流许可。
+struct chat_hedge;
+
+struct chat_hedge_stream {
+    struct chat_hedge *hedge;
+    CURL *curl;
+    coze_transport_sink_t sink;
+    coze_response_t response; // 胜者的 logid 交给调用方
+    struct SSEContext ctx;
+    char *events; // 胜出前缓存的事件, 每个为 u32 长度 + 内容, 依次为 id/event/data, 各自以 '\0' 结尾
+    size_t events_len;
+    size_t events_capacity;
+    char conversation_id[64]; // 来自 conversation.chat.created, 败者据此取消
+    char chat_id[64];
+    bool abort; // 败者已拿到 chat_id 或不再需要, 写回调返回 0 中止传输
+    bool done;
+    CURLcode result;
+    CURL *cancel; // 败者的取消请求, NULL 表示还没有发出
+    struct curl_slist *cancel_headers;
+    char *cancel_url;
+    struct json_writer cancel_body;
+    bool cancel_tried;
+    bool cancel_done;
+};
 
-    char *event = NULL;
-    char *sse_data = NULL;
-    char *line = (char *) data;
-    char *next_line;
+struct chat_hedge {
+    struct ChatSSECallbackContext *biz_ctx;
+    struct chat_hedge_stream streams[2];
+    int count;
+    struct chat_hedge_stream *winner;
+};
 
-    // Parse event: or data: prefix
-    char *saveptr;
-    char *line_copy = strdup(line);
-    char *curr_line = strtok_r(line_copy, "\n", &saveptr);
-    while (curr_line) {
-        if (strncmp(curr_line, "event:", 6) == 0) {
-            event = strdup(curr_line + 6);
-        } else if (strncmp(curr_line, "data:", 5) == 0) {
-            sse_data = strdup(curr_line + 5);
+static bool chat_hedge_buffer_field(struct chat_hedge_stream *stream, const char *value, size_t len) {
+    const uint32_t field_len = value ? (uint32_t) len + 1 : 0; // 0 表示 NULL
+    if (stream->events_len + sizeof(field_len) + field_len > stream->events_capacity) {
+        const size_t capacity = (stream->events_len + sizeof(field_len) + field_len) * 2;
+        char *events = coze_realloc(stream->events, capacity);
+        if (!events) {
+            return false;
         }
+        stream->events = events;
+        stream->events_capacity = capacity;
+    }
+    memcpy(stream->events + stream->events_len, &field_len, sizeof(field_len));
+    if (value) {
+        memcpy(stream->events + stream->events_len + sizeof(field_len), value, len);
+        stream->events[stream->events_len + sizeof(field_len) + len] = '\0';
+    }
+    stream->events_len += sizeof(field_len) + field_len;
+    return true;
+}
+
+static const char *chat_hedge_read_field(const struct chat_hedge_stream *stream, size_t *offset, size_t *len) {
+    uint32_t field_len;
+    memcpy(&field_len, stream->events + *offset, sizeof(field_len));
+    char *value = field_len ? stream->events + *offset + sizeof(field_len) : NULL;
+    *offset += sizeof(field_len) + field_len;
+    *len = field_len ? field_len - 1 : 0;
+    return value;
+}
 
-        curr_line = strtok_r(NULL, "\n", &saveptr);
+// 选出胜者并补发它缓存的事件
+static void chat_hedge_claim(struct chat_hedge *hedge, struct chat_hedge_stream *winner) {
+    hedge->winner = winner;
+    for (size_t offset = 0; offset < winner->events_len;) {
+        size_t len;
+        struct sse_event sse;
+        sse.id = chat_hedge_read_field(winner, &offset, &len);
+        sse.event = chat_hedge_read_field(winner, &offset, &len);
+        sse.data = (char *) chat_hedge_read_field(winner, &offset, &len);
+        sse.data_len = len;
+        chat_stream_handler(&sse, hedge->biz_ctx);
+    }
+    for (int i = 0; i < hedge->count; i++) {
+        struct chat_hedge_stream *stream = &hedge->streams[i];
+        if (stream != winner && stream->chat_id[0]) {
+            stream->abort = true;
+        }
     }
-    free(line_copy);
+}
 
-    if (!event || !sse_data || !ctx || !ctx->callback) {
-        if (event) free(event);
-        if (sse_data) free(sse_data);
+static void chat_hedge_event(const struct sse_event *sse, void *biz_ctx) {
+    struct chat_hedge_stream *stream = biz_ctx;
+    struct chat_hedge *hedge = stream->hedge;
+    if (hedge->winner == stream) {
+        chat_stream_handler(sse, hedge->biz_ctx);
+        return;
+    }
+    const bool created = sse->event && sse->data && strcmp(sse->event, COZE_EVENT_TYPE_CONVERSATION_CHAT_CREATED) == 0;
+    if (!hedge->winner && sse->event && strcmp(sse->event, COZE_EVENT_TYPE_CONVERSATION_MESSAGE_DELTA) == 0) {
+        chat_hedge_claim(hedge, stream);
+        chat_stream_handler(sse, hedge->biz_ctx);
         return;
     }
+    if (!hedge->winner && !(chat_hedge_buffer_field(stream, sse->id, sse->id ? strlen(sse->id) : 0) &&
+                            chat_hedge_buffer_field(stream, sse->event, sse->event ? strlen(sse->event) : 0) &&
+                            chat_hedge_buffer_field(stream, sse->data, sse->data_len))) {
+        stream->abort = true;
+        return;
+    }
+    if (created && !stream->chat_id[0]) {
+        // 缓存之后再解码, 解码会原地改写 data
+        coze_chat_t *chat = json_decode_event(sse->data, &chat_schema, sizeof(coze_chat_t));
+        if (chat && chat->id && chat->conversation_id && strlen(chat->id) < sizeof(stream->chat_id) &&
+            strlen(chat->conversation_id) < sizeof(stream->conversation_id)) {
+            strcpy(stream->chat_id, chat->id);
+            strcpy(stream->conversation_id, chat->conversation_id);
+        }
+        if (chat) {
+            coze_free_chat(chat);
+            coze_free(chat);
+        }
+        stream->abort = hedge->winner != NULL;
+    }
+}
 
-    // 在堆上创建事件
-    coze_chat_event_t *event_data = calloc(1, sizeof(coze_chat_event_t));
-    event_data->event = strdup(event);
-
-    if (strcmp(event, COZE_EVENT_TYPE_DONE) == 0) {
-    } else if (strcmp(event, COZE_EVENT_TYPE_ERROR) == 0) {
-        printf("[coze_api] SSE error: %s\n", sse_data);
-    } else if (strcmp(event, COZE_EVENT_TYPE_CONVERSATION_MESSAGE_DELTA) == 0 ||
-               strcmp(event, COZE_EVENT_TYPE_CONVERSATION_MESSAGE_COMPLETED) == 0 ||
-               strcmp(event, COZE_EVENT_TYPE_CONVERSATION_AUDIO_DELTA) == 0) {
-        cJSON *json_data = cJSON_Parse(sse_data);
-        if (json_data) {
-            coze_message_t *message = calloc(1, sizeof(coze_message_t));
-            const cJSON *id = cJSON_GetObjectItem(json_data, "id");
-            const cJSON *conversation_id = cJSON_GetObjectItem(json_data, "conversation_id");
-            const cJSON *bot_id = cJSON_GetObjectItem(json_data, "bot_id");
-            const cJSON *chat_id = cJSON_GetObjectItem(json_data, "chat_id");
-            const cJSON *role = cJSON_GetObjectItem(json_data, "role");
-            const cJSON *content = cJSON_GetObjectItem(json_data, "content");
-            const cJSON *content_type = cJSON_GetObjectItem(json_data, "content_type");
-            const cJSON *type = cJSON_GetObjectItem(json_data, "type");
-            const cJSON *created_at = cJSON_GetObjectItem(json_data, "created_at");
-            const cJSON *updated_at = cJSON_GetObjectItem(json_data, "updated_at");
-
-            message->id = id ? strdup(id->valuestring) : NULL;
-            message->conversation_id = conversation_id ? strdup(conversation_id->valuestring) : NULL;
-            message->bot_id = bot_id ? strdup(bot_id->valuestring) : NULL;
-            message->chat_id = chat_id ? strdup(chat_id->valuestring) : NULL;
-            message->role = role ? strdup(role->valuestring) : NULL;
-            message->content = content ? strdup(content->valuestring) : NULL;
-            message->content_type = content_type ? strdup(content_type->valuestring) : NULL;
-            message->type = type ? strdup(type->valuestring) : NULL;
-            message->created_at = created_at ? created_at->valueint : 0;
-            message->updated_at = updated_at ? updated_at->valueint : 0;
+static size_t chat_hedge_header_callback(char *buffer, size_t size, size_t nitems, void *userdata) {
+    struct chat_hedge_stream *stream = userdata;
+    return stream->abort ? 0 : coze_transport_sink_header(&stream->sink, buffer, size * nitems);
+}
 
-            cJSON_Delete(json_data);
-            event_data->message = message;
+static size_t chat_hedge_write_callback(char *contents, size_t size, size_t nmemb, void *userp) {
+    struct chat_hedge_stream *stream = userp;
+    if (stream->abort) {
+        return 0;
+    }
+    const size_t written = coze_transport_sink_body(&stream->sink, contents, size * nmemb);
+    return stream->abort ? 0 : written;
+}
+
+// 失败时 curl 仍归调用方
+static bool chat_hedge_start(struct chat_hedge *hedge, CURLM *multi, CURL *curl, const coze_transport_request_t *req,
+                             struct curl_slist *headers) {
+    if (!curl) {
+        return false;
+    }
+    struct chat_hedge_stream *stream = &hedge->streams[hedge->count];
+    stream->hedge = hedge;
+    stream->ctx.sse_event_callback = chat_hedge_event;
+    stream->ctx.biz_ctx = stream;
+    stream->response.allocator = t_allocator;
+    stream->sink = (coze_transport_sink_t){
+        .coze_response = &stream->response,
+        .write_body = sse_write_callback,
+        .body_userp = &stream->ctx,
+    };
+    stream->curl = curl;
+    curl_request_setup(curl, req, headers, chat_hedge_header_callback, chat_hedge_write_callback, stream);
+    curl_easy_setopt(curl, CURLOPT_PRIVATE, stream);
+    if (curl_multi_add_handle(multi, curl) != CURLM_OK) {
+        return false;
+    }
+    hedge->count++;
+    return true;
+}
+
+static size_t chat_hedge_discard(char *contents, size_t size, size_t nmemb, void *userp) {
+    (void) contents;
+    (void) userp;
+    return size * nmemb;
+}
+
+// 败者拿到 chat_id 后在 multi 里发出取消请求, 响应不关心; 失败时留给流程结束后的 coze_chat_cancel
+static void chat_hedge_cancel_start(struct chat_hedge_stream *stream, CURLM *multi, const char *base,
+                                    const char *api_token, int timeout_ms) {
+    stream->cancel_tried = true;
+    json_writer_begin(&stream->cancel_body, NULL);
+    json_writer_string_field(&stream->cancel_body, "conversation_id", stream->conversation_id);
+    json_writer_string_field(&stream->cancel_body, "chat_id", stream->chat_id);
+    const coze_transport_request_t req = {
+        .method = "POST",
+        .url = stream->cancel_url = build_url(base, "/v3/chat/cancel"),
+        .path = "/v3/chat/cancel",
+        .api_token = api_token,
+        .body = json_writer_finish(&stream->cancel_body),
+        .timeout_ms = timeout_ms,
+    };
+    stream->cancel = req.url && req.body ? curl_easy_init() : NULL;
+    if (stream->cancel) {
+        stream->cancel_headers = curl_request_headers(&req);
+        curl_request_setup(stream->cancel, &req, stream->cancel_headers, chat_hedge_discard, chat_hedge_discard, NULL);
+        curl_easy_setopt(stream->cancel, CURLOPT_PRIVATE, stream);
+    }
+    if (stream->cancel && curl_multi_add_handle(multi, stream->cancel) != CURLM_OK) {
+        curl_easy_cleanup(stream->cancel);
+        stream->cancel = NULL;
+    }
+    if (stream->cancel) {
+        COZE_LOG("hedge SSE: cancel losing chat %s\n", stream->chat_id);
+        return;
+    }
+    curl_slist_free_all(stream->cancel_headers);
+    stream->cancel_headers = NULL;
+    coze_free(stream->cancel_url);
+    stream->cancel_url = NULL;
+    json_writer_release(&stream->cancel_body);
+}
+
+// hedge_body 为对冲流的请求体 (auto_save_history 为 false)
+static coze_error_t chat_stream_hedged(const coze_chat_stream_request_t *req, const char *path,
+                                       const char *json_body, const char *hedge_body,
+                                       struct ChatSSECallbackContext *biz_ctx, coze_response_t *coze_response,
+                                       uint64_t deadline_us, uint32_t unreachable) {
+    coze_response->allocator = t_allocator;
+    struct endpoint_pick endpoint; // 两个流发往同一个端点, 共用一个熔断凭证和一个限流许可
+    if (!endpoint_select(REQ_API_BASE(req), unreachable, &endpoint)) {
+        return COZE_ERROR_NETWORK;
+    }
+    const coze_transport_sink_t no_response = {0};
+    char *url = build_url(endpoint.base, path);
+    struct pooled_conn conn; // 主流用池中的连接, 对冲流和取消请求加进同一个 multi
+    if (!url || !conn_pool_take(url, &conn)) {
+        endpoint_release(&endpoint, &no_response, COZE_OK, false);
+        coze_free(url);
+        return !url ? COZE_ERROR_MEMORY : COZE_ERROR_NETWORK;
+    }
+    CURLM *multi = conn.multi;
+    struct circuit_permit circuit;
+    struct rate_permit permit;
+    coze_error_t limited = deadline_remaining_ms(deadline_us) < 0 ? COZE_ERROR_DEADLINE_EXCEEDED
+                                                                  : circuit_acquire(endpoint.base, &circuit);
+    if (limited == COZE_OK &&
+        (limited = rate_limit_acquire(REQ_API_TOKEN(req), path, deadline_us, &permit)) != COZE_OK) {
+        circuit_skip(&circuit);
+    }
+    if (limited != COZE_OK) {
+        endpoint_release(&endpoint, &no_response, limited, false);
+        conn_pool_put(&conn, url, true);
+        coze_free(url);
+        return limited;
+    }
+    COZE_LOG("start SSE (hedge after %d ms): POST %s, body: %s\n", req->hedge_ttft_ms, url, json_body);
+
+    coze_transport_request_t transport_req = {
+        .method = "POST",
+        .url = url,
+        .path = path,
+        .api_token = REQ_API_TOKEN(req),
+        .body = json_body,
+        .stream = true,
+        .timeout_ms = deadline_remaining_ms(deadline_us),
+    };
+    struct curl_slist *headers = curl_request_headers(&transport_req);
+    struct chat_hedge hedge = {.biz_ctx = biz_ctx};
+    const uint64_t hedge_at = now_us() + (uint64_t) req->hedge_ttft_ms * 1000u;
+    bool hedge_decided = !chat_hedge_start(&hedge, multi, conn.curl, &transport_req, headers);
+
+    while (hedge.count > 0) {
+        int running = 0;
+        if (curl_multi_perform(multi, &running) != CURLM_OK) {
+            break;
+        }
+        CURLMsg *msg;
+        int queued;
+        while ((msg = curl_multi_info_read(multi, &queued))) {
+            struct chat_hedge_stream *stream = NULL;
+            if (msg->msg != CURLMSG_DONE || curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE,
+                                                              (char **) &stream) != CURLE_OK || !stream) {
+                continue;
+            }
+            if (msg->easy_handle == stream->cancel) {
+                stream->cancel_done = true;
+                continue;
+            }
+            stream->done = true;
+            stream->result = msg->data.result;
+            stream->sink.connect_failed = curl_connect_failed(stream->result);
+            if (!hedge.winner && stream->result == CURLE_OK) {
+                chat_hedge_claim(&hedge, stream); // 没有 delta 就正常结束, 例如 conversation.chat.failed
+            }
         }
-    } else if (strcmp(event, COZE_EVENT_TYPE_CONVERSATION_CHAT_CREATED) == 0 ||
-               strcmp(event, COZE_EVENT_TYPE_CONVERSATION_CHAT_IN_PROGRESS) == 0 ||
-               strcmp(event, COZE_EVENT_TYPE_CONVERSATION_CHAT_COMPLETED) == 0 ||
-               strcmp(event, COZE_EVENT_TYPE_CONVERSATION_CHAT_FAILED) == 0 ||
-               strcmp(event, COZE_EVENT_TYPE_CONVERSATION_CHAT_REQUIRES_ACTION) == 0) {
-        cJSON *json_data = cJSON_Parse(sse_data);
-        if (json_data) {
-            coze_chat_t *chat = calloc(1, sizeof(coze_chat_t));
-            const cJSON *id = cJSON_GetObjectItem(json_data, "id");
-            const cJSON *conversation_id = cJSON_GetObjectItem(json_data, "conversation_id");
-            const cJSON *bot_id = cJSON_GetObjectItem(json_data, "bot_id");
-            const cJSON *created_at = cJSON_GetObjectItem(json_data, "created_at");
-            const cJSON *completed_at = cJSON_GetObjectItem(json_data, "completed_at");
-            const cJSON *status = cJSON_GetObjectItem(json_data, "status");
-
-            chat->id = id ? strdup(id->valuestring) : NULL;
-            chat->conversation_id = conversation_id ? strdup(conversation_id->valuestring) : NULL;
-            chat->bot_id = bot_id ? strdup(bot_id->valuestring) : NULL;
-            chat->created_at = created_at ? created_at->valueint : 0;
-            chat->completed_at = completed_at ? completed_at->valueint : 0;
-            chat->status = status ? strdup(status->valuestring) : NULL;
 
-            cJSON_Delete(json_data);
-            event_data->chat = chat;
+        // 胜者结束后不再等待还没拿到 chat_id 的败者, 只等已经发出的取消请求
+        bool finished = hedge.winner && hedge.winner->done;
+        if (!hedge.winner) {
+            finished = true;
+            for (int i = 0; i < hedge.count; i++) {
+                finished = finished && hedge.streams[i].done;
+            }
+        }
+        for (int i = 0; i < hedge.count; i++) {
+            struct chat_hedge_stream *stream = &hedge.streams[i];
+            const int remaining_ms = deadline_remaining_ms(deadline_us);
+            if (hedge.winner && stream != hedge.winner && stream->chat_id[0] && !stream->cancel_tried &&
+                remaining_ms >= 0) {
+                chat_hedge_cancel_start(stream, multi, endpoint.base, REQ_API_TOKEN(req), remaining_ms);
+            }
+            finished = finished && (!stream->cancel || stream->cancel_done);
+        }
+        if (!hedge_decided && !hedge.winner && !hedge.streams[0].done && now_us() >= hedge_at) {
+            hedge_decided = true;
+            transport_req.body = hedge_body;
+            transport_req.timeout_ms = deadline_remaining_ms(deadline_us); // 对冲流只能用剩下的时间
+            CURL *curl = transport_req.timeout_ms >= 0 ? curl_easy_init() : NULL;
+            if (chat_hedge_start(&hedge, multi, curl, &transport_req, headers)) {
+                __atomic_fetch_add(&g_transfer_stats.hedges, 1, __ATOMIC_RELAXED);
+                COZE_LOG("hedge SSE: no delta after %d ms, body: %s\n", req->hedge_ttft_ms, hedge_body);
+                finished = false;
+            } else {
+                curl_easy_cleanup(curl);
+            }
+        }
+        if (finished) {
+            break;
+        }
+
+        int timeout_ms = 100;
+        if (!hedge_decided) {
+            const uint64_t now = now_us();
+            timeout_ms = hedge_at > now ? (int) ((hedge_at - now + 999) / 1000) : 0;
+            timeout_ms = timeout_ms > 100 ? 100 : timeout_ms;
+        }
+        curl_multi_poll(multi, NULL, 0, timeout_ms, NULL);
+    }
+
+    // 都没有正常结束时以主流为准
+    if (!hedge.winner && hedge.count > 0) {
+        chat_hedge_claim(&hedge, &hedge.streams[0]);
+    }
+    coze_error_t err = COZE_ERROR_NETWORK;
+    bool failover = false;
+    for (int i = 0; i < hedge.count; i++) {
+        struct chat_hedge_stream *stream = &hedge.streams[i];
+        if (stream == hedge.winner) {
+            rate_limit_release(&permit, &stream->sink);
+            permit.bucket = NULL;
+            sse_finish(&stream->ctx);
+            *coze_response = stream->response;
+            err = stream->done ? curl_result_error(&transport_req, stream->result) : COZE_ERROR_NETWORK;
+            circuit_release(&circuit, &stream->sink, err);
+            circuit.circuit = NULL;
+            endpoint_release(&endpoint, &stream->sink, err, true);
+            failover = endpoint_failover(&endpoint, &stream->sink, err, &unreachable);
+            endpoint.group = -1;
+            if (i > 0) {
+                __atomic_fetch_add(&g_transfer_stats.hedge_wins, 1, __ATOMIC_RELAXED);
+            }
+        } else {
+            stream->ctx.failed = true; // 只释放, 不再派发败者的事件
+            sse_finish(&stream->ctx);
+            coze_free_response(&stream->response);
+        }
+        curl_off_t wire_bytes = 0;
+        curl_easy_getinfo(stream->curl, CURLINFO_SIZE_DOWNLOAD_T, &wire_bytes);
+        transfer_stats_add(&stream->sink, (size_t) wire_bytes);
+        transfer_stats_connects(stream->curl);
+        curl_multi_remove_handle(multi, stream->curl);
+        if (stream->curl != conn.curl) {
+            curl_easy_cleanup(stream->curl);
+        }
+        coze_free(stream->events);
+        if (stream->cancel) {
+            curl_multi_remove_handle(multi, stream->cancel);
+            curl_easy_cleanup(stream->cancel);
+            curl_slist_free_all(stream->cancel_headers);
+            coze_free(stream->cancel_url);
+            json_writer_release(&stream->cancel_body);
+        }
+    }
+    if (permit.bucket || circuit.circuit || endpoint.group >= 0) {
+        rate_limit_release(&permit, &no_response);
+        circuit_release(&circuit, &no_response, COZE_ERROR_NETWORK);
+        endpoint_release(&endpoint, &no_response, COZE_ERROR_NETWORK, true);
+    }
+    curl_slist_free_all(headers);
+    conn_pool_put(&conn, url, hedge.winner && hedge.winner->done && hedge.winner->result == CURLE_OK);
+    if (failover) {
+        // 主流没有连上, 什么都没有派发, 整个对冲换到下一个端点重来
+        COZE_LOG("failover: POST %s, connect failed\n", url);
+        __atomic_fetch_add(&g_transfer_stats.failovers, 1, __ATOMIC_RELAXED);
+        coze_free(url);
+        coze_free_response(coze_response);
+        *coze_response = (coze_response_t){0};
+        return chat_stream_hedged(req, path, json_body, hedge_body, biz_ctx, coze_response, deadline_us,
+                                  unreachable);
+    }
+    coze_free(url);
+
+    // 对冲过程中没能发出取消的败者 (例如都没有正常结束时才定下胜者), 对话在服务端可能还在生成, 这里取消
+    for (int i = 0; i < hedge.count; i++) {
+        const struct chat_hedge_stream *stream = &hedge.streams[i];
+        if (stream == hedge.winner || !stream->chat_id[0] || stream->cancel) {
+            continue;
         }
+        const coze_chat_cancel_request_t cancel_req = {
+            .client = req->client, .api_token = req->api_token, .api_base = req->api_base,
+            .conversation_id = stream->conversation_id, .chat_id = stream->chat_id,
+        };
+        coze_chat_cancel_response_t cancel_resp = {0};
+        coze_chat_cancel(&cancel_req, &cancel_resp);
+        coze_free_chat_cancel_response(&cancel_resp);
     }
 
-    if (ctx->callback) {
-        ctx->callback(event_data);
+    if (err == COZE_OK) {
+        COZE_LOG("SSE completed: %s (%s stream)\n", coze_response->logid,
+                 hedge.winner == &hedge.streams[0] ? "primary" : "hedge");
     }
-
-    // 释放临时数据
-    free(event);
-    free(sse_data);
+    return err;
 }
 
+// *** chat stream hedging ***
+
 coze_error_t coze_chat_stream(const coze_chat_stream_request_t *req,
                               coze_chat_stream_response_t *resp) {
-    if (!req || !resp || !req->api_token) {
+    if (!req || !resp || !REQ_API_TOKEN(req)) {
         return COZE_ERROR_INVALID_PARAM;
     }
+    ALLOCATOR_SCOPE(client_allocator(req->client));
+    char bot_id_buffer[ID_BUFFER_SIZE];
+    const char *req_bot_id = REQ_ID(req, bot_id, bot_id_buffer);
+    char conversation_id_buffer[ID_BUFFER_SIZE];
+    const char *req_conversation_id = REQ_ID(req, conversation_id, conversation_id_buffer);
 
     char path[512];
     snprintf(path, sizeof(path), "/v3/chat%s%s",
-             req->conversation_id ? "?conversation_id=" : "",
-             req->conversation_id ? req->conversation_id : "");
+             req_conversation_id ? "?conversation_id=" : "",
+             req_conversation_id ? req_conversation_id : "");
 
-    cJSON *body = cJSON_CreateObject();
-    if (req->bot_id) {
-        cJSON_AddStringToObject(body, "bot_id", req->bot_id);
-    }
-    if (req->user_id) {
-        cJSON_AddStringToObject(body, "user_id", req->user_id);
-    }
-    if (req->additional_messages && req->additional_messages_count > 0) {
-        cJSON *additional_messages_array = cJSON_CreateArray();
-        for (size_t i = 0; i < req->additional_messages_count; i++) {
-            cJSON *message_obj = cJSON_CreateObject();
-            if (req->additional_messages[i].role) {
-                cJSON_AddStringToObject(message_obj, "role", req->additional_messages[i].role);
-            }
-            if (req->additional_messages[i].type) {
-                cJSON_AddStringToObject(message_obj, "type", req->additional_messages[i].type);
-            }
-            if (req->additional_messages[i].content) {
-                cJSON_AddStringToObject(message_obj, "content", req->additional_messages[i].content);
-            }
-            if (req->additional_messages[i].content_type) {
-                cJSON_AddStringToObject(message_obj, "content_type", req->additional_messages[i].content_type);
-            }
-            cJSON_AddItemToArray(additional_messages_array, message_obj);
-        }
-        cJSON_AddItemToObject(body, "additional_messages", additional_messages_array);
-    }
-    cJSON_AddTrueToObject(body, "stream");
-    if (req->auto_save_history) {
-        cJSON_AddBoolToObject(body, "auto_save_history", req->auto_save_history);
-    }
-    char *json_body = cJSON_PrintUnformatted(body);
-    cJSON_Delete(body);
+    struct json_writer body;
+    json_writer_begin(&body, req->client);
+    const char *json_body = chat_stream_body(&body, req, req_bot_id, false);
 
     coze_response_t coze_response = {0};
 
     struct ChatSSECallbackContext biz_ctx = {
         .callback = req->on_event,
     };
-    const coze_error_t err = make_http_sse_request(req->api_base, req->api_token, path, "POST", json_body,
-                                                   chat_stream_handler,
-                                                   &biz_ctx,
-                                                   &coze_response);
+    coze_error_t err;
+    // 自定义 transport 和录制时走单流: 对冲流不经过 perform_transport, 录下的交互要能一一回放
+    if (req->hedge_ttft_ms > 0 && !g_transport.fn && !vcr_recording()) {
+        struct json_writer hedge_body;
+        json_writer_begin(&hedge_body, req->client);
+        const char *hedge_json_body = chat_stream_body(&hedge_body, req, req_bot_id, true);
+        err = json_body && hedge_json_body
+                  ? chat_stream_hedged(req, path, json_body, hedge_json_body, &biz_ctx, &coze_response,
+                                       REQ_DEADLINE(req), 0)
+                  : COZE_ERROR_MEMORY;
+        json_writer_release(&hedge_body);
+    } else {
+        err = make_http_sse_request(REQ_API_BASE(req), REQ_API_TOKEN(req), REQ_DEADLINE(req), path,
+                                    "POST", json_body,
+                                    chat_stream_handler,
+                                    &biz_ctx,
+                                    &coze_response);
+    }
     resp->response = coze_response;
-    free(json_body);
+    json_writer_release(&body);
     if (err != COZE_OK) {
         return err;
     }
@@ -2085,9 +6472,10 @@ coze_error_t coze_chat_stream(const coze_chat_stream_request_t *req,
 
 void coze_free_chat_stream_response(coze_chat_stream_response_t *resp) {
     if (!resp) return;
+    ALLOCATOR_SCOPE(resp->response.allocator);
 
     if (resp->msg && strlen(resp->msg) > 0) {
-        free((void *) resp->msg);
+        coze_free((void *) resp->msg);
     }
     coze_free_response(&resp->response);
 }
@@ -2095,516 +6483,238 @@ void coze_free_chat_stream_response(coze_chat_stream_response_t *resp) {
 
 coze_error_t coze_chat_retrieve(const coze_chat_retrieve_request_t *req,
                                 coze_chat_retrieve_response_t *resp) {
-    if (!req || !resp || !req->conversation_id || !req->chat_id) {
+    if (!req || !resp || !REQ_HAS_ID(req, conversation_id) || !REQ_HAS_ID(req, chat_id)) {
         return COZE_ERROR_INVALID_PARAM;
     }
-
-    struct MemoryStruct chunk = {0};
-    chunk.memory = malloc(1);
-    chunk.size = 0;
+    ALLOCATOR_SCOPE(client_allocator(req->client));
+    char conversation_id_buffer[ID_BUFFER_SIZE];
+    const char *req_conversation_id = REQ_ID(req, conversation_id, conversation_id_buffer);
+    char chat_id_buffer[ID_BUFFER_SIZE];
+    const char *req_chat_id = REQ_ID(req, chat_id, chat_id_buffer);
 
     char path[512];
     snprintf(path, sizeof(path), "/v3/chat/retrieve?conversation_id=%s&chat_id=%s",
-             req->conversation_id, req->chat_id);
+             req_conversation_id, req_chat_id);
 
 
+    const struct json_target target = {
+        .code = &resp->code, .msg = &resp->msg, .data_key = "data", .schema = &chat_schema, .data = &resp->data
+    };
     coze_response_t coze_response = {0};
-    coze_error_t err = make_http_request(req->api_base, req->api_token, path, "GET", NULL, &chunk, &coze_response);
+    const coze_error_t err = make_http_json_request(REQ_API_BASE(req), REQ_API_TOKEN(req), REQ_DEADLINE(req), path,
+                                                    "GET", NULL, &target, &coze_response);
     resp->response = coze_response;
-
-    if (err != COZE_OK) {
-        free(chunk.memory);
-        return err;
-    }
-
-    cJSON *json = cJSON_Parse(chunk.memory);
-    if (!json) {
-        free(chunk.memory);
-        return COZE_ERROR_API;
-    }
-
-    char *tmp_msg = NULL;
-    err = parse_response_code(json, &tmp_msg, &resp->code);
-    resp->msg = tmp_msg;
-    if (err != COZE_OK) {
-        cJSON_Delete(json);
-        free(chunk.memory);
-        return err;
-    }
-
-    // 解析数据
-    coze_chat_t chat_data = {0};
-    const cJSON *data = cJSON_GetObjectItem(json, "data");
-    if (data) {
-        const cJSON *id = cJSON_GetObjectItem(data, "id");
-        const cJSON *conversation_id = cJSON_GetObjectItem(data, "conversation_id");
-        const cJSON *bot_id = cJSON_GetObjectItem(data, "bot_id");
-        const cJSON *created_at = cJSON_GetObjectItem(data, "created_at");
-        const cJSON *completed_at = cJSON_GetObjectItem(data, "completed_at");
-        const cJSON *status = cJSON_GetObjectItem(data, "status");
-
-        chat_data.id = id ? strdup(id->valuestring) : NULL;
-        chat_data.conversation_id = conversation_id ? strdup(conversation_id->valuestring) : NULL;
-        chat_data.bot_id = bot_id ? strdup(bot_id->valuestring) : NULL;
-        chat_data.created_at = created_at ? created_at->valueint : 0;
-        chat_data.completed_at = completed_at ? completed_at->valueint : 0;
-        chat_data.status = status ? strdup(status->valuestring) : NULL;
-    }
-    resp->data = chat_data;
-
-    cJSON_Delete(json);
-    free(chunk.memory);
-
-    return COZE_OK;
+    return err;
 }
 
 void coze_free_chat_retrieve_response(coze_chat_retrieve_response_t *resp) {
     if (!resp) return;
+    ALLOCATOR_SCOPE(resp->response.allocator);
 
-    free((void *) resp->msg);
+    coze_free((void *) resp->msg);
     coze_free_response(&resp->response);
     coze_free_chat(&resp->data);
 }
 
 coze_error_t coze_chat_messages_list(const coze_chat_messages_list_request_t *req,
                                      coze_chat_messages_list_response_t *resp) {
-    if (!req || !resp || !req->conversation_id || !req->chat_id) {
+    if (!req || !resp || !REQ_HAS_ID(req, conversation_id) || !REQ_HAS_ID(req, chat_id)) {
         return COZE_ERROR_INVALID_PARAM;
     }
-
-    struct MemoryStruct chunk = {0};
-    chunk.memory = malloc(1);
-    chunk.size = 0;
+    ALLOCATOR_SCOPE(client_allocator(req->client));
+    char conversation_id_buffer[ID_BUFFER_SIZE];
+    const char *req_conversation_id = REQ_ID(req, conversation_id, conversation_id_buffer);
+    char chat_id_buffer[ID_BUFFER_SIZE];
+    const char *req_chat_id = REQ_ID(req, chat_id, chat_id_buffer);
 
     char path[512];
     snprintf(path, sizeof(path),
              "/v3/chat/message/list?conversation_id=%s&chat_id=%s",
-             req->conversation_id, req->chat_id);
+             req_conversation_id, req_chat_id);
 
 
+    const struct json_target target = {
+        .code = &resp->code, .msg = &resp->msg,
+        .schema = req->columnar ? &chat_messages_columns_schema : &chat_messages_list_schema, .data = &resp->data,
+        .zero_copy = req->zero_copy, .client = req->client
+    };
     coze_response_t coze_response = {0};
-    coze_error_t err = make_http_request(req->api_base, req->api_token, path, "GET", NULL, &chunk, &coze_response);
+    const coze_error_t err = make_http_json_request(REQ_API_BASE(req), REQ_API_TOKEN(req), REQ_DEADLINE(req), path,
+                                                    "GET", NULL, &target, &coze_response);
     resp->response = coze_response;
-
-    if (err != COZE_OK) {
-        free(chunk.memory);
-        return err;
-    }
-
-    cJSON *json = cJSON_Parse(chunk.memory);
-    if (!json) {
-        free(chunk.memory);
-        return COZE_ERROR_API;
-    }
-
-    char *tmp_msg = NULL;
-    err = parse_response_code(json, &tmp_msg, &resp->code);
-    resp->msg = tmp_msg;
-    if (err != COZE_OK) {
-        cJSON_Delete(json);
-        free(chunk.memory);
-        return err;
-    }
-
-    // 解析数据
-    coze_chat_messages_list_data_t messages_data = {0};
-    const cJSON *data = cJSON_GetObjectItem(json, "data");
-    if (data) {
-        const int messages_count = cJSON_GetArraySize(data);
-        messages_data.messages_count = messages_count;
-        messages_data.messages = calloc(messages_count, sizeof(coze_message_t));
-
-        for (int i = 0; i < messages_count; i++) {
-            const cJSON *message = cJSON_GetArrayItem(data, i);
-            if (message) {
-                const cJSON *id = cJSON_GetObjectItem(message, "id");
-                const cJSON *conversation_id = cJSON_GetObjectItem(message, "conversation_id");
-                const cJSON *bot_id = cJSON_GetObjectItem(message, "bot_id");
-                const cJSON *chat_id = cJSON_GetObjectItem(message, "chat_id");
-                const cJSON *role = cJSON_GetObjectItem(message, "role");
-                const cJSON *content = cJSON_GetObjectItem(message, "content");
-                const cJSON *content_type = cJSON_GetObjectItem(message, "content_type");
-                const cJSON *type = cJSON_GetObjectItem(message, "type");
-                const cJSON *created_at = cJSON_GetObjectItem(message, "created_at");
-                const cJSON *updated_at = cJSON_GetObjectItem(message, "updated_at");
-
-                messages_data.messages[i].id = id ? strdup(id->valuestring) : NULL;
-                messages_data.messages[i].conversation_id = conversation_id
-                                                                ? strdup(conversation_id->valuestring)
-                                                                : NULL;
-                messages_data.messages[i].bot_id = bot_id ? strdup(bot_id->valuestring) : NULL;
-                messages_data.messages[i].chat_id = chat_id ? strdup(chat_id->valuestring) : NULL;
-                messages_data.messages[i].role = role ? strdup(role->valuestring) : NULL;
-                messages_data.messages[i].content = content ? strdup(content->valuestring) : NULL;
-                messages_data.messages[i].content_type = content_type ? strdup(content_type->valuestring) : NULL;
-                messages_data.messages[i].type = type ? strdup(type->valuestring) : NULL;
-                messages_data.messages[i].created_at = created_at ? created_at->valueint : 0;
-                messages_data.messages[i].updated_at = updated_at ? updated_at->valueint : 0;
-            }
-        }
-    }
-    resp->data = messages_data;
-
-    cJSON_Delete(json);
-    free(chunk.memory);
-
-    return COZE_OK;
+    return err;
 }
 
 void coze_free_chat_messages_list_response(coze_chat_messages_list_response_t *resp) {
     if (!resp) return;
+    ALLOCATOR_SCOPE(resp->response.allocator);
 
-    free((void *) resp->msg);
+    coze_free((void *) resp->msg);
     coze_free_response(&resp->response);
-    for (int i = 0; i < resp->data.messages_count; i++) {
-        coze_free_message(&resp->data.messages[i]);
-    }
-    free(resp->data.messages);
+    json_schema_free(&chat_messages_list_schema, &resp->data);
+    json_columns_free(&message_columns_schema, &resp->data.columns);
 }
 
 
 coze_error_t coze_chat_submit_tool_outputs_create(const coze_chat_submit_tool_outputs_create_request_t *req,
                                                   coze_chat_submit_tool_outputs_create_response_t *resp) {
-    if (!req || !resp || !req->conversation_id || !req->chat_id) {
+    if (!req || !resp || !REQ_HAS_ID(req, conversation_id) || !REQ_HAS_ID(req, chat_id)) {
         return COZE_ERROR_INVALID_PARAM;
     }
-
-    struct MemoryStruct chunk = {0};
-    chunk.memory = malloc(1);
-    chunk.size = 0;
+    ALLOCATOR_SCOPE(client_allocator(req->client));
+    char conversation_id_buffer[ID_BUFFER_SIZE];
+    const char *req_conversation_id = REQ_ID(req, conversation_id, conversation_id_buffer);
+    char chat_id_buffer[ID_BUFFER_SIZE];
+    const char *req_chat_id = REQ_ID(req, chat_id, chat_id_buffer);
 
     char path[512];
     snprintf(path, sizeof(path), "/v3/chat/submit_tool_outputs?conversation_id=%s&chat_id=%s",
-             req->conversation_id, req->chat_id);
+             req_conversation_id, req_chat_id);
 
 
-    cJSON *body = cJSON_CreateObject();
+    struct json_writer body;
+    json_writer_begin(&body, req->client);
     if (req->tool_outputs && req->tool_outputs_count > 0) {
-        cJSON *tool_outputs_array = cJSON_CreateArray();
+        json_writer_array_field(&body, "tool_outputs");
         for (size_t i = 0; i < req->tool_outputs_count; i++) {
-            cJSON *tool_output_obj = cJSON_CreateObject();
+            json_writer_object_begin(&body);
             if (req->tool_outputs[i].tool_call_id) {
-                cJSON_AddStringToObject(tool_output_obj, "tool_call_id", req->tool_outputs[i].tool_call_id);
+                json_writer_string_field(&body, "tool_call_id", req->tool_outputs[i].tool_call_id);
             }
             if (req->tool_outputs[i].output) {
-                cJSON_AddStringToObject(tool_output_obj, "output", req->tool_outputs[i].output);
+                json_writer_string_field(&body, "output", req->tool_outputs[i].output);
             }
-            cJSON_AddItemToArray(tool_outputs_array, tool_output_obj);
+            json_writer_object_end(&body);
         }
-        cJSON_AddItemToObject(body, "tool_outputs", tool_outputs_array);
+        json_writer_array_end(&body);
     }
-    cJSON_AddFalseToObject(body, "stream");
-    char *json_body = cJSON_PrintUnformatted(body);
-    cJSON_Delete(body);
+    json_writer_bool_field(&body, "stream", false);
+    const char *json_body = json_writer_finish(&body);
 
+    const struct json_target target = {
+        .code = &resp->code, .msg = &resp->msg, .data_key = "data", .schema = &chat_schema, .data = &resp->data
+    };
     coze_response_t coze_response = {0};
-    coze_error_t err = make_http_request(req->api_base, req->api_token, path, "POST", json_body, &chunk,
-                                         &coze_response);
+    const coze_error_t err = make_http_json_request(REQ_API_BASE(req), REQ_API_TOKEN(req), REQ_DEADLINE(req), path,
+                                                    "POST", json_body, &target, &coze_response);
     resp->response = coze_response;
-    free(json_body);
-    if (err != COZE_OK) {
-        free(chunk.memory);
-        return err;
-    }
-
-    cJSON *json = cJSON_Parse(chunk.memory);
-    if (!json) {
-        free(chunk.memory);
-        return COZE_ERROR_API;
-    }
-
-    char *tmp_msg = NULL;
-    err = parse_response_code(json, &tmp_msg, &resp->code);
-    resp->msg = tmp_msg;
-    if (err != COZE_OK) {
-        cJSON_Delete(json);
-        free(chunk.memory);
-        return err;
-    }
-
-    // 解析数据
-    coze_chat_t chat_data = {0};
-    const cJSON *data = cJSON_GetObjectItem(json, "data");
-    if (data) {
-        const cJSON *id = cJSON_GetObjectItem(data, "id");
-        const cJSON *conversation_id = cJSON_GetObjectItem(data, "conversation_id");
-        const cJSON *bot_id = cJSON_GetObjectItem(data, "bot_id");
-        const cJSON *created_at = cJSON_GetObjectItem(data, "created_at");
-        const cJSON *completed_at = cJSON_GetObjectItem(data, "completed_at");
-        const cJSON *status = cJSON_GetObjectItem(data, "status");
-
-        chat_data.id = id ? strdup(id->valuestring) : NULL;
-        chat_data.conversation_id = conversation_id ? strdup(conversation_id->valuestring) : NULL;
-        chat_data.bot_id = bot_id ? strdup(bot_id->valuestring) : NULL;
-        chat_data.created_at = created_at ? created_at->valueint : 0;
-        chat_data.completed_at = completed_at ? completed_at->valueint : 0;
-        chat_data.status = status ? strdup(status->valuestring) : NULL;
-    }
-    resp->data = chat_data;
-
-    cJSON_Delete(json);
-    free(chunk.memory);
-
-    return COZE_OK;
+    json_writer_release(&body);
+    return err;
 }
 
 void coze_free_chat_submit_tool_outputs_create_response(coze_chat_submit_tool_outputs_create_response_t *resp) {
     if (!resp) return;
+    ALLOCATOR_SCOPE(resp->response.allocator);
 
-    free((void *) resp->msg);
+    coze_free((void *) resp->msg);
     coze_free_response(&resp->response);
     coze_free_chat(&resp->data);
 }
 
 coze_error_t coze_chat_cancel(const coze_chat_cancel_request_t *req,
                               coze_chat_cancel_response_t *resp) {
-    if (!req || !resp || !req->api_token || !req->conversation_id || !req->chat_id) {
+    if (!req || !resp || !REQ_API_TOKEN(req) || !REQ_HAS_ID(req, conversation_id) || !REQ_HAS_ID(req, chat_id)) {
         return COZE_ERROR_INVALID_PARAM;
     }
-
-    struct MemoryStruct chunk = {0};
-    chunk.memory = malloc(1);
-    chunk.size = 0;
+    ALLOCATOR_SCOPE(client_allocator(req->client));
+    char conversation_id_buffer[ID_BUFFER_SIZE];
+    const char *req_conversation_id = REQ_ID(req, conversation_id, conversation_id_buffer);
+    char chat_id_buffer[ID_BUFFER_SIZE];
+    const char *req_chat_id = REQ_ID(req, chat_id, chat_id_buffer);
 
     char path[512];
     snprintf(path, sizeof(path), "/v3/chat/cancel");
 
 
-    cJSON *body = cJSON_CreateObject();
-    if (req->conversation_id) {
-        cJSON_AddStringToObject(body, "conversation_id", req->conversation_id);
+    struct json_writer body;
+    json_writer_begin(&body, req->client);
+    if (req_conversation_id) {
+        json_writer_string_field(&body, "conversation_id", req_conversation_id);
     }
-    if (req->chat_id) {
-        cJSON_AddStringToObject(body, "chat_id", req->chat_id);
+    if (req_chat_id) {
+        json_writer_string_field(&body, "chat_id", req_chat_id);
     }
-    char *json_body = cJSON_PrintUnformatted(body);
-    cJSON_Delete(body);
+    const char *json_body = json_writer_finish(&body);
 
+    const struct json_target target = {
+        .code = &resp->code, .msg = &resp->msg, .data_key = "data", .schema = &chat_schema, .data = &resp->data
+    };
     coze_response_t coze_response = {0};
-    coze_error_t err = make_http_request(req->api_base, req->api_token, path, "POST", json_body, &chunk,
-                                         &coze_response);
+    const coze_error_t err = make_http_json_request(REQ_API_BASE(req), REQ_API_TOKEN(req), REQ_DEADLINE(req), path,
+                                                    "POST", json_body, &target, &coze_response);
     resp->response = coze_response;
-    free(json_body);
-
-    if (err != COZE_OK) {
-        free(chunk.memory);
-        return err;
-    }
-
-    cJSON *json = cJSON_Parse(chunk.memory);
-    if (!json) {
-        free(chunk.memory);
-        return COZE_ERROR_API;
-    }
-
-    char *tmp_msg = NULL;
-    err = parse_response_code(json, &tmp_msg, &resp->code);
-    resp->msg = tmp_msg;
-    if (err != COZE_OK) {
-        cJSON_Delete(json);
-        free(chunk.memory);
-        return err;
-    }
-
-    // 解析数据
-    coze_chat_t chat_data = {0};
-    const cJSON *data = cJSON_GetObjectItem(json, "data");
-    if (data) {
-        const cJSON *id = cJSON_GetObjectItem(data, "id");
-        const cJSON *conversation_id = cJSON_GetObjectItem(data, "conversation_id");
-        const cJSON *bot_id = cJSON_GetObjectItem(data, "bot_id");
-        const cJSON *created_at = cJSON_GetObjectItem(data, "created_at");
-        const cJSON *completed_at = cJSON_GetObjectItem(data, "completed_at");
-        const cJSON *status = cJSON_GetObjectItem(data, "status");
-
-        chat_data.id = id ? strdup(id->valuestring) : NULL;
-        chat_data.conversation_id = conversation_id ? strdup(conversation_id->valuestring) : NULL;
-        chat_data.bot_id = bot_id ? strdup(bot_id->valuestring) : NULL;
-        chat_data.created_at = created_at ? created_at->valueint : 0;
-        chat_data.completed_at = completed_at ? completed_at->valueint : 0;
-        chat_data.status = status ? strdup(status->valuestring) : NULL;
-    }
-    resp->data = chat_data;
-
-    cJSON_Delete(json);
-    free(chunk.memory);
-
-    return COZE_OK;
+    json_writer_release(&body);
+    return err;
 }
 
 void coze_free_chat_cancel_response(coze_chat_cancel_response_t *resp) {
     if (!resp) return;
+    ALLOCATOR_SCOPE(resp->response.allocator);
 
-    free((void *) resp->msg);
+    coze_free((void *) resp->msg);
     coze_free_response(&resp->response);
     coze_free_chat(&resp->data);
 }
 
 coze_error_t coze_files_upload(const coze_files_upload_request_t *req,
                                coze_files_upload_response_t *resp) {
-    if (!req || !resp || !req->api_token || !req->file) {
+    if (!req || !resp || !REQ_API_TOKEN(req) || !req->file) {
         return COZE_ERROR_INVALID_PARAM;
     }
+    ALLOCATOR_SCOPE(client_allocator(req->client));
 
-    CURL *curl = curl_easy_init();
-    if (!curl) {
-        return COZE_ERROR_API;
-    }
-
-    struct MemoryStruct chunk = {0};
-    chunk.memory = malloc(1);
-    chunk.size = 0;
-
-    // 设置 URL
-    const char *path = "/v1/files/upload";
-
-    // 设置请求头
-    struct curl_slist *headers = NULL;
-    char auth_header[256];
-    snprintf(auth_header, sizeof(auth_header), "Authorization: Bearer %s", req->api_token);
-    headers = curl_slist_append(headers, auth_header);
-
-    // 设置 CURL 选项
-    curl_easy_setopt(curl, CURLOPT_URL, build_url(req->api_base, path));
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteMemoryCallback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void*)&chunk);
-    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, header_callback);
-    curl_easy_setopt(curl, CURLOPT_HEADERDATA, &resp->response);
-
-    // 设置文件上传
-    curl_mime *mime = curl_mime_init(curl);
-    curl_mimepart *part = curl_mime_addpart(mime);
-    curl_mime_name(part, "file");
-    curl_mime_filedata(part, req->file);
-    curl_easy_setopt(curl, CURLOPT_MIMEPOST, mime);
-
-    // 执行请求
-    CURLcode res = curl_easy_perform(curl);
-
-    if (res != CURLE_OK) {
-        free(chunk.memory);
-        curl_slist_free_all(headers);
-        curl_mime_free(mime);
-        curl_easy_cleanup(curl);
-        return COZE_ERROR_NETWORK;
-    }
-
-    // 解析响应
-    cJSON *json = cJSON_Parse(chunk.memory);
-    if (!json) {
-        free(chunk.memory);
-        curl_slist_free_all(headers);
-        curl_mime_free(mime);
-        curl_easy_cleanup(curl);
-        return COZE_ERROR_API;
-    }
-
-    char *tmp_msg = NULL;
-    coze_error_t err = parse_response_code(json, &tmp_msg, &resp->code);
-    resp->msg = tmp_msg;
-    if (err != COZE_OK) {
-        cJSON_Delete(json);
-        free(chunk.memory);
-        return err;
-    }
-
-    coze_file_t file_data = {0};
-    const cJSON *data = cJSON_GetObjectItem(json, "data");
-    if (data) {
-        const cJSON *id = cJSON_GetObjectItem(data, "id");
-        const cJSON *file_name = cJSON_GetObjectItem(data, "file_name");
-        const cJSON *created_at = cJSON_GetObjectItem(data, "created_at");
-        const cJSON *bytes = cJSON_GetObjectItem(data, "bytes");
-
-        file_data.id = id ? strdup(id->valuestring) : NULL;
-        file_data.file_name = file_name ? strdup(file_name->valuestring) : NULL;
-        file_data.created_at = created_at ? created_at->valueint : 0;
-        file_data.bytes = bytes ? bytes->valueint : 0;
-    }
-    resp->data = file_data;
-
-    cJSON_Delete(json);
-    free(chunk.memory);
-    curl_slist_free_all(headers);
-    curl_mime_free(mime);
-    curl_easy_cleanup(curl);
-
-    return err;
+    // 和其他请求一样经过端点选择、熔断、限流和 transport, 响应边接收边解码
+    const struct json_target target = {
+        .code = &resp->code, .msg = &resp->msg, .data_key = "data", .schema = &file_schema, .data = &resp->data
+    };
+    struct json_stream stream;
+    json_stream_init(&stream, &target);
+    const coze_error_t err = make_http_request(REQ_API_BASE(req), REQ_API_TOKEN(req), REQ_DEADLINE(req),
+                                               "/v1/files/upload", "POST", NULL, req->file,
+                                               json_stream_write_callback, NULL, &stream, false, &resp->response);
+    if (err == COZE_OK) {
+        COZE_LOG("response: %s, %zu bytes\n", resp->response.logid, stream.received);
+    }
+    return json_stream_finish(&stream, err);
 }
 
 void coze_free_files_upload_response(coze_files_upload_response_t *resp) {
     if (!resp) return;
+    ALLOCATOR_SCOPE(resp->response.allocator);
 
-    free((void *) resp->msg);
+    coze_free((void *) resp->msg);
     coze_free_response(&resp->response);
     coze_free_file(&resp->data);
 }
 
 coze_error_t coze_files_retrieve(const coze_files_retrieve_request_t *req,
                                  coze_files_retrieve_response_t *resp) {
-    if (!req || !resp || !req->api_token || !req->file_id) {
+    if (!req || !resp || !REQ_API_TOKEN(req) || !REQ_HAS_ID(req, file_id)) {
         return COZE_ERROR_INVALID_PARAM;
     }
-
-    struct MemoryStruct chunk = {0};
-    chunk.memory = malloc(1);
-    chunk.size = 0;
+    ALLOCATOR_SCOPE(client_allocator(req->client));
+    char file_id_buffer[ID_BUFFER_SIZE];
+    const char *req_file_id = REQ_ID(req, file_id, file_id_buffer);
 
     char path[512];
-    snprintf(path, sizeof(path), "/v1/files/retrieve?file_id=%s", req->file_id);
+    snprintf(path, sizeof(path), "/v1/files/retrieve?file_id=%s", req_file_id);
 
 
+    const struct json_target target = {
+        .code = &resp->code, .msg = &resp->msg, .data_key = "data", .schema = &file_schema, .data = &resp->data
+    };
     coze_response_t coze_response = {0};
-    coze_error_t err = make_http_request(req->api_base, req->api_token, path, "GET", NULL, &chunk, &coze_response);
+    const coze_error_t err = make_http_json_request(REQ_API_BASE(req), REQ_API_TOKEN(req), REQ_DEADLINE(req), path,
+                                                    "GET", NULL, &target, &coze_response);
     resp->response = coze_response;
-
-    if (err != COZE_OK) {
-        free(chunk.memory);
-        return err;
-    }
-
-    cJSON *json = cJSON_Parse(chunk.memory);
-    if (!json) {
-        free(chunk.memory);
-        return COZE_ERROR_API;
-    }
-
-    char *tmp_msg = NULL;
-    err = parse_response_code(json, &tmp_msg, &resp->code);
-    resp->msg = tmp_msg;
-    if (err != COZE_OK) {
-        cJSON_Delete(json);
-        free(chunk.memory);
-        return err;
-    }
-
-    // 解析数据
-    coze_file_t file_data = {0};
-    const cJSON *data = cJSON_GetObjectItem(json, "data");
-    if (data) {
-        const cJSON *id = cJSON_GetObjectItem(data, "id");
-        const cJSON *bytes = cJSON_GetObjectItem(data, "bytes");
-        const cJSON *created_at = cJSON_GetObjectItem(data, "created_at");
-        const cJSON *file_name = cJSON_GetObjectItem(data, "file_name");
-
-        file_data.id = id ? strdup(id->valuestring) : NULL;
-        file_data.file_name = file_name ? strdup(file_name->valuestring) : NULL;
-        file_data.created_at = created_at ? created_at->valueint : 0;
-        file_data.bytes = bytes ? bytes->valueint : 0;
-    }
-    resp->data = file_data;
-
-    cJSON_Delete(json);
-    free(chunk.memory);
-
-    return COZE_OK;
+    return err;
 }
 
 void coze_free_files_retrieve_response(coze_files_retrieve_response_t *resp) {
     if (!resp) return;
+    ALLOCATOR_SCOPE(resp->response.allocator);
 
-    free((void *) resp->msg);
+    coze_free((void *) resp->msg);
     coze_free_response(&resp->response);
     coze_free_file(&resp->data);
 }
@@ -2612,214 +6722,144 @@ void coze_free_files_retrieve_response(coze_files_retrieve_response_t *resp) {
 
 coze_error_t coze_workflows_runs_create(const coze_workflows_runs_create_request_t *req,
                                         coze_workflows_runs_create_response_t *resp) {
-    if (!req || !resp || !req->api_token || !req->workflow_id) {
+    if (!req || !resp || !REQ_API_TOKEN(req) || !req->workflow_id) {
         return COZE_ERROR_INVALID_PARAM;
     }
-
-    struct MemoryStruct chunk = {0};
-    chunk.memory = malloc(1);
-    chunk.size = 0;
+    ALLOCATOR_SCOPE(client_allocator(req->client));
+    char bot_id_buffer[ID_BUFFER_SIZE];
+    const char *req_bot_id = REQ_ID(req, bot_id, bot_id_buffer);
 
     char path[512];
     snprintf(path, sizeof(path), "/v1/workflow/run");
 
 
-    cJSON *body = cJSON_CreateObject();
+    struct json_writer body;
+    json_writer_begin(&body, req->client);
     if (req->workflow_id) {
-        cJSON_AddStringToObject(body, "workflow_id", req->workflow_id);
+        json_writer_string_field(&body, "workflow_id", req->workflow_id);
     }
-    if (req->bot_id) {
-        cJSON_AddStringToObject(body, "bot_id", req->bot_id);
+    if (req_bot_id) {
+        json_writer_string_field(&body, "bot_id", req_bot_id);
     }
     if (req->is_async) {
-        cJSON_AddBoolToObject(body, "is_async", req->is_async);
+        json_writer_bool_field(&body, "is_async", req->is_async);
     }
-    char *json_body = cJSON_PrintUnformatted(body);
-    cJSON_Delete(body);
+    const char *json_body = json_writer_finish(&body);
 
 
+    const struct json_target target = {
+        .code = &resp->code, .msg = &resp->msg, .schema = &workflow_run_result_schema, .data = &resp->data
+    };
     coze_response_t coze_response = {0};
-    coze_error_t err = make_http_request(req->api_base, req->api_token, path, "POST", json_body, &chunk,
-                                         &coze_response);
+    const coze_error_t err = make_http_json_request(REQ_API_BASE(req), REQ_API_TOKEN(req), REQ_DEADLINE(req), path,
+                                                    "POST", json_body, &target, &coze_response);
     resp->response = coze_response;
-    free(json_body);
-    if (err != COZE_OK) {
-        free(chunk.memory);
-        return err;
-    }
-
-    cJSON *json = cJSON_Parse(chunk.memory);
-    if (!json) {
-        free(chunk.memory);
-        return COZE_ERROR_API;
-    }
-
-    char *tmp_msg = NULL;
-    err = parse_response_code(json, &tmp_msg, &resp->code);
-    resp->msg = tmp_msg;
-    if (err != COZE_OK) {
-        cJSON_Delete(json);
-        free(chunk.memory);
-        return err;
-    }
-
-    // 解析数据
-    coze_workflow_run_result_t workflow_run_result = {0};
-    const cJSON *data = cJSON_GetObjectItem(json, "data");
-    const cJSON *debug_url = cJSON_GetObjectItem(json, "debug_url");
-    const cJSON *execute_id = cJSON_GetObjectItem(json, "execute_id");
-
-    workflow_run_result.data = data ? strdup(data->valuestring) : NULL;
-    workflow_run_result.debug_url = debug_url ? strdup(debug_url->valuestring) : NULL;
-    workflow_run_result.execute_id = execute_id ? strdup(execute_id->valuestring) : NULL;
-    resp->data = workflow_run_result;
-
-    cJSON_Delete(json);
-    free(chunk.memory);
-
-    return COZE_OK;
+    json_writer_release(&body);
+    return err;
 }
 
 void coze_free_workflows_runs_create_response(coze_workflows_runs_create_response_t *resp) {
     if (!resp) return;
+    ALLOCATOR_SCOPE(resp->response.allocator);
 
-    free((void *) resp->msg);
+    coze_free((void *) resp->msg);
     coze_free_response(&resp->response);
-    if (resp->data.data) {
-        free((void *) resp->data.data);
-    }
-    if (resp->data.debug_url) {
-        free((void *) resp->data.debug_url);
-    }
-    if (resp->data.execute_id) {
-        free((void *) resp->data.execute_id);
-    }
-}
-
-// Remove leading and trailing whitespace from a string
-void trim_whitespace(char *str) {
-    if (!str) return;
-
-    // Skip leading whitespace
-    char *start = str;
-    while (*start && (*start == ' ' || *start == '\n' || *start == '\r' || *start == '\t')) {
-        start++;
-    }
-
-    // If string is all whitespace
-    if (!*start) {
-        str[0] = '\0';
-        return;
-    }
-
-    // Move string to beginning if needed
-    if (start != str) {
-        memmove(str, start, strlen(start) + 1);
-    }
-
-    // Trim trailing whitespace
-    char *end = str + strlen(str) - 1;
-    while (end > str && (*end == ' ' || *end == '\n' || *end == '\r' || *end == '\t')) {
-        *end = '\0';
-        end--;
-    }
+    json_schema_free(&workflow_run_result_schema, &resp->data);
 }
 
-
 struct WorkflowSSECallbackContext {
     void (*callback)(const coze_workflow_event_t *workflow_event);
 };
 
-void workflow_stream_handler(const char *data, void *biz_ctx) {
-    printf("[coze_api] workflows.runs sse event: %s\n", data);
+static void free_workflow_event(coze_workflow_event_t *event) {
+    if (!event) return;
+
+    coze_free((void *) event->id);
+    coze_free((void *) event->event);
+    if (event->message) {
+        coze_free((void *) event->message->content);
+        coze_free((void *) event->message->node_title);
+        coze_free((void *) event->message->node_seq_id);
+        coze_free(event->message);
+    }
+    if (event->error) {
+        coze_free((void *) event->error->error_message);
+        coze_free(event->error);
+    }
+    if (event->interrupt) {
+        if (event->interrupt->interrupt_data) {
+            coze_free((void *) event->interrupt->interrupt_data->event_id);
+            coze_free(event->interrupt->interrupt_data);
+        }
+        coze_free((void *) event->interrupt->node_title);
+        coze_free(event->interrupt);
+    }
+    coze_free(event);
+}
 
+void workflow_stream_handler(const struct sse_event *sse, void *biz_ctx) {
     const struct WorkflowSSECallbackContext *ctx = (struct WorkflowSSECallbackContext *) biz_ctx;
-
-    char *id = NULL;
-    char *event = NULL;
-    char *sse_data = NULL;
-    char *line = (char *) data;
-    char *next_line;
-
-    // Parse event: or data: prefix
-    char *saveptr;
-    char *line_copy = strdup(line);
-    char *curr_line = strtok_r(line_copy, "\n", &saveptr);
-    while (curr_line) {
-        if (strncmp(curr_line, "id:", 3) == 0) {
-            id = strdup(curr_line + 3);
-            trim_whitespace(id);
-        } else if (strncmp(curr_line, "event:", 6) == 0) {
-            event = strdup(curr_line + 6);
-            trim_whitespace(event);
-        } else if (strncmp(curr_line, "data:", 5) == 0) {
-            sse_data = strdup(curr_line + 5);
-            while (sse_data[0] == ' ')
-                memmove(sse_data, sse_data + 1, strlen(sse_data));
-        }
-
-        curr_line = strtok_r(NULL, "\n", &saveptr);
-    }
-    free(line_copy);
+    const char *id = sse->id;
+    const char *event = sse->event;
+    const char *sse_data = sse->data;
+    COZE_LOG("workflows.runs sse event: id: %s, event: %s, data: %s\n", id ? id : "", event ? event : "",
+             sse_data ? sse_data : "");
 
     if (!event || !sse_data || !ctx || !ctx->callback) {
-        if (id) free(id);
-        if (event) free(event);
-        if (sse_data) free(sse_data);
         return;
     }
 
     // 在堆上创建事件
-    coze_workflow_event_t *event_data = calloc(1, sizeof(coze_workflow_event_t));
-    event_data->id = id ? strdup(id) : NULL;
-    event_data->event = event ? strdup(event) : NULL;
+    coze_workflow_event_t *event_data = coze_calloc(1, sizeof(coze_workflow_event_t));
+    event_data->id = id ? coze_strdup(id) : NULL;
+    event_data->event = event ? coze_strdup(event) : NULL;
 
     if (strcmp(event, COZE_WORKFLOW_EVENT_TYPE_DONE) == 0) {
         // return;
     } else if (strcmp(event, COZE_WORKFLOW_EVENT_TYPE_MESSAGE) == 0) {
-        cJSON *json_data = cJSON_Parse(sse_data);
+        cJSON *json_data = cjson_parse(sse_data);
         if (json_data) {
-            coze_workflow_event_message_t *message = calloc(1, sizeof(coze_workflow_event_message_t));
+            coze_workflow_event_message_t *message = coze_calloc(1, sizeof(coze_workflow_event_message_t));
             const cJSON *content = cJSON_GetObjectItem(json_data, "content");
             const cJSON *node_title = cJSON_GetObjectItem(json_data, "node_title");
             const cJSON *node_seq_id = cJSON_GetObjectItem(json_data, "node_seq_id");
             const cJSON *node_is_finish = cJSON_GetObjectItem(json_data, "node_is_finish");
             // const cJSON *ext = cJSON_GetObjectItem(json_data, "ext");
 
-            message->content = content ? strdup(content->valuestring) : NULL;
-            message->node_title = node_title ? strdup(node_title->valuestring) : NULL;
-            message->node_seq_id = node_seq_id ? strdup(node_seq_id->valuestring) : NULL;
+            message->content = content ? coze_strdup(content->valuestring) : NULL;
+            message->node_title = node_title ? coze_strdup(node_title->valuestring) : NULL;
+            message->node_seq_id = node_seq_id ? coze_strdup(node_seq_id->valuestring) : NULL;
             message->node_is_finish = node_is_finish ? node_is_finish->valueint : 0;
-            // message->ext = ext ? strdup(ext->valuestring) : NULL;
+            // message->ext = ext ? coze_strdup(ext->valuestring) : NULL;
 
             cJSON_Delete(json_data);
             event_data->message = message;
         }
     } else if (strcmp(event, COZE_WORKFLOW_EVENT_TYPE_ERROR) == 0) {
-        cJSON *json_data = cJSON_Parse(sse_data);
+        cJSON *json_data = cjson_parse(sse_data);
         if (json_data) {
-            coze_workflow_event_error_t *error = calloc(1, sizeof(coze_workflow_event_error_t));
+            coze_workflow_event_error_t *error = coze_calloc(1, sizeof(coze_workflow_event_error_t));
             const cJSON *error_code = cJSON_GetObjectItem(json_data, "error_code");
             const cJSON *error_message = cJSON_GetObjectItem(json_data, "error_message");
 
             error->error_code = error_code ? error_code->valueint : 0;
-            error->error_message = error_message ? strdup(error_message->valuestring) : NULL;
+            error->error_message = error_message ? coze_strdup(error_message->valuestring) : NULL;
 
             cJSON_Delete(json_data);
             event_data->error = error;
         }
     } else if (strcmp(event, COZE_WORKFLOW_EVENT_TYPE_INTERRUPT) == 0) {
-        cJSON *json_data = cJSON_Parse(sse_data);
+        cJSON *json_data = cjson_parse(sse_data);
         if (json_data) {
-            coze_workflow_event_interrupt_t *interrupt = calloc(1, sizeof(coze_workflow_event_interrupt_t));
+            coze_workflow_event_interrupt_t *interrupt = coze_calloc(1, sizeof(coze_workflow_event_interrupt_t));
             const cJSON *interrupt_data = cJSON_GetObjectItem(json_data, "interrupt_data");
             const cJSON *node_title = cJSON_GetObjectItem(json_data, "node_title");
 
             if (interrupt_data) {
-                coze_workflow_event_interrupt_data_t *interrupt_data_data = calloc(
+                coze_workflow_event_interrupt_data_t *interrupt_data_data = coze_calloc(
                     1, sizeof(coze_workflow_event_interrupt_data_t));
                 interrupt_data_data->event_id = cJSON_GetObjectItem(interrupt_data, "event_id")
-                                                    ? strdup(
+                                                    ? coze_strdup(
                                                         cJSON_GetObjectItem(interrupt_data, "event_id")->valuestring)
                                                     : NULL;
                 interrupt_data_data->type = cJSON_GetObjectItem(interrupt_data, "type")
@@ -2827,7 +6867,7 @@ void workflow_stream_handler(const char *data, void *biz_ctx) {
                                                 : 0;
                 interrupt->interrupt_data = interrupt_data_data;
             }
-            interrupt->node_title = node_title ? strdup(node_title->valuestring) : NULL;
+            interrupt->node_title = node_title ? coze_strdup(node_title->valuestring) : NULL;
 
             cJSON_Delete(json_data);
             event_data->interrupt = interrupt;
@@ -2835,45 +6875,48 @@ void workflow_stream_handler(const char *data, void *biz_ctx) {
     }
 
     if (ctx->callback) {
+        ALLOCATOR_SCOPE(NULL); // 用户回调中分配的内存不属于本客户端
         ctx->callback(event_data);
     }
 
-    // 释放临时数据
-    if (id) free(id);
-    if (event) free(event);
-    if (sse_data) free(sse_data);
+    // 事件只在回调期间有效, 回调返回后释放
+    free_workflow_event(event_data);
 }
 
 coze_error_t coze_workflows_runs_stream(const coze_workflows_runs_stream_request_t *req,
                                         coze_workflows_runs_stream_response_t *resp) {
-    if (!req || !resp || !req->api_token) {
+    if (!req || !resp || !REQ_API_TOKEN(req)) {
         return COZE_ERROR_INVALID_PARAM;
     }
+    ALLOCATOR_SCOPE(client_allocator(req->client));
+    char bot_id_buffer[ID_BUFFER_SIZE];
+    const char *req_bot_id = REQ_ID(req, bot_id, bot_id_buffer);
 
 
     const char *path = "/v1/workflow/stream_run";
 
 
-    cJSON *body = cJSON_CreateObject();
+    struct json_writer body;
+    json_writer_begin(&body, req->client);
     if (req->workflow_id) {
-        cJSON_AddStringToObject(body, "workflow_id", req->workflow_id);
+        json_writer_string_field(&body, "workflow_id", req->workflow_id);
     }
-    if (req->bot_id) {
-        cJSON_AddStringToObject(body, "bot_id", req->bot_id);
+    if (req_bot_id) {
+        json_writer_string_field(&body, "bot_id", req_bot_id);
     }
-    char *json_body = cJSON_PrintUnformatted(body);
-    cJSON_Delete(body);
+    const char *json_body = json_writer_finish(&body);
 
     coze_response_t coze_response = {0};
     struct WorkflowSSECallbackContext biz_ctx = {
         .callback = req->on_event,
     };
-    const coze_error_t err = make_http_sse_request(req->api_base, req->api_token, path, "POST", json_body,
+    const coze_error_t err = make_http_sse_request(REQ_API_BASE(req), REQ_API_TOKEN(req), REQ_DEADLINE(req), path,
+                                                   "POST", json_body,
                                                    workflow_stream_handler,
                                                    &biz_ctx,
                                                    &coze_response);
     resp->response = coze_response;
-    free(json_body);
+    json_writer_release(&body);
     if (err != COZE_OK) {
         return err;
     }
@@ -2890,42 +6933,47 @@ coze_error_t coze_workflows_runs_stream(const coze_workflows_runs_stream_request
 
 void coze_free_workflows_runs_stream_response(coze_workflows_runs_stream_response_t *resp) {
     if (!resp) return;
+    ALLOCATOR_SCOPE(resp->response.allocator);
 
     if (resp->msg && strlen(resp->msg) > 0) {
-        free((void *) resp->msg);
+        coze_free((void *) resp->msg);
     }
     coze_free_response(&resp->response);
 }
 
 coze_error_t coze_workflows_runs_resume(const coze_workflows_runs_resume_request_t *req,
                                         coze_workflows_runs_resume_response_t *resp) {
-    if (!req || !resp || !req->api_token) {
+    if (!req || !resp || !REQ_API_TOKEN(req)) {
         return COZE_ERROR_INVALID_PARAM;
     }
+    ALLOCATOR_SCOPE(client_allocator(req->client));
+    char bot_id_buffer[ID_BUFFER_SIZE];
+    const char *req_bot_id = REQ_ID(req, bot_id, bot_id_buffer);
 
     const char *path = "/v1/workflow/stream_resume";
 
 
-    cJSON *body = cJSON_CreateObject();
+    struct json_writer body;
+    json_writer_begin(&body, req->client);
     if (req->workflow_id) {
-        cJSON_AddStringToObject(body, "workflow_id", req->workflow_id);
+        json_writer_string_field(&body, "workflow_id", req->workflow_id);
     }
-    if (req->bot_id) {
-        cJSON_AddStringToObject(body, "bot_id", req->bot_id);
+    if (req_bot_id) {
+        json_writer_string_field(&body, "bot_id", req_bot_id);
     }
-    char *json_body = cJSON_PrintUnformatted(body);
-    cJSON_Delete(body);
+    const char *json_body = json_writer_finish(&body);
 
     coze_response_t coze_response = {0};
     struct WorkflowSSECallbackContext biz_ctx = {
         .callback = req->on_event,
     };
-    const coze_error_t err = make_http_sse_request(req->api_base, req->api_token, path, "POST", json_body,
+    const coze_error_t err = make_http_sse_request(REQ_API_BASE(req), REQ_API_TOKEN(req), REQ_DEADLINE(req), path,
+                                                   "POST", json_body,
                                                    workflow_stream_handler,
                                                    &biz_ctx,
                                                    &coze_response);
     resp->response = coze_response;
-    free(json_body);
+    json_writer_release(&body);
     if (err != COZE_OK) {
         return err;
     }
@@ -2942,22 +6990,20 @@ coze_error_t coze_workflows_runs_resume(const coze_workflows_runs_resume_request
 
 void coze_free_workflows_runs_resume_response(coze_workflows_runs_resume_response_t *resp) {
     if (!resp) return;
+    ALLOCATOR_SCOPE(resp->response.allocator);
 
     if (resp->msg && strlen(resp->msg) > 0) {
-        free((void *) resp->msg);
+        coze_free((void *) resp->msg);
     }
     coze_free_response(&resp->response);
 }
 
 coze_error_t coze_audio_voices_list(const coze_audio_voices_list_request_t *req,
                                     coze_audio_voices_list_response_t *resp) {
-    if (!req || !resp || !req->api_token) {
+    if (!req || !resp || !REQ_API_TOKEN(req)) {
         return COZE_ERROR_INVALID_PARAM;
     }
-
-    struct MemoryStruct chunk = {0};
-    chunk.memory = malloc(1);
-    chunk.size = 0;
+    ALLOCATOR_SCOPE(client_allocator(req->client));
 
     const int page_size = req->page_size ? req->page_size : 100;
     const int page_num = req->page_num ? req->page_num : 1;
@@ -2967,290 +7013,129 @@ coze_error_t coze_audio_voices_list(const coze_audio_voices_list_request_t *req,
     snprintf(path, sizeof(path), "/v1/audio/voices?page_size=%d&page_num=%d&filter_system_voice=%s", page_size,
              page_num, filter_system_voice);
 
+    const struct json_target target = {
+        .code = &resp->code, .msg = &resp->msg, .data_key = "data", .schema = &voices_list_data_schema,
+        .data = &resp->data, .zero_copy = req->zero_copy, .client = req->client
+    };
     coze_response_t coze_response = {0};
-    coze_error_t err = make_http_request(req->api_base, req->api_token, path, "GET", NULL, &chunk, &coze_response);
+    const coze_error_t err = make_http_json_request(REQ_API_BASE(req), REQ_API_TOKEN(req), REQ_DEADLINE(req), path,
+                                                    "GET", NULL, &target, &coze_response);
     resp->response = coze_response;
-
-    if (err != COZE_OK) {
-        free(chunk.memory);
-        return err;
-    }
-
-    cJSON *json = cJSON_Parse(chunk.memory);
-    if (!json) {
-        free(chunk.memory);
-        return COZE_ERROR_API;
-    }
-
-    char *tmp_msg = NULL;
-    err = parse_response_code(json, &tmp_msg, &resp->code);
-    resp->msg = tmp_msg;
-    if (err != COZE_OK) {
-        cJSON_Delete(json);
-        free(chunk.memory);
-        return err;
-    }
-
-    // 解析数据
-    coze_audio_voices_list_data_t voices_data = {0};
-    cJSON *data = cJSON_GetObjectItem(json, "data");
-    if (data) {
-        const cJSON *has_more = cJSON_GetObjectItem(data, "has_more");
-        const cJSON *voice_list = cJSON_GetObjectItem(data, "voice_list");
-        const int voices_count = cJSON_GetArraySize(voice_list);
-
-        voices_data.voices_count = voices_count;
-        voices_data.voices = calloc(voices_count, sizeof(coze_voice_t));
-        voices_data.has_more = has_more ? has_more->valueint : 0;
-
-        for (int i = 0; i < voices_count; i++) {
-            const cJSON *voice = cJSON_GetArrayItem(voice_list, i);
-            if (voice) {
-                const cJSON *preview_audio = cJSON_GetObjectItem(voice, "preview_audio");
-                const cJSON *language_name = cJSON_GetObjectItem(voice, "language_name");
-                const cJSON *is_system_voice = cJSON_GetObjectItem(voice, "is_system_voice");
-                const cJSON *preview_text = cJSON_GetObjectItem(voice, "preview_text");
-                const cJSON *create_time = cJSON_GetObjectItem(voice, "create_time");
-                const cJSON *update_time = cJSON_GetObjectItem(voice, "update_time");
-                const cJSON *name = cJSON_GetObjectItem(voice, "name");
-                const cJSON *language_code = cJSON_GetObjectItem(voice, "language_code");
-                const cJSON *voice_id = cJSON_GetObjectItem(voice, "voice_id");
-                const cJSON *available_training_times = cJSON_GetObjectItem(voice, "available_training_times");
-
-                voices_data.voices[i].preview_audio = preview_audio ? strdup(preview_audio->valuestring) : NULL;
-                voices_data.voices[i].language_name = language_name ? strdup(language_name->valuestring) : NULL;
-                voices_data.voices[i].is_system_voice = is_system_voice ? is_system_voice->valueint : 0;
-                voices_data.voices[i].preview_text = preview_text ? strdup(preview_text->valuestring) : NULL;
-                voices_data.voices[i].create_time = create_time ? create_time->valueint : 0;
-                voices_data.voices[i].update_time = update_time ? update_time->valueint : 0;
-                voices_data.voices[i].name = name ? strdup(name->valuestring) : NULL;
-                voices_data.voices[i].language_code = language_code ? strdup(language_code->valuestring) : NULL;
-                voices_data.voices[i].voice_id = voice_id ? strdup(voice_id->valuestring) : NULL;
-                voices_data.voices[i].available_training_times = available_training_times
-                                                                     ? available_training_times->valueint
-                                                                     : 0;
-            }
-        }
-    }
-    resp->data = voices_data;
-
-    cJSON_Delete(json);
-    free(chunk.memory);
-
-    return COZE_OK;
+    return err;
 }
 
 void coze_free_audio_voices_list_response(coze_audio_voices_list_response_t *resp) {
     if (!resp) return;
+    ALLOCATOR_SCOPE(resp->response.allocator);
 
-    free((void *) resp->msg);
+    coze_free((void *) resp->msg);
     coze_free_response(&resp->response);
-    for (int i = 0; i < resp->data.voices_count; i++) {
-        coze_free_voice(&resp->data.voices[i]);
-    }
-    free(resp->data.voices);
+    json_schema_free(&voices_list_data_schema, &resp->data);
 }
 
 coze_error_t coze_audio_rooms_create(const coze_audio_rooms_create_request_t *req,
                                      coze_audio_rooms_create_response_t *resp) {
-    if (!req || !resp || !req->api_token || !req->bot_id) {
+    if (!req || !resp || !REQ_API_TOKEN(req) || !REQ_HAS_ID(req, bot_id)) {
         return COZE_ERROR_INVALID_PARAM;
     }
-
-    struct MemoryStruct chunk = {0};
-    chunk.memory = malloc(1);
-    chunk.size = 0;
+    ALLOCATOR_SCOPE(client_allocator(req->client));
+    char bot_id_buffer[ID_BUFFER_SIZE];
+    const char *req_bot_id = REQ_ID(req, bot_id, bot_id_buffer);
+    char conversation_id_buffer[ID_BUFFER_SIZE];
+    const char *req_conversation_id = REQ_ID(req, conversation_id, conversation_id_buffer);
 
     const char *path = "/v1/audio/rooms";
 
-    cJSON *body = cJSON_CreateObject();
-    if (req->bot_id) {
-        cJSON_AddStringToObject(body, "bot_id", req->bot_id);
+    struct json_writer body;
+    json_writer_begin(&body, req->client);
+    if (req_bot_id) {
+        json_writer_string_field(&body, "bot_id", req_bot_id);
     }
-    if (req->conversation_id) {
-        cJSON_AddStringToObject(body, "conversation_id", req->conversation_id);
+    if (req_conversation_id) {
+        json_writer_string_field(&body, "conversation_id", req_conversation_id);
     }
     if (req->voice_id) {
-        cJSON_AddStringToObject(body, "voice_id", req->voice_id);
+        json_writer_string_field(&body, "voice_id", req->voice_id);
     }
-    char *json_body = cJSON_PrintUnformatted(body);
-    cJSON_Delete(body);
+    const char *json_body = json_writer_finish(&body);
 
 
+    const struct json_target target = {
+        .code = &resp->code, .msg = &resp->msg, .data_key = "data", .schema = &audio_room_schema, .data = &resp->data
+    };
     coze_response_t coze_response = {0};
-    coze_error_t err = make_http_request(req->api_base, req->api_token, path, "POST", json_body, &chunk,
-                                         &coze_response);
+    const coze_error_t err = make_http_json_request(REQ_API_BASE(req), REQ_API_TOKEN(req), REQ_DEADLINE(req), path,
+                                                    "POST", json_body, &target, &coze_response);
     resp->response = coze_response;
-    free(json_body);
-
-    if (err != COZE_OK) {
-        free(chunk.memory);
-        return err;
-    }
-
-    cJSON *json = cJSON_Parse(chunk.memory);
-    if (!json) {
-        free(chunk.memory);
-        return COZE_ERROR_API;
-    }
-
-    char *tmp_msg = NULL;
-    err = parse_response_code(json, &tmp_msg, &resp->code);
-    resp->msg = tmp_msg;
-    if (err != COZE_OK) {
-        cJSON_Delete(json);
-        free(chunk.memory);
-        return err;
-    }
-
-    // 解析数据
-    cJSON *data = cJSON_GetObjectItem(json, "data");
-    if (data) {
-        const cJSON *room_id = cJSON_GetObjectItem(data, "room_id");
-        const cJSON *app_id = cJSON_GetObjectItem(data, "app_id");
-        const cJSON *token = cJSON_GetObjectItem(data, "token");
-        const cJSON *uid = cJSON_GetObjectItem(data, "uid");
-
-        resp->data.room_id = room_id ? strdup(room_id->valuestring) : NULL;
-        resp->data.app_id = app_id ? strdup(app_id->valuestring) : NULL;
-        resp->data.token = token ? strdup(token->valuestring) : NULL;
-        resp->data.uid = uid ? strdup(uid->valuestring) : NULL;
-    }
-
-    cJSON_Delete(json);
-    free(chunk.memory);
-
-    return COZE_OK;
+    json_writer_release(&body);
+    return err;
 }
 
 void coze_free_audio_rooms_create_response(coze_audio_rooms_create_response_t *resp) {
     if (!resp) return;
+    ALLOCATOR_SCOPE(resp->response.allocator);
 
-    free((void *) resp->msg);
+    coze_free((void *) resp->msg);
     coze_free_response(&resp->response);
-    free((void *) resp->data.token);
-    free((void *) resp->data.room_id);
-    free((void *) resp->data.app_id);
-    free((void *) resp->data.uid);
+    json_schema_free(&audio_room_schema, &resp->data);
 }
 
 void coze_free_response(coze_response_t *resp) {
     if (!resp) return;
 
-    free((void *) resp->logid);
+    coze_free((void *) resp->logid);
 }
 
 void coze_free_bot(coze_bot_t *bot) {
     if (!bot) return;
 
-    if (bot->bot_id) {
-        free((void *) bot->bot_id);
-    }
-    if (bot->name) {
-        free((void *) bot->name);
-    }
-    if (bot->description) {
-        free((void *) bot->description);
-    }
-    if (bot->icon_url) {
-        free((void *) bot->icon_url);
-    }
-    if (bot->version) {
-        free((void *) bot->version);
-    }
+    json_schema_free(&bot_schema, bot);
 }
 
 void coze_free_conversation(coze_conversation_t *conversation) {
     if (!conversation) return;
 
-    free((void *) conversation->id);
-    free((void *) conversation->last_section_id);
+    json_schema_free(&conversation_schema, conversation);
 }
 
 void coze_free_message(coze_message_t *message) {
     if (!message) return;
 
-    free((void *) message->id);
-    free((void *) message->conversation_id);
-    free((void *) message->bot_id);
-    free((void *) message->chat_id);
-    free((void *) message->role);
-    free((void *) message->content);
-    free((void *) message->content_type);
-    free((void *) message->type);
+    json_schema_free(&message_schema, message);
 }
 
 void coze_free_chat(coze_chat_t *chat) {
     if (!chat) return;
 
-    free((void *) chat->id);
-    free((void *) chat->conversation_id);
-    free((void *) chat->bot_id);
-    free((void *) chat->status);
-    free((void *) chat->last_error.msg);
-    free((void *) chat->required_action.type);
+    json_schema_free(&chat_schema, chat);
+    coze_free((void *) chat->required_action.type);
     for (int i = 0; i < chat->required_action.submit_tool_outputs.tool_calls_count; i++) {
-        free((void *) chat->required_action.submit_tool_outputs.tool_calls[i].function->name);
-        free((void *) chat->required_action.submit_tool_outputs.tool_calls[i].function->arguments);
+        coze_free((void *) chat->required_action.submit_tool_outputs.tool_calls[i].function->name);
+        coze_free((void *) chat->required_action.submit_tool_outputs.tool_calls[i].function->arguments);
     }
-    free(chat->required_action.submit_tool_outputs.tool_calls);
+    coze_free(chat->required_action.submit_tool_outputs.tool_calls);
 }
 
 void coze_free_file(coze_file_t *file) {
     if (!file) return;
 
-    free((void *) file->id);
-    free((void *) file->file_name);
+    json_schema_free(&file_schema, file);
 }
 
 void coze_free_voice(coze_voice_t *voice) {
     if (!voice) return;
 
-
-    if (voice->preview_audio && strlen(voice->preview_audio) > 0) {
-        free((void *) voice->preview_audio);
-    }
-    if (voice->language_name && strlen(voice->language_name) > 0) {
-        free((void *) voice->language_name);
-    }
-    if (voice->preview_text && strlen(voice->preview_text) > 0) {
-        free((void *) voice->preview_text);
-    }
-    if (voice->name && strlen(voice->name) > 0) {
-        free((void *) voice->name);
-    }
-    if (voice->language_code && strlen(voice->language_code) > 0) {
-        free((void *) voice->language_code);
-    }
-    if (voice->voice_id && strlen(voice->voice_id) > 0) {
-        free((void *) voice->voice_id);
-    }
+    json_schema_free(&voice_schema, voice);
 }
 
 void coze_free_oauth_token(coze_oauth_token_t *token) {
     if (!token) return;
 
-    if (token->access_token && strlen(token->access_token) > 0) {
-        free((void *) token->access_token);
-    }
-    if (token->refresh_token && strlen(token->refresh_token) > 0) {
-        free((void *) token->refresh_token);
-    }
-    if (token->token_type && strlen(token->token_type) > 0) {
-        free((void *) token->token_type);
-    }
+    json_schema_free(&oauth_token_schema, token);
 }
 
 void coze_free_bots_list_data(coze_bots_list_data_t *data) {
     if (!data) return;
 
-    for (int i = 0; i < data->space_bot_count; i++) {
-        free((void *) data->space_bots[i].bot_id);
-        free((void *) data->space_bots[i].bot_name);
-        free((void *) data->space_bots[i].description);
-        free((void *) data->space_bots[i].icon_url);
-        free((void *) data->space_bots[i].publish_time);
-    }
-
-    free(data->space_bots);
+    json_schema_free(&bots_list_data_schema, data);
 }